@@ -0,0 +1,793 @@
+#include "AssetRegistry.h"
+#include "GeometryArena.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include <wincodec.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdio.h>
+#include <wctype.h>
+
+// For WIC's imaging factory, used to decode textures on worker threads
+#pragma comment(lib, "windowscodecs.lib")
+
+// Singleton requirement
+AssetRegistry* AssetRegistry::instance;
+
+// Mesh loads through the ANSI file functions, so widen the same way
+static std::wstring WidenPath(const std::string& path)
+{
+	std::wstring widePath(MultiByteToWideChar(CP_ACP, 0, path.c_str(), -1, 0, 0), L'\0');
+	MultiByteToWideChar(CP_ACP, 0, path.c_str(), -1, &widePath[0], (int)widePath.size());
+	widePath.resize(wcslen(widePath.c_str()));
+	return widePath;
+}
+
+AssetRegistry::AssetRegistry()
+{
+	nextId = 0;
+	stats = {};
+	pendingLoads = 0;
+	batchLoads = 0;
+}
+
+AssetRegistry::~AssetRegistry()
+{
+}
+
+void AssetRegistry::Initialize(std::shared_ptr<RenderContext> context)
+{
+	this->context = context;
+}
+
+std::shared_ptr<Mesh> AssetRegistry::LoadMesh(const std::string& path, bool packed)
+{
+	std::wstring fullPath = NormalizePath(WidenPath(path));
+	std::wstring key = MakeKey(fullPath, AssetType::Mesh, packed);
+
+	unsigned int id = FindByPath(key);
+	if (id != NotFound)
+		return assets[id].LoadedMesh;
+
+	// An up to date mesh cache already knows the contents' hash,
+	// so copies can be found without reading the OBJ at all
+	unsigned long long hash;
+	bool cached = Mesh::GetCachedSourceHash(path.c_str(), hash);
+	if (cached)
+	{
+		id = FindByContent(key, hash, AssetType::Mesh, packed);
+		if (id != NotFound)
+			return assets[id].LoadedMesh;
+	}
+
+	// Otherwise the mesh reads and hashes the file once, while loading it
+	std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(path.c_str(), packed);
+	if (mesh->GetIndexCount() == 0)
+		return 0;
+
+	hash = mesh->GetSourceHash();
+	if (!cached)
+	{
+		id = FindByContent(key, hash, AssetType::Mesh, packed);
+		if (id != NotFound)
+			return assets[id].LoadedMesh;
+	}
+
+	Asset& asset = assets[Add(key, fullPath, AssetType::Mesh, packed, hash)];
+	asset.LoadedMesh = mesh;
+	asset.Bytes = mesh->GetMemoryFootprint();
+	return mesh;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::LoadTexture(const std::wstring& path)
+{
+	return LoadTextureAsset(path, AssetType::Texture);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::LoadCubeMap(const std::wstring& path)
+{
+	return LoadTextureAsset(path, AssetType::CubeMap);
+}
+
+std::shared_future<std::shared_ptr<Mesh>> AssetRegistry::LoadMeshAsync(const std::string& path, bool packed,
+	std::function<void(std::shared_ptr<Mesh>)> onLoaded)
+{
+	std::wstring fullPath = NormalizePath(WidenPath(path));
+	std::wstring key = MakeKey(fullPath, AssetType::Mesh, packed);
+
+	unsigned int id = FindByPath(key);
+	if (id != NotFound)
+	{
+		if (onLoaded)
+			onLoaded(assets[id].LoadedMesh);
+		return MakeReadyFuture(assets[id].LoadedMesh);
+	}
+
+	std::shared_future<std::shared_ptr<Mesh>> future;
+	if (!Wait(pendingMeshes, key, onLoaded, future))
+	{
+		stats.PathHits++;
+		return future;
+	}
+
+	// Parse (or map the cache) on a worker, leaving the upload for later
+	StartLoad();
+	ThreadPool::GetInstance().Enqueue([this, path, fullPath, key, packed]()
+	{
+		// The mesh only reads and hashes the file if its cache is out of date
+		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(path.c_str(), packed, true);
+		unsigned long long hash = mesh->GetSourceHash();
+		if (mesh->GetIndexCount() == 0)
+			mesh = 0;
+
+		// Moved, so the worker holds no reference once the completion is
+		// queued; otherwise UnloadUnused right after WaitForLoads could
+		// see one and keep the mesh
+		Complete([this, fullPath, key, packed, hash, mesh = std::move(mesh)]()
+		{
+			std::shared_ptr<Mesh> result;
+			if (mesh)
+			{
+				// Something else may have loaded it in the meantime
+				auto loaded = byPath.find(key);
+				unsigned int id = loaded != byPath.end() ? loaded->second : FindByContent(key, hash, AssetType::Mesh, packed);
+				if (id != NotFound)
+				{
+					result = assets[id].LoadedMesh;
+				}
+				else
+				{
+					mesh->Upload();
+					Asset& asset = assets[Add(key, fullPath, AssetType::Mesh, packed, hash)];
+					asset.LoadedMesh = mesh;
+					asset.Bytes = mesh->GetMemoryFootprint();
+					result = mesh;
+				}
+			}
+
+			Fulfil(pendingMeshes, key, result);
+			FinishLoad();
+		});
+	});
+
+	return future;
+}
+
+std::shared_future<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> AssetRegistry::LoadTextureAsync(const std::wstring& path,
+	std::function<void(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>)> onLoaded)
+{
+	return LoadTextureAssetAsync(path, AssetType::Texture, onLoaded);
+}
+
+std::shared_future<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> AssetRegistry::LoadCubeMapAsync(const std::wstring& path,
+	std::function<void(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>)> onLoaded)
+{
+	return LoadTextureAssetAsync(path, AssetType::CubeMap, onLoaded);
+}
+
+void AssetRegistry::ProcessCompletedLoads()
+{
+	std::vector<std::function<void()>> finished;
+	{
+		std::lock_guard<std::mutex> lock(completedMutex);
+		finished.swap(completed);
+	}
+
+	for (auto& finish : finished)
+		finish();
+}
+
+void AssetRegistry::WaitForLoads()
+{
+	while (pendingLoads > 0)
+	{
+		{
+			std::unique_lock<std::mutex> lock(completedMutex);
+			completedAvailable.wait(lock, [this]() { return !completed.empty(); });
+		}
+		ProcessCompletedLoads();
+	}
+}
+
+unsigned int AssetRegistry::GetPendingLoadCount()
+{
+	return pendingLoads;
+}
+
+std::shared_ptr<Mesh> AssetRegistry::GetPlaceholderMesh(bool packed)
+{
+	std::shared_ptr<Mesh>& placeholder = placeholderMeshes[packed ? 1 : 0];
+	if (placeholder)
+		return placeholder;
+
+	// A corner on each side of each axis (+x, -x, +y, -y, +z, -z)
+	Vertex vertices[6] = {};
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			Vertex& vertex = vertices[axis * 2 + side];
+			float sign = side == 0 ? 1.0f : -1.0f;
+			(&vertex.Position.x)[axis] = sign * 0.5f;
+			(&vertex.Normal.x)[axis] = sign;
+			vertex.UV = DirectX::XMFLOAT2(0.5f + 0.5f * vertex.Normal.x, 0.5f - 0.5f * vertex.Normal.y);
+		}
+	}
+
+	// One face per octant, wound clockwise when seen from outside
+	unsigned int indices[24];
+	int index = 0;
+	for (int octant = 0; octant < 8; octant++)
+	{
+		unsigned int x = octant & 1, y = 2 + ((octant >> 1) & 1), z = 4 + ((octant >> 2) & 1);
+		bool flip = ((octant & 1) + ((octant >> 1) & 1) + ((octant >> 2) & 1)) % 2 == 1;
+		indices[index++] = y;
+		indices[index++] = flip ? x : z;
+		indices[index++] = flip ? z : x;
+	}
+
+	placeholder = std::make_shared<Mesh>(vertices, 6, indices, 24, packed);
+	return placeholder;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::GetPlaceholderTexture(DirectX::XMFLOAT4 color)
+{
+	auto channel = [](float value) { return (unsigned int)((value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value) * 255.0f + 0.5f); };
+	unsigned int rgba = channel(color.x) | channel(color.y) << 8 | channel(color.z) << 16 | channel(color.w) << 24;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& placeholder = placeholderTextures[rgba];
+	if (!placeholder)
+		placeholder = CreateSolidTexture(rgba, false);
+	return placeholder;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::GetPlaceholderCubeMap()
+{
+	if (!placeholderCubeMap)
+		placeholderCubeMap = CreateSolidTexture(0xFF808080, true);
+	return placeholderCubeMap;
+}
+
+unsigned int AssetRegistry::UnloadUnused()
+{
+	std::vector<unsigned int> unused;
+	for (auto& entry : assets)
+	{
+		if (GetReferences(entry.second) == 0)
+			unused.push_back(entry.first);
+	}
+	if (unused.empty())
+		return 0;
+
+	// Forget every path and hash that led to them
+	auto isUnused = [&](unsigned int id) { return std::find(unused.begin(), unused.end(), id) != unused.end(); };
+	for (auto i = byPath.begin(); i != byPath.end();)
+	{
+		if (isUnused(i->second))
+			i = byPath.erase(i);
+		else
+			++i;
+	}
+	for (auto i = byContent.begin(); i != byContent.end();)
+	{
+		if (isUnused(i->second))
+			i = byContent.erase(i);
+		else
+			++i;
+	}
+
+	for (unsigned int id : unused)
+		assets.erase(id);
+	return (unsigned int)unused.size();
+}
+
+std::vector<AssetInfo> AssetRegistry::GetResidentAssets()
+{
+	std::vector<AssetInfo> resident;
+	resident.reserve(assets.size());
+	for (auto& entry : assets)
+	{
+		const Asset& asset = entry.second;
+		AssetInfo info = {};
+		info.Type = asset.Type;
+		info.Path = asset.Path;
+		info.Aliases = asset.Aliases;
+		info.ContentHash = asset.ContentHash;
+		info.References = GetReferences(asset);
+		info.Bytes = asset.Bytes;
+		resident.push_back(info);
+	}
+
+	std::sort(resident.begin(), resident.end(),
+		[](const AssetInfo& a, const AssetInfo& b) { return a.Bytes > b.Bytes; });
+	return resident;
+}
+
+unsigned long long AssetRegistry::GetResidentBytes()
+{
+	unsigned long long bytes = 0;
+	for (auto& entry : assets)
+		bytes += entry.second.Bytes;
+	return bytes;
+}
+
+void AssetRegistry::PrintResidencyReport()
+{
+	static const char* typeNames[] = { "mesh", "texture", "cube map" };
+
+	std::vector<AssetInfo> resident = GetResidentAssets();
+	printf("Resident assets: %d (%.2f MB), %d loads, %d path hits, %d content hits\n",
+		(int)resident.size(), GetResidentBytes() / (1024.0 * 1024.0), stats.Loads, stats.PathHits, stats.ContentHits);
+
+	for (const AssetInfo& info : resident)
+	{
+		printf("  %-8s %10.1f KB  %2ld refs  %016llx  %ls", typeNames[(int)info.Type],
+			info.Bytes / 1024.0, info.References, info.ContentHash, info.Path.c_str());
+		if (info.Aliases > 0)
+			printf(" (+%d aliases)", info.Aliases);
+		printf("\n");
+	}
+
+	// Every resident mesh's data lives here, and unloads leave holes
+	GeometryArena::GetInstance().PrintReport();
+}
+
+AssetRegistryStats AssetRegistry::GetStats()
+{
+	return stats;
+}
+
+AssetRegistry::ContentKey AssetRegistry::MakeContentKey(unsigned long long hash, AssetType type, bool packed)
+{
+	return ContentKey(hash, (unsigned int)type * 2 + (packed ? 1 : 0));
+}
+
+// --------------------------------------------------------
+// Makes the path absolute (resolving any "." and "..") and
+// lower case with backslashes, so every spelling of a file
+// ends up the same
+// --------------------------------------------------------
+std::wstring AssetRegistry::NormalizePath(const std::wstring& path)
+{
+	std::wstring normalized = path;
+	DWORD length = GetFullPathNameW(path.c_str(), 0, 0, 0);
+	if (length > 0)
+	{
+		normalized.resize(length);
+		length = GetFullPathNameW(path.c_str(), length, &normalized[0], 0);
+		normalized.resize(length);
+	}
+
+	for (wchar_t& c : normalized)
+		c = c == L'/' ? L'\\' : (wchar_t)towlower(c);
+	return normalized;
+}
+
+bool AssetRegistry::ReadContents(const std::wstring& path, std::vector<char>& data)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !data.empty();
+}
+
+// Keys for byPath, which tell apart the ways a file can be loaded
+std::wstring AssetRegistry::MakeKey(const std::wstring& path, AssetType type, bool packed)
+{
+	if (type == AssetType::CubeMap)
+		return path + L"|cube";
+	return packed ? path + L"|packed" : path;
+}
+
+// --------------------------------------------------------
+// Whether an image's metadata says it's sRGB, checked the
+// same way DirectXTK's WIC loader does
+// --------------------------------------------------------
+static bool IsSRGB(IWICBitmapDecoder* decoder, IWICBitmapFrameDecode* frame)
+{
+	Microsoft::WRL::ComPtr<IWICMetadataQueryReader> reader;
+	GUID container;
+	if (FAILED(frame->GetMetadataQueryReader(reader.GetAddressOf())) || FAILED(decoder->GetContainerFormat(&container)))
+		return false;
+
+	bool srgb = false;
+	PROPVARIANT value;
+	PropVariantInit(&value);
+	if (container == GUID_ContainerFormatPng)
+	{
+		// An sRGB chunk, or a gamma chunk with sRGB's gamma
+		if (SUCCEEDED(reader->GetMetadataByName(L"/sRGB/RenderingIntent", &value)) && value.vt == VT_UI1)
+			srgb = true;
+		else if (SUCCEEDED(reader->GetMetadataByName(L"/gAMA/ImageGamma", &value)) && value.vt == VT_UI4)
+			srgb = value.uintVal == 45455;
+	}
+	else if (SUCCEEDED(reader->GetMetadataByName(L"System.Image.ColorSpace", &value)) && value.vt == VT_UI2)
+	{
+		srgb = value.uiVal == 1;
+	}
+	PropVariantClear(&value);
+	return srgb;
+}
+
+// --------------------------------------------------------
+// Decodes an image file's contents with WIC, which is safe
+// on any thread.  Grayscale images stay a single channel,
+// and everything else becomes 8-bit RGBA.
+// --------------------------------------------------------
+bool AssetRegistry::DecodeImage(const std::vector<char>& data, DecodedImage& image)
+{
+	// Worker threads haven't necessarily initialized COM
+	HRESULT com = CoInitializeEx(0, COINIT_MULTITHREADED);
+
+	bool decoded = false;
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICStream> stream;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf())))
+			&& SUCCEEDED(factory->CreateStream(stream.GetAddressOf()))
+			&& SUCCEEDED(stream->InitializeFromMemory((BYTE*)data.data(), (DWORD)data.size()))
+			&& SUCCEEDED(factory->CreateDecoderFromStream(stream.Get(), 0, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf()))
+			&& SUCCEEDED(decoder->GetFrame(0, frame.GetAddressOf()))
+			&& SUCCEEDED(frame->GetSize(&image.Width, &image.Height)))
+		{
+			WICPixelFormatGUID sourceFormat;
+			bool gray = SUCCEEDED(frame->GetPixelFormat(&sourceFormat)) && sourceFormat == GUID_WICPixelFormat8bppGray;
+			if (gray)
+				image.Format = DXGI_FORMAT_R8_UNORM;
+			else
+				image.Format = IsSRGB(decoder.Get(), frame.Get()) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+
+			image.RowPitch = image.Width * (gray ? 1 : 4);
+			image.Pixels.resize((size_t)image.RowPitch * image.Height);
+			UINT size = (UINT)image.Pixels.size();
+
+			if (gray)
+			{
+				decoded = SUCCEEDED(frame->CopyPixels(0, image.RowPitch, size, image.Pixels.data()));
+			}
+			else
+			{
+				Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+				decoded = SUCCEEDED(factory->CreateFormatConverter(converter.GetAddressOf()))
+					&& SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, 0, 0.0, WICBitmapPaletteTypeMedianCut))
+					&& SUCCEEDED(converter->CopyPixels(0, image.RowPitch, size, image.Pixels.data()));
+			}
+		}
+	}
+
+	if (SUCCEEDED(com))
+		CoUninitialize();
+	return decoded;
+}
+
+// --------------------------------------------------------
+// Size of a texture's data across its mip levels and array
+// slices (six for a cube map)
+// --------------------------------------------------------
+unsigned long long AssetRegistry::GetTextureBytes(ID3D11ShaderResourceView* srv)
+{
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+	srv->GetResource(resource.GetAddressOf());
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(resource.As(&texture)))
+		return 0;
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+
+	// Block compressed formats store 4x4 blocks of 8 or 16 bytes
+	unsigned int blockBytes = 0;
+	unsigned int pixelBytes = 4;
+	switch (desc.Format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+		blockBytes = 8;
+		break;
+	case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+		blockBytes = 16;
+		break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		pixelBytes = 16;
+		break;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM:
+		pixelBytes = 8;
+		break;
+	case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_R16_UNORM:
+		pixelBytes = 2;
+		break;
+	case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM:
+		pixelBytes = 1;
+		break;
+	default:
+		break;
+	}
+
+	unsigned long long bytes = 0;
+	for (unsigned int mip = 0; mip < desc.MipLevels; mip++)
+	{
+		unsigned long long width = desc.Width >> mip > 0 ? desc.Width >> mip : 1;
+		unsigned long long height = desc.Height >> mip > 0 ? desc.Height >> mip : 1;
+		if (blockBytes > 0)
+			bytes += ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+		else
+			bytes += width * height * pixelBytes;
+	}
+	return bytes * desc.ArraySize;
+}
+
+// --------------------------------------------------------
+// References held outside the registry.  Textures count
+// COM references, which includes pipeline bindings.
+// --------------------------------------------------------
+long AssetRegistry::GetReferences(const Asset& asset)
+{
+	if (asset.LoadedMesh)
+		return asset.LoadedMesh.use_count() - 1;
+
+	if (asset.LoadedTexture)
+	{
+		asset.LoadedTexture->AddRef();
+		return (long)asset.LoadedTexture->Release() - 1;
+	}
+
+	return 0;
+}
+
+unsigned int AssetRegistry::FindByPath(const std::wstring& key)
+{
+	auto entry = byPath.find(key);
+	if (entry == byPath.end())
+		return NotFound;
+
+	stats.PathHits++;
+	return entry->second;
+}
+
+unsigned int AssetRegistry::FindByContent(const std::wstring& key, unsigned long long hash, AssetType type, bool packed)
+{
+	auto entry = byContent.find(MakeContentKey(hash, type, packed));
+	if (entry == byContent.end())
+		return NotFound;
+
+	stats.ContentHits++;
+	byPath[key] = entry->second;
+	assets[entry->second].Aliases++;
+	return entry->second;
+}
+
+unsigned int AssetRegistry::Add(const std::wstring& key, const std::wstring& path, AssetType type, bool packed, unsigned long long hash)
+{
+	unsigned int id = nextId++;
+	Asset& asset = assets[id];
+	asset.Type = type;
+	asset.Packed = packed;
+	asset.Path = path;
+	asset.Aliases = 0;
+	asset.ContentHash = hash;
+	asset.Bytes = 0;
+
+	byPath[key] = id;
+	byContent[MakeContentKey(hash, type, packed)] = id;
+	stats.Loads++;
+	return id;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::LoadTextureAsset(const std::wstring& path, AssetType type)
+{
+	std::wstring fullPath = NormalizePath(path);
+	std::wstring key = MakeKey(fullPath, type, false);
+
+	unsigned int id = FindByPath(key);
+	if (id != NotFound)
+		return assets[id].LoadedTexture;
+
+	std::vector<char> data;
+	if (!ReadContents(fullPath, data))
+		return 0;
+
+	unsigned long long hash = MeshCache::Hash(data.data(), data.size());
+	id = FindByContent(key, hash, type, false);
+	if (id != NotFound)
+		return assets[id].LoadedTexture;
+
+	DecodedImage image = {};
+	if (type == AssetType::Texture && !DecodeImage(data, image))
+		return 0;
+	return CreateTextureAsset(key, fullPath, type, hash, data, image);
+}
+
+std::shared_future<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> AssetRegistry::LoadTextureAssetAsync(const std::wstring& path, AssetType type,
+	std::function<void(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>)> onLoaded)
+{
+	std::wstring fullPath = NormalizePath(path);
+	std::wstring key = MakeKey(fullPath, type, false);
+
+	unsigned int id = FindByPath(key);
+	if (id != NotFound)
+	{
+		if (onLoaded)
+			onLoaded(assets[id].LoadedTexture);
+		return MakeReadyFuture(assets[id].LoadedTexture);
+	}
+
+	std::shared_future<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> future;
+	if (!Wait(pendingTextures, key, onLoaded, future))
+	{
+		stats.PathHits++;
+		return future;
+	}
+
+	// Read and decode on a worker.  DDS files need no decoding,
+	// so their contents are passed along as they are.
+	StartLoad();
+	ThreadPool::GetInstance().Enqueue([this, fullPath, key, type]()
+	{
+		std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>();
+		std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+		unsigned long long hash = 0;
+		bool loaded = ReadContents(fullPath, *data);
+		if (loaded)
+		{
+			hash = MeshCache::Hash(data->data(), data->size());
+			if (type == AssetType::Texture)
+			{
+				loaded = DecodeImage(*data, *image);
+				std::vector<char>().swap(*data);
+			}
+		}
+
+		Complete([this, fullPath, key, type, hash, loaded, data, image]()
+		{
+			Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+			if (loaded)
+				srv = CreateTextureAsset(key, fullPath, type, hash, *data, *image);
+
+			Fulfil(pendingTextures, key, srv);
+			FinishLoad();
+		});
+	});
+
+	return future;
+}
+
+// --------------------------------------------------------
+// Creates and records a texture from data already read and
+// decoded, unless the same texture has been loaded since
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::CreateTextureAsset(const std::wstring& key, const std::wstring& path, AssetType type,
+	unsigned long long hash, const std::vector<char>& data, const DecodedImage& image)
+{
+	auto loaded = byPath.find(key);
+	unsigned int id = loaded != byPath.end() ? loaded->second : FindByContent(key, hash, type, false);
+	if (id != NotFound)
+		return assets[id].LoadedTexture;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (type == AssetType::CubeMap)
+		context->CreateTextureFromDDS(data.data(), data.size(), srv.GetAddressOf());
+	else
+		srv = CreateTexture(image);
+	if (!srv)
+		return 0;
+
+	Asset& asset = assets[Add(key, path, type, false, hash)];
+	asset.LoadedTexture = srv;
+	asset.Bytes = GetTextureBytes(srv.Get());
+	return srv;
+}
+
+// --------------------------------------------------------
+// Uploads decoded pixels and generates the rest of the mip
+// chain on the GPU
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::CreateTexture(const DecodedImage& image)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = image.Width;
+	desc.Height = image.Height;
+	desc.MipLevels = 0; // Full chain
+	desc.ArraySize = 1;
+	desc.Format = image.Format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET; // Render target for GenerateMips
+	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(context->CreateTexture2D(&desc, 0, texture.GetAddressOf())))
+		return 0;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (FAILED(context->CreateShaderResourceView(texture.Get(), 0, srv.GetAddressOf())))
+		return 0;
+
+	context->UpdateSubresource(texture.Get(), 0, 0, image.Pixels.data(), image.RowPitch, 0);
+	context->GenerateMips(srv.Get());
+	return srv;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::CreateSolidTexture(unsigned int color, bool cube)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.MipLevels = 1;
+	desc.ArraySize = cube ? 6 : 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.MiscFlags = cube ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+	D3D11_SUBRESOURCE_DATA faces[6] = {};
+	for (D3D11_SUBRESOURCE_DATA& face : faces)
+	{
+		face.pSysMem = &color;
+		face.SysMemPitch = sizeof(color);
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(context->CreateTexture2D(&desc, faces, texture.GetAddressOf())))
+		return 0;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+	viewDesc.Format = desc.Format;
+	if (cube)
+	{
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		viewDesc.TextureCube.MipLevels = 1;
+	}
+	else
+	{
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		viewDesc.Texture2D.MipLevels = 1;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	context->CreateShaderResourceView(texture.Get(), &viewDesc, srv.GetAddressOf());
+	return srv;
+}
+
+void AssetRegistry::Complete(std::function<void()> finish)
+{
+	{
+		std::lock_guard<std::mutex> lock(completedMutex);
+		completed.push_back(std::move(finish));
+	}
+	completedAvailable.notify_one();
+}
+
+void AssetRegistry::StartLoad()
+{
+	if (pendingLoads == 0)
+	{
+		batchStart = std::chrono::high_resolution_clock::now();
+		batchLoads = 0;
+	}
+	pendingLoads++;
+	batchLoads++;
+}
+
+void AssetRegistry::FinishLoad()
+{
+	pendingLoads--;
+
+#if defined(DEBUG) || defined(_DEBUG)
+	if (pendingLoads == 0)
+	{
+		std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - batchStart;
+		printf("Finished %d async loads in %.2f ms on %d threads\n", batchLoads, loadTime.count(), ThreadPool::GetInstance().GetThreadCount());
+	}
+#endif
+}
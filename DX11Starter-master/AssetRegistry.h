@@ -0,0 +1,262 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXMath.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Mesh.h"
+
+enum class AssetType
+{
+	Mesh,
+	Texture, // Loaded through WIC
+	CubeMap  // Loaded from a .dds file
+};
+
+// --------------------------------------------------------
+// One entry of the residency report
+// --------------------------------------------------------
+struct AssetInfo
+{
+	AssetType Type;
+	std::wstring Path;             // Normalized path it was first loaded from
+	unsigned int Aliases;          // Other paths that turned out to hold the same contents
+	unsigned long long ContentHash;
+	long References;               // Holders besides the registry itself
+	unsigned long long Bytes;      // GPU memory, including mip levels and levels of detail
+};
+
+struct AssetRegistryStats
+{
+	unsigned int Loads;       // Requests that read and uploaded a file
+	unsigned int PathHits;    // Requests for a path that was already loaded (or loading)
+	unsigned int ContentHits; // Requests for a new path whose contents were already loaded
+};
+
+// --------------------------------------------------------
+// Loads each mesh and texture once, however many times and
+// under whatever paths it's requested.  Assets are found by
+// normalized path first, and on a miss by a hash of the
+// file's contents, so copies of a file share one upload.
+//
+// The Async versions read, parse and decode on the thread
+// pool.  Only creating the device resources is left for
+// ProcessCompletedLoads, which the thread that owns the
+// context calls each frame; that's also where futures are
+// fulfilled and callbacks run, so don't block on a future
+// from that thread.  Until then, draw with a placeholder.
+//
+// The registry keeps every asset alive until UnloadUnused
+// is called, which drops those nothing else references.
+// --------------------------------------------------------
+class AssetRegistry
+{
+public:
+	// Gets the one and only instance of this class
+	static AssetRegistry& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new AssetRegistry();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	AssetRegistry(AssetRegistry const&) = delete;
+	void operator=(AssetRegistry const&) = delete;
+
+private:
+	static AssetRegistry* instance;
+	AssetRegistry();
+
+public:
+	~AssetRegistry();
+
+	void Initialize(std::shared_ptr<RenderContext> context);
+
+	// Each returns the shared copy of the asset, loading it if needed,
+	// or null if the file couldn't be read (or, for a mesh, held no
+	// triangles).  Packed and unpacked versions of a mesh are separate
+	// assets.  A mesh whose .meshcache is up to date is matched by the
+	// hash stored in the cache, so its OBJ is never read.
+	std::shared_ptr<Mesh> LoadMesh(const std::string& path, bool packed = false);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadTexture(const std::wstring& path);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadCubeMap(const std::wstring& path);
+
+	// Same as above, but returning right away.  The future and callback
+	// get the asset (or null) once it's ready, which is immediately if
+	// it was already loaded.
+	std::shared_future<std::shared_ptr<Mesh>> LoadMeshAsync(const std::string& path, bool packed = false,
+		std::function<void(std::shared_ptr<Mesh>)> onLoaded = nullptr);
+	std::shared_future<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> LoadTextureAsync(const std::wstring& path,
+		std::function<void(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>)> onLoaded = nullptr);
+	std::shared_future<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> LoadCubeMapAsync(const std::wstring& path,
+		std::function<void(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>)> onLoaded = nullptr);
+
+	// Finishes async loads whose CPU work is done.  Call from the thread
+	// that owns the render context.
+	void ProcessCompletedLoads();
+
+	// Blocks until every async load has finished
+	void WaitForLoads();
+	unsigned int GetPendingLoadCount();
+
+	// Stand-ins to draw with while the real asset loads: a small
+	// octahedron, and single pixel textures
+	std::shared_ptr<Mesh> GetPlaceholderMesh(bool packed = false);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetPlaceholderTexture(DirectX::XMFLOAT4 color = DirectX::XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f));
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetPlaceholderCubeMap();
+
+	// Releases every asset referenced only by the registry, returning how many
+	unsigned int UnloadUnused();
+
+	// What is resident right now, largest first
+	std::vector<AssetInfo> GetResidentAssets();
+	unsigned long long GetResidentBytes();
+
+	// Lists resident assets, then how full and fragmented the
+	// geometry arena holding their meshes is
+	void PrintResidencyReport();
+
+	AssetRegistryStats GetStats();
+
+private:
+	struct Asset
+	{
+		AssetType Type;
+		bool Packed;
+		std::wstring Path;
+		unsigned int Aliases;
+		unsigned long long ContentHash;
+		unsigned long long Bytes;
+		std::shared_ptr<Mesh> LoadedMesh;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadedTexture;
+	};
+
+	// Pixels decoded on a worker, ready for a texture
+	struct DecodedImage
+	{
+		unsigned int Width;
+		unsigned int Height;
+		unsigned int RowPitch;
+		DXGI_FORMAT Format;
+		std::vector<unsigned char> Pixels;
+	};
+
+	// Everyone waiting on an asset that's still loading
+	template<typename T>
+	struct PendingAsset
+	{
+		std::promise<T> Promise;
+		std::shared_future<T> Future;
+		std::vector<std::function<void(T)>> Callbacks;
+	};
+
+	// Content lookups also match on the type and packing, since
+	// the same file loaded differently is a different asset
+	typedef std::pair<unsigned long long, unsigned int> ContentKey;
+	static ContentKey MakeContentKey(unsigned long long hash, AssetType type, bool packed);
+
+	static std::wstring NormalizePath(const std::wstring& path);
+	static std::wstring MakeKey(const std::wstring& path, AssetType type, bool packed);
+	static bool ReadContents(const std::wstring& path, std::vector<char>& data);
+	static bool DecodeImage(const std::vector<char>& data, DecodedImage& image);
+	static unsigned long long GetTextureBytes(ID3D11ShaderResourceView* srv);
+	static long GetReferences(const Asset& asset);
+
+	// Each returns NotFound on a miss.  A content hit records the key as an alias.
+	unsigned int FindByPath(const std::wstring& key);
+	unsigned int FindByContent(const std::wstring& key, unsigned long long hash, AssetType type, bool packed);
+	unsigned int Add(const std::wstring& key, const std::wstring& path, AssetType type, bool packed, unsigned long long hash);
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadTextureAsset(const std::wstring& path, AssetType type);
+	std::shared_future<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> LoadTextureAssetAsync(const std::wstring& path, AssetType type,
+		std::function<void(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>)> onLoaded);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateTextureAsset(const std::wstring& key, const std::wstring& path, AssetType type,
+		unsigned long long hash, const std::vector<char>& data, const DecodedImage& image);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateTexture(const DecodedImage& image);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateSolidTexture(unsigned int color, bool cube);
+
+	// Queues work for ProcessCompletedLoads (from any thread)
+	void Complete(std::function<void()> finish);
+	void StartLoad();
+	void FinishLoad();
+
+	template<typename T>
+	static std::shared_future<T> MakeReadyFuture(T value)
+	{
+		std::promise<T> promise;
+		promise.set_value(value);
+		return promise.get_future().share();
+	}
+
+	// Joins a load of the key already in progress, or starts
+	// waiting on a new one.  Returns true if it was new.
+	template<typename T>
+	static bool Wait(std::unordered_map<std::wstring, std::shared_ptr<PendingAsset<T>>>& pending, const std::wstring& key,
+		std::function<void(T)> onLoaded, std::shared_future<T>& future)
+	{
+		std::shared_ptr<PendingAsset<T>>& asset = pending[key];
+		bool added = !asset;
+		if (added)
+		{
+			asset = std::make_shared<PendingAsset<T>>();
+			asset->Future = asset->Promise.get_future().share();
+		}
+
+		if (onLoaded)
+			asset->Callbacks.push_back(onLoaded);
+		future = asset->Future;
+		return added;
+	}
+
+	template<typename T>
+	static void Fulfil(std::unordered_map<std::wstring, std::shared_ptr<PendingAsset<T>>>& pending, const std::wstring& key, T value)
+	{
+		auto entry = pending.find(key);
+		std::shared_ptr<PendingAsset<T>> asset = entry->second;
+		pending.erase(entry);
+
+		asset->Promise.set_value(value);
+		for (auto& callback : asset->Callbacks)
+			callback(value);
+	}
+
+	std::shared_ptr<RenderContext> context;
+
+	std::map<unsigned int, Asset> assets;
+	std::unordered_map<std::wstring, unsigned int> byPath; // Normalized path (plus options) to asset
+	std::map<ContentKey, unsigned int> byContent;
+	unsigned int nextId;
+
+	AssetRegistryStats stats;
+
+	// Loads in flight, by the same keys as byPath
+	std::unordered_map<std::wstring, std::shared_ptr<PendingAsset<std::shared_ptr<Mesh>>>> pendingMeshes;
+	std::unordered_map<std::wstring, std::shared_ptr<PendingAsset<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>>> pendingTextures;
+	unsigned int pendingLoads;
+	unsigned int batchLoads;
+	std::chrono::high_resolution_clock::time_point batchStart;
+
+	// Finished worker jobs, waiting for the owning thread
+	std::mutex completedMutex;
+	std::condition_variable completedAvailable;
+	std::vector<std::function<void()>> completed;
+
+	std::shared_ptr<Mesh> placeholderMeshes[2]; // Unpacked and packed
+	std::map<unsigned int, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> placeholderTextures; // By RGBA8 color
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholderCubeMap;
+
+	static const unsigned int NotFound = 0xFFFFFFFF;
+};
@@ -0,0 +1,1019 @@
+#include "Bench.h"
+#include "Transform.h"
+#include "ObjParser.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "AssetRegistry.h"
+#include "GeometryArena.h"
+#include "NullRenderContext.h"
+#include "ThreadPool.h"
+#include "SimpleShader.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <float.h>
+#include <fstream>
+#include <limits.h>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+// Milliseconds from start until now
+static double MillisecondsSince(BenchClock::time_point start)
+{
+	std::chrono::duration<double, std::milli> time = BenchClock::now() - start;
+	return time.count();
+}
+
+// --------------------------------------------------------
+// One transform as Transform stored it before TransformSystem:
+// a struct per object, rebuilt one at a time when read after
+// a change.  Kept here only as the baseline for Transforms().
+// --------------------------------------------------------
+struct LegacyTransform
+{
+	XMFLOAT4X4 worldMatrix;
+	XMFLOAT4X4 worldInverseTranspose;
+	XMFLOAT3 position;
+	XMFLOAT3 scale;
+	XMFLOAT3 pitchYawRoll;
+	bool needsUpdate;
+
+	LegacyTransform()
+	{
+		position = XMFLOAT3(0, 0, 0);
+		scale = XMFLOAT3(1, 1, 1);
+		pitchYawRoll = XMFLOAT3(0, 0, 0);
+		XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
+		XMStoreFloat4x4(&worldInverseTranspose, XMMatrixIdentity());
+		needsUpdate = false;
+	}
+
+	void Rotate(float pitch, float yaw, float roll)
+	{
+		pitchYawRoll.x += pitch;
+		pitchYawRoll.y += yaw;
+		pitchYawRoll.z += roll;
+		needsUpdate = true;
+	}
+
+	XMFLOAT4X4 GetWorldMatrix()
+	{
+		if (needsUpdate)
+			UpdateMatrices();
+		return worldMatrix;
+	}
+
+	void UpdateMatrices()
+	{
+		XMMATRIX translMat = XMMatrixTranslationFromVector(XMLoadFloat3(&position));
+		XMMATRIX rotMat = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+		XMMATRIX scaleMat = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
+
+		XMMATRIX world = scaleMat * rotMat * translMat;
+
+		XMStoreFloat4x4(&worldMatrix, world);
+		XMStoreFloat4x4(&worldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(world)));
+
+		needsUpdate = false;
+	}
+};
+
+// --------------------------------------------------------
+// Times rebuilding the matrices of 1k, 100k and 1M changed
+// transforms three ways: the old per-object way, through
+// TransformSystem one at a time as each is read (what a
+// draw reading a dirty transform does), and all together
+// through TransformSystem::UpdateMatrices() before reading
+// --------------------------------------------------------
+bool Bench::Transforms()
+{
+	const unsigned int counts[] = { 1000, 100000, 1000000 };
+	const int passes = 10;
+	volatile float sink = 0; // Keeps the reads from being optimized out
+
+	printf("Transform rebuilds, average ms over %d passes:\n", passes);
+	printf("  %10s %12s %12s %12s\n", "Transforms", "Old (AoS)", "On read", "Batched");
+	for (unsigned int count : counts)
+	{
+		std::vector<LegacyTransform> legacyTransforms(count);
+		std::vector<Transform> transforms(count);
+		double legacy = 0;
+		double onRead = 0;
+		double batched = 0;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (LegacyTransform& transform : legacyTransforms)
+				transform.Rotate(0.0f, 0.0f, 0.01f);
+			BenchClock::time_point start = BenchClock::now();
+			for (LegacyTransform& transform : legacyTransforms)
+				sink += transform.GetWorldMatrix()._11;
+			legacy += MillisecondsSince(start);
+
+			for (Transform& transform : transforms)
+				transform.Rotate(0.0f, 0.0f, 0.01f);
+			start = BenchClock::now();
+			for (Transform& transform : transforms)
+				sink += transform.GetWorldMatrix()._11;
+			onRead += MillisecondsSince(start);
+
+			for (Transform& transform : transforms)
+				transform.Rotate(0.0f, 0.0f, 0.01f);
+			start = BenchClock::now();
+			TransformSystem::GetInstance().UpdateMatrices();
+			for (Transform& transform : transforms)
+				sink += transform.GetWorldMatrix()._11;
+			batched += MillisecondsSince(start);
+		}
+
+		printf("  %10u %12.4f %12.4f %12.4f\n", count, legacy / passes, onRead / passes, batched / passes);
+	}
+
+	// The inverse transpose each rebuild does, on its own, for
+	// a spread of scales and rotations
+	const unsigned int matrixCount = 100000;
+	std::vector<XMFLOAT4X4> worlds(matrixCount);
+	for (unsigned int i = 0; i < matrixCount; i++)
+	{
+		float t = (float)i;
+		XMMATRIX world =
+			XMMatrixScaling(0.5f + fmodf(t * 0.37f, 2.0f), 0.5f + fmodf(t * 0.53f, 2.0f), 0.5f + fmodf(t * 0.71f, 2.0f)) *
+			XMMatrixRotationRollPitchYaw(t * 0.013f, t * 0.029f, t * 0.041f) *
+			XMMatrixTranslation(fmodf(t, 100.0f), fmodf(t * 0.5f, 100.0f), fmodf(t * 0.25f, 100.0f));
+		XMStoreFloat4x4(&worlds[i], world);
+	}
+
+	double general = 0;
+	double trs = 0;
+	float largestDifference = 0;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		BenchClock::time_point start = BenchClock::now();
+		for (XMFLOAT4X4& world : worlds)
+			sink += XMVectorGetX(XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&world))).r[0]);
+		general += MillisecondsSince(start);
+
+		start = BenchClock::now();
+		for (XMFLOAT4X4& world : worlds)
+			sink += XMVectorGetX(TransformSystem::InverseTransposeTRS(XMLoadFloat4x4(&world)).r[0]);
+		trs += MillisecondsSince(start);
+	}
+
+	for (XMFLOAT4X4& world : worlds)
+	{
+		XMFLOAT4X4 a;
+		XMFLOAT4X4 b;
+		XMStoreFloat4x4(&a, XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&world))));
+		XMStoreFloat4x4(&b, TransformSystem::InverseTransposeTRS(XMLoadFloat4x4(&world)));
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				largestDifference = fmaxf(largestDifference, fabsf(a.m[r][c] - b.m[r][c]));
+	}
+
+	printf("Inverse transposes of %u matrices, average ms over %d passes:\n", matrixCount, passes);
+	printf("  General %.4f  Scale/rotation/translation %.4f  Largest difference %g\n",
+		general / passes, trs / passes, largestDifference);
+
+	return true;
+}
+
+// --------------------------------------------------------
+// The OBJ loader Mesh(const char*) used before ObjParser:
+// 100 character lines read with getline and parsed with
+// sscanf_s into one unindexed vertex per corner.  Kept
+// here only as the baseline for ObjParsing().
+// --------------------------------------------------------
+static void ParseObjLegacy(std::istream& obj, std::vector<Vertex>& verts)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT3> normals;
+	std::vector<XMFLOAT2> uvs;
+	char chars[100];
+
+	while (obj.good())
+	{
+		obj.getline(chars, 100);
+
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			XMFLOAT3 norm;
+			sscanf_s(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+			normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			XMFLOAT2 uv;
+			sscanf_s(chars, "vt %f %f", &uv.x, &uv.y);
+			uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			XMFLOAT3 pos;
+			sscanf_s(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+			positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			unsigned int i[12];
+			int numbersRead = sscanf_s(
+				chars,
+				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2],
+				&i[3], &i[4], &i[5],
+				&i[6], &i[7], &i[8],
+				&i[9], &i[10], &i[11]);
+
+			if (numbersRead == 1)
+			{
+				numbersRead = sscanf_s(
+					chars,
+					"f %d//%d %d//%d %d//%d %d//%d",
+					&i[0], &i[2],
+					&i[3], &i[5],
+					&i[6], &i[8],
+					&i[9], &i[11]);
+				i[1] = 1;
+				i[4] = 1;
+				i[7] = 1;
+				i[10] = 1;
+				if (uvs.size() == 0)
+					uvs.push_back(XMFLOAT2(0, 0));
+			}
+
+			// Same flips as the old loader, three vertices per triangle
+			Vertex v[4];
+			int cornerCount = (numbersRead == 12 || numbersRead == 8) ? 4 : 3;
+			for (int c = 0; c < cornerCount; c++)
+			{
+				v[c].Position = positions[i[c * 3] - 1];
+				v[c].UV = uvs[i[c * 3 + 1] - 1];
+				v[c].Normal = normals[i[c * 3 + 2] - 1];
+				v[c].Tangent = XMFLOAT3(0, 0, 0);
+				v[c].UV.y = 1.0f - v[c].UV.y;
+				v[c].Position.z *= -1.0f;
+				v[c].Normal.z *= -1.0f;
+			}
+
+			verts.push_back(v[0]);
+			verts.push_back(v[2]);
+			verts.push_back(v[1]);
+			if (cornerCount == 4)
+			{
+				verts.push_back(v[0]);
+				verts.push_back(v[3]);
+				verts.push_back(v[2]);
+			}
+		}
+	}
+}
+
+// Bitwise hash of a whole vertex, for welding the old loader's output
+struct LegacyVertexHash
+{
+	size_t operator()(const std::string_view& bytes) const { return std::hash<std::string_view>()(bytes); }
+};
+
+// --------------------------------------------------------
+// Welds the old loader's unindexed corners into an indexed
+// mesh, matching whole vertices bit for bit, so the old
+// path can be timed doing the same work as ObjParser's
+// Parse and BuildMesh together
+// --------------------------------------------------------
+static void WeldLegacy(const std::vector<Vertex>& corners, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	std::unordered_map<std::string_view, unsigned int, LegacyVertexHash> welded;
+	welded.reserve(corners.size());
+	vertices.reserve(corners.size());
+	indices.reserve(corners.size());
+	for (const Vertex& corner : corners)
+	{
+		std::string_view key((const char*)&corner, sizeof(Vertex));
+		auto result = welded.insert({ key, (unsigned int)vertices.size() });
+		if (result.second)
+			vertices.push_back(corner);
+		indices.push_back(result.first->second);
+	}
+}
+
+// --------------------------------------------------------
+// Reads fileName into fileData (null terminated, as
+// ObjParser wants it), or without a file, generates a
+// gridSize x gridSize grid of quads with positions, uvs
+// and normals as OBJ text
+// --------------------------------------------------------
+static bool ReadObjText(const char* fileName, int gridSize, std::vector<char>& fileData)
+{
+	if (fileName)
+	{
+		if (ObjParser::ReadFile(fileName, fileData))
+			return true;
+
+		printf("Couldn't read %s\n", fileName);
+		return false;
+	}
+
+	std::string generated;
+	char line[100];
+	for (int z = 0; z <= gridSize; z++)
+	{
+		for (int x = 0; x <= gridSize; x++)
+		{
+			float u = (float)x / gridSize;
+			float v = (float)z / gridSize;
+			generated.append(line, snprintf(line, sizeof(line), "v %f %f %f\n", u * 100.0f - 50.0f, sinf(u * 20.0f) * cosf(v * 20.0f), v * 100.0f - 50.0f));
+			generated.append(line, snprintf(line, sizeof(line), "vt %f %f\n", u, v));
+			generated.append(line, snprintf(line, sizeof(line), "vn %f %f %f\n", 0.0f, 1.0f, 0.0f));
+		}
+	}
+	for (int z = 0; z < gridSize; z++)
+	{
+		for (int x = 0; x < gridSize; x++)
+		{
+			int a = z * (gridSize + 1) + x + 1;
+			int b = a + 1;
+			int c = a + gridSize + 1;
+			int d = c + 1;
+			generated.append(line, snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, c, c, c, b, b, b));
+			generated.append(line, snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", b, b, b, c, c, c, d, d, d));
+		}
+	}
+	fileData.assign(generated.begin(), generated.end());
+	fileData.push_back(0);
+	return true;
+}
+
+// --------------------------------------------------------
+// Times parsing one OBJ file with the old loader and with
+// ObjParser, on their own and then welded into an indexed
+// mesh (the old loader never welded, so the same bitwise
+// weld is run on its output), then how parsing scales from
+// 1 thread to the whole pool.  Without a file, a grid of
+// quads with positions, uvs and normals (about 100 MB of
+// text) is generated in memory.
+// --------------------------------------------------------
+bool Bench::ObjParsing(const char* fileName)
+{
+	std::vector<char> fileData;
+	if (!ReadObjText(fileName, 700, fileData))
+		return false;
+
+	size_t size = fileData.size() - 1;
+	double megabytes = size / (1024.0 * 1024.0);
+	const int passes = 3;
+	printf("Parsing %s (%.2f MB), best of %d passes:\n", fileName ? fileName : "a generated grid", megabytes, passes);
+
+	// The old loader read from a file stream, so give it a stream over the same bytes
+	double legacyParse = DBL_MAX;
+	double legacyTotal = DBL_MAX;
+	size_t legacyVertices = 0;
+	size_t legacyTriangles = 0;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		std::istringstream stream(std::string(fileData.data(), size));
+		std::vector<Vertex> corners;
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+
+		BenchClock::time_point start = BenchClock::now();
+		ParseObjLegacy(stream, corners);
+		double parse = MillisecondsSince(start);
+		WeldLegacy(corners, verts, indices);
+		double total = MillisecondsSince(start);
+
+		legacyParse = fmin(legacyParse, parse);
+		legacyTotal = fmin(legacyTotal, total);
+		legacyVertices = verts.size();
+		legacyTriangles = indices.size() / 3;
+	}
+
+	double tokenizerParse = DBL_MAX;
+	double tokenizerTotal = DBL_MAX;
+	size_t vertices = 0;
+	size_t triangles = 0;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		ObjParser parser;
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+
+		BenchClock::time_point start = BenchClock::now();
+		parser.Parse(fileData.data(), size, 1);
+		double parse = MillisecondsSince(start);
+		parser.BuildMesh(verts, indices);
+		double total = MillisecondsSince(start);
+
+		tokenizerParse = fmin(tokenizerParse, parse);
+		tokenizerTotal = fmin(tokenizerTotal, total);
+		vertices = verts.size();
+		triangles = indices.size() / 3;
+	}
+
+	printf("  %-22s %10s %10s %14s %10s %10s %12s\n", "", "Parse ms", "MB/s", "Parse+weld ms", "MB/s", "Vertices", "Triangles");
+	printf("  %-22s %10.2f %10.1f %14.2f %10.1f %10zu %12zu\n", "getline/sscanf_s",
+		legacyParse, megabytes / (legacyParse / 1000.0), legacyTotal, megabytes / (legacyTotal / 1000.0), legacyVertices, legacyTriangles);
+	printf("  %-22s %10.2f %10.1f %14.2f %10.1f %10zu %12zu\n", "ObjParser (1 thread)",
+		tokenizerParse, megabytes / (tokenizerParse / 1000.0), tokenizerTotal, megabytes / (tokenizerTotal / 1000.0), vertices, triangles);
+
+	// Parse alone across more and more of the pool.  Files under
+	// 1 MB per thread are split into fewer chunks than threads.
+	ThreadPool& pool = ThreadPool::GetInstance();
+	std::vector<Vertex> serialVerts;
+	std::vector<unsigned int> serialIndices;
+	double serial = 0;
+	bool identical = true;
+	printf("Parse only, 1 to %u threads, best of %d passes:\n", pool.GetThreadCount(), passes);
+	printf("  %8s %10s %10s %8s\n", "Threads", "ms", "MB/s", "Speedup");
+	for (unsigned int threads = 1; threads <= pool.GetThreadCount(); threads++)
+	{
+		double best = DBL_MAX;
+		ObjParser parser;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			parser = ObjParser();
+
+			BenchClock::time_point start = BenchClock::now();
+			parser.Parse(fileData.data(), size, threads);
+			best = fmin(best, MillisecondsSince(start));
+		}
+		if (threads == 1)
+			serial = best;
+
+		// The output must not depend on the thread count
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		parser.BuildMesh(verts, indices);
+		if (threads == 1)
+		{
+			serialVerts.swap(verts);
+			serialIndices.swap(indices);
+		}
+		else if (indices != serialIndices || verts.size() != serialVerts.size() ||
+			(verts.size() > 0 && memcmp(verts.data(), serialVerts.data(), verts.size() * sizeof(Vertex)) != 0))
+		{
+			identical = false;
+		}
+
+		printf("  %8u %10.2f %10.1f %7.2fx\n", threads, best, megabytes / (best / 1000.0), serial / best);
+	}
+	printf("Output %s the serial parse at every thread count\n", identical ? "matches" : "DOES NOT match");
+
+	return identical;
+}
+
+// --------------------------------------------------------
+// Vertex count and buffer size before welding (one vertex
+// per triangle corner, as the loader used to emit them)
+// and after, and how long BuildMesh takes.  Fails if two
+// welded vertices are still identical or an index points
+// past the vertices.
+// --------------------------------------------------------
+static bool ReportWelding(ObjParser& parser)
+{
+	const int passes = 3;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	double build = DBL_MAX;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		BenchClock::time_point start = BenchClock::now();
+		parser.BuildMesh(vertices, indices);
+		build = fmin(build, MillisecondsSince(start));
+	}
+
+	bool welded = true;
+	std::unordered_map<std::string_view, unsigned int, LegacyVertexHash> unique;
+	unique.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		std::string_view key((const char*)&vertices[i], sizeof(Vertex));
+		if (!unique.insert({ key, (unsigned int)i }).second)
+			welded = false;
+	}
+	for (unsigned int index : indices)
+	{
+		if (index >= vertices.size())
+			welded = false;
+	}
+
+	size_t corners = indices.size();
+	printf("Welding:\n");
+	printf("  %-14s %10s %12s\n", "", "Vertices", "Buffer KB");
+	printf("  %-14s %10zu %12.1f\n", "One per corner", corners, corners * sizeof(Vertex) / 1024.0);
+	printf("  %-14s %10zu %12.1f\n", "Welded", vertices.size(), vertices.size() * sizeof(Vertex) / 1024.0);
+	printf("  BuildMesh %.2f ms (best of %d), %.2f corners per vertex\n",
+		build, passes, vertices.size() > 0 ? (double)corners / vertices.size() : 0.0);
+	if (!welded)
+		printf("  Welded vertices aren't unique, or an index is past the end\n");
+	return welded;
+}
+
+// --------------------------------------------------------
+// Each triangle as its three vertices' positions in the
+// welded mesh (which are unique), rotated to start at the
+// lowest, then sorted, so meshes can be checked for holding
+// the same triangles whatever order either is in
+// --------------------------------------------------------
+static std::vector<std::array<unsigned int, 3>> TriangleSet(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	const std::unordered_map<std::string_view, unsigned int, LegacyVertexHash>& originalIndices)
+{
+	std::vector<std::array<unsigned int, 3>> triangles;
+	triangles.reserve(indices.size() / 3);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int corners[3];
+		for (int c = 0; c < 3; c++)
+		{
+			std::string_view key((const char*)&vertices[indices[i + c]], sizeof(Vertex));
+			auto found = originalIndices.find(key);
+			corners[c] = found != originalIndices.end() ? found->second : UINT_MAX;
+		}
+		int first = corners[0] <= corners[1] && corners[0] <= corners[2] ? 0 : (corners[1] <= corners[2] ? 1 : 2);
+		triangles.push_back({ corners[first], corners[(first + 1) % 3], corners[(first + 2) % 3] });
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// --------------------------------------------------------
+// ACMR and ATVR of the welded mesh in file order and after
+// MeshOptimizer (what Mesh's load prints in debug builds
+// only), at the cache size it targets and a larger one,
+// and how long optimizing takes.  Fails if the cache miss
+// ratio gets worse or a triangle is lost or flipped.
+// --------------------------------------------------------
+static bool ReportVertexCache(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	const int passes = 3;
+	const unsigned int cacheSizes[] = { MeshOptimizer::CacheSize, 32 };
+	std::vector<Vertex> optimizedVertices;
+	std::vector<unsigned int> optimizedIndices;
+	double optimize = DBL_MAX;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		optimizedVertices = vertices;
+		optimizedIndices = indices;
+		BenchClock::time_point start = BenchClock::now();
+		MeshOptimizer::Optimize(optimizedVertices, optimizedIndices);
+		optimize = fmin(optimize, MillisecondsSince(start));
+	}
+
+	printf("Vertex cache:\n");
+	printf("  %6s %12s %12s %12s %12s\n", "Cache", "File ACMR", "File ATVR", "Opt. ACMR", "Opt. ATVR");
+	bool improved = true;
+	for (unsigned int cacheSize : cacheSizes)
+	{
+		VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, (unsigned int)vertices.size(), cacheSize);
+		VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(optimizedIndices, (unsigned int)optimizedVertices.size(), cacheSize);
+		printf("  %6u %12.3f %12.3f %12.3f %12.3f\n", cacheSize, before.ACMR, before.ATVR, after.ACMR, after.ATVR);
+		if (after.ACMR > before.ACMR + 0.001f)
+			improved = false;
+	}
+	printf("  Optimize %.2f ms (best of %d)\n", optimize, passes);
+
+	std::unordered_map<std::string_view, unsigned int, LegacyVertexHash> originalIndices;
+	originalIndices.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+		originalIndices.insert({ std::string_view((const char*)&vertices[i], sizeof(Vertex)), (unsigned int)i });
+	bool sameTriangles = TriangleSet(vertices, indices, originalIndices) == TriangleSet(optimizedVertices, optimizedIndices, originalIndices);
+
+	if (!improved)
+		printf("  The optimized order misses the cache more than file order\n");
+	if (!sameTriangles)
+		printf("  The optimized mesh DOES NOT hold the same triangles\n");
+	return improved && sameTriangles;
+}
+
+// --------------------------------------------------------
+// Vertex buffer size and bytes the vertex shader fetches
+// per draw (one vertex per post-transform cache miss) as
+// Vertex and as PackedVertex, how long packing takes, and
+// the largest errors after unpacking again.  Fails if the
+// errors are past what the formats can hold.
+// --------------------------------------------------------
+static bool ReportVertexPacking(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	const int passes = 3;
+	BoundingBox bounds;
+	BoundingBox::CreateFromPoints(bounds, vertices.size(), &vertices[0].Position, sizeof(Vertex));
+
+	double encode = DBL_MAX;
+	std::vector<PackedVertex> packed;
+	for (int pass = 0; pass < passes; pass++)
+	{
+		BenchClock::time_point start = BenchClock::now();
+		VertexPacking::EncodeAll(vertices.data(), (int)vertices.size(), bounds, packed);
+		encode = fmin(encode, MillisecondsSince(start));
+	}
+	VertexPackingError error = VertexPacking::MeasureError(vertices.data(), (int)vertices.size(), bounds);
+	VertexCacheStats cache = MeshOptimizer::AnalyzeVertexCache(indices, (unsigned int)vertices.size());
+
+	printf("Vertex packing:\n");
+	printf("  %-14s %8s %12s %16s\n", "", "Stride", "Buffer KB", "Fetched KB/draw");
+	printf("  %-14s %8zu %12.1f %16.1f\n", "Vertex", sizeof(Vertex),
+		vertices.size() * sizeof(Vertex) / 1024.0, cache.Transforms * sizeof(Vertex) / 1024.0);
+	printf("  %-14s %8zu %12.1f %16.1f\n", "PackedVertex", sizeof(PackedVertex),
+		packed.size() * sizeof(PackedVertex) / 1024.0, cache.Transforms * sizeof(PackedVertex) / 1024.0);
+	printf("  Encode %.2f ms (best of %d), %.1f%% of the fetch bandwidth\n",
+		encode, passes, 100.0 * sizeof(PackedVertex) / sizeof(Vertex));
+	printf("  Largest round trip errors: position %g, normal %.4f deg, tangent %.4f deg, uv %g\n",
+		error.MaxPositionError, error.MaxNormalAngle, error.MaxTangentAngle, error.MaxUVError);
+
+	// A 16-bit step along the longest side of the bounds, a
+	// hundredth of a degree and a 2048th of a uv (half floats
+	// have 11 bits of precision, and uv's here stay under 2)
+	XMFLOAT3 scale = VertexPacking::GetPositionScale(bounds);
+	float positionLimit = fmaxf(scale.x, fmaxf(scale.y, scale.z)) / 65535.0f;
+	bool withinLimits = error.MaxPositionError <= positionLimit &&
+		error.MaxNormalAngle < 0.01f && error.MaxTangentAngle < 0.01f;
+	if (!withinLimits)
+		printf("  Errors are larger than 16-bit storage should give\n");
+	return withinLimits;
+}
+
+// --------------------------------------------------------
+// Mesh::CalculateTangents as it was before it worked on
+// four triangles at a time: one triangle per XMVECTOR, on
+// one thread.  Kept here only as the baseline for
+// ReportTangents().
+// --------------------------------------------------------
+static void CalculateTangentsLegacy(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices)
+{
+	for (int i = 0; i < numVerts; i++)
+		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+
+	for (int t = 0; t < numIndices / 3; t++)
+	{
+		const Vertex& v1 = verts[indices[t * 3]];
+		const Vertex& v2 = verts[indices[t * 3 + 1]];
+		const Vertex& v3 = verts[indices[t * 3 + 2]];
+
+		XMVECTOR p1 = XMLoadFloat3(&v1.Position);
+		XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&v2.Position), p1);
+		XMVECTOR e2 = XMVectorSubtract(XMLoadFloat3(&v3.Position), p1);
+		float s1 = v2.UV.x - v1.UV.x;
+		float t1 = v2.UV.y - v1.UV.y;
+		float s2 = v3.UV.x - v1.UV.x;
+		float t2 = v3.UV.y - v1.UV.y;
+
+		XMVECTOR tangent = XMVectorZero();
+		float denominator = s1 * t2 - s2 * t1;
+		if (denominator != 0.0f)
+		{
+			float r = 1.0f / denominator;
+			tangent = XMVectorScale(XMVectorSubtract(XMVectorScale(e1, t2), XMVectorScale(e2, t1)), r);
+		}
+
+		for (int c = 0; c < 3; c++)
+		{
+			Vertex& v = verts[indices[t * 3 + c]];
+			XMStoreFloat3(&v.Tangent, XMVectorAdd(XMLoadFloat3(&v.Tangent), tangent));
+		}
+	}
+
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+		XMStoreFloat3(&verts[i].Tangent, XMVector3Normalize(tangent - normal * XMVector3Dot(normal, tangent)));
+	}
+}
+
+// --------------------------------------------------------
+// Times the old tangent loop against Mesh::CalculateTangents,
+// on the first 32,768 triangles (which the new version does
+// on one thread, so the difference is doing four triangles
+// at a time) and on the whole mesh (which it also spreads
+// across the pool).  Fails unless both give the same bits.
+// --------------------------------------------------------
+static bool ReportTangents(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	const int passes = 5;
+	const size_t smallTriangles = 32768;
+	size_t counts[] = { smallTriangles < indices.size() / 3 ? smallTriangles : indices.size() / 3, indices.size() / 3 };
+	bool identical = true;
+
+	printf("Tangents, best of %d passes:\n", passes);
+	printf("  %10s %12s %12s %8s\n", "Triangles", "Old ms", "New ms", "Speedup");
+	for (size_t triangles : counts)
+	{
+		std::vector<Vertex> legacyVertices(vertices);
+		std::vector<Vertex> newVertices(vertices);
+		std::vector<unsigned int> triangleIndices(indices.begin(), indices.begin() + triangles * 3);
+		double legacy = DBL_MAX;
+		double current = DBL_MAX;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			BenchClock::time_point start = BenchClock::now();
+			CalculateTangentsLegacy(&legacyVertices[0], (int)vertices.size(), &triangleIndices[0], (int)triangleIndices.size());
+			legacy = fmin(legacy, MillisecondsSince(start));
+
+			start = BenchClock::now();
+			Mesh::CalculateTangents(&newVertices[0], (int)vertices.size(), &triangleIndices[0], (int)triangleIndices.size());
+			current = fmin(current, MillisecondsSince(start));
+		}
+
+		if (memcmp(legacyVertices.data(), newVertices.data(), vertices.size() * sizeof(Vertex)) != 0)
+			identical = false;
+		printf("  %10zu %12.3f %12.3f %7.2fx\n", triangles, legacy, current, legacy / current);
+	}
+	printf("  Tangents %s the old loop's bit for bit\n", identical ? "match" : "DO NOT match");
+	return identical;
+}
+
+// --------------------------------------------------------
+// Loads one OBJ file the way Mesh(const char*) does (parse
+// across the pool, weld, optimize, tangents), reporting on
+// each stage as it goes.  Without a file, a grid of
+// quads is generated in memory.
+// --------------------------------------------------------
+bool Bench::Meshes(const char* fileName)
+{
+	std::vector<char> fileData;
+	if (!ReadObjText(fileName, 300, fileData))
+		return false;
+
+	ObjParser parser;
+	parser.Parse(fileData.data(), fileData.size() - 1, ThreadPool::GetInstance().GetThreadCount());
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	parser.BuildMesh(vertices, indices);
+	if (indices.size() == 0)
+	{
+		printf("No triangles in %s\n", fileName ? fileName : "the generated grid");
+		return false;
+	}
+	printf("%s: %zu triangles\n", fileName ? fileName : "Generated grid", indices.size() / 3);
+
+	bool passed = true;
+	passed = ReportWelding(parser) && passed;
+	passed = ReportVertexCache(vertices, indices) && passed;
+
+	MeshOptimizer::Optimize(vertices, indices);
+	Mesh::CalculateTangents(&vertices[0], (int)vertices.size(), &indices[0], (int)indices.size());
+	passed = ReportVertexPacking(vertices, indices) && passed;
+	passed = ReportTangents(vertices, indices) && passed;
+	return passed;
+}
+
+// --------------------------------------------------------
+// Times loading one OBJ file into a Mesh from scratch (with
+// no .meshcache beside it, so it's parsed, welded, optimized,
+// simplified and cached) against loading it again from the
+// cache that leaves behind.  Without a file, the generated
+// grid is written to the working directory and removed
+// afterwards.  Meshes are loaded with deferUpload, so no
+// device or geometry arena is needed.
+// --------------------------------------------------------
+bool Bench::MeshCaching(const char* fileName)
+{
+	const int passes = 5;
+	std::string objFile = fileName ? fileName : "MeshCacheBench.obj";
+	std::string cacheFile = objFile + ".meshcache";
+	if (!fileName)
+	{
+		std::vector<char> fileData;
+		ReadObjText(0, 300, fileData);
+		std::ofstream out(objFile, std::ios::binary | std::ios::trunc);
+		out.write(fileData.data(), (std::streamsize)fileData.size() - 1);
+		if (!out.good())
+		{
+			printf("Couldn't write %s\n", objFile.c_str());
+			return false;
+		}
+	}
+
+	// What each load produced, to check the cache gives back the same mesh
+	struct LoadResult
+	{
+		int IndexCount;
+		int LODIndexCounts[MESH_CACHE_MAX_LODS + 1];
+		int LODCount;
+		unsigned long long SourceHash;
+		unsigned long long Footprint;
+	};
+	auto load = [&](LoadResult& result)
+	{
+		BenchClock::time_point start = BenchClock::now();
+		Mesh mesh(objFile.c_str(), false, true);
+		double time = MillisecondsSince(start);
+
+		memset(&result, 0, sizeof(LoadResult));
+		result.IndexCount = mesh.GetIndexCount();
+		result.LODCount = mesh.GetLODCount();
+		for (int lod = 0; lod < result.LODCount && lod <= MESH_CACHE_MAX_LODS; lod++)
+			result.LODIndexCounts[lod] = mesh.GetLOD(lod)->GetIndexCount();
+		result.SourceHash = mesh.GetSourceHash();
+		result.Footprint = mesh.GetMemoryFootprint();
+		return time;
+	};
+
+	double cold = DBL_MAX;
+	LoadResult coldResult = {};
+	for (int pass = 0; pass < passes; pass++)
+	{
+		DeleteFileA(cacheFile.c_str());
+		cold = fmin(cold, load(coldResult));
+	}
+
+	unsigned long long cachedHash = 0;
+	bool cacheWritten = Mesh::GetCachedSourceHash(objFile.c_str(), cachedHash) && cachedHash == coldResult.SourceHash;
+
+	double hit = DBL_MAX;
+	LoadResult hitResult = {};
+	for (int pass = 0; pass < passes; pass++)
+		hit = fmin(hit, load(hitResult));
+
+	if (!fileName)
+	{
+		DeleteFileA(objFile.c_str());
+		DeleteFileA(cacheFile.c_str());
+	}
+
+	bool identical = cacheWritten && coldResult.IndexCount > 0 && memcmp(&coldResult, &hitResult, sizeof(LoadResult)) == 0;
+	printf("%s: %d triangles, %d levels of detail\n", fileName ? fileName : "Generated grid", coldResult.IndexCount / 3, coldResult.LODCount);
+	printf("Mesh cache, best of %d loads:\n", passes);
+	printf("  %-24s %10s\n", "", "ms");
+	printf("  %-24s %10.2f\n", "Cold (parse and cache)", cold);
+	printf("  %-24s %10.2f\n", "Cache hit (mapped)", hit);
+	printf("  %.1fx faster from the cache\n", cold / hit);
+	printf("  Cached mesh %s the parsed one\n", identical ? "matches" : "DOES NOT match");
+	return identical;
+}
+
+// --------------------------------------------------------
+// Writes meshCount generated grids, each a little bigger
+// than the last so no two share contents, and loads them
+// all through AssetRegistry: one after another with
+// LoadMesh, then with LoadMeshAsync, 1 to N loads in flight
+// at a time, waiting for each group before starting the
+// next.  Both are timed without mesh caches (as on a first
+// run) and with them.  A NullRenderContext stands in for
+// the device, so uploads cost what they do on the CPU.
+// --------------------------------------------------------
+bool Bench::AssetLoading(unsigned int meshCount)
+{
+	const int passes = 3;
+	std::vector<std::string> objFiles;
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		std::vector<char> fileData;
+		ReadObjText(0, 150 + i, fileData);
+
+		char name[64];
+		snprintf(name, sizeof(name), "AssetLoadBench%u.obj", i);
+		objFiles.push_back(name);
+		std::ofstream out(name, std::ios::binary | std::ios::trunc);
+		out.write(fileData.data(), (std::streamsize)fileData.size() - 1);
+		if (!out.good())
+		{
+			printf("Couldn't write %s\n", name);
+			return false;
+		}
+	}
+
+	std::shared_ptr<NullRenderContext> context = std::make_shared<NullRenderContext>();
+	GeometryArena::GetInstance().Initialize(context);
+	AssetRegistry& assets = AssetRegistry::GetInstance();
+	assets.Initialize(context);
+
+	// What the synchronous loads gave, which every other way must match
+	std::vector<int> expectedIndices(meshCount, 0);
+	std::vector<unsigned long long> expectedBytes(meshCount, 0);
+	bool identical = true;
+
+	// Loads every file (0 in flight meaning synchronously), checks the
+	// results, then unloads them again.  Returns the best time in ms.
+	auto load = [&](unsigned int inFlight, bool cached)
+	{
+		double best = DBL_MAX;
+		for (int pass = 0; pass < passes; pass++)
+		{
+			if (!cached)
+			{
+				for (const std::string& objFile : objFiles)
+					DeleteFileA((objFile + ".meshcache").c_str());
+			}
+
+			std::vector<std::shared_ptr<Mesh>> meshes(meshCount);
+			BenchClock::time_point start = BenchClock::now();
+			if (inFlight == 0)
+			{
+				for (unsigned int i = 0; i < meshCount; i++)
+					meshes[i] = assets.LoadMesh(objFiles[i]);
+			}
+			else
+			{
+				for (unsigned int first = 0; first < meshCount; first += inFlight)
+				{
+					for (unsigned int i = first; i < first + inFlight && i < meshCount; i++)
+						assets.LoadMeshAsync(objFiles[i], false, [&meshes, i](std::shared_ptr<Mesh> mesh) { meshes[i] = mesh; });
+					assets.WaitForLoads();
+				}
+			}
+			best = fmin(best, MillisecondsSince(start));
+
+			for (unsigned int i = 0; i < meshCount; i++)
+			{
+				int indices = meshes[i] ? meshes[i]->GetIndexCount() : 0;
+				unsigned long long bytes = meshes[i] ? meshes[i]->GetMemoryFootprint() : 0;
+				if (inFlight == 0 && !cached && pass == 0)
+				{
+					expectedIndices[i] = indices;
+					expectedBytes[i] = bytes;
+				}
+				if (indices == 0 || indices != expectedIndices[i] || bytes != expectedBytes[i])
+					identical = false;
+			}
+
+			meshes.clear();
+			if (assets.UnloadUnused() != meshCount)
+				identical = false;
+		}
+		return best;
+	};
+
+	ThreadPool& pool = ThreadPool::GetInstance();
+	double sync[2];
+	for (int cached = 0; cached < 2; cached++)
+		sync[cached] = load(0, cached != 0);
+
+	printf("%u generated grids, %d to %d triangles, on %u threads\n", meshCount, 150 * 150 * 2, (149 + meshCount) * (149 + meshCount) * 2, pool.GetThreadCount());
+	printf("AssetRegistry mesh loads, best of %d passes:\n", passes);
+	printf("  %-18s %10s %8s %10s %8s\n", "", "Cold ms", "Speedup", "Cached ms", "Speedup");
+	printf("  %-18s %10.2f %7.2fx %10.2f %7.2fx\n", "LoadMesh", sync[0], 1.0, sync[1], 1.0);
+	for (unsigned int inFlight = 1; inFlight <= pool.GetThreadCount() && inFlight <= meshCount; inFlight++)
+	{
+		double cold = load(inFlight, false);
+		double cached = load(inFlight, true);
+
+		char label[32];
+		snprintf(label, sizeof(label), "Async, %u at once", inFlight);
+		printf("  %-18s %10.2f %7.2fx %10.2f %7.2fx\n", label, cold, sync[0] / cold, cached, sync[1] / cached);
+	}
+
+	AssetRegistryStats stats = assets.GetStats();
+	if (stats.ContentHits > 0)
+		identical = false;
+	printf("Async meshes %s the synchronous ones\n", identical ? "match" : "DO NOT match");
+
+	for (const std::string& objFile : objFiles)
+	{
+		DeleteFileA(objFile.c_str());
+		DeleteFileA((objFile + ".meshcache").c_str());
+	}
+	assets.Initialize(0);
+	GeometryArena::GetInstance().Initialize(0);
+	return identical;
+}
+
+// --------------------------------------------------------
+// Sets one matrix a million times each way: by a name in a
+// std::string built for every call (what the setters cost
+// when they took one by value), by a string_view of the
+// name, and by an index looked up once beforehand
+// --------------------------------------------------------
+bool Bench::ShaderSetters(std::shared_ptr<SimpleVertexShader> shader)
+{
+	const char* name = "worldInverseTranspose";
+	int index = shader->GetVariableIndex(name);
+	if (index < 0)
+	{
+		printf("The shader has no %s variable\n", name);
+		return false;
+	}
+
+	const int calls = 1000000;
+	XMFLOAT4X4 matrix;
+	XMStoreFloat4x4(&matrix, XMMatrixIdentity());
+	double nanoseconds[3] = {};
+	for (int way = 0; way < 3; way++)
+	{
+		BenchClock::time_point start = BenchClock::now();
+		for (int i = 0; i < calls; i++)
+		{
+			matrix._44 = (float)i;
+			if (way == 0)
+				shader->SetMatrix4x4(std::string(name), matrix);
+			else if (way == 1)
+				shader->SetMatrix4x4(std::string_view(name), matrix);
+			else
+				shader->SetMatrix4x4((unsigned int)index, matrix);
+		}
+		nanoseconds[way] = MillisecondsSince(start) * 1000000.0 / calls;
+	}
+
+	printf("SetMatrix4x4(\"%s\"), ns per call over %d calls:\n", name, calls);
+	printf("  std::string %.2f  string_view %.2f  index %.2f\n", nanoseconds[0], nanoseconds[1], nanoseconds[2]);
+	return true;
+}
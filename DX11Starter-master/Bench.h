@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+
+class SimpleVertexShader;
+
+// --------------------------------------------------------
+// Timings of the CPU-side systems, run by the -...bench
+// command line flags so build machines can compare them
+// with no window or GPU.  Each prints a table and returns
+// false if the work it timed gave a wrong result.
+// --------------------------------------------------------
+class Bench
+{
+public:
+	// Rebuilding 1k, 100k and 1M changed transforms the old per-object
+	// way, one at a time through TransformSystem and in its batched pass,
+	// then the general inverse transpose against the TRS one
+	static bool Transforms();
+
+	// OBJ parse throughput (MB/s) of the old getline/sscanf_s loader
+	// against ObjParser, then ObjParser from 1 to N threads, on fileName
+	// or a generated grid if null
+	static bool ObjParsing(const char* fileName);
+
+	// Loads fileName (or a generated grid if null) like Mesh does and
+	// reports each stage's numbers: vertex counts before and after
+	// welding, ACMR and ATVR before and after MeshOptimizer, vertex
+	// packing's buffer and fetch sizes and round trip error, and
+	// tangents against the old loop
+	static bool Meshes(const char* fileName);
+
+	// Loading fileName (or a generated grid if null) into a Mesh with
+	// no mesh cache, against loading it again from the cache
+	static bool MeshCaching(const char* fileName);
+
+	// Loading meshCount generated grids through AssetRegistry one at a
+	// time, against loading them asynchronously 1 to N at once, with
+	// and without their mesh caches
+	static bool AssetLoading(unsigned int meshCount);
+
+	// Setting one matrix by a std::string name, a string_view name and
+	// an index, on a shader with a worldInverseTranspose variable
+	static bool ShaderSetters(std::shared_ptr<SimpleVertexShader> shader);
+};
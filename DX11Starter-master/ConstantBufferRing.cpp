@@ -0,0 +1,86 @@
+#include "ConstantBufferRing.h"
+#include <string.h>
+
+ConstantBufferRing::ConstantBufferRing(std::shared_ptr<RenderContext> context, unsigned int size)
+	: allocator(size, SliceAlignment)
+{
+	this->context = context;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = allocator.GetCapacity();
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+	if (desc.ByteWidth > 0)
+		context->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+}
+
+ConstantBufferRing::~ConstantBufferRing()
+{
+}
+
+bool ConstantBufferRing::IsValid()
+{
+	return buffer.Get() != 0;
+}
+
+void ConstantBufferRing::BeginFrame()
+{
+	allocator.Reset();
+}
+
+bool ConstantBufferRing::Write(const void* data, unsigned int size, ConstantBufferSlice& slice)
+{
+	RingAllocation allocation;
+	if (!buffer || !allocator.Allocate(size, allocation))
+		return false;
+
+	// The first slice of a fill gets the buffer new memory, and the
+	// rest go around whatever the GPU might still be reading
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT hr = context->Map(
+		buffer.Get(), 0,
+		allocation.Discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE,
+		0, &mapped);
+	if (FAILED(hr))
+	{
+		// The discard may not have happened, so make sure the next write does one
+		allocator.Reset();
+		return false;
+	}
+
+	memcpy((unsigned char*)mapped.pData + allocation.Offset, data, size);
+	context->Unmap(buffer.Get(), 0);
+
+	slice.FirstConstant = allocation.Offset / ConstantSize;
+	slice.ConstantCount = allocation.Size / ConstantSize;
+	slice.Generation = allocation.Generation;
+	return true;
+}
+
+bool ConstantBufferRing::IsCurrent(const ConstantBufferSlice& slice)
+{
+	return allocator.IsCurrent(slice.Generation);
+}
+
+unsigned int ConstantBufferRing::GetGeneration()
+{
+	return allocator.GetGeneration();
+}
+
+ID3D11Buffer* ConstantBufferRing::GetBuffer()
+{
+	return buffer.Get();
+}
+
+const RingAllocatorStats& ConstantBufferRing::GetStats()
+{
+	return allocator.GetStats();
+}
+
+void ConstantBufferRing::ResetStats()
+{
+	allocator.ResetStats();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include "RenderContext.h"
+#include "RingAllocator.h"
+
+// --------------------------------------------------------
+// Where some constant data was written in the ring, in the
+// units SetConstantBuffers1 takes
+// --------------------------------------------------------
+struct ConstantBufferSlice
+{
+	unsigned int FirstConstant; // 16 byte constants from the start of the buffer
+	unsigned int ConstantCount;
+	unsigned int Generation;    // Zero if never written
+};
+
+// --------------------------------------------------------
+// One large dynamic constant buffer that constant data is
+// written into a fresh slice of each time it changes, and
+// bound from at an offset.  Copying in new data never has
+// to wait on draws still reading the old, unlike updating
+// a buffer with UpdateSubresource.
+//
+// Slices are 256 bytes apart, as Direct3D 11.1 binds
+// constant buffers in ranges of 16 constants.  Needs the
+// render context to support constant buffer offsets.
+// --------------------------------------------------------
+class ConstantBufferRing
+{
+public:
+	ConstantBufferRing(std::shared_ptr<RenderContext> context, unsigned int size);
+	~ConstantBufferRing();
+
+	bool IsValid();
+
+	// Starts over at the front, once at the start of each frame
+	void BeginFrame();
+
+	// Copies the data into a new slice, returning false if it
+	// couldn't (it's bigger than the ring, or mapping failed)
+	bool Write(const void* data, unsigned int size, ConstantBufferSlice& slice);
+
+	// Whether the slice still holds what was written to it
+	bool IsCurrent(const ConstantBufferSlice& slice);
+	unsigned int GetGeneration();
+
+	ID3D11Buffer* GetBuffer();
+
+	const RingAllocatorStats& GetStats();
+	void ResetStats();
+
+	// Enough for a few thousand draws' worth of constants a frame
+	static const unsigned int DefaultSize = 1024 * 1024;
+
+private:
+	// Direct3D 11.1 binds constant buffers 16 constants at a time
+	static const unsigned int SliceAlignment = 256;
+	static const unsigned int ConstantSize = 16;
+
+	std::shared_ptr<RenderContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	RingAllocator allocator;
+};
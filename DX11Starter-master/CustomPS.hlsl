@@ -1,4 +1,4 @@
-cbuffer ExternalData : register(b0) {
+cbuffer PerMaterial : register(b1) {
 	float4 colorTint;
 }
 
@@ -0,0 +1,343 @@
+#include "D3D11RenderContext.h"
+#include <DDSTextureLoader.h>
+
+D3D11RenderContext::D3D11RenderContext(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	this->device = device;
+	this->context = context;
+
+	// Binding constant buffers at an offset needs the 11.1 context,
+	// and the driver has to allow it and mapping them without discarding
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	context.As(&context1);
+	constantBufferOffsets = context1 &&
+		SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		options.ConstantBufferOffsetting &&
+		options.MapNoOverwriteOnDynamicConstantBuffer;
+}
+
+D3D11RenderContext::~D3D11RenderContext()
+{
+}
+
+HRESULT D3D11RenderContext::CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer)
+{
+	HRESULT hr = device->CreateBuffer(desc, initialData, buffer);
+	if (SUCCEEDED(hr))
+		Record(RenderCommand::CreateBuffer, ShaderStage::Count, 0, desc->ByteWidth, *buffer);
+	return hr;
+}
+
+HRESULT D3D11RenderContext::CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture)
+{
+	HRESULT hr = device->CreateTexture2D(desc, initialData, texture);
+	if (SUCCEEDED(hr) && texture)
+		Record(RenderCommand::CreateTexture, ShaderStage::Count, 0, 1, *texture);
+	return hr;
+}
+
+HRESULT D3D11RenderContext::CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view)
+{
+	HRESULT hr = device->CreateShaderResourceView(resource, desc, view);
+	if (SUCCEEDED(hr) && view)
+		Record(RenderCommand::CreateView, ShaderStage::Count, 0, 1, *view);
+	return hr;
+}
+
+// --------------------------------------------------------
+// Makes one stage's shader with the device call given,
+// handing it back as the device child it also is
+// --------------------------------------------------------
+template<typename T>
+static HRESULT CreateStageShader(ID3D11Device* device, HRESULT (STDMETHODCALLTYPE ID3D11Device::*create)(const void*, SIZE_T, ID3D11ClassLinkage*, T**),
+	const void* bytecode, SIZE_T length, ID3D11DeviceChild** shader)
+{
+	T* created = 0;
+	HRESULT hr = (device->*create)(bytecode, length, 0, shader ? &created : 0);
+	if (shader)
+		*shader = created;
+	return hr;
+}
+
+HRESULT D3D11RenderContext::CreateShader(ShaderStage stage, const void* bytecode, SIZE_T length, ID3D11DeviceChild** shader)
+{
+	HRESULT hr = E_INVALIDARG;
+	switch (stage)
+	{
+	case ShaderStage::Vertex:   hr = CreateStageShader(device.Get(), &ID3D11Device::CreateVertexShader, bytecode, length, shader); break;
+	case ShaderStage::Hull:     hr = CreateStageShader(device.Get(), &ID3D11Device::CreateHullShader, bytecode, length, shader); break;
+	case ShaderStage::Domain:   hr = CreateStageShader(device.Get(), &ID3D11Device::CreateDomainShader, bytecode, length, shader); break;
+	case ShaderStage::Geometry: hr = CreateStageShader(device.Get(), &ID3D11Device::CreateGeometryShader, bytecode, length, shader); break;
+	case ShaderStage::Pixel:    hr = CreateStageShader(device.Get(), &ID3D11Device::CreatePixelShader, bytecode, length, shader); break;
+	case ShaderStage::Compute:  hr = CreateStageShader(device.Get(), &ID3D11Device::CreateComputeShader, bytecode, length, shader); break;
+	default: break;
+	}
+
+	if (SUCCEEDED(hr) && shader)
+		Record(RenderCommand::CreateShader, stage, 0, (UINT)length, *shader);
+	return hr;
+}
+
+HRESULT D3D11RenderContext::CreateGeometryShaderWithStreamOutput(const void* bytecode, SIZE_T length, const D3D11_SO_DECLARATION_ENTRY* declaration, UINT entryCount,
+	const UINT* strides, UINT strideCount, UINT rasterizedStream, ID3D11ClassLinkage* classLinkage, ID3D11GeometryShader** shader)
+{
+	HRESULT hr = device->CreateGeometryShaderWithStreamOutput(bytecode, length, declaration, entryCount, strides, strideCount, rasterizedStream, classLinkage, shader);
+	if (SUCCEEDED(hr) && shader)
+		Record(RenderCommand::CreateShader, ShaderStage::Geometry, 0, (UINT)length, *shader);
+	return hr;
+}
+
+HRESULT D3D11RenderContext::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* bytecode, SIZE_T length, ID3D11InputLayout** inputLayout)
+{
+	HRESULT hr = device->CreateInputLayout(elements, elementCount, bytecode, length, inputLayout);
+	if (SUCCEEDED(hr) && inputLayout)
+		Record(RenderCommand::CreateInputLayout, ShaderStage::Count, 0, elementCount, *inputLayout);
+	return hr;
+}
+
+HRESULT D3D11RenderContext::CreateSamplerState(const D3D11_SAMPLER_DESC* desc, ID3D11SamplerState** state)
+{
+	HRESULT hr = device->CreateSamplerState(desc, state);
+	if (SUCCEEDED(hr) && state)
+		Record(RenderCommand::CreateState, ShaderStage::Count, 0, 1, *state);
+	return hr;
+}
+
+HRESULT D3D11RenderContext::CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** state)
+{
+	HRESULT hr = device->CreateRasterizerState(desc, state);
+	if (SUCCEEDED(hr) && state)
+		Record(RenderCommand::CreateState, ShaderStage::Count, 0, 1, *state);
+	return hr;
+}
+
+HRESULT D3D11RenderContext::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** state)
+{
+	HRESULT hr = device->CreateDepthStencilState(desc, state);
+	if (SUCCEEDED(hr) && state)
+		Record(RenderCommand::CreateState, ShaderStage::Count, 0, 1, *state);
+	return hr;
+}
+
+// --------------------------------------------------------
+// Loaded by DirectXTK, which fills in missing mips with the
+// context (so this has to be on the rendering thread)
+// --------------------------------------------------------
+HRESULT D3D11RenderContext::CreateTextureFromDDS(const void* data, size_t size, ID3D11ShaderResourceView** view)
+{
+	HRESULT hr = DirectX::CreateDDSTextureFromMemory(device.Get(), context.Get(), (const uint8_t*)data, size, 0, view);
+	if (SUCCEEDED(hr) && view)
+		Record(RenderCommand::CreateTexture, ShaderStage::Count, 0, 1, *view);
+	return hr;
+}
+
+void D3D11RenderContext::UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box, const void* data, UINT rowPitch, UINT depthPitch)
+{
+	Record(RenderCommand::UpdateSubresource, ShaderStage::Count, subresource, GetUpdateSize(resource, box), resource);
+	context->UpdateSubresource(resource, subresource, box, data, rowPitch, depthPitch);
+}
+
+void D3D11RenderContext::CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y, UINT z,
+	ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* box)
+{
+	Record(RenderCommand::CopySubresourceRegion, ShaderStage::Count, destinationSubresource, box ? box->right - box->left : 0, destination);
+	context->CopySubresourceRegion(destination, destinationSubresource, x, y, z, source, sourceSubresource, box);
+}
+
+HRESULT D3D11RenderContext::Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT flags, D3D11_MAPPED_SUBRESOURCE* mapped)
+{
+	Record(RenderCommand::Map, ShaderStage::Count, subresource, (UINT)mapType, resource);
+	return context->Map(resource, subresource, mapType, flags, mapped);
+}
+
+void D3D11RenderContext::Unmap(ID3D11Resource* resource, UINT subresource)
+{
+	Record(RenderCommand::Unmap, ShaderStage::Count, subresource, 1, resource);
+	context->Unmap(resource, subresource);
+}
+
+void D3D11RenderContext::IASetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	Record(RenderCommand::SetInputLayout, ShaderStage::Count, 0, 1, inputLayout);
+	context->IASetInputLayout(inputLayout);
+}
+
+void D3D11RenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	Record(RenderCommand::SetPrimitiveTopology, ShaderStage::Count, (UINT)topology, 1, 0);
+	context->IASetPrimitiveTopology(topology);
+}
+
+void D3D11RenderContext::IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets)
+{
+	Record(RenderCommand::SetVertexBuffers, ShaderStage::Count, startSlot, count, count > 0 ? buffers[0] : 0);
+	context->IASetVertexBuffers(startSlot, count, buffers, strides, offsets);
+}
+
+void D3D11RenderContext::IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	Record(RenderCommand::SetIndexBuffer, ShaderStage::Count, offset, 1, buffer);
+	context->IASetIndexBuffer(buffer, format, offset);
+}
+
+void D3D11RenderContext::SetShader(ShaderStage stage, ID3D11DeviceChild* shader)
+{
+	Record(RenderCommand::SetShader, stage, 0, 1, shader);
+	switch (stage)
+	{
+	case ShaderStage::Vertex:   context->VSSetShader(static_cast<ID3D11VertexShader*>(shader), 0, 0); break;
+	case ShaderStage::Hull:     context->HSSetShader(static_cast<ID3D11HullShader*>(shader), 0, 0); break;
+	case ShaderStage::Domain:   context->DSSetShader(static_cast<ID3D11DomainShader*>(shader), 0, 0); break;
+	case ShaderStage::Geometry: context->GSSetShader(static_cast<ID3D11GeometryShader*>(shader), 0, 0); break;
+	case ShaderStage::Pixel:    context->PSSetShader(static_cast<ID3D11PixelShader*>(shader), 0, 0); break;
+	case ShaderStage::Compute:  context->CSSetShader(static_cast<ID3D11ComputeShader*>(shader), 0, 0); break;
+	default: break;
+	}
+}
+
+void D3D11RenderContext::SetConstantBuffers(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	Record(RenderCommand::SetConstantBuffers, stage, startSlot, count, count > 0 ? buffers[0] : 0);
+	switch (stage)
+	{
+	case ShaderStage::Vertex:   context->VSSetConstantBuffers(startSlot, count, buffers); break;
+	case ShaderStage::Hull:     context->HSSetConstantBuffers(startSlot, count, buffers); break;
+	case ShaderStage::Domain:   context->DSSetConstantBuffers(startSlot, count, buffers); break;
+	case ShaderStage::Geometry: context->GSSetConstantBuffers(startSlot, count, buffers); break;
+	case ShaderStage::Pixel:    context->PSSetConstantBuffers(startSlot, count, buffers); break;
+	case ShaderStage::Compute:  context->CSSetConstantBuffers(startSlot, count, buffers); break;
+	default: break;
+	}
+}
+
+// --------------------------------------------------------
+// Without the 11.1 context the offsets are lost, and the
+// whole of each buffer is bound (see SupportsConstantBufferOffsets)
+// --------------------------------------------------------
+void D3D11RenderContext::SetConstantBuffers1(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts)
+{
+	if (!context1)
+	{
+		SetConstantBuffers(stage, startSlot, count, buffers);
+		return;
+	}
+
+	Record(RenderCommand::SetConstantBuffers, stage, startSlot, count, count > 0 ? buffers[0] : 0);
+	switch (stage)
+	{
+	case ShaderStage::Vertex:   context1->VSSetConstantBuffers1(startSlot, count, buffers, firstConstants, constantCounts); break;
+	case ShaderStage::Hull:     context1->HSSetConstantBuffers1(startSlot, count, buffers, firstConstants, constantCounts); break;
+	case ShaderStage::Domain:   context1->DSSetConstantBuffers1(startSlot, count, buffers, firstConstants, constantCounts); break;
+	case ShaderStage::Geometry: context1->GSSetConstantBuffers1(startSlot, count, buffers, firstConstants, constantCounts); break;
+	case ShaderStage::Pixel:    context1->PSSetConstantBuffers1(startSlot, count, buffers, firstConstants, constantCounts); break;
+	case ShaderStage::Compute:  context1->CSSetConstantBuffers1(startSlot, count, buffers, firstConstants, constantCounts); break;
+	default: break;
+	}
+}
+
+void D3D11RenderContext::SetShaderResources(ShaderStage stage, UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views)
+{
+	Record(RenderCommand::SetShaderResources, stage, startSlot, count, count > 0 ? views[0] : 0);
+	switch (stage)
+	{
+	case ShaderStage::Vertex:   context->VSSetShaderResources(startSlot, count, views); break;
+	case ShaderStage::Hull:     context->HSSetShaderResources(startSlot, count, views); break;
+	case ShaderStage::Domain:   context->DSSetShaderResources(startSlot, count, views); break;
+	case ShaderStage::Geometry: context->GSSetShaderResources(startSlot, count, views); break;
+	case ShaderStage::Pixel:    context->PSSetShaderResources(startSlot, count, views); break;
+	case ShaderStage::Compute:  context->CSSetShaderResources(startSlot, count, views); break;
+	default: break;
+	}
+}
+
+void D3D11RenderContext::SetSamplers(ShaderStage stage, UINT startSlot, UINT count, ID3D11SamplerState* const* samplers)
+{
+	Record(RenderCommand::SetSamplers, stage, startSlot, count, count > 0 ? samplers[0] : 0);
+	switch (stage)
+	{
+	case ShaderStage::Vertex:   context->VSSetSamplers(startSlot, count, samplers); break;
+	case ShaderStage::Hull:     context->HSSetSamplers(startSlot, count, samplers); break;
+	case ShaderStage::Domain:   context->DSSetSamplers(startSlot, count, samplers); break;
+	case ShaderStage::Geometry: context->GSSetSamplers(startSlot, count, samplers); break;
+	case ShaderStage::Pixel:    context->PSSetSamplers(startSlot, count, samplers); break;
+	case ShaderStage::Compute:  context->CSSetSamplers(startSlot, count, samplers); break;
+	default: break;
+	}
+}
+
+void D3D11RenderContext::CSSetUnorderedAccessViews(UINT startSlot, UINT count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts)
+{
+	Record(RenderCommand::SetUnorderedAccessViews, ShaderStage::Compute, startSlot, count, count > 0 ? views[0] : 0);
+	context->CSSetUnorderedAccessViews(startSlot, count, views, initialCounts);
+}
+
+void D3D11RenderContext::SOSetTargets(UINT count, ID3D11Buffer* const* buffers, const UINT* offsets)
+{
+	Record(RenderCommand::SetStreamOutTargets, ShaderStage::Count, 0, count, count > 0 ? buffers[0] : 0);
+	context->SOSetTargets(count, buffers, offsets);
+}
+
+void D3D11RenderContext::RSSetState(ID3D11RasterizerState* state)
+{
+	Record(RenderCommand::SetRasterizerState, ShaderStage::Count, 0, 1, state);
+	context->RSSetState(state);
+}
+
+void D3D11RenderContext::RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports)
+{
+	Record(RenderCommand::SetViewports, ShaderStage::Count, 0, count, 0);
+	context->RSSetViewports(count, viewports);
+}
+
+void D3D11RenderContext::OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+{
+	Record(RenderCommand::SetDepthStencilState, ShaderStage::Count, stencilRef, 1, state);
+	context->OMSetDepthStencilState(state, stencilRef);
+}
+
+void D3D11RenderContext::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* renderTargets, ID3D11DepthStencilView* depthStencil)
+{
+	Record(RenderCommand::SetRenderTargets, ShaderStage::Count, 0, count, count > 0 ? renderTargets[0] : 0);
+	context->OMSetRenderTargets(count, renderTargets, depthStencil);
+}
+
+void D3D11RenderContext::ClearRenderTargetView(ID3D11RenderTargetView* renderTarget, const FLOAT color[4])
+{
+	Record(RenderCommand::ClearRenderTarget, ShaderStage::Count, 0, 1, renderTarget);
+	context->ClearRenderTargetView(renderTarget, color);
+}
+
+void D3D11RenderContext::ClearDepthStencilView(ID3D11DepthStencilView* depthStencil, UINT flags, FLOAT depth, UINT8 stencil)
+{
+	Record(RenderCommand::ClearDepthStencil, ShaderStage::Count, 0, 1, depthStencil);
+	context->ClearDepthStencilView(depthStencil, flags, depth, stencil);
+}
+
+void D3D11RenderContext::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	Record(RenderCommand::DrawIndexed, ShaderStage::Count, startIndex, indexCount, 0);
+	context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11RenderContext::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	Record(RenderCommand::DrawIndexedInstanced, ShaderStage::Count, startIndex, indexCountPerInstance * instanceCount, 0);
+	context->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void D3D11RenderContext::Dispatch(UINT groupsX, UINT groupsY, UINT groupsZ)
+{
+	Record(RenderCommand::Dispatch, ShaderStage::Compute, 0, groupsX * groupsY * groupsZ, 0);
+	context->Dispatch(groupsX, groupsY, groupsZ);
+}
+
+void D3D11RenderContext::GenerateMips(ID3D11ShaderResourceView* view)
+{
+	Record(RenderCommand::GenerateMips, ShaderStage::Count, 0, 1, view);
+	context->GenerateMips(view);
+}
+
+bool D3D11RenderContext::SupportsConstantBufferOffsets()
+{
+	return constantBufferOffsets;
+}
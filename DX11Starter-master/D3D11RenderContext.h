@@ -0,0 +1,66 @@
+#pragma once
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include "RenderContext.h"
+
+// --------------------------------------------------------
+// Renders with Direct3D 11, counting as it goes
+// --------------------------------------------------------
+class D3D11RenderContext : public RenderContext
+{
+public:
+	D3D11RenderContext(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~D3D11RenderContext();
+
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer);
+	HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture);
+	HRESULT CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view);
+	HRESULT CreateShader(ShaderStage stage, const void* bytecode, SIZE_T length, ID3D11DeviceChild** shader);
+	HRESULT CreateGeometryShaderWithStreamOutput(const void* bytecode, SIZE_T length, const D3D11_SO_DECLARATION_ENTRY* declaration, UINT entryCount,
+		const UINT* strides, UINT strideCount, UINT rasterizedStream, ID3D11ClassLinkage* classLinkage, ID3D11GeometryShader** shader);
+	HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* bytecode, SIZE_T length, ID3D11InputLayout** inputLayout);
+	HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC* desc, ID3D11SamplerState** state);
+	HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** state);
+	HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** state);
+	HRESULT CreateTextureFromDDS(const void* data, size_t size, ID3D11ShaderResourceView** view);
+
+	void UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box, const void* data, UINT rowPitch, UINT depthPitch);
+	void CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y, UINT z,
+		ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* box);
+	HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT flags, D3D11_MAPPED_SUBRESOURCE* mapped);
+	void Unmap(ID3D11Resource* resource, UINT subresource);
+
+	void IASetInputLayout(ID3D11InputLayout* inputLayout);
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets);
+	void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+
+	void SetShader(ShaderStage stage, ID3D11DeviceChild* shader);
+	void SetConstantBuffers(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+	void SetConstantBuffers1(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts);
+	void SetShaderResources(ShaderStage stage, UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views);
+	void SetSamplers(ShaderStage stage, UINT startSlot, UINT count, ID3D11SamplerState* const* samplers);
+	void CSSetUnorderedAccessViews(UINT startSlot, UINT count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts);
+	void SOSetTargets(UINT count, ID3D11Buffer* const* buffers, const UINT* offsets);
+
+	void RSSetState(ID3D11RasterizerState* state);
+	void RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports);
+	void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef);
+	void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* renderTargets, ID3D11DepthStencilView* depthStencil);
+	void ClearRenderTargetView(ID3D11RenderTargetView* renderTarget, const FLOAT color[4]);
+	void ClearDepthStencilView(ID3D11DepthStencilView* depthStencil, UINT flags, FLOAT depth, UINT8 stencil);
+
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+	void Dispatch(UINT groupsX, UINT groupsY, UINT groupsZ);
+	void GenerateMips(ID3D11ShaderResourceView* view);
+
+	bool SupportsConstantBufferOffsets();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1; // Null before Direct3D 11.1
+	bool constantBufferOffsets;
+};
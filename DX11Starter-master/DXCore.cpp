@@ -1,7 +1,14 @@
 #include "DXCore.h"
 #include "Input.h"
+#include "ThreadPool.h"
+#include "GeometryArena.h"
+#include "AssetRegistry.h"
+#include "D3D11RenderContext.h"
+#include "NullRenderContext.h"
+#include "SimpleShader.h"
 
 #include <WindowsX.h>
+#include <algorithm>
 #include <sstream>
 
 // Define the static instance variable so our OS-level 
@@ -76,6 +83,14 @@ DXCore::~DXCore()
 
 	// Delete input manager singleton
 	delete& Input::GetInstance();
+
+	// Stop the worker threads
+	delete& ThreadPool::GetInstance();
+
+	// Release loaded assets, then the shared geometry buffers they used
+	delete& AssetRegistry::GetInstance();
+	delete& GeometryArena::GetInstance();
+	delete& TransformSystem::GetInstance();
 }
 
 // --------------------------------------------------------
@@ -215,6 +230,11 @@ HRESULT DXCore::InitDirectX()
 		context.GetAddressOf());	// Pointer to our Device Context pointer
 	if (FAILED(hr)) return hr;
 
+	// Per-frame rendering goes through this, rather than the context
+	// itself, dropping any binds that wouldn't change anything
+	stateCache = std::make_shared<StateCache>(std::make_shared<D3D11RenderContext>(device, context));
+	renderContext = stateCache;
+
 	// The above function created the back buffer render target
 	// for us, but we need a reference to it
 	ID3D11Texture2D* backBufferTexture = 0;
@@ -264,7 +284,7 @@ HRESULT DXCore::InitDirectX()
 
 	// Bind the views to the pipeline, so rendering properly 
 	// uses their underlying textures
-	context->OMSetRenderTargets(
+	renderContext->OMSetRenderTargets(
 		1, 
 		backBufferRTV.GetAddressOf(), 
 		depthStencilView.Get());
@@ -278,12 +298,44 @@ HRESULT DXCore::InitDirectX()
 	viewport.Height		= (float)height;
 	viewport.MinDepth	= 0.0f;
 	viewport.MaxDepth	= 1.0f;
-	context->RSSetViewports(1, &viewport);
+	renderContext->RSSetViewports(1, &viewport);
 
 	// Return the "everything is ok" HRESULT value
 	return S_OK;
 }
 
+// --------------------------------------------------------
+// Sends printf to the console we were started from, unless
+// output is already going somewhere else (like a file)
+// --------------------------------------------------------
+void DXCore::AttachParentConsole()
+{
+	if (GetFileType(GetStdHandle(STD_OUTPUT_HANDLE)) == FILE_TYPE_UNKNOWN && AttachConsole(ATTACH_PARENT_PROCESS))
+	{
+		FILE* stream;
+		freopen_s(&stream, "CONOUT$", "w", stdout);
+	}
+}
+
+// --------------------------------------------------------
+// Sets up for running without a window or a GPU.  There's
+// no device at all: everything is created through, and
+// every frame goes to, a NullRenderContext, which just
+// counts what it's sent.
+// --------------------------------------------------------
+HRESULT DXCore::InitHeadless()
+{
+	AttachParentConsole();
+
+	stateCache = std::make_shared<StateCache>(std::make_shared<NullRenderContext>());
+	renderContext = stateCache;
+
+	// No window to read input from, so it just stays empty
+	Input::GetInstance().Initialize(0);
+
+	return S_OK;
+}
+
 // --------------------------------------------------------
 // When the window is resized, the underlying 
 // buffers (textures) must also be resized to match.
@@ -348,7 +400,7 @@ void DXCore::OnResize()
 
 	// Bind the views to the pipeline, so rendering properly 
 	// uses their underlying textures
-	context->OMSetRenderTargets(
+	renderContext->OMSetRenderTargets(
 		1, 
 		backBufferRTV.GetAddressOf(), // This requires a pointer to a pointer (an array of pointers), so we get the address of the pointer
 		depthStencilView.Get());
@@ -362,7 +414,7 @@ void DXCore::OnResize()
 	viewport.Height = (float)height;
 	viewport.MinDepth = 0.0f;
 	viewport.MaxDepth = 1.0f;
-	context->RSSetViewports(1, &viewport);
+	renderContext->RSSetViewports(1, &viewport);
 }
 
 
@@ -421,6 +473,53 @@ HRESULT DXCore::Run()
 }
 
 
+// --------------------------------------------------------
+// The game loop without a window, for benchmarking.  Every
+// frame steps the same 1/60th of a second so runs can be
+// compared, and the frames are only timed once all assets
+// have loaded.
+// --------------------------------------------------------
+HRESULT DXCore::RunHeadless(unsigned int frameCount)
+{
+	__int64 now;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	startTime = now;
+	currentTime = now;
+	previousTime = now;
+
+	Init();
+
+	// Finish loading, and let the game swap in what it loaded
+	AssetRegistry::GetInstance().WaitForLoads();
+	deltaTime = 1.0f / 60.0f;
+	Update(deltaTime, totalTime);
+	renderContext->ResetStats();
+	stateCache->ResetCacheStats();
+	ISimpleShader::ResetUploadStats();
+	if (ISimpleShader::GetConstantBufferRing())
+		ISimpleShader::GetConstantBufferRing()->ResetStats();
+	ResetHeadlessStats();
+
+	std::vector<double> frameTimes;
+	frameTimes.reserve(frameCount);
+	for (unsigned int i = 0; i < frameCount; i++)
+	{
+		totalTime += deltaTime;
+
+		__int64 frameStart;
+		__int64 frameEnd;
+		QueryPerformanceCounter((LARGE_INTEGER*)&frameStart);
+		Update(deltaTime, totalTime);
+		Draw(deltaTime, totalTime);
+		QueryPerformanceCounter((LARGE_INTEGER*)&frameEnd);
+
+		frameTimes.push_back((frameEnd - frameStart) * perfCounterSeconds * 1000.0);
+	}
+
+	PrintHeadlessReport(frameTimes);
+	return S_OK;
+}
+
 // --------------------------------------------------------
 // Sends an OS-level window close message to our process, which
 // will be handled by our message processing function
@@ -502,6 +601,72 @@ void DXCore::UpdateTitleBarStats()
 	fpsTimeElapsed += 1.0f;
 }
 
+// --------------------------------------------------------
+// Prints the spread of frame times, and how much of each
+// kind of rendering work an average frame did
+// --------------------------------------------------------
+void DXCore::PrintHeadlessReport(std::vector<double>& frameTimes)
+{
+	if (frameTimes.size() == 0)
+		return;
+
+	double total = 0;
+	for (double time : frameTimes)
+		total += time;
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	size_t last = frameTimes.size() - 1;
+
+	printf("Headless run: %d frames, CPU time per frame (Update + Draw)\n", (int)frameTimes.size());
+	printf("  Average %.4fms  Min %.4fms  Median %.4fms  95th %.4fms  99th %.4fms  Max %.4fms\n",
+		total / frameTimes.size(),
+		frameTimes[0],
+		frameTimes[last / 2],
+		frameTimes[(size_t)(last * 0.95)],
+		frameTimes[(size_t)(last * 0.99)],
+		frameTimes[last]);
+
+	// Everything asked of the state cache, and what it did with it
+	const RenderStats& stats = renderContext->GetStats();
+	const StateCacheStats& cacheStats = stateCache->GetCacheStats();
+	double frames = (double)frameTimes.size();
+	printf("Render calls per frame:  %10s %10s %10s\n", "Requested", "Issued", "Skipped");
+	for (int c = 0; c < (int)RenderCommand::Count; c++)
+	{
+		if (stats.Calls[c] > 0)
+		{
+			printf("  %-24s %10.1f %10.1f %10.1f\n",
+				RenderContext::GetCommandName((RenderCommand)c),
+				stats.Calls[c] / frames,
+				cacheStats.Issued[c] / frames,
+				cacheStats.Skipped[c] / frames);
+		}
+	}
+	printf("  %-24s %10.1f\n", "Indices drawn", stats.IndicesDrawn / frames);
+	printf("Draws per frame: %.1f DrawIndexedInstanced, %.1f DrawIndexed\n",
+		stats.Calls[(int)RenderCommand::DrawIndexedInstanced] / frames,
+		stats.Calls[(int)RenderCommand::DrawIndexed] / frames);
+	printf("  %-24s %10.1f\n", "Bytes updated", stats.BytesUpdated / frames);
+
+	const SimpleShaderUploadStats& uploads = ISimpleShader::GetUploadStats();
+	printf("Constant buffer copies per frame: %.1f uploaded, %.1f skipped as unchanged\n",
+		uploads.Uploads / frames,
+		uploads.Skipped / frames);
+
+	std::shared_ptr<ConstantBufferRing> ring = ISimpleShader::GetConstantBufferRing();
+	if (ring)
+	{
+		const RingAllocatorStats& ringStats = ring->GetStats();
+		printf("Constant buffer ring per frame: %.1f slices, %.1f bytes, %.1f discards, %.1f wraps\n",
+			ringStats.Allocations / frames,
+			ringStats.BytesAllocated / frames,
+			ringStats.Discards / frames,
+			ringStats.Wraps / frames);
+	}
+
+	PrintHeadlessStats(frames);
+}
+
 // --------------------------------------------------------
 // Allocates a console window we can print to for debugging
 // 
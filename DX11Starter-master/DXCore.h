@@ -2,8 +2,12 @@
 
 #include <Windows.h>
 #include <d3d11.h>
+#include <memory>
 #include <string>
+#include <vector>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
+#include "RenderContext.h"
+#include "StateCache.h"
 
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
@@ -36,6 +40,16 @@ public:
 	HRESULT InitWindow();
 	HRESULT InitDirectX();
 	HRESULT Run();
+
+	// Runs without a window or GPU: frames are sent to a NullRenderContext,
+	// and the CPU time of each Update and Draw is reported at the end
+	HRESULT InitHeadless();
+	HRESULT RunHeadless(unsigned int frameCount);
+
+	// Sends printf to the console the app was started from, for the
+	// headless, -selftest and -...bench modes
+	static void AttachParentConsole();
+
 	void Quit();
 	virtual void OnResize();
 
@@ -58,11 +72,14 @@ protected:
 	// Helpful if we want to pause while not the active window
 	bool hasFocus;
 
-	// DirectX related objects and variables
+	// DirectX related objects and variables.  The device and its context
+	// only make the swap chain's views, and are null when headless.
 	D3D_FEATURE_LEVEL		dxFeatureLevel;
 	Microsoft::WRL::ComPtr<IDXGISwapChain>		swapChain;
 	Microsoft::WRL::ComPtr<ID3D11Device>		device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext>	context;
+	std::shared_ptr<RenderContext>				renderContext; // Everything created or drawn goes through this
+	std::shared_ptr<StateCache>					stateCache;    // Which is this, in front of the real one
 
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferRTV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthStencilView;
@@ -93,5 +110,11 @@ private:
 
 	void UpdateTimer();			// Updates the timer for this frame
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
+	void PrintHeadlessReport(std::vector<double>& frameTimes);
+
+	// The game's own lines for the end of the headless report, and
+	// clearing what they count when the render stats are cleared
+	virtual void ResetHeadlessStats() {}
+	virtual void PrintHeadlessStats(double /*frames*/) {}
 };
 
@@ -1,5 +1,6 @@
 #include "Entity.h"
 #include "Camera.h"
+#include <math.h>
 
 using namespace DirectX;
 
@@ -7,33 +8,93 @@ Entity::Entity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
 {
 	this->mesh = mesh;
 	this->material = material;
-}
+	lodScreenSizes = { 0.5f, 0.25f, 0.125f };
 
-void Entity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera)
-{
+	// These are set on every draw, so skip the name lookups
 	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
-	vs->SetMatrix4x4("world", transform.GetWorldMatrix());
-	vs->SetMatrix4x4("worldInverseTranspose", transform.GetWorldInverseTransposeMatrix());
-	vs->SetMatrix4x4("view", camera->GetView()); 
-	vs->SetMatrix4x4("projection", camera->GetProjection()); 
+	worldIndex = vs->GetVariableIndex("world");
+	worldInverseTransposeIndex = vs->GetVariableIndex("worldInverseTranspose");
+	positionOffsetIndex = vs->GetVariableIndex("positionOffset");
+	positionScaleIndex = vs->GetVariableIndex("positionScale");
+}
 
-	vs->CopyAllBufferData();
+void Entity::Draw(std::shared_ptr<RenderContext> context, std::shared_ptr<Camera> camera)
+{
+	Draw(context, camera, SelectLOD(camera));
+}
 
-	std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
-	ps->SetFloat4("colorTint", material->GetTint());
-	ps->SetFloat3("cameraPosition", camera->GetPosition());
-	ps->SetFloat("roughness", material->GetRoughness());
-	ps->SetFloat("uvScale", material->GetUVScale());
+void Entity::Draw(std::shared_ptr<RenderContext> context, std::shared_ptr<Camera> camera, int level)
+{
+	Mesh* lod = mesh->GetLOD(level);
 
-	for (auto& t : material->GetTextureSRVs()) { ps->SetShaderResourceView(t.first.c_str(), t.second); }
-	for (auto& s : material->GetSamplers()) { ps->SetSamplerState(s.first.c_str(), s.second); }
+	// Only the per-object data changes from entity to entity; the
+	// camera and material are already uploaded (see Game::Draw)
+	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
+	vs->SetMatrix4x4(worldIndex, transform.GetWorldMatrix());
+	vs->SetMatrix4x4(worldInverseTransposeIndex, transform.GetWorldInverseTransposeMatrix());
+	if(lod->IsPacked()) {
+		vs->SetFloat3(positionOffsetIndex, lod->GetPositionOffset());
+		vs->SetFloat3(positionScaleIndex, lod->GetPositionScale());
+	}
 
-	ps->CopyAllBufferData();
+	vs->CopyBufferData("PerObject");
 
 	material->GetVertexShader()->SetShader();
 	material->GetPixelShader()->SetShader();
 
-	mesh->Draw();
+	// Only draw the meshlets that could be visible
+	if(lod->GetMeshlets().size() > 0) {
+		XMFLOAT4X4 view = camera->GetView();
+		XMFLOAT4X4 projection = camera->GetProjection();
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+
+		visibleMeshlets.clear();
+		MeshletCuller::Cull(lod->GetMeshlets(), transform.GetWorldMatrix(), viewProjection, camera->GetPosition(), visibleMeshlets);
+		lod->Draw(context, visibleMeshlets);
+	}
+	else {
+		lod->Draw(context);
+	}
+}
+
+int Entity::SelectLOD(std::shared_ptr<Camera> camera)
+{
+	if(mesh->GetLODCount() == 1) {
+		return 0;
+	}
+
+	// Bounding sphere of the mesh in world space.  The scale comes from
+	// the world matrix's rows, so it includes every parent's scale too.
+	BoundingBox bounds = mesh->GetBounds();
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	float scaleX = sqrtf(world._11 * world._11 + world._12 * world._12 + world._13 * world._13);
+	float scaleY = sqrtf(world._21 * world._21 + world._22 * world._22 + world._23 * world._23);
+	float scaleZ = sqrtf(world._31 * world._31 + world._32 * world._32 + world._33 * world._33);
+	float maxScale = fmaxf(scaleX, fmaxf(scaleY, scaleZ));
+	float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents))) * maxScale;
+
+	XMFLOAT3 cameraPosition = camera->GetPosition();
+	XMVECTOR center = XMVector3Transform(XMLoadFloat3(&bounds.Center), XMLoadFloat4x4(&world));
+	float distance = XMVectorGetX(XMVector3Length(center - XMLoadFloat3(&cameraPosition)));
+	if(distance <= radius) {
+		return 0;
+	}
+
+	// The projection's _22 is 1 / tan(fov / 2), so this is the
+	// sphere's size as a fraction of the screen's height
+	float screenSize = radius * camera->GetProjection()._22 / distance;
+
+	int level = 0;
+	while(level < (int)lodScreenSizes.size() && level + 1 < mesh->GetLODCount() && screenSize < lodScreenSizes[level]) {
+		level++;
+	}
+	return level;
+}
+
+void Entity::SetLODScreenSizes(std::vector<float> screenSizes)
+{
+	lodScreenSizes = screenSizes;
 }
 
 Transform* Entity::GetTransform()
@@ -46,6 +107,11 @@ std::shared_ptr<Mesh> Entity::GetMesh()
 	return mesh;
 }
 
+void Entity::SetMesh(std::shared_ptr<Mesh> mesh)
+{
+	this->mesh = mesh;
+}
+
 std::shared_ptr<Material> Entity::GetMaterial()
 {
 	return material;
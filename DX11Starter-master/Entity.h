@@ -2,6 +2,7 @@
 #include "Transform.h"
 #include "Mesh.h"
 #include <memory>
+#include <vector>
 #include "Camera.h"
 #include "Material.h"
 
@@ -10,15 +11,30 @@ class Entity
 public:
 	Entity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
 
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera);
+	void Draw(std::shared_ptr<RenderContext> context, std::shared_ptr<Camera> camera);
+	void Draw(std::shared_ptr<RenderContext> context, std::shared_ptr<Camera> camera, int level); // Level already picked by SelectLOD
 
 	Transform* GetTransform();
 	std::shared_ptr<Mesh> GetMesh();
+	void SetMesh(std::shared_ptr<Mesh> mesh); // Such as once a placeholder's asset loads
 	std::shared_ptr<Material> GetMaterial();
 
+	// Picks a level of detail from how much of the screen's height the
+	// mesh's bounding sphere covers.  Each size a LOD is used below.
+	int SelectLOD(std::shared_ptr<Camera> camera);
+	void SetLODScreenSizes(std::vector<float> screenSizes);
+
 private:
 	Transform transform;
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
+	std::vector<float> lodScreenSizes;
+	std::vector<SubMesh> visibleMeshlets; // Kept to avoid reallocating every frame
+
+	// The vertex shader's per-object variables, looked up once (-1 if missing)
+	int worldIndex;
+	int worldInverseTransposeIndex;
+	int positionOffsetIndex;
+	int positionScaleIndex;
 };
 
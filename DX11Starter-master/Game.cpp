@@ -1,9 +1,11 @@
 #include "Game.h"
 #include "Vertex.h"
 #include "Input.h"
+#include "GeometryArena.h"
+#include "AssetRegistry.h"
+#include "TransformSystem.h"
+#include "Bench.h"
 #include <memory>
-#include <WICTextureLoader.h>
-#include <DDSTextureLoader.h>
 
 // Needed for a helper function to read compiled shader files from the hard drive
 #pragma comment(lib, "d3dcompiler.lib")
@@ -27,7 +29,8 @@ Game::Game(HINSTANCE hInstance)
 		1280,			   // Width of the window's client area
 		720,			   // Height of the window's client area
 		true),			   // Show extra stats (fps) in title bar?
-	vsync(false)
+	vsync(false),
+	propCount(0)
 {
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -52,6 +55,10 @@ Game::~Game()
 	for (Entity* entity : entities) {
 		delete entity;
 	}
+
+	// Shaders share the ring through a static, which would
+	// otherwise hold onto it (and the render context) past this point
+	ISimpleShader::SetConstantBufferRing(nullptr);
 }
 
 // --------------------------------------------------------
@@ -64,12 +71,30 @@ void Game::Init()
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
 	LoadShaders();
+
+	// Constant data goes into slices of one big buffer where the
+	// GPU can bind at an offset, rather than updating each
+	// shader's buffers in place between draws
+	if(renderContext->SupportsConstantBufferOffsets()) {
+		constantBufferRing = std::make_shared<ConstantBufferRing>(renderContext, ConstantBufferRing::DefaultSize);
+		if(constantBufferRing->IsValid()) {
+			ISimpleShader::SetConstantBufferRing(constantBufferRing);
+		}
+	}
+
+	// Every mesh's vertices and indices go into shared buffers,
+	// and every file is loaded through the registry
+	GeometryArena::GetInstance().Initialize(renderContext);
+	AssetRegistry::GetInstance().Initialize(renderContext);
 	CreateBasicGeometry();
+
+	instanceBatcher = std::make_shared<InstanceBatcher>(renderContext, InstanceBatcher::DefaultMaxInstances);
+
 	
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
 	// Essentially: "What kind of shape should the GPU draw with our data?"
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	renderContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	worldCam = std::make_shared<Camera>((float)this->width / this->height, XMFLOAT3(0, 0, -5));
 
@@ -116,14 +141,51 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	vertexShader = std::make_shared<SimpleVertexShader>(device, context, GetFullPathTo_Wide(L"VertexShader.cso").c_str());
-	pixelShader = std::make_shared<SimplePixelShader>(device, context, GetFullPathTo_Wide(L"PixelShader.cso").c_str());
-	skyVertexShader = std::make_shared<SimpleVertexShader>(device, context, GetFullPathTo_Wide(L"SkyVertexShader.cso").c_str());
-	skyPixelShader = std::make_shared<SimplePixelShader>(device, context, GetFullPathTo_Wide(L"SkyPixelShader.cso").c_str());
-	customPixelShader = std::make_shared<SimplePixelShader>(device, context, GetFullPathTo_Wide(L"CustomPS.cso").c_str());
+	vertexShader = std::make_shared<SimpleVertexShader>(renderContext, GetFullPathTo_Wide(L"VertexShader.cso").c_str());
+	packedVertexShader = std::make_shared<SimpleVertexShader>(renderContext, GetFullPathTo_Wide(L"PackedVertexShader.cso").c_str());
+	instancedVertexShader = std::make_shared<SimpleVertexShader>(renderContext, GetFullPathTo_Wide(L"InstancedVertexShader.cso").c_str());
+	packedInstancedVertexShader = std::make_shared<SimpleVertexShader>(renderContext, GetFullPathTo_Wide(L"PackedInstancedVertexShader.cso").c_str());
+	pixelShader = std::make_shared<SimplePixelShader>(renderContext, GetFullPathTo_Wide(L"PixelShader.cso").c_str());
+	skyVertexShader = std::make_shared<SimpleVertexShader>(renderContext, GetFullPathTo_Wide(L"SkyVertexShader.cso").c_str());
+	skyPixelShader = std::make_shared<SimplePixelShader>(renderContext, GetFullPathTo_Wide(L"SkyPixelShader.cso").c_str());
+	customPixelShader = std::make_shared<SimplePixelShader>(renderContext, GetFullPathTo_Wide(L"CustomPS.cso").c_str());
 }
 
 
+// --------------------------------------------------------
+// Loads the shaders on their own and times the vertex
+// shader's setters (see Bench::ShaderSetters)
+// --------------------------------------------------------
+HRESULT Game::RunSetterBenchmark()
+{
+	LoadShaders();
+	return Bench::ShaderSetters(vertexShader) ? S_OK : E_FAIL;
+}
+
+void Game::ResetHeadlessStats()
+{
+	instanceBatcher->ResetStats();
+}
+
+// --------------------------------------------------------
+// Splits the entities drawn into those instanced and those
+// drawn one at a time, for the end of the headless report
+// --------------------------------------------------------
+void Game::PrintHeadlessStats(double frames)
+{
+	const InstanceBatcherStats& stats = instanceBatcher->GetStats();
+	printf("Entities per frame: %.1f instanced in %.1f draws (%.1f per draw), %.1f drawn one at a time\n",
+		stats.Instances / frames,
+		stats.InstancedDraws / frames,
+		stats.InstancedDraws > 0 ? (double)stats.Instances / stats.InstancedDraws : 0.0,
+		stats.SingleDraws / frames);
+}
+
+void Game::SetPropCount(unsigned int count)
+{
+	propCount = count;
+}
+
 void Game::CreateBasicGeometry()
 {
 	// Create some temporary variables to represent colors
@@ -133,45 +195,6 @@ void Game::CreateBasicGeometry()
 	XMFLOAT4 blue = XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f);
 	XMFLOAT4 white = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 
-	// Load Models
-	sphere = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device, context);
-	cube = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device, context);
-	spiral = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device, context);
-
-	// load textures
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronze;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeNormal;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeRoughness;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeMetal;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestone;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneNormal;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneRoughness;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneMetal;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skyBox;
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), 
-		GetFullPathTo_Wide(L"../../Assets/Textures/PBR/bronze_albedo.png").c_str(), nullptr, bronze.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), 
-		GetFullPathTo_Wide(L"../../Assets/Textures/PBR/bronze_normals.png").c_str(), nullptr, bronzeNormal.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"../../Assets/Textures/PBR/bronze_roughness.png").c_str(), nullptr, bronzeRoughness.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"../../Assets/Textures/PBR/bronze_metal.png").c_str(), nullptr, bronzeMetal.GetAddressOf());
-
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"../../Assets/Textures/PBR/cobblestone_albedo.png").c_str(), nullptr, cobblestone.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"../../Assets/Textures/PBR/cobblestone_normals.png").c_str(), nullptr, cobblestoneNormal.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"../../Assets/Textures/PBR/cobblestone_roughness.png").c_str(), nullptr, cobblestoneRoughness.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		GetFullPathTo_Wide(L"../../Assets/Textures/PBR/cobblestone_metal.png").c_str(), nullptr, cobblestoneMetal.GetAddressOf());
-	
-	CreateDDSTextureFromFile(device.Get(), context.Get(), 
-		GetFullPathTo_Wide(L"../../Assets/Textures/Skies/SunnyCubeMap.dds").c_str(), nullptr, skyBox.GetAddressOf());
-
 	// create sampler
 	D3D11_SAMPLER_DESC samplerDescription = {};
 	samplerDescription.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -181,33 +204,32 @@ void Game::CreateBasicGeometry()
 	samplerDescription.MaxAnisotropy = 8;
 	samplerDescription.MaxLOD = D3D11_FLOAT32_MAX;
 
-	device.Get()->CreateSamplerState(&samplerDescription, samplerState.GetAddressOf());
+	renderContext->CreateSamplerState(&samplerDescription, samplerState.GetAddressOf());
 
-	this->blue = std::make_shared<Material>(white, vertexShader, pixelShader, 0.5f);
+	this->blue = std::make_shared<Material>(white, packedVertexShader, pixelShader, 0.5f);
 	this->red = std::make_shared<Material>(white, vertexShader, pixelShader, 0.5f);
-	this->green = std::make_shared<Material>(white, vertexShader, pixelShader, 0.5f);
+	this->green = std::make_shared<Material>(white, packedVertexShader, pixelShader, 0.5f);
 	
 	this->green.get()->AddSampler("DefaultSampler", samplerState.Get());
 	this->blue.get()->AddSampler("DefaultSampler", samplerState.Get());
 	this->red.get()->AddSampler("DefaultSampler", samplerState.Get());
 
-	this->red.get()->AddTextureSRV("Albedo", bronze.Get());
-	this->red.get()->AddTextureSRV("NormalMap", bronzeNormal.Get());
-	this->red.get()->AddTextureSRV("RoughnessMap", bronzeRoughness.Get());
-	this->red.get()->AddTextureSRV("MetalMap", bronzeMetal.Get());
-
-	this->green.get()->AddTextureSRV("Albedo", bronze.Get());
-	this->green.get()->AddTextureSRV("NormalMap", bronzeNormal.Get());
-	this->green.get()->AddTextureSRV("RoughnessMap", bronzeRoughness.Get());
-	this->green.get()->AddTextureSRV("MetalMap", bronzeMetal.Get());
-
-	this->blue.get()->AddTextureSRV("Albedo", cobblestone.Get());
-	this->blue.get()->AddTextureSRV("NormalMap", cobblestoneNormal.Get());
-	this->blue.get()->AddTextureSRV("RoughnessMap", cobblestoneRoughness.Get());
-	this->blue.get()->AddTextureSRV("MetalMap", cobblestoneMetal.Get());
+	// Entities sharing a material and a mesh can be drawn together,
+	// with an instanced shader that takes the same vertices
+	this->red->SetInstancedVertexShader(instancedVertexShader);
+	this->blue->SetInstancedVertexShader(packedInstancedVertexShader);
+	this->green->SetInstancedVertexShader(packedInstancedVertexShader);
 
 	this->red.get()->SetUVScale(4.0f);
 
+	// Everything starts out with placeholders, and switches over
+	// as each asset finishes loading on the thread pool
+	// - The cube is shared with the sky, whose shader expects full vertices
+	AssetRegistry& assets = AssetRegistry::GetInstance();
+	cube = assets.GetPlaceholderMesh();
+	sphere = assets.GetPlaceholderMesh(true);
+	spiral = assets.GetPlaceholderMesh(true);
+
 	entities = std::vector<Entity*>();
 	Entity* cubeEntity = new Entity(cube, this->red);
 	cubeEntity->GetTransform()->MoveAbsolute(-5, 0, 0);
@@ -220,7 +242,79 @@ void Game::CreateBasicGeometry()
 	spiralEntity->GetTransform()->MoveAbsolute(5, 0, 0);
 	entities.push_back(spiralEntity);
 
-	sky = new Sky(cube, samplerState, device, skyVertexShader, skyPixelShader, skyBox);
+	// Identical props in rows of 100 behind everything else, which
+	// the instance batcher should draw in a handful of calls
+	for(unsigned int i = 0; i < propCount; i++) {
+		Entity* prop = new Entity(cube, this->red);
+		prop->GetTransform()->MoveAbsolute((float)(i % 100) * 2.0f - 99.0f, (float)(i / 100 % 100) * 2.0f - 99.0f, 50.0f + (float)(i / 10000) * 2.0f);
+		entities.push_back(prop);
+		props.push_back(prop);
+	}
+	if(propCount > 0) {
+		printf("Added %u props sharing one mesh and material\n", propCount);
+	}
+
+	sky = new Sky(cube, samplerState, renderContext, skyVertexShader, skyPixelShader, assets.GetPlaceholderCubeMap());
+
+	// Load Models
+	assets.LoadMeshAsync(GetFullPathTo("../../Assets/Models/cube.obj"), false, [this, cubeEntity](std::shared_ptr<Mesh> mesh) {
+		if(mesh) {
+			cube = mesh;
+			cubeEntity->SetMesh(mesh);
+			sky->SetMesh(mesh);
+			for(Entity* prop : props) {
+				prop->SetMesh(mesh);
+			}
+		}
+	});
+	assets.LoadMeshAsync(GetFullPathTo("../../Assets/Models/sphere.obj"), true, [this, sphereEntity](std::shared_ptr<Mesh> mesh) {
+		if(mesh) {
+			sphere = mesh;
+			sphereEntity->SetMesh(mesh);
+		}
+	});
+	assets.LoadMeshAsync(GetFullPathTo("../../Assets/Models/helix.obj"), true, [this, spiralEntity](std::shared_ptr<Mesh> mesh) {
+		if(mesh) {
+			spiral = mesh;
+			spiralEntity->SetMesh(mesh);
+		}
+	});
+
+	// load textures
+	// - Placeholders are neutral: mid gray, a flat normal, and no metal
+	auto loadTexture = [&](const wchar_t* file, const char* name, XMFLOAT4 placeholder, std::vector<std::shared_ptr<Material>> materials) {
+		for(auto& material : materials) {
+			material->AddTextureSRV(name, assets.GetPlaceholderTexture(placeholder));
+		}
+
+		std::string textureName = name;
+		assets.LoadTextureAsync(GetFullPathTo_Wide(file), [textureName, materials](Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) {
+			for(auto& material : materials) {
+				if(srv) {
+					material->AddTextureSRV(textureName, srv);
+				}
+			}
+		});
+	};
+	XMFLOAT4 gray = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
+	XMFLOAT4 flatNormal = XMFLOAT4(0.5f, 0.5f, 1.0f, 1.0f);
+	XMFLOAT4 black = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	loadTexture(L"../../Assets/Textures/PBR/bronze_albedo.png", "Albedo", gray, { this->red, this->green });
+	loadTexture(L"../../Assets/Textures/PBR/bronze_normals.png", "NormalMap", flatNormal, { this->red, this->green });
+	loadTexture(L"../../Assets/Textures/PBR/bronze_roughness.png", "RoughnessMap", gray, { this->red, this->green });
+	loadTexture(L"../../Assets/Textures/PBR/bronze_metal.png", "MetalMap", black, { this->red, this->green });
+
+	loadTexture(L"../../Assets/Textures/PBR/cobblestone_albedo.png", "Albedo", gray, { this->blue });
+	loadTexture(L"../../Assets/Textures/PBR/cobblestone_normals.png", "NormalMap", flatNormal, { this->blue });
+	loadTexture(L"../../Assets/Textures/PBR/cobblestone_roughness.png", "RoughnessMap", gray, { this->blue });
+	loadTexture(L"../../Assets/Textures/PBR/cobblestone_metal.png", "MetalMap", black, { this->blue });
+
+	assets.LoadCubeMapAsync(GetFullPathTo_Wide(L"../../Assets/Textures/Skies/SunnyCubeMap.dds"), [this](Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) {
+		if(srv) {
+			sky->SetTexture(srv);
+		}
+	});
 }
 
 
@@ -246,6 +340,18 @@ void Game::Update(float deltaTime, float totalTime)
 	if (Input::GetInstance().KeyDown(VK_ESCAPE))
 		Quit();
 
+	// Swap in any assets that finished loading
+	AssetRegistry& assets = AssetRegistry::GetInstance();
+	if(assets.GetPendingLoadCount() > 0) {
+		assets.ProcessCompletedLoads();
+
+#if defined(DEBUG) || defined(_DEBUG)
+		if(assets.GetPendingLoadCount() == 0) {
+			assets.PrintResidencyReport();
+		}
+#endif
+	}
+
 	worldCam->Update(deltaTime);
 
 	for(Entity* entity : entities) {
@@ -264,13 +370,33 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Clear the render target and depth buffer (erases what's on the screen)
 	//  - Do this ONCE PER FRAME
 	//  - At the beginning of Draw (before drawing *anything*)
-	context->ClearRenderTargetView(backBufferRTV.Get(), color);
-	context->ClearDepthStencilView(
+	renderContext->ClearRenderTargetView(backBufferRTV.Get(), color);
+	renderContext->ClearDepthStencilView(
 		depthStencilView.Get(),
 		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
 		1.0f,
 		0);
 
+	// Every transform changed this frame gets its matrices at once,
+	// rather than one at a time as each entity is drawn
+	TransformSystem::GetInstance().UpdateMatrices();
+
+	// Last frame's constant data is no longer needed
+	if(constantBufferRing) {
+		constantBufferRing->BeginFrame();
+	}
+
+	// The camera, lights and ambient color are the same for every
+	// entity, so they're uploaded once per frame for each shader
+	for(std::shared_ptr<SimpleVertexShader> vs : { vertexShader, packedVertexShader, instancedVertexShader, packedInstancedVertexShader }) {
+		vs->SetMatrix4x4("view", worldCam->GetView());
+		vs->SetMatrix4x4("projection", worldCam->GetProjection());
+		vs->CopyBufferData("PerFrame");
+	}
+
+	pixelShader->SetFloat3("cameraPosition", worldCam->GetPosition());
+	pixelShader->SetFloat3("ambient", ambientColor);
+
 	pixelShader->SetData(
 		"directionalLight1",   // The name of the (eventual) variable in the shader 
 		&dirLight,   // The address of the data to set 
@@ -296,19 +422,23 @@ void Game::Draw(float deltaTime, float totalTime)
 		&yellowPoint,   // The address of the data to set 
 		sizeof(Light));  // The size of the data (the whole struct!) to set
 
-	for(Entity* entity : entities) {
-		entity->GetMaterial()->GetPixelShader()->SetFloat3("ambient", ambientColor);
-		entity->Draw(context, worldCam);
-	}
+	pixelShader->CopyBufferData("PerFrame");
+
+	// Entities sharing a mesh and material go in one draw, and
+	// material data only goes up when the material changes
+	instanceBatcher->Draw(entities, worldCam);
 
-	sky->Draw(context, worldCam);
+	sky->Draw(renderContext, worldCam);
 
 	// Present the back buffer to the user
 	//  - Puts the final frame we're drawing into the window so the user can see it
 	//  - Do this exactly ONCE PER FRAME (always at the very end of the frame)
-	swapChain->Present(vsync ? 1 : 0, 0);
+	//  - There's no swap chain when running headless
+	if(swapChain) {
+		swapChain->Present(vsync ? 1 : 0, 0);
+	}
 
 	// Due to the usage of a more sophisticated swap chain,
 	// the render target must be re-bound after every call to Present()
-	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
+	renderContext->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthStencilView.Get());
 }
\ No newline at end of file
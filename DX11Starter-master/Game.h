@@ -12,6 +12,7 @@
 #include "Material.h"
 #include "Lights.h"
 #include "Sky.h"
+#include "InstanceBatcher.h"
 
 class Game 
 	: public DXCore
@@ -28,11 +29,26 @@ public:
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 
+	// Times setting a shader variable by a std::string name, by a
+	// string_view name and by index (call after InitHeadless)
+	HRESULT RunSetterBenchmark();
+
+	// Adds this many identical props (sharing a mesh and material) to
+	// the scene, for measuring instancing.  Call before Init.
+	void SetPropCount(unsigned int count);
+
+protected:
+	// How the instance batcher drew the entities
+	void ResetHeadlessStats();
+	void PrintHeadlessStats(double frames);
+
 private:
 	std::shared_ptr<Mesh> cube;
 	std::shared_ptr<Mesh> sphere;
 	std::shared_ptr<Mesh> spiral;
 	std::vector<Entity*> entities;
+	std::vector<Entity*> props; // Also in entities, which owns them
+	unsigned int propCount;
 	std::shared_ptr<Camera> worldCam;
 	std::shared_ptr<Material> blue;
 	std::shared_ptr<Material> red;
@@ -63,12 +79,21 @@ private:
 	// Shaders and shader-related constructs
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimpleVertexShader> packedVertexShader;
+	std::shared_ptr<SimpleVertexShader> instancedVertexShader;
+	std::shared_ptr<SimpleVertexShader> packedInstancedVertexShader;
 	std::shared_ptr<SimplePixelShader> customPixelShader;
 	std::shared_ptr<SimplePixelShader> skyPixelShader;
 	std::shared_ptr<SimpleVertexShader> skyVertexShader;
 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
 
+	// Null if constant buffers can't be bound at an offset
+	std::shared_ptr<ConstantBufferRing> constantBufferRing;
+
+	// Draws the entities, instancing those that share a mesh and material
+	std::shared_ptr<InstanceBatcher> instanceBatcher;
+
 	Sky* sky;
 };
 
@@ -0,0 +1,274 @@
+#include "GeometryArena.h"
+#include <stdio.h>
+#include <unordered_map>
+
+// Singleton requirement
+GeometryArena* GeometryArena::instance;
+
+GeometryArena::GeometryArena()
+{
+}
+
+GeometryArena::~GeometryArena()
+{
+}
+
+void GeometryArena::Initialize(std::shared_ptr<RenderContext> context)
+{
+	this->context = context;
+}
+
+unsigned int GeometryArena::Allocate(const void* vertices, unsigned int vertexStride, unsigned int vertexCount,
+	const void* indices, DXGI_FORMAT indexFormat, unsigned int indexCount)
+{
+	if (!context)
+		return InvalidHandle;
+
+	unsigned int indexSize = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+
+	Allocation allocation = {};
+	allocation.Live = true;
+	allocation.VertexPool = GetPool(vertexStride, DXGI_FORMAT_UNKNOWN, D3D11_BIND_VERTEX_BUFFER);
+	allocation.IndexPool = GetPool(indexSize, indexFormat, D3D11_BIND_INDEX_BUFFER);
+	allocation.VertexOffset = AllocateElements(allocation.VertexPool, vertices, vertexCount);
+	allocation.IndexOffset = AllocateElements(allocation.IndexPool, indices, indexCount);
+	allocation.Range.BaseVertex = (int)allocation.VertexOffset;
+	allocation.Range.FirstIndex = allocation.IndexOffset;
+	allocation.Range.IndexCount = indexCount;
+	allocation.Range.VertexCount = vertexCount;
+
+	// Reuse handles of freed meshes first
+	if (freeHandles.size() > 0)
+	{
+		unsigned int handle = freeHandles.back();
+		freeHandles.pop_back();
+		allocations[handle] = allocation;
+		return handle;
+	}
+
+	allocations.push_back(allocation);
+	return (unsigned int)allocations.size() - 1;
+}
+
+void GeometryArena::Free(unsigned int handle)
+{
+	if (handle >= allocations.size() || !allocations[handle].Live)
+		return;
+
+	Allocation& allocation = allocations[handle];
+	if (allocation.Range.VertexCount > 0)
+		pools[allocation.VertexPool].Allocator.Free(allocation.VertexOffset);
+	if (allocation.Range.IndexCount > 0)
+		pools[allocation.IndexPool].Allocator.Free(allocation.IndexOffset);
+
+	allocation.Live = false;
+	freeHandles.push_back(handle);
+}
+
+const GeometryRange& GeometryArena::GetRange(unsigned int handle)
+{
+	return allocations[handle].Range;
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> GeometryArena::GetVertexBuffer(unsigned int handle)
+{
+	return pools[allocations[handle].VertexPool].Buffer;
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> GeometryArena::GetIndexBuffer(unsigned int handle)
+{
+	return pools[allocations[handle].IndexPool].Buffer;
+}
+
+void GeometryArena::Bind(unsigned int handle)
+{
+	const Allocation& allocation = allocations[handle];
+
+	Pool& vertexPool = pools[allocation.VertexPool];
+	UINT stride = vertexPool.ElementSize;
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, vertexPool.Buffer.GetAddressOf(), &stride, &offset);
+
+	Pool& indexPool = pools[allocation.IndexPool];
+	context->IASetIndexBuffer(indexPool.Buffer.Get(), indexPool.IndexFormat, 0);
+}
+
+// --------------------------------------------------------
+// Packs each buffer's ranges together by copying them into
+// a new buffer of the same size, then points the handles
+// at their new offsets
+// --------------------------------------------------------
+void GeometryArena::Compact()
+{
+	std::vector<RangeMove> moves;
+	std::unordered_map<unsigned int, unsigned int> newOffsets;
+
+	for (unsigned int p = 0; p < pools.size(); p++)
+	{
+		Pool& pool = pools[p];
+		pool.Allocator.Compact(moves);
+
+		// Nothing to copy if every range stayed put
+		bool moved = false;
+		for (const RangeMove& move : moves)
+			moved = moved || move.From != move.To;
+		if (!moved)
+			continue;
+
+		ResizePool(pool, pool.Allocator.GetCapacity(), moves);
+
+		newOffsets.clear();
+		for (const RangeMove& move : moves)
+			newOffsets[move.From] = move.To;
+
+		for (Allocation& allocation : allocations)
+		{
+			if (!allocation.Live)
+				continue;
+
+			if (allocation.VertexPool == p && allocation.Range.VertexCount > 0)
+			{
+				allocation.VertexOffset = newOffsets[allocation.VertexOffset];
+				allocation.Range.BaseVertex = (int)allocation.VertexOffset;
+			}
+			if (allocation.IndexPool == p && allocation.Range.IndexCount > 0)
+			{
+				allocation.IndexOffset = newOffsets[allocation.IndexOffset];
+				allocation.Range.FirstIndex = allocation.IndexOffset;
+			}
+		}
+	}
+}
+
+GeometryArenaStats GeometryArena::GetStats()
+{
+	GeometryArenaStats stats = {};
+	stats.Buffers = (unsigned int)pools.size();
+	stats.Allocations = (unsigned int)(allocations.size() - freeHandles.size());
+	for (Pool& pool : pools)
+	{
+		stats.CapacityBytes += (unsigned long long)pool.Allocator.GetCapacity() * pool.ElementSize;
+		stats.UsedBytes += (unsigned long long)pool.Allocator.GetUsed() * pool.ElementSize;
+		if (pool.Allocator.GetFragmentation() > stats.WorstFragmentation)
+			stats.WorstFragmentation = pool.Allocator.GetFragmentation();
+	}
+	return stats;
+}
+
+void GeometryArena::PrintReport()
+{
+	GeometryArenaStats stats = GetStats();
+	printf("Geometry arena: %u meshes in %u buffers, %.2f of %.2f MB used, worst fragmentation %.3f\n",
+		stats.Allocations, stats.Buffers, stats.UsedBytes / (1024.0 * 1024.0), stats.CapacityBytes / (1024.0 * 1024.0),
+		stats.WorstFragmentation);
+
+	for (Pool& pool : pools)
+	{
+		char name[32];
+		if (pool.IndexFormat == DXGI_FORMAT_UNKNOWN)
+			snprintf(name, sizeof(name), "%u-byte vertices", pool.ElementSize);
+		else
+			snprintf(name, sizeof(name), "%u-bit indices", pool.ElementSize * 8);
+
+		RangeAllocator& allocator = pool.Allocator;
+		unsigned int capacity = allocator.GetCapacity();
+		printf("  %-17s %10.1f KB  %5.1f%% used  %5u free ranges, largest %10.1f KB  fragmentation %.3f\n",
+			name, (double)capacity * pool.ElementSize / 1024.0,
+			capacity > 0 ? 100.0 * allocator.GetUsed() / capacity : 0.0,
+			allocator.GetFreeRangeCount(), (double)allocator.GetLargestFreeRange() * pool.ElementSize / 1024.0,
+			allocator.GetFragmentation());
+	}
+}
+
+// --------------------------------------------------------
+// Finds the buffer for this kind of data, making an empty
+// one if needed
+// --------------------------------------------------------
+unsigned int GeometryArena::GetPool(unsigned int elementSize, DXGI_FORMAT indexFormat, UINT bindFlags)
+{
+	for (unsigned int p = 0; p < pools.size(); p++)
+	{
+		if (pools[p].ElementSize == elementSize && pools[p].IndexFormat == indexFormat && pools[p].BindFlags == bindFlags)
+			return p;
+	}
+
+	Pool pool;
+	pool.ElementSize = elementSize;
+	pool.IndexFormat = indexFormat;
+	pool.BindFlags = bindFlags;
+	pools.push_back(pool);
+	return (unsigned int)pools.size() - 1;
+}
+
+// --------------------------------------------------------
+// Reserves space in a pool (growing it if there isn't a
+// large enough free range) and uploads the data there
+// --------------------------------------------------------
+unsigned int GeometryArena::AllocateElements(unsigned int p, const void* data, unsigned int count)
+{
+	if (count == 0)
+		return 0;
+
+	Pool& pool = pools[p];
+	unsigned int offset = pool.Allocator.Allocate(count);
+	if (offset == RangeAllocator::InvalidOffset)
+	{
+		unsigned int capacity = pool.Allocator.GetCapacity();
+		unsigned int newCapacity = capacity > 0 ? capacity * 2 : InitialCapacity;
+		while (newCapacity - capacity < count)
+			newCapacity *= 2;
+
+		std::vector<RangeMove> keepAll;
+		pool.Allocator.Grow(newCapacity);
+		ResizePool(pool, newCapacity, keepAll);
+		offset = pool.Allocator.Allocate(count);
+	}
+
+	D3D11_BOX box = {};
+	box.left = offset * pool.ElementSize;
+	box.right = (offset + count) * pool.ElementSize;
+	box.bottom = 1;
+	box.back = 1;
+	context->UpdateSubresource(pool.Buffer.Get(), 0, &box, data, 0, 0);
+	return offset;
+}
+
+// --------------------------------------------------------
+// Replaces a pool's buffer with one of the given capacity.
+// With no moves the old contents are copied over as they
+// are, otherwise just the moved ranges are.
+// --------------------------------------------------------
+void GeometryArena::ResizePool(Pool& pool, unsigned int capacity, const std::vector<RangeMove>& moves)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT; // Not immutable, since ranges are updated and moved
+	desc.ByteWidth = capacity * pool.ElementSize;
+	desc.BindFlags = pool.BindFlags;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	context->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+	if (pool.Buffer)
+	{
+		D3D11_BUFFER_DESC oldDesc;
+		pool.Buffer->GetDesc(&oldDesc);
+
+		D3D11_BOX box = {};
+		box.bottom = 1;
+		box.back = 1;
+		if (moves.size() == 0)
+		{
+			box.right = oldDesc.ByteWidth < desc.ByteWidth ? oldDesc.ByteWidth : desc.ByteWidth;
+			context->CopySubresourceRegion(buffer.Get(), 0, 0, 0, 0, pool.Buffer.Get(), 0, &box);
+		}
+
+		for (const RangeMove& move : moves)
+		{
+			box.left = move.From * pool.ElementSize;
+			box.right = (move.From + move.Size) * pool.ElementSize;
+			context->CopySubresourceRegion(buffer.Get(), 0, move.To * pool.ElementSize, 0, 0, pool.Buffer.Get(), 0, &box);
+		}
+	}
+
+	pool.Buffer = buffer;
+}
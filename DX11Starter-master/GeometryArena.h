@@ -0,0 +1,125 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include "RangeAllocator.h"
+#include "RenderContext.h"
+
+// --------------------------------------------------------
+// Where a mesh's data lives within the arena's buffers
+// --------------------------------------------------------
+struct GeometryRange
+{
+	int BaseVertex;          // Added to every index when drawing
+	unsigned int FirstIndex; // Start of the mesh's indices
+	unsigned int IndexCount;
+	unsigned int VertexCount;
+};
+
+struct GeometryArenaStats
+{
+	unsigned int Buffers;        // Vertex and index buffers across all formats
+	unsigned int Allocations;
+	unsigned long long CapacityBytes;
+	unsigned long long UsedBytes;
+	float WorstFragmentation;    // Highest of any buffer's allocator
+};
+
+// --------------------------------------------------------
+// Suballocates every mesh's vertices and indices out of a
+// few large shared buffers: one vertex buffer per vertex
+// stride and one index buffer per index format.  Meshes
+// hold a handle, and draws of meshes sharing buffers skip
+// rebinding the input assembler.
+//
+// Buffers grow when full.  Compact() packs live ranges
+// together, which changes offsets but not handles, so
+// ranges should be looked up with GetRange when drawing.
+// --------------------------------------------------------
+class GeometryArena
+{
+public:
+	// Gets the one and only instance of this class
+	static GeometryArena& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new GeometryArena();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	GeometryArena(GeometryArena const&) = delete;
+	void operator=(GeometryArena const&) = delete;
+
+private:
+	static GeometryArena* instance;
+	GeometryArena();
+
+public:
+	~GeometryArena();
+
+	void Initialize(std::shared_ptr<RenderContext> context);
+
+	// Copies the data into the shared buffers and returns a handle to it,
+	// or InvalidHandle if the arena hasn't been initialized
+	unsigned int Allocate(const void* vertices, unsigned int vertexStride, unsigned int vertexCount,
+		const void* indices, DXGI_FORMAT indexFormat, unsigned int indexCount);
+	void Free(unsigned int handle);
+
+	const GeometryRange& GetRange(unsigned int handle);
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer(unsigned int handle);
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer(unsigned int handle);
+
+	// Binds the handle's buffers.  Redundant binds are left for the
+	// render context's StateCache to filter out.
+	void Bind(unsigned int handle);
+
+	// Moves every live range to the front of its buffer
+	void Compact();
+
+	GeometryArenaStats GetStats();
+
+	// Prints how full each buffer is and how splintered its free
+	// space has become, to judge whether Compact is worth running
+	void PrintReport();
+
+	static const unsigned int InvalidHandle = 0xFFFFFFFF;
+
+private:
+	// One shared buffer and the allocator tracking its elements
+	struct Pool
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+		RangeAllocator Allocator;
+		unsigned int ElementSize;
+		DXGI_FORMAT IndexFormat; // DXGI_FORMAT_UNKNOWN for vertex buffers
+		UINT BindFlags;
+	};
+
+	struct Allocation
+	{
+		bool Live;
+		unsigned int VertexPool;
+		unsigned int IndexPool;
+		unsigned int VertexOffset;
+		unsigned int IndexOffset;
+		GeometryRange Range;
+	};
+
+	unsigned int GetPool(unsigned int elementSize, DXGI_FORMAT indexFormat, UINT bindFlags);
+	unsigned int AllocateElements(unsigned int pool, const void* data, unsigned int count);
+	void ResizePool(Pool& pool, unsigned int capacity, const std::vector<RangeMove>& moves);
+
+	std::shared_ptr<RenderContext> context;
+
+	std::vector<Pool> pools;
+	std::vector<Allocation> allocations;
+	std::vector<unsigned int> freeHandles;
+
+	// Starting size of a new buffer, in elements
+	static const unsigned int InitialCapacity = 65536;
+};
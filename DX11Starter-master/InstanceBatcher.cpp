@@ -0,0 +1,162 @@
+#include "InstanceBatcher.h"
+#include <algorithm>
+#include <functional>
+#include <string.h>
+
+InstanceBatcher::InstanceBatcher(std::shared_ptr<RenderContext> context, unsigned int maxInstances)
+	: allocator(maxInstances * sizeof(InstanceData), sizeof(InstanceData))
+{
+	this->context = context;
+	lastMaterial = 0;
+	ResetStats();
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = allocator.GetCapacity();
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+	if (desc.ByteWidth > 0)
+		context->CreateBuffer(&desc, 0, instanceBuffer.GetAddressOf());
+}
+
+InstanceBatcher::~InstanceBatcher()
+{
+}
+
+bool InstanceBatcher::IsValid()
+{
+	return instanceBuffer.Get() != 0;
+}
+
+void InstanceBatcher::Draw(const std::vector<Entity*>& entities, std::shared_ptr<Camera> camera)
+{
+	// Last frame's instances may still be in use, which the
+	// first write of the frame discarding the buffer takes care of
+	allocator.Reset();
+	lastMaterial = 0;
+
+	// Anything that can't be instanced is drawn right away
+	items.clear();
+	for (Entity* entity : entities)
+	{
+		Material* material = entity->GetMaterial().get();
+		int level = entity->SelectLOD(camera);
+		Mesh* lod = entity->GetMesh()->GetLOD(level);
+		if (instanceBuffer && material->GetInstancedVertexShader() && lod->GetMeshlets().size() == 0)
+		{
+			items.push_back({ material, lod, entity });
+			continue;
+		}
+
+		if (material != lastMaterial)
+		{
+			material->PrepareMaterial();
+			lastMaterial = material;
+		}
+		entity->Draw(context, camera, level);
+		stats.SingleDraws++;
+	}
+
+	// Sorting puts each batch in one run, with runs sharing a material together
+	std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b)
+	{
+		if (a.Surface != b.Surface)
+			return std::less<Material*>()(a.Surface, b.Surface);
+		return std::less<Mesh*>()(a.LOD, b.LOD);
+	});
+
+	size_t start = 0;
+	while (start < items.size())
+	{
+		size_t end = start + 1;
+		while (end < items.size() && items[end].Surface == items[start].Surface && items[end].LOD == items[start].LOD)
+			end++;
+
+		DrawBatch(&items[start], (unsigned int)(end - start));
+		start = end;
+	}
+}
+
+// --------------------------------------------------------
+// Draws entities sharing a mesh and material, in as many
+// instanced draws as it takes to fit them in the buffer
+// --------------------------------------------------------
+void InstanceBatcher::DrawBatch(const DrawItem* batch, unsigned int count)
+{
+	Material* material = batch[0].Surface;
+	if (material != lastMaterial)
+	{
+		material->PrepareMaterial();
+		lastMaterial = material;
+	}
+
+	// Packed meshes' bounds are the same for every instance
+	std::shared_ptr<SimpleVertexShader> vs = material->GetInstancedVertexShader();
+	Mesh* lod = batch[0].LOD;
+	if (lod->IsPacked())
+	{
+		vs->SetFloat3("positionOffset", lod->GetPositionOffset());
+		vs->SetFloat3("positionScale", lod->GetPositionScale());
+		vs->CopyBufferData("PerMesh");
+	}
+
+	vs->SetShader();
+	material->GetPixelShader()->SetShader();
+
+	// Instances are picked out with the start instance, so the buffer itself never moves
+	UINT stride = sizeof(InstanceData);
+	UINT offset = 0;
+	context->IASetVertexBuffers(1, 1, instanceBuffer.GetAddressOf(), &stride, &offset);
+
+	unsigned int maxInstances = allocator.GetCapacity() / sizeof(InstanceData);
+	while (count > 0)
+	{
+		unsigned int instanceCount = count < maxInstances ? count : maxInstances;
+
+		RingAllocation allocation;
+		if (!allocator.Allocate(instanceCount * sizeof(InstanceData), allocation))
+			return;
+
+		// The first write of a fill gets the buffer new memory, and the
+		// rest go around whatever the GPU might still be reading
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		HRESULT hr = context->Map(
+			instanceBuffer.Get(), 0,
+			allocation.Discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE,
+			0, &mapped);
+		if (FAILED(hr))
+		{
+			// The discard may not have happened, so make sure the next write does one
+			allocator.Reset();
+			return;
+		}
+
+		InstanceData* instances = (InstanceData*)((unsigned char*)mapped.pData + allocation.Offset);
+		for (unsigned int i = 0; i < instanceCount; i++)
+		{
+			Transform* transform = batch[i].Owner->GetTransform();
+			instances[i].World = transform->GetWorldMatrix();
+			instances[i].WorldInverseTranspose = transform->GetWorldInverseTransposeMatrix();
+		}
+		context->Unmap(instanceBuffer.Get(), 0);
+
+		lod->DrawInstanced(context, instanceCount, allocation.Offset / sizeof(InstanceData));
+
+		stats.InstancedDraws++;
+		stats.Instances += instanceCount;
+		batch += instanceCount;
+		count -= instanceCount;
+	}
+}
+
+const InstanceBatcherStats& InstanceBatcher::GetStats()
+{
+	return stats;
+}
+
+void InstanceBatcher::ResetStats()
+{
+	memset(&stats, 0, sizeof(InstanceBatcherStats));
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include "RenderContext.h"
+#include "RingAllocator.h"
+#include "Entity.h"
+#include "Camera.h"
+
+// --------------------------------------------------------
+// One instance's data, as InstancedVertexShader reads it
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInverseTranspose;
+};
+
+struct InstanceBatcherStats
+{
+	unsigned int InstancedDraws; // One per batch, unless a batch outgrew the buffer
+	unsigned int Instances;      // Entities drawn by them
+	unsigned int SingleDraws;    // Entities that couldn't be instanced
+};
+
+// --------------------------------------------------------
+// Draws a list of entities, collapsing each group sharing
+// a mesh (after picking a level of detail) and a material
+// into one instanced draw.  Every entity's transforms go
+// into a dynamic vertex buffer, handed out and refilled
+// each frame the same way as ConstantBufferRing.
+//
+// Entities are still drawn one at a time when their
+// material has no instanced vertex shader, or their mesh
+// is split into meshlets (which are culled per entity,
+// so instances of one mesh draw different index ranges).
+// A material's instanced vertex shader takes the same
+// vertices as its vertex shader: InstancedVertexShader
+// for Vertex, or PackedInstancedVertexShader (which gets
+// the mesh bounds once per draw) for PackedVertex.
+// --------------------------------------------------------
+class InstanceBatcher
+{
+public:
+	InstanceBatcher(std::shared_ptr<RenderContext> context, unsigned int maxInstances);
+	~InstanceBatcher();
+
+	bool IsValid();
+
+	// Draws every entity.  Each shader's per-frame data
+	// needs to be copied to it beforehand.
+	void Draw(const std::vector<Entity*>& entities, std::shared_ptr<Camera> camera);
+
+	const InstanceBatcherStats& GetStats();
+	void ResetStats();
+
+	static const unsigned int DefaultMaxInstances = 16384;
+
+private:
+	// One entity to instance, with what it's batched by
+	struct DrawItem
+	{
+		Material* Surface;
+		Mesh* LOD;
+		Entity* Owner;
+	};
+
+	void DrawBatch(const DrawItem* batch, unsigned int count);
+
+	std::shared_ptr<RenderContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	RingAllocator allocator;
+	InstanceBatcherStats stats;
+
+	Material* lastMaterial;      // Last one prepared, to skip preparing it again
+	std::vector<DrawItem> items; // Kept to avoid reallocating every frame
+};
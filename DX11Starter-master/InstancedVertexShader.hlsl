@@ -0,0 +1,52 @@
+#include "ShaderStructs.hlsli"
+
+// The same as VertexShader, except each instance brings its own
+// transforms (see InstanceBatcher), so there's no PerObject buffer
+cbuffer PerFrame : register(b0) {
+	matrix view;
+	matrix projection;
+}
+
+// Rows of each matrix exactly as they sit in an XMFLOAT4X4 on the
+// CPU, in the second vertex buffer.  The "_PER_INSTANCE" suffix
+// is what makes SimpleShader step them once per instance.
+struct VertexShaderInput
+{ 
+	float3 localPosition: POSITION; // XYZ position
+	float3 normal: NORMAL;
+	float3 tangent: TANGENT;
+	float2 uv: TEXCOORD;
+	float4 world0: WORLD_PER_INSTANCE0;
+	float4 world1: WORLD_PER_INSTANCE1;
+	float4 world2: WORLD_PER_INSTANCE2;
+	float4 world3: WORLD_PER_INSTANCE3;
+	float4 worldInverseTranspose0: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE0;
+	float4 worldInverseTranspose1: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE1;
+	float4 worldInverseTranspose2: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE2;
+	float4 worldInverseTranspose3: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE3;
+};
+
+VertexToPixel main( VertexShaderInput input )
+{
+	// Set up output struct
+	VertexToPixel output;
+
+	// Constant buffers are column major, so the same memory read as
+	// rows is the transpose of what VertexShader sees
+	matrix world = transpose(matrix(input.world0, input.world1, input.world2, input.world3));
+	matrix worldInverseTranspose = transpose(matrix(
+		input.worldInverseTranspose0,
+		input.worldInverseTranspose1,
+		input.worldInverseTranspose2,
+		input.worldInverseTranspose3));
+
+	// Multiply the three matrices together first  
+	matrix wvp = mul(projection, mul(view, world));  
+	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+	output.normal = mul((float3x3)worldInverseTranspose, input.normal);
+	output.tangent = mul((float3x3)worldInverseTranspose, input.tangent);
+	output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
+	output.uv = input.uv;
+
+	return output;
+}
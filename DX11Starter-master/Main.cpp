@@ -1,6 +1,11 @@
 
 #include <Windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include "Game.h"
+#include "SelfTest.h"
+#include "Bench.h"
 
 // --------------------------------------------------------
 // Entry point for a graphical (non-console) Windows application
@@ -25,6 +30,91 @@ int WINAPI WinMain(
 	// Result variable for function calls below
 	HRESULT hr = S_OK;
 
+	// "-selftest" runs the CPU-side checks and exits with a failure
+	// code if any of them fail, and needs no window or device
+	if(strstr(lpCmdLine, "-selftest")) {
+		DXCore::AttachParentConsole();
+		return SelfTest::RunAll() > 0 ? E_FAIL : S_OK;
+	}
+
+	// "-transformbench" times transform matrix rebuilds and inverse transposes,
+	// and needs no window or device
+	if(strstr(lpCmdLine, "-transformbench")) {
+		DXCore::AttachParentConsole();
+		return Bench::Transforms() ? S_OK : E_FAIL;
+	}
+
+	// "-objbench [file.obj]" times OBJ parsing on a file, or on a
+	// generated grid if none is given
+	const char* objBench = strstr(lpCmdLine, "-objbench");
+	if(objBench) {
+		char fileName[MAX_PATH] = {};
+		sscanf_s(objBench + strlen("-objbench"), "%259s", fileName, (unsigned int)MAX_PATH);
+		DXCore::AttachParentConsole();
+		return Bench::ObjParsing(fileName[0] && fileName[0] != '-' ? fileName : 0) ? S_OK : E_FAIL;
+	}
+
+	// "-meshbench [file.obj]" loads a file, or a generated grid if none
+	// is given, and reports on each stage of Mesh's loading
+	const char* meshBench = strstr(lpCmdLine, "-meshbench");
+	if(meshBench) {
+		char fileName[MAX_PATH] = {};
+		sscanf_s(meshBench + strlen("-meshbench"), "%259s", fileName, (unsigned int)MAX_PATH);
+		DXCore::AttachParentConsole();
+		return Bench::Meshes(fileName[0] && fileName[0] != '-' ? fileName : 0) ? S_OK : E_FAIL;
+	}
+
+	// "-cachebench [file.obj]" times loading a file, or a generated grid
+	// if none is given, with and without its mesh cache
+	const char* cacheBench = strstr(lpCmdLine, "-cachebench");
+	if(cacheBench) {
+		char fileName[MAX_PATH] = {};
+		sscanf_s(cacheBench + strlen("-cachebench"), "%259s", fileName, (unsigned int)MAX_PATH);
+		DXCore::AttachParentConsole();
+		return Bench::MeshCaching(fileName[0] && fileName[0] != '-' ? fileName : 0) ? S_OK : E_FAIL;
+	}
+
+	// "-loadbench [count]" times loading that many generated meshes (8
+	// if no count is given) through the asset registry, synchronously
+	// and asynchronously, and needs no window or device
+	const char* loadBench = strstr(lpCmdLine, "-loadbench");
+	if(loadBench) {
+		int meshCount = atoi(loadBench + strlen("-loadbench"));
+		if(meshCount <= 0) meshCount = 8;
+
+		DXCore::AttachParentConsole();
+		return Bench::AssetLoading((unsigned int)meshCount) ? S_OK : E_FAIL;
+	}
+
+	// "-setterbench" times shader variable setters by name and by index,
+	// with the same setup as -headless
+	if(strstr(lpCmdLine, "-setterbench")) {
+		hr = dxGame.InitHeadless();
+		if(FAILED(hr)) return hr;
+
+		return dxGame.RunSetterBenchmark();
+	}
+
+	// "-headless 600" runs 600 frames with no window or GPU, then
+	// prints how long they took (for benchmarking on build machines).
+	// Add "-props 10000" to fill the scene with identical props.
+	const char* headless = strstr(lpCmdLine, "-headless");
+	if(headless) {
+		int frameCount = atoi(headless + strlen("-headless"));
+		if(frameCount <= 0) frameCount = 600;
+
+		const char* props = strstr(lpCmdLine, "-props");
+		if(props) {
+			int propCount = atoi(props + strlen("-props"));
+			if(propCount > 0) dxGame.SetPropCount((unsigned int)propCount);
+		}
+
+		hr = dxGame.InitHeadless();
+		if(FAILED(hr)) return hr;
+
+		return dxGame.RunHeadless((unsigned int)frameCount);
+	}
+
 	// Attempt to create the window for our program, and
 	// exit early if something failed
 	hr = dxGame.InitWindow();
@@ -7,6 +7,30 @@ Material::Material(DirectX::XMFLOAT4 tint, std::shared_ptr<SimpleVertexShader> v
     this->vertexShader = vertexShader;
     this->roughness = roughness;
     this->uvScale = 1.0f;
+
+    colorTintIndex = pixelShader->GetVariableIndex("colorTint");
+    roughnessIndex = pixelShader->GetVariableIndex("roughness");
+    uvScaleIndex = pixelShader->GetVariableIndex("uvScale");
+
+    // Size the binding tables to cover the registers the shader uses
+    srvTableStart = samplerTableStart = 0;
+    unsigned int srvTableEnd = 0;
+    for (unsigned int i = 0; i < pixelShader->GetShaderResourceViewCount(); i++)
+    {
+        unsigned int bindIndex = pixelShader->GetShaderResourceViewInfo(i)->BindIndex;
+        if (i == 0 || bindIndex < srvTableStart) srvTableStart = bindIndex;
+        if (i == 0 || bindIndex >= srvTableEnd) srvTableEnd = bindIndex + 1;
+    }
+    srvTable.resize(srvTableEnd - srvTableStart, 0);
+
+    unsigned int samplerTableEnd = 0;
+    for (unsigned int i = 0; i < pixelShader->GetSamplerCount(); i++)
+    {
+        unsigned int bindIndex = pixelShader->GetSamplerInfo(i)->BindIndex;
+        if (i == 0 || bindIndex < samplerTableStart) samplerTableStart = bindIndex;
+        if (i == 0 || bindIndex >= samplerTableEnd) samplerTableEnd = bindIndex + 1;
+    }
+    samplerTable.resize(samplerTableEnd - samplerTableStart, 0);
 }
 
 DirectX::XMFLOAT4 Material::GetTint()
@@ -21,20 +45,29 @@ std::shared_ptr<SimplePixelShader> Material::GetPixelShader()
 
 void Material::AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
-    textureSRVs.insert({ name, srv });
+    // Names the shader doesn't use are kept, but never bound
+    const SimpleSRV* srvInfo = pixelShader->GetShaderResourceViewInfo(name);
+    if (srvInfo)
+        srvTable[srvInfo->BindIndex - srvTableStart] = srv.Get();
+
+    textureSRVs[name] = srv; // Replaces any placeholder
 }
 
 void Material::AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
-    samplers.insert({ name, samplerState });
+    // Doesn't replace an existing sampler, so the table takes whichever is kept
+    auto result = samplers.insert({ name, samplerState });
+    const SimpleSampler* samplerInfo = pixelShader->GetSamplerInfo(name);
+    if (samplerInfo)
+        samplerTable[samplerInfo->BindIndex - samplerTableStart] = result.first->second.Get();
 }
 
-std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> Material::GetTextureSRVs()
+const std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& Material::GetTextureSRVs()
 {
     return textureSRVs;
 }
 
-std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> Material::GetSamplers()
+const std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>>& Material::GetSamplers()
 {
     return samplers;
 }
@@ -58,3 +91,24 @@ std::shared_ptr<SimpleVertexShader> Material::GetVertexShader()
 {
     return vertexShader;
 }
+
+void Material::SetInstancedVertexShader(std::shared_ptr<SimpleVertexShader> instancedVertexShader)
+{
+    this->instancedVertexShader = instancedVertexShader;
+}
+
+std::shared_ptr<SimpleVertexShader> Material::GetInstancedVertexShader()
+{
+    return instancedVertexShader;
+}
+
+void Material::PrepareMaterial()
+{
+    pixelShader->SetFloat4(colorTintIndex, tint);
+    pixelShader->SetFloat(roughnessIndex, roughness);
+    pixelShader->SetFloat(uvScaleIndex, uvScale);
+    pixelShader->CopyBufferData("PerMaterial");
+
+    if (!srvTable.empty()) { pixelShader->SetShaderResourceViews(srvTableStart, (unsigned int)srvTable.size(), srvTable.data()); }
+    if (!samplerTable.empty()) { pixelShader->SetSamplerStates(samplerTableStart, (unsigned int)samplerTable.size(), samplerTable.data()); }
+}
@@ -3,6 +3,7 @@
 #include <memory>
 #include "SimpleShader.h"
 #include <unordered_map>
+#include <vector>
 #include <string.h>
 
 class Material
@@ -13,21 +14,44 @@ public:
 	DirectX::XMFLOAT4 GetTint();
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
+
+	// A version of the vertex shader reading each instance's transforms from
+	// a vertex buffer (like InstancedVertexShader), or null if there isn't one
+	void SetInstancedVertexShader(std::shared_ptr<SimpleVertexShader> instancedVertexShader);
+	std::shared_ptr<SimpleVertexShader> GetInstancedVertexShader();
 	void AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	void AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> GetTextureSRVs();
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> GetSamplers();
+	const std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& GetTextureSRVs();
+	const std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>>& GetSamplers();
 	void SetUVScale(float value);
 	float GetUVScale();
 	float GetRoughness();
 
+	// Sets and uploads the pixel shader's PerMaterial data, and binds the
+	// textures and samplers (one call each).  Only needed when the material changes.
+	void PrepareMaterial();
+
 private:
 	DirectX::XMFLOAT4 tint;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimpleVertexShader> instancedVertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
+
+	// The textures and samplers by register, from the first one the pixel
+	// shader uses to its last (null where nothing's been added).  The maps
+	// above hold the references.
+	std::vector<ID3D11ShaderResourceView*> srvTable;
+	std::vector<ID3D11SamplerState*> samplerTable;
+	unsigned int srvTableStart;
+	unsigned int samplerTableStart;
 	float roughness; // 0 - 1
 	float uvScale;
+
+	// The pixel shader's PerMaterial variables, looked up once (-1 if missing)
+	int colorTintIndex;
+	int roughnessIndex;
+	int uvScaleIndex;
 };
 
@@ -1,277 +1,659 @@
 #include "Mesh.h"
-#include <fstream>
+#include "ObjParser.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexPacking.h"
+#include "GeometryArena.h"
 #include <DirectXMath.h>
 #include <vector>
+#include <string>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
 using namespace DirectX;
 
+// Run the vertex cache, overdraw and vertex fetch optimizations on loaded OBJ files
+bool Mesh::OptimizeOnLoad = true;
+
+// Split meshes too large for 16-bit indices into sub-meshes that aren't
+bool Mesh::SplitLargeMeshes = true;
+
+// Split meshes with at least MeshletMinTriangles triangles into meshlets for culling
+bool Mesh::BuildMeshlets = true;
+
+// Build levels of detail with half, a quarter and an eighth of the triangles
+std::vector<float> Mesh::LODRatios = { 0.5f, 0.25f, 0.125f };
+
+// The LOD ratios in use, laid out as a cache header stores them
+static void GetCacheLODRatios(float ratios[MESH_CACHE_MAX_LODS])
+{
+	for (int i = 0; i < MESH_CACHE_MAX_LODS; i++)
+		ratios[i] = i < (int)Mesh::LODRatios.size() ? Mesh::LODRatios[i] : 0.0f;
+}
+
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() {
-	return vertexBuffer;
+	if (geometry == GeometryArena::InvalidHandle)
+		return 0;
+	return GeometryArena::GetInstance().GetVertexBuffer(geometry);
 }
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer() {
-	return indexBuffer;
+	if (geometry == GeometryArena::InvalidHandle)
+		return 0;
+	return GeometryArena::GetInstance().GetIndexBuffer(geometry);
+}
+
+unsigned int Mesh::GetGeometry() {
+	return geometry;
 }
 
 int Mesh::GetIndexCount() {
 	return numIndices;
 }
 
-void Mesh::Draw() {
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+DXGI_FORMAT Mesh::GetIndexFormat() {
+	return indexFormat;
+}
+
+const std::vector<SubMesh>& Mesh::GetSubMeshes() {
+	return subMeshes;
+}
+
+const std::vector<Meshlet>& Mesh::GetMeshlets() {
+	return meshlets;
+}
+
+int Mesh::GetLODCount() {
+	return (int)lods.size() + 1;
+}
+
+Mesh* Mesh::GetLOD(int level) {
+	if (level <= 0 || lods.size() == 0)
+		return this;
+	return lods[level <= (int)lods.size() ? level - 1 : lods.size() - 1].get();
+}
+
+DirectX::BoundingBox Mesh::GetBounds() {
+	return bounds;
+}
+
+unsigned long long Mesh::GetMemoryFootprint() {
+	unsigned long long bytes = 0;
+	if (geometry != GeometryArena::InvalidHandle)
+	{
+		const GeometryRange& range = GeometryArena::GetInstance().GetRange(geometry);
+		unsigned int indexSize = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+		bytes = (unsigned long long)range.VertexCount * vertexStride + (unsigned long long)range.IndexCount * indexSize;
+	}
 
-	context->DrawIndexed(
-		numIndices,     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0      // Offset to add to each index when looking up vertices
-	);
+	for (auto& lod : lods)
+		bytes += lod->GetMemoryFootprint();
+	return bytes;
 }
 
-Mesh::Mesh(const char* fileName, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+unsigned long long Mesh::GetSourceHash() {
+	return sourceHash;
+}
+
+bool Mesh::IsPacked() {
+	return packed;
+}
+
+DirectX::XMFLOAT3 Mesh::GetPositionOffset() {
+	return packed ? VertexPacking::GetPositionOffset(bounds) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+}
+
+DirectX::XMFLOAT3 Mesh::GetPositionScale() {
+	return packed ? VertexPacking::GetPositionScale(bounds) : XMFLOAT3(1.0f, 1.0f, 1.0f);
+}
+
+void Mesh::Draw(std::shared_ptr<RenderContext> context) {
+	Draw(context, subMeshes);
+}
+
+// --------------------------------------------------------
+// Draws only the given ranges of the index buffer, such as
+// the visible meshlets from MeshletCuller.  Ranges are
+// relative to this mesh, which sits somewhere within the
+// arena's shared buffers.
+// --------------------------------------------------------
+void Mesh::Draw(std::shared_ptr<RenderContext> context, const std::vector<SubMesh>& ranges) {
+	if (geometry == GeometryArena::InvalidHandle)
+		return;
+
+	GeometryArena& arena = GeometryArena::GetInstance();
+	arena.Bind(geometry);
+	const GeometryRange& location = arena.GetRange(geometry);
+
+	for (const SubMesh& range : ranges)
+	{
+		context->DrawIndexed(
+			range.IndexCount,                         // The number of indices to use
+			location.FirstIndex + range.StartIndex,   // Offset to the first index we want to use
+			location.BaseVertex + range.BaseVertex    // Offset to add to each index when looking up vertices
+		);
+	}
+}
+
+// --------------------------------------------------------
+// Draws the whole mesh instanceCount times, with per-instance
+// data read from startInstance onward in whatever is bound
+// to the second vertex buffer slot
+// --------------------------------------------------------
+void Mesh::DrawInstanced(std::shared_ptr<RenderContext> context, unsigned int instanceCount, unsigned int startInstance) {
+	if (geometry == GeometryArena::InvalidHandle || instanceCount == 0)
+		return;
+
+	GeometryArena& arena = GeometryArena::GetInstance();
+	arena.Bind(geometry);
+	const GeometryRange& location = arena.GetRange(geometry);
+
+	for (const SubMesh& range : subMeshes)
+	{
+		context->DrawIndexedInstanced(
+			range.IndexCount,
+			instanceCount,
+			location.FirstIndex + range.StartIndex,
+			location.BaseVertex + range.BaseVertex,
+			startInstance);
+	}
+}
+
+// --------------------------------------------------------
+// Opens a mesh cache if it was built with the current load
+// options, whether or not its source has changed since
+// --------------------------------------------------------
+static bool OpenCache(const char* cacheFile, MeshCache& cache)
 {
-	// Author: Chris Cascioli
-	// File input object
-	std::ifstream obj(fileName);
+	unsigned int cacheFlags = Mesh::OptimizeOnLoad ? MESH_CACHE_OPTIMIZED : 0;
+	float lodRatios[MESH_CACHE_MAX_LODS];
+	GetCacheLODRatios(lodRatios);
+	return cache.Open(cacheFile)
+		&& cache.GetHeader()->Flags == cacheFlags
+		&& memcmp(cache.GetHeader()->LODRatios, lodRatios, sizeof(lodRatios)) == 0;
+}
+
+// --------------------------------------------------------
+// Gets the OBJ's content hash from an up to date mesh cache,
+// without reading the OBJ itself.  Returns false if there's
+// no cache, or the OBJ changed after it was written.
+// --------------------------------------------------------
+bool Mesh::GetCachedSourceHash(const char* fileName, unsigned long long& hash)
+{
+	unsigned long long sourceSize, sourceWriteTime;
+	if (!MeshCache::GetSourceInfo(fileName, sourceSize, sourceWriteTime))
+		return false;
+
+	MeshCache cache;
+	std::string cacheFile = std::string(fileName) + ".meshcache";
+	if (!OpenCache(cacheFile.c_str(), cache) ||
+		cache.GetHeader()->SourceSize != sourceSize ||
+		cache.GetHeader()->SourceWriteTime != sourceWriteTime)
+		return false;
+
+	hash = cache.GetHeader()->SourceHash;
+	return true;
+}
 
-	// Check for successful open
-	if (!obj.is_open())
+Mesh::Mesh(const char* fileName, bool packed, bool deferUpload)
+{
+	this->packed = packed;
+	this->deferUpload = deferUpload;
+	vertexStride = sizeof(Vertex);
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	geometry = GeometryArena::InvalidHandle;
+	numIndices = 0;
+	sourceHash = 0;
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	unsigned long long sourceSize, sourceWriteTime;
+	if (!MeshCache::GetSourceInfo(fileName, sourceSize, sourceWriteTime))
 		return;
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
+	// Use the binary cache if the OBJ hasn't been modified since it was written
+	// (and was processed with the same options)
+	unsigned int cacheFlags = OptimizeOnLoad ? MESH_CACHE_OPTIMIZED : 0;
+	float lodRatios[MESH_CACHE_MAX_LODS];
+	GetCacheLODRatios(lodRatios);
+	std::string cacheFile = std::string(fileName) + ".meshcache";
+	MeshCache cache;
+	bool cacheOpen = OpenCache(cacheFile.c_str(), cache);
+	if (cacheOpen && cache.GetHeader()->SourceSize == sourceSize && cache.GetHeader()->SourceWriteTime == sourceWriteTime)
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+		sourceHash = cache.GetHeader()->SourceHash;
+		CreateFromCache(cache);
+
+#if defined(DEBUG) || defined(_DEBUG)
+		std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - startTime;
+		printf("Loaded %s from cache: %d vertices, %d indices in %.2f ms\n",
+			fileName, (int)cache.GetHeader()->VertexCount, numIndices, loadTime.count());
+#endif
+		return;
+	}
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
+	// Read the whole file at once and tokenize it in place
+	std::vector<char> fileData;
+	if (!ObjParser::ReadFile(fileName, fileData))
+		return;
+
+	// The file was touched, but if the contents are the same the cache is still good
+	sourceHash = MeshCache::Hash(fileData.data(), fileData.size() - 1);
+	if (cacheOpen && cache.GetHeader()->SourceHash == sourceHash)
+	{
+		MeshCacheHeader header = *cache.GetHeader();
+		CreateFromCache(cache);
+		cache.Close();
+
+		header.SourceSize = sourceSize;
+		header.SourceWriteTime = sourceWriteTime;
+		MeshCache::RewriteHeader(cacheFile.c_str(), header);
+		return;
+	}
+	cache.Close();
+
+	// Large files are parsed in parallel across the whole thread pool
+	ObjParser parser;
+	parser.Parse(fileData.data(), fileData.size() - 1, ThreadPool::GetInstance().GetThreadCount());
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	parser.BuildMesh(verts, indices);
+	if (parser.GetSkippedTriangles() > 0)
+		printf("Skipped %u triangles in %s with out of range indices\n", parser.GetSkippedTriangles(), fileName);
+	if (verts.size() == 0)
+		return;
+
+	// Reorder for the GPU's vertex cache, overdraw and vertex fetch
+	if (OptimizeOnLoad)
+	{
+#if defined(DEBUG) || defined(_DEBUG)
+		VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(indices, (unsigned int)verts.size());
+#endif
+		MeshOptimizer::Optimize(verts, indices);
+#if defined(DEBUG) || defined(_DEBUG)
+		VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(indices, (unsigned int)verts.size());
+		printf("Optimized %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", fileName, before.ACMR, after.ACMR, before.ATVR, after.ATVR);
+#endif
+	}
+
+	CalculateTangents(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+	bounds = CalculateBounds(&verts[0], (int)verts.size());
+
+	// Simplified levels of detail index the same vertices as the full mesh
+	std::vector<float> ratios(lodRatios, lodRatios + (LODRatios.size() < MESH_CACHE_MAX_LODS ? LODRatios.size() : MESH_CACHE_MAX_LODS));
+	std::vector<std::vector<unsigned int>> lodIndices;
+	MeshSimplifier::BuildLODChain(verts, indices, ratios, lodIndices);
+	if (OptimizeOnLoad)
+	{
+		for (std::vector<unsigned int>& lod : lodIndices)
+			MeshOptimizer::OptimizeVertexCache(lod, (unsigned int)verts.size());
+	}
+
+	// Save the final data so later launches can skip parsing
+	MeshCacheHeader header = {};
+	header.Magic = MESH_CACHE_MAGIC;
+	header.Version = MESH_CACHE_VERSION;
+	header.VertexStride = sizeof(Vertex);
+	header.Flags = cacheFlags;
+	header.SourceHash = sourceHash;
+	header.SourceSize = sourceSize;
+	header.SourceWriteTime = sourceWriteTime;
+	header.VertexCount = (unsigned int)verts.size();
+	header.IndexCount = (unsigned int)indices.size();
+	header.Bounds = bounds;
+	memcpy(header.LODRatios, lodRatios, sizeof(lodRatios));
+	header.LODCount = (unsigned int)lodIndices.size();
+	for (unsigned int lod = 0; lod < header.LODCount; lod++)
+		header.LODIndexCounts[lod] = (unsigned int)lodIndices[lod].size();
+	MeshCache::Write(cacheFile.c_str(), header, &verts[0], &indices[0], lodIndices);
+
+	CreateMesh(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+	for (const std::vector<unsigned int>& lod : lodIndices)
+		CreateLOD(&verts[0], (int)verts.size(), lod.data(), (int)lod.size());
+
+#if defined(DEBUG) || defined(_DEBUG)
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - startTime;
+	printf("Loaded %s (%.2f MB): %d vertices, %d indices in %.2f ms\n",
+		fileName, fileData.size() / (1024.0 * 1024.0), (int)verts.size(), (int)indices.size(), loadTime.count());
+	for (size_t lod = 0; lod < lodIndices.size(); lod++)
+		printf("  LOD %d: %d triangles\n", (int)lod + 1, (int)lodIndices[lod].size() / 3);
+#endif
+}
+
+Mesh::Mesh(Vertex* vertices, int numVertices, unsigned int* indices, int numIndices, bool packed) {
+	this->packed = packed;
+	deferUpload = false;
+	sourceHash = 0;
+	vertexStride = sizeof(Vertex);
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	this->numIndices = 0;
+	geometry = GeometryArena::InvalidHandle;
+	CalculateTangents(vertices, numVertices, indices, numIndices);
+	bounds = CalculateBounds(vertices, numVertices);
+	CreateMesh(vertices, numVertices, indices, numIndices);
+}
+
+// --------------------------------------------------------
+// Creates the buffers straight from a mapped cache file,
+// which already has tangents and bounds
+// --------------------------------------------------------
+void Mesh::CreateFromCache(MeshCache& cache) {
+	const MeshCacheHeader* header = cache.GetHeader();
+	bounds = header->Bounds;
+	CreateMesh(cache.GetVertices(), (int)header->VertexCount, cache.GetIndices(), (int)header->IndexCount);
+	for (unsigned int lod = 0; lod < header->LODCount; lod++)
+		CreateLOD(cache.GetVertices(), (int)header->VertexCount, cache.GetLODIndices(lod), (int)header->LODIndexCounts[lod]);
+}
+
+// --------------------------------------------------------
+// Creates a level of detail from indices into this mesh's
+// vertices, keeping only the vertices they use
+// --------------------------------------------------------
+void Mesh::CreateLOD(const Vertex* vertices, int numVertices, const unsigned int* indices, int numIndices) {
+	std::vector<Vertex> lodVertices(vertices, vertices + numVertices);
+	std::vector<unsigned int> lodIndices(indices, indices + numIndices);
+	MeshOptimizer::OptimizeVertexFetch(lodVertices, lodIndices);
+
+	std::shared_ptr<Mesh> lod(new Mesh());
+	lod->packed = packed;
+	lod->deferUpload = deferUpload;
+	lod->bounds = bounds; // Packed positions stay relative to the full mesh's bounds
+	lod->CreateMesh(lodVertices.data(), (int)lodVertices.size(), lodIndices.data(), (int)lodIndices.size());
+	lods.push_back(lod);
+}
+
+BoundingBox Mesh::CalculateBounds(const Vertex* vertices, int numVertices) {
+	BoundingBox box;
+	BoundingBox::CreateFromPoints(box, numVertices, &vertices[0].Position, sizeof(Vertex));
+	return box;
+}
+
+void Mesh::CreateMesh(const Vertex* vertices, int numVertices, const unsigned int* indices, int numIndices) {
+	vertexStride = sizeof(Vertex);
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	subMeshes.clear();
+
+	// Too many vertices for 16-bit indices, so either split the mesh
+	// or draw the whole thing at once with 32-bit indices
+	std::vector<Vertex> splitVertices;
+	std::vector<unsigned int> splitIndices;
+	bool shortIndices = numVertices <= MaxShortIndexVertices;
+	if (!shortIndices && SplitLargeMeshes)
+	{
+		SplitForShortIndices(vertices, numVertices, indices, numIndices, splitVertices, splitIndices, subMeshes);
+		vertices = splitVertices.data();
+		numVertices = (int)splitVertices.size();
+		indices = splitIndices.data();
+		numIndices = (int)splitIndices.size();
+		shortIndices = true;
+
+#if defined(DEBUG) || defined(_DEBUG)
+		printf("Split mesh into %d sub-meshes for 16-bit indices (%d vertices after duplication)\n",
+			(int)subMeshes.size(), numVertices);
+#endif
+	}
+	else
+	{
+		SubMesh whole = { 0, (unsigned int)numIndices, 0 };
+		subMeshes.push_back(whole);
+	}
+	this->numIndices = numIndices;
+
+	// Large meshes are split into meshlets that can be culled separately
+	meshlets.clear();
+	if (BuildMeshlets && numIndices / 3 >= MeshletMinTriangles)
+		MeshletBuilder::Build(vertices, indices, subMeshes, meshlets);
+
+	// Packed meshes upload the compact format instead, which the
+	// cache doesn't store since it depends on the final bounds
+	std::vector<PackedVertex> packedVertices;
+	const void* vertexData = vertices;
+	if (packed)
+	{
+		VertexPacking::EncodeAll(vertices, numVertices, bounds, packedVertices);
+		vertexData = packedVertices.data();
+		vertexStride = sizeof(PackedVertex);
+
+#if defined(DEBUG) || defined(_DEBUG)
+		VertexPackingError error = VertexPacking::MeasureError(vertices, numVertices, bounds);
+		printf("Packed %d vertices (%d -> %d bytes): position %f, normal %.3f deg, tangent %.3f deg, uv %f\n",
+			numVertices, (int)sizeof(Vertex), (int)sizeof(PackedVertex),
+			error.MaxPositionError, error.MaxNormalAngle, error.MaxTangentAngle, error.MaxUVError);
+#endif
+	}
+
+	// Every sub-mesh addresses at most 65,536 vertices from its base,
+	// so the indices can be halved
+	std::vector<unsigned short> shortIndexData;
+	const void* indexData = indices;
+	if (shortIndices)
+	{
+		shortIndexData.resize(numIndices);
+		for (int i = 0; i < numIndices; i++)
+			shortIndexData[i] = (unsigned short)indices[i];
+
+		indexData = shortIndexData.data();
+		indexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
+	// Keep the final data around for Upload, which has to
+	// happen on the thread that owns the device context
+	if (deferUpload)
+	{
+		const unsigned char* vertexBytes = (const unsigned char*)vertexData;
+		const unsigned char* indexBytes = (const unsigned char*)indexData;
+		unsigned int indexSize = shortIndices ? sizeof(unsigned short) : sizeof(unsigned int);
+		pendingVertices.assign(vertexBytes, vertexBytes + (size_t)vertexStride * numVertices);
+		pendingIndices.assign(indexBytes, indexBytes + (size_t)indexSize * numIndices);
+		return;
+	}
+
+	// Copy everything into the shared buffers, which GeometryArena
+	// binds once for every mesh with the same formats
+	geometry = GeometryArena::GetInstance().Allocate(vertexData, vertexStride, numVertices, indexData, indexFormat, numIndices);
+}
+
+// --------------------------------------------------------
+// Copies data prepared by a deferred load into the shared
+// buffers, along with every level of detail
+// --------------------------------------------------------
+void Mesh::Upload() {
+	if (!pendingVertices.empty())
+	{
+		geometry = GeometryArena::GetInstance().Allocate(pendingVertices.data(), vertexStride, (unsigned int)(pendingVertices.size() / vertexStride),
+			pendingIndices.data(), indexFormat, numIndices);
+
+		// Release the memory, not just the contents
+		std::vector<unsigned char>().swap(pendingVertices);
+		std::vector<unsigned char>().swap(pendingIndices);
+	}
+
+	for (auto& lod : lods)
+		lod->Upload();
+}
+
+// --------------------------------------------------------
+// Walks the triangles in order, starting a new sub-mesh
+// whenever the next one would reference more than 65,536
+// vertices.  Each sub-mesh gets its own copy of the
+// vertices it uses (only those shared across a boundary
+// are duplicated), with indices relative to its base.
+// --------------------------------------------------------
+void Mesh::SplitForShortIndices(const Vertex* vertices, int numVertices, const unsigned int* indices, int numIndices,
+	std::vector<Vertex>& outVertices, std::vector<unsigned int>& outIndices, std::vector<SubMesh>& outSubMeshes)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(numVertices, unused);
+	std::vector<unsigned int> remapped;
+	outVertices.reserve(numVertices);
+	outIndices.reserve(numIndices);
+
+	SubMesh current = { 0, 0, 0 };
+	for (int i = 0; i + 2 < numIndices; i += 3)
+	{
+		int added = 0;
+		for (int c = 0; c < 3; c++)
 		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
+			if (remap[indices[i + c]] == unused)
+				added++;
 		}
-		else if (chars[0] == 'v')
+
+		// Close the current sub-mesh if this triangle won't fit
+		if ((int)outVertices.size() - current.BaseVertex + added > MaxShortIndexVertices)
 		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
+			current.IndexCount = (unsigned int)outIndices.size() - current.StartIndex;
+			outSubMeshes.push_back(current);
+
+			for (unsigned int v : remapped)
+				remap[v] = unused;
+			remapped.clear();
+
+			current.StartIndex = (unsigned int)outIndices.size();
+			current.BaseVertex = (int)outVertices.size();
 		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
 
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[i + c];
+			if (remap[v] == unused)
 			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
+				remap[v] = (unsigned int)(outVertices.size() - current.BaseVertex);
+				outVertices.push_back(vertices[v]);
+				remapped.push_back(v);
 			}
+			outIndices.push_back(remap[v]);
 		}
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
+	current.IndexCount = (unsigned int)outIndices.size() - current.StartIndex;
+	if (current.IndexCount > 0)
+		outSubMeshes.push_back(current);
+}
 
-	// Pass loaded data into other constructor
-	CreateMesh(&verts[0], vertCounter, &indices[0], indexCounter, device, context);
+Mesh::Mesh() {
+	packed = false;
+	deferUpload = false;
+	sourceHash = 0;
+	vertexStride = sizeof(Vertex);
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	numIndices = 0;
+	geometry = GeometryArena::InvalidHandle;
 }
 
-Mesh::Mesh(Vertex* vertices, int numVertices, unsigned int* indices, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) {
-	CreateMesh(vertices, numVertices, indices, numIndices, device, context);
+Mesh::~Mesh() {
+	GeometryArena::GetInstance().Free(geometry);
 }
 
-void Mesh::CreateMesh(Vertex* vertices, int numVertices, unsigned int* indices, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) {
-	this->numIndices = numIndices;
-	this->context = context;
+// --------------------------------------------------------
+// Unnormalized tangent of a single triangle, or zero if its
+// uv's are degenerate (its infinite tangent would spread to
+// every shared vertex).  Each lane does the same operations
+// in the same order as the original scalar version, so the
+// results are bit-for-bit identical.
+// --------------------------------------------------------
+static inline XMVECTOR TriangleTangent(const Vertex& v1, const Vertex& v2, const Vertex& v3)
+{
+	// Calculate vectors relative to triangle positions
+	XMVECTOR p1 = XMLoadFloat3(&v1.Position);
+	XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&v2.Position), p1);
+	XMVECTOR e2 = XMVectorSubtract(XMLoadFloat3(&v3.Position), p1);
 
-	CalculateTangents(vertices, numVertices, indices, numIndices);
+	// Do the same for vectors relative to triangle uv's
+	float s1 = v2.UV.x - v1.UV.x;
+	float t1 = v2.UV.y - v1.UV.y;
 
-	// Create the VERTEX BUFFER description
-	D3D11_BUFFER_DESC vbd = {};
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * numVertices; 
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells DirectX this is a vertex buffer
-	vbd.CPUAccessFlags = 0;
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
+	float s2 = v3.UV.x - v1.UV.x;
+	float t2 = v3.UV.y - v1.UV.y;
 
-	// Create the proper struct to hold the initial vertex data
-	D3D11_SUBRESOURCE_DATA initialVertexData = {};
-	initialVertexData.pSysMem = vertices;
+	float denominator = s1 * t2 - s2 * t1;
+	if (denominator == 0.0f)
+		return XMVectorZero();
 
-	// Actually create the buffer with the initial data
-	device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
+	float r = 1.0f / denominator;
+	return XMVectorScale(XMVectorSubtract(XMVectorScale(e1, t2), XMVectorScale(e2, t1)), r);
+}
 
-	// Create the INDEX BUFFER description
-	D3D11_BUFFER_DESC ibd = {};
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * numIndices;
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells DirectX this is an index buffer
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
+// --------------------------------------------------------
+// Unnormalized tangents of four triangles (twelve indices)
+// at once, one triangle per lane.  Each corner's positions
+// and uv's are loaded a triangle per row, then transposed
+// to a component per row, so every operation works on all
+// four triangles.  The lanes do the same operations in the
+// same order as TriangleTangent, so the results match it
+// bit for bit.
+// --------------------------------------------------------
+static inline void TriangleTangents4(const Vertex* verts, const unsigned int* indices, XMFLOAT3* tangents)
+{
+	XMMATRIX positions[3];
+	XMMATRIX uvs[3];
+	for (int c = 0; c < 3; c++)
+	{
+		for (int t = 0; t < 4; t++)
+		{
+			const Vertex& v = verts[indices[t * 3 + c]];
+			positions[c].r[t] = XMLoadFloat3(&v.Position);
+			uvs[c].r[t] = XMLoadFloat2(&v.UV);
+		}
+		positions[c] = XMMatrixTranspose(positions[c]);
+		uvs[c] = XMMatrixTranspose(uvs[c]);
+	}
+
+	XMVECTOR s1 = XMVectorSubtract(uvs[1].r[0], uvs[0].r[0]);
+	XMVECTOR t1 = XMVectorSubtract(uvs[1].r[1], uvs[0].r[1]);
+	XMVECTOR s2 = XMVectorSubtract(uvs[2].r[0], uvs[0].r[0]);
+	XMVECTOR t2 = XMVectorSubtract(uvs[2].r[1], uvs[0].r[1]);
+
+	// Degenerate uv's give a zero tangent, as in TriangleTangent
+	XMVECTOR denominator = XMVectorSubtract(XMVectorMultiply(s1, t2), XMVectorMultiply(s2, t1));
+	XMVECTOR degenerate = XMVectorEqual(denominator, XMVectorZero());
+	XMVECTOR r = XMVectorDivide(XMVectorSplatOne(), denominator);
 
-	// Create the proper struct to hold the initial index data
-	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = indices;
+	XMFLOAT4A components[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		XMVECTOR e1 = XMVectorSubtract(positions[1].r[axis], positions[0].r[axis]);
+		XMVECTOR e2 = XMVectorSubtract(positions[2].r[axis], positions[0].r[axis]);
+		XMVECTOR tangent = XMVectorMultiply(XMVectorSubtract(XMVectorMultiply(e1, t2), XMVectorMultiply(e2, t1)), r);
+		XMStoreFloat4A(&components[axis], XMVectorSelect(tangent, XMVectorZero(), degenerate));
+	}
 
-	// Actually create the buffer with the initial data
-	device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+	tangents[0] = XMFLOAT3(components[0].x, components[1].x, components[2].x);
+	tangents[1] = XMFLOAT3(components[0].y, components[1].y, components[2].y);
+	tangents[2] = XMFLOAT3(components[0].z, components[1].z, components[2].z);
+	tangents[3] = XMFLOAT3(components[0].w, components[1].w, components[2].w);
 }
 
-Mesh::~Mesh() {}
+// --------------------------------------------------------
+// Tangents of triangles first through end - 1, four at a
+// time and the last few one at a time
+// --------------------------------------------------------
+static void TriangleTangents(const Vertex* verts, const unsigned int* indices, int first, int end, XMFLOAT3* tangents)
+{
+	int t = first;
+	for (; t + 4 <= end; t += 4)
+	{
+		TriangleTangents4(verts, &indices[t * 3], &tangents[t - first]);
+	}
+	for (; t < end; t++)
+	{
+		const unsigned int* triangle = &indices[t * 3];
+		XMStoreFloat3(&tangents[t - first], TriangleTangent(verts[triangle[0]], verts[triangle[1]], verts[triangle[2]]));
+	}
+}
+
+// --------------------------------------------------------
+// Use Gram-Schmidt orthonormalize to ensure the normal and
+// tangent are exactly 90 degrees apart
+// --------------------------------------------------------
+static inline void OrthonormalizeTangent(Vertex& vertex, XMVECTOR tangent)
+{
+	XMVECTOR normal = XMLoadFloat3(&vertex.Normal);
+	tangent = XMVector3Normalize(
+		tangent - normal * XMVector3Dot(normal, tangent));
+	XMStoreFloat3(&vertex.Tangent, tangent);
+}
 
 // --------------------------------------------------------
 // Author: Chris Cascioli
@@ -289,76 +671,90 @@ Mesh::~Mesh() {}
 //         contain an XMFLOAT3 called Tangent
 //
 // - Be sure to call this BEFORE creating your D3D vertex/index buffers
+//
+// - Modified to use DirectXMath vectors, four triangles at
+//   a time, and on large meshes to split the work across
+//   the thread pool.  Each vertex still sums its triangles'
+//   tangents in index order, so the output matches the
+//   single threaded version exactly.
 // --------------------------------------------------------
 void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	int numTriangles = numIndices / 3;
+	ThreadPool& pool = ThreadPool::GetInstance();
+	if (numTriangles < ParallelTangentTriangles || pool.GetThreadCount() == 1)
 	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+		// Reset tangents
+		for (int i = 0; i < numVerts; i++)
+		{
+			verts[i].Tangent = XMFLOAT3(0, 0, 0);
+		}
+
+		// Calculate tangents four whole triangles at a time,
+		// adding them to each vert of each triangle
+		for (int first = 0; first < numTriangles; first += 4)
+		{
+			XMFLOAT3 tangents[4];
+			int end = first + 4 < numTriangles ? first + 4 : numTriangles;
+			TriangleTangents(verts, indices, first, end, tangents);
+			for (int t = first; t < end; t++)
+			{
+				XMVECTOR tangent = XMLoadFloat3(&tangents[t - first]);
+				for (int c = 0; c < 3; c++)
+				{
+					Vertex& v = verts[indices[t * 3 + c]];
+					XMStoreFloat3(&v.Tangent, XMVectorAdd(XMLoadFloat3(&v.Tangent), tangent));
+				}
+			}
+		}
+
+		// Ensure all of the tangents are orthogonal to the normals
+		for (int i = 0; i < numVerts; i++)
+		{
+			OrthonormalizeTangent(verts[i], XMLoadFloat3(&verts[i].Tangent));
+		}
+		return;
 	}
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+	// Every triangle's tangent is independent, so those can be done in batches
+	const int batchSize = 16384;
+	std::vector<XMFLOAT3> triangleTangents(numTriangles);
+	pool.ParallelFor((numTriangles + batchSize - 1) / batchSize, [&](size_t batch) {
+		int first = (int)batch * batchSize;
+		int end = first + batchSize < numTriangles ? first + batchSize : numTriangles;
+		TriangleTangents(verts, indices, first, end, &triangleTangents[first]);
+	});
+
+	// Vertex to triangle adjacency, one entry per corner in
+	// index order, so no two threads write the same vertex
+	std::vector<unsigned int> cornerStart(numVerts + 1, 0);
+	for (int i = 0; i < numTriangles * 3; i++)
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
+		cornerStart[indices[i] + 1]++;
 	}
-
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
+	for (int v = 0; v < numVerts; v++)
 	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
+		cornerStart[v + 1] += cornerStart[v];
+	}
 
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
+	std::vector<unsigned int> cornerTriangles(numTriangles * 3);
+	std::vector<unsigned int> fill(cornerStart.begin(), cornerStart.end() - 1);
+	for (int i = 0; i < numTriangles * 3; i++)
+	{
+		cornerTriangles[fill[indices[i]]++] = (unsigned int)(i / 3);
 	}
-}
\ No newline at end of file
+
+	// Gather each vertex's tangents, then orthonormalize
+	pool.ParallelFor((numVerts + batchSize - 1) / batchSize, [&](size_t batch) {
+		int end = (int)(batch + 1) * batchSize < numVerts ? (int)(batch + 1) * batchSize : numVerts;
+		for (int v = (int)batch * batchSize; v < end; v++)
+		{
+			XMVECTOR tangent = XMVectorZero();
+			for (unsigned int c = cornerStart[v]; c < cornerStart[v + 1]; c++)
+			{
+				tangent = XMVectorAdd(tangent, XMLoadFloat3(&triangleTangents[cornerTriangles[c]]));
+			}
+			OrthonormalizeTangent(verts[v], tangent);
+		}
+	});
+}
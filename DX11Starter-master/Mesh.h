@@ -1,26 +1,112 @@
 #pragma once
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <DirectXCollision.h>
+#include <vector>
+#include <memory>
 #include "Vertex.h"
+#include "SubMesh.h"
+#include "Meshlet.h"
+#include "RenderContext.h"
+
+class MeshCache;
 
 class Mesh
 {
 private:
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
-	void CreateMesh(Vertex* vertices, int numVertices, unsigned int* indices, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	unsigned int geometry; // Handle to the vertices and indices in GeometryArena
+	void CreateMesh(const Vertex* vertices, int numVertices, const unsigned int* indices, int numIndices);
+	void CreateFromCache(MeshCache& cache);
+	void CreateLOD(const Vertex* vertices, int numVertices, const unsigned int* indices, int numIndices);
+	DirectX::BoundingBox CalculateBounds(const Vertex* vertices, int numVertices);
+	static void SplitForShortIndices(const Vertex* vertices, int numVertices, const unsigned int* indices, int numIndices,
+		std::vector<Vertex>& outVertices, std::vector<unsigned int>& outIndices, std::vector<SubMesh>& outSubMeshes);
 	int numIndices;
+	DirectX::BoundingBox bounds;
+	bool packed;
+	unsigned long long sourceHash;
+	unsigned int vertexStride;
+	DXGI_FORMAT indexFormat;
+	std::vector<SubMesh> subMeshes;
+	std::vector<std::shared_ptr<Mesh>> lods;
+	std::vector<Meshlet> meshlets;
+
+	// Deferred loads hold their final vertex and index data here until Upload
+	bool deferUpload;
+	std::vector<unsigned char> pendingVertices;
+	std::vector<unsigned char> pendingIndices;
+
+	// Indices 0 - 65535 fit in an unsigned short
+	static const int MaxShortIndexVertices = 65536;
+
+	// Smaller meshes are cheaper to draw whole than to cull
+	static const int MeshletMinTriangles = 4096;
+
+	// Smaller meshes calculate tangents on one thread
+	static const int ParallelTangentTriangles = 65536;
+
+	// For levels of detail, which fill themselves in
+	Mesh();
 
 public:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
+	unsigned int GetGeometry(); // GeometryArena handle
 	int GetIndexCount();
-	void Draw();
+	DXGI_FORMAT GetIndexFormat();
+	const std::vector<SubMesh>& GetSubMeshes();
+	const std::vector<Meshlet>& GetMeshlets(); // Empty if the mesh wasn't split
+
+	// Level 0 is this mesh, and higher levels have fewer triangles.
+	// Levels past the last return the last.
+	int GetLODCount();
+	Mesh* GetLOD(int level);
+	DirectX::BoundingBox GetBounds();
+
+	// Bytes of vertex and index data, including every level of detail
+	unsigned long long GetMemoryFootprint();
 
-	Mesh(const char* fileName, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
-	Mesh(Vertex* vertices, int numVertices, unsigned int* indices, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	// Hash of the OBJ's contents (MeshCache::Hash), or 0 if not loaded from a file
+	unsigned long long GetSourceHash();
+	static bool GetCachedSourceHash(const char* fileName, unsigned long long& hash);
+	void Draw(std::shared_ptr<RenderContext> context);
+	void Draw(std::shared_ptr<RenderContext> context, const std::vector<SubMesh>& ranges);
+	void DrawInstanced(std::shared_ptr<RenderContext> context, unsigned int instanceCount, unsigned int startInstance);
+	void Upload();
+
+	// Packed meshes store PackedVertex data and need a shader like
+	// PackedVertexShader, given the position offset and scale below
+	bool IsPacked();
+	DirectX::XMFLOAT3 GetPositionOffset();
+	DirectX::XMFLOAT3 GetPositionScale();
+
+	// With deferUpload, the file is loaded without touching the render
+	// context (so it's safe on another thread), and can't be drawn
+	// until Upload is called on the thread that owns the context
+	Mesh(const char* fileName, bool packed = false, bool deferUpload = false);
+	Mesh(Vertex* vertices, int numVertices, unsigned int* indices, int numIndices, bool packed = false);
 	~Mesh();
+
+	// Each mesh owns its range of the shared buffers
+	Mesh(Mesh const&) = delete;
+	void operator=(Mesh const&) = delete;
+
+	// Whether OBJ files are run through MeshOptimizer before upload
+	static bool OptimizeOnLoad;
+
+	// Whether meshes with more than 65,536 vertices are split into
+	// sub-meshes with 16-bit indices, rather than using 32-bit indices
+	static bool SplitLargeMeshes;
+
+	// Whether large meshes are split into meshlets, which Entity culls
+	// against the frustum and their normal cones before drawing
+	static bool BuildMeshlets;
+
+	// Triangle ratios (of the full mesh) for the levels of detail built
+	// when loading OBJ files, at most MESH_CACHE_MAX_LODS of them
+	static std::vector<float> LODRatios;
+
+	// Fills in every vertex's tangent from its triangles' positions and uv's
+	static void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 };
 
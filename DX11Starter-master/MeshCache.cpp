@@ -0,0 +1,203 @@
+#include "MeshCache.h"
+#include <fstream>
+#include <string>
+#include <string.h>
+
+MeshCache::MeshCache()
+{
+	file = INVALID_HANDLE_VALUE;
+	mapping = 0;
+	view = 0;
+}
+
+MeshCache::~MeshCache()
+{
+	Close();
+}
+
+// --------------------------------------------------------
+// Maps the cache file into memory.  Fails if the file is
+// missing, truncated or was written by a different
+// version or Vertex layout.
+// --------------------------------------------------------
+bool MeshCache::Open(const char* cacheFile)
+{
+	Close();
+
+	file = CreateFileA(cacheFile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if(file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(MeshCacheHeader)) {
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if(mapping) {
+		view = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if(!view) {
+		Close();
+		return false;
+	}
+
+	const MeshCacheHeader* header = GetHeader();
+	unsigned long long expectedSize = sizeof(MeshCacheHeader)
+		+ (unsigned long long)header->VertexCount * sizeof(Vertex)
+		+ (unsigned long long)header->IndexCount * sizeof(unsigned int);
+	for(unsigned int lod = 0; lod < header->LODCount && lod < MESH_CACHE_MAX_LODS; lod++) {
+		expectedSize += (unsigned long long)header->LODIndexCounts[lod] * sizeof(unsigned int);
+	}
+
+	if(header->Magic != MESH_CACHE_MAGIC
+		|| header->Version != MESH_CACHE_VERSION
+		|| header->VertexStride != sizeof(Vertex)
+		|| header->LODCount > MESH_CACHE_MAX_LODS
+		|| (unsigned long long)fileSize.QuadPart != expectedSize)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshCache::Close()
+{
+	if(view) {
+		UnmapViewOfFile(view);
+		view = 0;
+	}
+	if(mapping) {
+		CloseHandle(mapping);
+		mapping = 0;
+	}
+	if(file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+}
+
+const MeshCacheHeader* MeshCache::GetHeader()
+{
+	return (const MeshCacheHeader*)view;
+}
+
+const Vertex* MeshCache::GetVertices()
+{
+	return (const Vertex*)(view + sizeof(MeshCacheHeader));
+}
+
+const unsigned int* MeshCache::GetIndices()
+{
+	return (const unsigned int*)(view + sizeof(MeshCacheHeader) + GetHeader()->VertexCount * sizeof(Vertex));
+}
+
+const unsigned int* MeshCache::GetLODIndices(unsigned int lod)
+{
+	const unsigned int* indices = GetIndices() + GetHeader()->IndexCount;
+	for(unsigned int i = 0; i < lod; i++) {
+		indices += GetHeader()->LODIndexCounts[i];
+	}
+	return indices;
+}
+
+// --------------------------------------------------------
+// Writes a new cache file.  Data goes to a temporary file
+// first so a crash mid-write never leaves a cache that
+// looks valid.  The temporary file is named for the
+// writing process and thread, since packed and unpacked
+// loads of the same file can write at the same time; the
+// last one to finish replaces the cache.
+// --------------------------------------------------------
+bool MeshCache::Write(const char* cacheFile, const MeshCacheHeader& header, const Vertex* vertices, const unsigned int* indices,
+	const std::vector<std::vector<unsigned int>>& lodIndices)
+{
+	std::string tempFile = std::string(cacheFile) + "." + std::to_string(GetCurrentProcessId()) + "." +
+		std::to_string(GetCurrentThreadId()) + ".tmp";
+	{
+		std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+		if(!out.is_open()) {
+			return false;
+		}
+
+		out.write((const char*)&header, sizeof(MeshCacheHeader));
+		out.write((const char*)vertices, (std::streamsize)header.VertexCount * sizeof(Vertex));
+		out.write((const char*)indices, (std::streamsize)header.IndexCount * sizeof(unsigned int));
+		for(unsigned int lod = 0; lod < header.LODCount; lod++) {
+			out.write((const char*)lodIndices[lod].data(), (std::streamsize)header.LODIndexCounts[lod] * sizeof(unsigned int));
+		}
+		if(!out.good()) {
+			out.close();
+			DeleteFileA(tempFile.c_str());
+			return false;
+		}
+	}
+
+	return MoveFileExA(tempFile.c_str(), cacheFile, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+// --------------------------------------------------------
+// Overwrites just the header, for when the source file was
+// touched but its contents did not change
+// --------------------------------------------------------
+bool MeshCache::RewriteHeader(const char* cacheFile, const MeshCacheHeader& header)
+{
+	std::fstream out(cacheFile, std::ios::binary | std::ios::in | std::ios::out);
+	if(!out.is_open()) {
+		return false;
+	}
+
+	out.write((const char*)&header, sizeof(MeshCacheHeader));
+	return out.good();
+}
+
+// --------------------------------------------------------
+// 64-bit content hash.  Four independent lanes consume
+// 32 bytes per step so the multiplies overlap, which keeps
+// hashing far cheaper than parsing the text it covers.
+// --------------------------------------------------------
+unsigned long long MeshCache::Hash(const char* data, size_t size)
+{
+	const unsigned long long prime1 = 0x9E3779B185EBCA87ull;
+	const unsigned long long prime2 = 0xC2B2AE3D27D4EB4Full;
+
+	unsigned long long lanes[4] = { prime1, prime2, prime1 ^ prime2, ~prime1 };
+	size_t i = 0;
+	for(; i + 32 <= size; i += 32) {
+		for(int l = 0; l < 4; l++) {
+			unsigned long long word;
+			memcpy(&word, data + i + l * 8, 8);
+			lanes[l] = (lanes[l] ^ word) * prime1;
+			lanes[l] ^= lanes[l] >> 29;
+		}
+	}
+
+	unsigned long long hash = size * prime2;
+	for(int l = 0; l < 4; l++) {
+		hash = (hash ^ lanes[l]) * prime1;
+	}
+	for(; i < size; i++) {
+		hash = (hash ^ (unsigned char)data[i]) * prime2;
+	}
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	return hash;
+}
+
+bool MeshCache::GetSourceInfo(const char* fileName, unsigned long long& size, unsigned long long& writeTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if(!GetFileAttributesExA(fileName, GetFileExInfoStandard, &attributes)) {
+		return false;
+	}
+
+	size = ((unsigned long long)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	writeTime = ((unsigned long long)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <Windows.h>
+#include <DirectXCollision.h>
+#include <vector>
+#include "Vertex.h"
+
+#define MESH_CACHE_MAGIC 0x4348534D // "MSHC"
+#define MESH_CACHE_VERSION 3
+
+// Header flags for how the cached data was processed
+#define MESH_CACHE_OPTIMIZED 1
+
+// Most simplified levels of detail a cache can hold
+#define MESH_CACHE_MAX_LODS 4
+
+// --------------------------------------------------------
+// Header at the start of a .meshcache file.  The vertex
+// array (with tangents already calculated) follows it
+// directly, then the index array, then the index arrays of
+// each level of detail (which use the same vertices).
+// --------------------------------------------------------
+struct MeshCacheHeader
+{
+	unsigned int Magic;
+	unsigned int Version;
+	unsigned int VertexStride; // sizeof(Vertex) when written, so layout changes invalidate old caches
+	unsigned int Flags;
+	unsigned long long SourceHash; // Hash of the OBJ file's contents
+	unsigned long long SourceSize;
+	unsigned long long SourceWriteTime;
+	unsigned int VertexCount;
+	unsigned int IndexCount;
+	DirectX::BoundingBox Bounds;
+	float LODRatios[MESH_CACHE_MAX_LODS]; // Requested ratios, zero when unused
+	unsigned int LODCount;                // Levels actually built, which can be fewer
+	unsigned int LODIndexCounts[MESH_CACHE_MAX_LODS];
+};
+
+// --------------------------------------------------------
+// A memory-mapped, read only view of a mesh cache file
+// --------------------------------------------------------
+class MeshCache
+{
+public:
+	MeshCache();
+	~MeshCache();
+
+	bool Open(const char* cacheFile);
+	void Close();
+
+	const MeshCacheHeader* GetHeader();
+	const Vertex* GetVertices();
+	const unsigned int* GetIndices();
+	const unsigned int* GetLODIndices(unsigned int lod);
+
+	static bool Write(const char* cacheFile, const MeshCacheHeader& header, const Vertex* vertices, const unsigned int* indices,
+		const std::vector<std::vector<unsigned int>>& lodIndices);
+	static bool RewriteHeader(const char* cacheFile, const MeshCacheHeader& header);
+
+	static unsigned long long Hash(const char* data, size_t size);
+	static bool GetSourceInfo(const char* fileName, unsigned long long& size, unsigned long long& writeTime);
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const unsigned char* view;
+};
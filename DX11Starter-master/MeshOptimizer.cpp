@@ -0,0 +1,287 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <math.h>
+using namespace DirectX;
+
+void MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned int> clusterStarts;
+	OptimizeVertexCache(indices, (unsigned int)vertices.size(), &clusterStarts);
+	OptimizeOverdraw(indices, vertices, clusterStarts);
+	OptimizeVertexFetch(vertices, indices);
+}
+
+// --------------------------------------------------------
+// Tipsify: repeatedly "fans" around a vertex, emitting all
+// of its remaining triangles, then moves to whichever
+// vertex just emitted will still be in the cache after its
+// own triangles are drawn.  When none qualify, it falls
+// back to recently used vertices, then to the next vertex
+// in order that still has triangles left.
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount, std::vector<unsigned int>* clusterStarts)
+{
+	size_t triangleCount = indices.size() / 3;
+	if(triangleCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+	// Vertex to triangle adjacency, stored flat
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for(unsigned int index : indices) {
+		liveTriangles[index]++;
+	}
+
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+	for(unsigned int v = 0; v < vertexCount; v++) {
+		adjacencyStart[v + 1] = adjacencyStart[v] + liveTriangles[v];
+	}
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for(size_t t = 0; t < triangleCount; t++) {
+		for(int c = 0; c < 3; c++) {
+			adjacency[fill[indices[t * 3 + c]]++] = (unsigned int)t;
+		}
+	}
+
+	// Cache time stamps start far enough back that nothing is cached
+	std::vector<int> cacheTime(vertexCount, 0);
+	int timeStamp = CacheSize + 1;
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnds;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	unsigned int cursor = 0;
+	int fanning = 0;
+	bool newCluster = true;
+
+	while(fanning >= 0) {
+		if(newCluster && clusterStarts) {
+			clusterStarts->push_back((unsigned int)output.size());
+		}
+
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for(unsigned int a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++) {
+			unsigned int t = adjacency[a];
+			if(emitted[t]) {
+				continue;
+			}
+
+			for(int c = 0; c < 3; c++) {
+				unsigned int v = indices[t * 3 + c];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+
+				if(timeStamp - cacheTime[v] > (int)CacheSize) {
+					cacheTime[v] = timeStamp++;
+				}
+			}
+			emitted[t] = true;
+		}
+
+		// Prefer the candidate that has been in the cache longest
+		// but will still be there once its triangles are emitted
+		int next = -1;
+		int bestPriority = -1;
+		for(unsigned int v : candidates) {
+			if(liveTriangles[v] == 0) {
+				continue;
+			}
+
+			int priority = 0;
+			if(timeStamp - cacheTime[v] + 2 * (int)liveTriangles[v] <= (int)CacheSize) {
+				priority = timeStamp - cacheTime[v];
+			}
+
+			if(priority > bestPriority) {
+				bestPriority = priority;
+				next = (int)v;
+			}
+		}
+
+		newCluster = false;
+		if(next == -1) {
+			// Dead end, so try recently used vertices first
+			while(!deadEnds.empty() && next == -1) {
+				unsigned int d = deadEnds.back();
+				deadEnds.pop_back();
+				if(liveTriangles[d] > 0) {
+					next = (int)d;
+				}
+			}
+
+			// Otherwise take the next vertex with triangles left
+			while(next == -1 && cursor < vertexCount) {
+				if(liveTriangles[cursor] > 0) {
+					next = (int)cursor;
+				}
+				cursor++;
+			}
+
+			// Jumping to a vertex that has fallen out of the
+			// cache is a safe place to start a new cluster
+			newCluster = next >= 0 && timeStamp - cacheTime[next] > (int)CacheSize;
+		}
+
+		fanning = next;
+	}
+
+	indices.swap(output);
+}
+
+// --------------------------------------------------------
+// Sorts the clusters by how far they face away from the
+// center of the mesh.  Outward facing clusters tend to
+// occlude the rest, so drawing them first lets the depth
+// test reject more pixels from every viewpoint.
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& clusterStarts)
+{
+	size_t clusterCount = clusterStarts.size();
+	if(clusterCount < 2) {
+		return;
+	}
+
+	struct Cluster
+	{
+		unsigned int Start;
+		unsigned int End;
+		float Area;
+		XMFLOAT3 Centroid;
+		XMFLOAT3 Normal;
+		float Sort;
+	};
+
+	std::vector<Cluster> clusters(clusterCount);
+	float meshArea = 0.0f;
+	XMFLOAT3 meshCentroid(0.0f, 0.0f, 0.0f);
+
+	for(size_t c = 0; c < clusterCount; c++) {
+		Cluster& cluster = clusters[c];
+		cluster.Start = clusterStarts[c];
+		cluster.End = c + 1 < clusterCount ? clusterStarts[c + 1] : (unsigned int)indices.size();
+		cluster.Area = 0.0f;
+		cluster.Centroid = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		cluster.Normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+		// Area weighted centroid and normal of the cluster's triangles
+		for(unsigned int i = cluster.Start; i + 2 < cluster.End; i += 3) {
+			const XMFLOAT3& p0 = vertices[indices[i]].Position;
+			const XMFLOAT3& p1 = vertices[indices[i + 1]].Position;
+			const XMFLOAT3& p2 = vertices[indices[i + 2]].Position;
+
+			float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+			float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+			float nx = e1y * e2z - e1z * e2y;
+			float ny = e1z * e2x - e1x * e2z;
+			float nz = e1x * e2y - e1y * e2x;
+			float area = sqrtf(nx * nx + ny * ny + nz * nz) * 0.5f;
+
+			cluster.Normal.x += nx;
+			cluster.Normal.y += ny;
+			cluster.Normal.z += nz;
+			cluster.Centroid.x += (p0.x + p1.x + p2.x) / 3.0f * area;
+			cluster.Centroid.y += (p0.y + p1.y + p2.y) / 3.0f * area;
+			cluster.Centroid.z += (p0.z + p1.z + p2.z) / 3.0f * area;
+			cluster.Area += area;
+		}
+
+		meshCentroid.x += cluster.Centroid.x;
+		meshCentroid.y += cluster.Centroid.y;
+		meshCentroid.z += cluster.Centroid.z;
+		meshArea += cluster.Area;
+
+		if(cluster.Area > 0.0f) {
+			cluster.Centroid.x /= cluster.Area;
+			cluster.Centroid.y /= cluster.Area;
+			cluster.Centroid.z /= cluster.Area;
+		}
+	}
+
+	if(meshArea > 0.0f) {
+		meshCentroid.x /= meshArea;
+		meshCentroid.y /= meshArea;
+		meshCentroid.z /= meshArea;
+	}
+
+	for(Cluster& cluster : clusters) {
+		float length = sqrtf(cluster.Normal.x * cluster.Normal.x + cluster.Normal.y * cluster.Normal.y + cluster.Normal.z * cluster.Normal.z);
+		cluster.Sort = 0.0f;
+		if(length > 0.0f) {
+			cluster.Sort = ((cluster.Centroid.x - meshCentroid.x) * cluster.Normal.x
+				+ (cluster.Centroid.y - meshCentroid.y) * cluster.Normal.y
+				+ (cluster.Centroid.z - meshCentroid.z) * cluster.Normal.z) / length;
+		}
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.Sort > b.Sort; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for(const Cluster& cluster : clusters) {
+		output.insert(output.end(), indices.begin() + cluster.Start, indices.begin() + cluster.End);
+	}
+	indices.swap(output);
+}
+
+// --------------------------------------------------------
+// Renumbers vertices in order of first use.  Vertices no
+// triangle references are dropped.
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(vertices.size(), unused);
+	std::vector<Vertex> output;
+	output.reserve(vertices.size());
+
+	for(unsigned int& index : indices) {
+		if(remap[index] == unused) {
+			remap[index] = (unsigned int)output.size();
+			output.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(output);
+}
+
+// --------------------------------------------------------
+// Simulates a FIFO cache of the given size to estimate how
+// many times the vertex shader would run
+// --------------------------------------------------------
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if(indices.size() < 3 || vertexCount == 0) {
+		return stats;
+	}
+
+	// A vertex is cached if fewer than cacheSize misses happened since it was loaded
+	std::vector<long long> loadedAt(vertexCount, -(long long)cacheSize - 1);
+	std::vector<bool> referenced(vertexCount, false);
+	long long misses = 0;
+	unsigned int uniqueVertices = 0;
+
+	for(unsigned int index : indices) {
+		if(misses - loadedAt[index] > (long long)cacheSize) {
+			loadedAt[index] = misses++;
+		}
+		if(!referenced[index]) {
+			referenced[index] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.Transforms = (unsigned int)misses;
+	stats.ACMR = (float)misses / (indices.size() / 3);
+	stats.ATVR = (float)misses / uniqueVertices;
+	return stats;
+}
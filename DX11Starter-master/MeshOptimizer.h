@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Results of simulating a FIFO post-transform cache
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int Transforms; // Vertex shader invocations (cache misses)
+	float ACMR;              // Average cache miss ratio: transforms per triangle
+	float ATVR;              // Average transform to vertex ratio: 1.0 is ideal
+};
+
+// --------------------------------------------------------
+// CPU-side reordering of indexed triangle lists for the
+// GPU's caches, run between loading and buffer creation
+//
+// - OptimizeVertexCache: Tipsify (Sander, Nehab, Barczak 2007)
+//   reorders triangles so shared vertices stay in the
+//   post-transform cache
+// - OptimizeOverdraw: sorts the clusters Tipsify produced
+//   so outward facing ones draw first, without breaking
+//   the cache order inside each cluster
+// - OptimizeVertexFetch: renumbers vertices in the order
+//   they are first used, so fetches walk memory linearly
+// --------------------------------------------------------
+class MeshOptimizer
+{
+public:
+	// Runs all three stages in order
+	static void Optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+	// clusterStarts receives the first index of each cluster, for OptimizeOverdraw
+	static void OptimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount, std::vector<unsigned int>* clusterStarts = 0);
+	static void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& clusterStarts);
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = 16);
+
+	// Cache size Tipsify optimizes for, which suits most GPUs
+	static const unsigned int CacheSize = 16;
+};
@@ -0,0 +1,296 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <unordered_map>
+#include <string.h>
+#include <math.h>
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Symmetric 4x4 matrix summing the squared distances to a
+// set of planes, stored as its upper triangle
+// --------------------------------------------------------
+struct Quadric
+{
+	double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+	void AddPlane(double a, double b, double c, double d, double weight)
+	{
+		a2 += a * a * weight; ab += a * b * weight; ac += a * c * weight; ad += a * d * weight;
+		b2 += b * b * weight; bc += b * c * weight; bd += b * d * weight;
+		c2 += c * c * weight; cd += c * d * weight;
+		d2 += d * d * weight;
+	}
+
+	void Add(const Quadric& q)
+	{
+		a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+		b2 += q.b2; bc += q.bc; bd += q.bd;
+		c2 += q.c2; cd += q.cd;
+		d2 += q.d2;
+	}
+
+	double Error(const XMFLOAT3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+			+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+			+ c2 * z * z + 2 * cd * z
+			+ d2;
+		return error > 0.0 ? error : 0.0;
+	}
+};
+
+struct Collapse
+{
+	unsigned int From;
+	unsigned int To;
+	float Cost;
+};
+
+struct PositionKey
+{
+	unsigned int Bits[3];
+	bool operator==(const PositionKey& other) const { return memcmp(Bits, other.Bits, sizeof(Bits)) == 0; }
+};
+
+struct PositionKeyHash
+{
+	size_t operator()(const PositionKey& key) const
+	{
+		unsigned int hash = 2166136261u;
+		for (int i = 0; i < 3; i++)
+			hash = (hash ^ key.Bits[i]) * 16777619u;
+		return hash;
+	}
+};
+
+static XMFLOAT3 TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+{
+	float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+	float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+	return XMFLOAT3(e1y * e2z - e1z * e2y, e1z * e2x - e1x * e2z, e1x * e2y - e1y * e2x);
+}
+
+float MeshSimplifier::Simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	unsigned int targetIndexCount, std::vector<unsigned int>& result, float maxError)
+{
+	result = indices;
+	unsigned int vertexCount = (unsigned int)vertices.size();
+	if (result.size() <= targetIndexCount || vertexCount == 0)
+		return 0.0f;
+
+	// Group vertices by position, since seams split one position into several vertices
+	std::vector<unsigned int> positionId(vertexCount);
+	std::vector<unsigned int> positionUses;
+	{
+		std::unordered_map<PositionKey, unsigned int, PositionKeyHash> positions;
+		positions.reserve(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; v++)
+		{
+			PositionKey key;
+			memcpy(key.Bits, &vertices[v].Position, sizeof(key.Bits));
+			auto inserted = positions.insert(std::make_pair(key, (unsigned int)positionUses.size()));
+			if (inserted.second)
+				positionUses.push_back(0);
+			positionId[v] = inserted.first->second;
+			positionUses[positionId[v]]++;
+		}
+	}
+
+	// Edges used by exactly one triangle are on a border, and
+	// edges used by more than two are non-manifold
+	std::vector<bool> locked(vertexCount, false);
+	{
+		std::unordered_map<unsigned long long, unsigned int> edgeUses;
+		edgeUses.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			unsigned int a = positionId[result[i]];
+			unsigned int b = positionId[result[i % 3 == 2 ? i - 2 : i + 1]];
+			unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+			edgeUses[key]++;
+		}
+
+		std::vector<bool> lockedPosition(positionUses.size(), false);
+		for (auto& edge : edgeUses)
+		{
+			if (edge.second != 2)
+			{
+				lockedPosition[(unsigned int)(edge.first >> 32)] = true;
+				lockedPosition[(unsigned int)(edge.first & 0xFFFFFFFF)] = true;
+			}
+		}
+
+		for (unsigned int v = 0; v < vertexCount; v++)
+			locked[v] = lockedPosition[positionId[v]] || positionUses[positionId[v]] > 1;
+	}
+
+	// Each vertex starts with the planes of its triangles, weighted by area
+	std::vector<Quadric> quadrics(vertexCount);
+	memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+	for (size_t i = 0; i + 2 < result.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = vertices[result[i]].Position;
+		XMFLOAT3 n = TriangleNormal(p0, vertices[result[i + 1]].Position, vertices[result[i + 2]].Position);
+		double length = sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+		if (length == 0.0)
+			continue;
+
+		double a = n.x / length, b = n.y / length, c = n.z / length;
+		double d = -(a * p0.x + b * p0.y + c * p0.z);
+		for (int c3 = 0; c3 < 3; c3++)
+			quadrics[result[i + c3]].AddPlane(a, b, c, d, length * 0.5);
+	}
+
+	std::vector<unsigned int> triangleStart(vertexCount + 1);
+	std::vector<unsigned int> triangles;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<Collapse> collapses;
+	float resultError = 0.0f;
+
+	// Each pass collapses as many independent edges as it can,
+	// cheapest first, then rebuilds the triangle list
+	while (result.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		// Vertex to triangle adjacency
+		std::fill(triangleStart.begin(), triangleStart.end(), 0);
+		for (unsigned int index : result)
+			triangleStart[index + 1]++;
+		for (unsigned int v = 0; v < vertexCount; v++)
+			triangleStart[v + 1] += triangleStart[v];
+
+		triangles.resize(result.size());
+		std::vector<unsigned int> fill(triangleStart.begin(), triangleStart.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			triangles[fill[result[i]]++] = (unsigned int)(i / 3);
+
+		// Every edge can collapse either way, as long as the vertex that moves isn't locked
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i++)
+		{
+			unsigned int a = result[i];
+			unsigned int b = result[i % 3 == 2 ? i - 2 : i + 1];
+			const XMFLOAT3& pa = vertices[a].Position;
+			const XMFLOAT3& pb = vertices[b].Position;
+			if (!locked[a])
+			{
+				Collapse collapse = { a, b, (float)(quadrics[a].Error(pb) + quadrics[b].Error(pb)) };
+				collapses.push_back(collapse);
+			}
+			if (!locked[b])
+			{
+				Collapse collapse = { b, a, (float)(quadrics[a].Error(pa) + quadrics[b].Error(pa)) };
+				collapses.push_back(collapse);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.Cost < y.Cost; });
+
+		// Each collapse removes about two triangles
+		size_t targetTriangles = targetIndexCount / 3;
+		size_t collapseBudget = (triangleCount - targetTriangles) / 2 + 1;
+		size_t collapseCount = 0;
+
+		for (unsigned int v = 0; v < vertexCount; v++)
+			remap[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapseCount >= collapseBudget || collapse.Cost > maxError)
+				break;
+
+			unsigned int from = collapse.From;
+			unsigned int to = collapse.To;
+			if (touched[from] || touched[to])
+				continue;
+
+			// Reject collapses that would flip a triangle (or turn it
+			// edge-on, more than about 75 degrees from where it faced),
+			// or pull it onto the far side of a seam at the destination
+			const XMFLOAT3& target = vertices[to].Position;
+			bool valid = true;
+			for (unsigned int t = triangleStart[from]; t < triangleStart[from + 1] && valid; t++)
+			{
+				const unsigned int* triangle = &result[triangles[t] * 3];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+					continue;
+
+				XMFLOAT3 before = TriangleNormal(vertices[triangle[0]].Position, vertices[triangle[1]].Position, vertices[triangle[2]].Position);
+				XMFLOAT3 corners[3];
+				for (int c = 0; c < 3; c++)
+				{
+					corners[c] = triangle[c] == from ? target : vertices[triangle[c]].Position;
+					if (triangle[c] != from && positionId[triangle[c]] == positionId[to])
+						valid = false;
+				}
+
+				XMFLOAT3 after = TriangleNormal(corners[0], corners[1], corners[2]);
+				float dot = before.x * after.x + before.y * after.y + before.z * after.z;
+				float lengthsSq = (before.x * before.x + before.y * before.y + before.z * before.z) *
+					(after.x * after.x + after.y * after.y + after.z * after.z);
+				if (dot <= 0.0f || dot * dot < 0.0625f * lengthsSq)
+					valid = false;
+			}
+			if (!valid)
+				continue;
+
+			remap[from] = to;
+			quadrics[to].Add(quadrics[from]);
+			resultError = collapse.Cost > resultError ? collapse.Cost : resultError;
+			collapseCount++;
+
+			// Neighbors keep their positions for the rest of the
+			// pass, so the flip checks above stay valid
+			for (unsigned int t = triangleStart[from]; t < triangleStart[from + 1]; t++)
+			{
+				const unsigned int* triangle = &result[triangles[t] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+			}
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		// Apply the collapses and drop triangles that became degenerate
+		size_t write = 0;
+		for (size_t i = 0; i + 2 < result.size(); i += 3)
+		{
+			unsigned int a = remap[result[i]];
+			unsigned int b = remap[result[i + 1]];
+			unsigned int c = remap[result[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	return resultError;
+}
+
+void MeshSimplifier::BuildLODChain(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	const std::vector<float>& ratios, std::vector<std::vector<unsigned int>>& lods)
+{
+	lods.clear();
+	lods.reserve(ratios.size());
+	const std::vector<unsigned int>* previous = &indices;
+	for (float ratio : ratios)
+	{
+		unsigned int target = (unsigned int)(indices.size() / 3 * ratio) * 3;
+		std::vector<unsigned int> lod;
+		Simplify(vertices, *previous, target, lod);
+
+		// Not worth another level if it barely shrank
+		if (lod.size() == 0 || lod.size() > previous->size() * 9 / 10)
+			break;
+
+		lods.push_back(std::move(lod));
+		previous = &lods.back();
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Reduces the triangle count of an indexed mesh by
+// collapsing edges in order of quadric error (Garland and
+// Heckbert 1997).  Vertices only ever collapse onto other
+// existing vertices, so the results index the original
+// vertex array and no attributes need interpolating.
+//
+// Vertices on UV/normal seams (several vertices sharing one
+// position) and on open borders are locked, so simplified
+// meshes keep their silhouettes and texture layout.
+// --------------------------------------------------------
+class MeshSimplifier
+{
+public:
+	// Simplifies until at most targetIndexCount indices remain, no
+	// collapse is left below maxError, or nothing more can collapse.
+	// Returns the largest error of any collapse that was made.
+	static float Simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+		unsigned int targetIndexCount, std::vector<unsigned int>& result, float maxError = 3.402823466e+38f);
+
+	// Builds one index list per ratio (of the original triangle count),
+	// each simplified from the one before.  Stops early once a level
+	// can't get meaningfully smaller than the last.
+	static void BuildLODChain(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+		const std::vector<float>& ratios, std::vector<std::vector<unsigned int>>& lods);
+};
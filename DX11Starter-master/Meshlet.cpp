@@ -0,0 +1,236 @@
+#include "Meshlet.h"
+#include <math.h>
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Finishes a meshlet by fitting a sphere around its
+// vertices and a cone around its triangle normals
+// --------------------------------------------------------
+static void CalculateMeshletBounds(const Vertex* vertices, const unsigned int* indices, Meshlet& meshlet)
+{
+	const Vertex* base = vertices + meshlet.BaseVertex;
+	const unsigned int* start = indices + meshlet.StartIndex;
+
+	// Sphere centered on the bounding box
+	XMFLOAT3 minimum = base[start[0]].Position;
+	XMFLOAT3 maximum = minimum;
+	for (unsigned int i = 1; i < meshlet.IndexCount; i++)
+	{
+		const XMFLOAT3& p = base[start[i]].Position;
+		minimum.x = fminf(minimum.x, p.x); maximum.x = fmaxf(maximum.x, p.x);
+		minimum.y = fminf(minimum.y, p.y); maximum.y = fmaxf(maximum.y, p.y);
+		minimum.z = fminf(minimum.z, p.z); maximum.z = fmaxf(maximum.z, p.z);
+	}
+	meshlet.Center = XMFLOAT3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+
+	float radiusSq = 0.0f;
+	for (unsigned int i = 0; i < meshlet.IndexCount; i++)
+	{
+		const XMFLOAT3& p = base[start[i]].Position;
+		float dx = p.x - meshlet.Center.x, dy = p.y - meshlet.Center.y, dz = p.z - meshlet.Center.z;
+		radiusSq = fmaxf(radiusSq, dx * dx + dy * dy + dz * dz);
+	}
+	meshlet.Radius = sqrtf(radiusSq);
+
+	// Axis is the area weighted average of the triangle normals.  Front
+	// faces wind clockwise, so cross(p1 - p0, p2 - p0) faces outward.
+	std::vector<XMFLOAT3> normals;
+	normals.reserve(meshlet.IndexCount / 3);
+	XMFLOAT3 axis(0.0f, 0.0f, 0.0f);
+	for (unsigned int i = 0; i + 2 < meshlet.IndexCount; i += 3)
+	{
+		const XMFLOAT3& p0 = base[start[i]].Position;
+		const XMFLOAT3& p1 = base[start[i + 1]].Position;
+		const XMFLOAT3& p2 = base[start[i + 2]].Position;
+		float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+		float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+		XMFLOAT3 n(e1y * e2z - e1z * e2y, e1z * e2x - e1x * e2z, e1x * e2y - e1y * e2x);
+
+		float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+		if (length == 0.0f)
+			continue;
+
+		axis.x += n.x; axis.y += n.y; axis.z += n.z;
+		normals.push_back(XMFLOAT3(n.x / length, n.y / length, n.z / length));
+	}
+
+	meshlet.ConeCutoff = 1.0f;
+	float axisLength = sqrtf(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+	if (axisLength == 0.0f)
+	{
+		meshlet.ConeAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		return;
+	}
+	meshlet.ConeAxis = XMFLOAT3(axis.x / axisLength, axis.y / axisLength, axis.z / axisLength);
+
+	float minDot = 1.0f;
+	for (const XMFLOAT3& n : normals)
+	{
+		minDot = fminf(minDot, n.x * meshlet.ConeAxis.x + n.y * meshlet.ConeAxis.y + n.z * meshlet.ConeAxis.z);
+	}
+
+	// Past 90 degrees some triangle always faces the camera
+	if (minDot > 0.0f)
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+void MeshletBuilder::Build(const Vertex* vertices, const unsigned int* indices, const std::vector<SubMesh>& subMeshes,
+	std::vector<Meshlet>& meshlets, unsigned int maxVertices, unsigned int maxTriangles)
+{
+	meshlets.clear();
+	std::vector<unsigned int> lastUse;
+
+	for (const SubMesh& subMesh : subMeshes)
+	{
+		// Which meshlet (plus one) last used each vertex of this sub-mesh
+		unsigned int maxIndex = 0;
+		for (unsigned int i = 0; i < subMesh.IndexCount; i++)
+		{
+			unsigned int index = indices[subMesh.StartIndex + i];
+			maxIndex = index > maxIndex ? index : maxIndex;
+		}
+		lastUse.assign(maxIndex + 1, 0);
+
+		Meshlet current = {};
+		current.StartIndex = subMesh.StartIndex;
+		current.BaseVertex = subMesh.BaseVertex;
+		unsigned int stamp = (unsigned int)meshlets.size() + 1;
+		unsigned int vertexCount = 0;
+
+		for (unsigned int i = 0; i + 2 < subMesh.IndexCount; i += 3)
+		{
+			const unsigned int* triangle = indices + subMesh.StartIndex + i;
+			unsigned int added = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				if (lastUse[triangle[c]] != stamp)
+					added++;
+			}
+
+			// Start a new meshlet if this triangle won't fit
+			if (current.IndexCount > 0 && (vertexCount + added > maxVertices || current.IndexCount / 3 + 1 > maxTriangles))
+			{
+				CalculateMeshletBounds(vertices, indices, current);
+				meshlets.push_back(current);
+
+				current.StartIndex += current.IndexCount;
+				current.IndexCount = 0;
+				stamp = (unsigned int)meshlets.size() + 1;
+				vertexCount = 0;
+			}
+
+			for (int c = 0; c < 3; c++)
+			{
+				if (lastUse[triangle[c]] != stamp)
+				{
+					lastUse[triangle[c]] = stamp;
+					vertexCount++;
+				}
+			}
+			current.IndexCount += 3;
+		}
+
+		if (current.IndexCount > 0)
+		{
+			CalculateMeshletBounds(vertices, indices, current);
+			meshlets.push_back(current);
+		}
+	}
+}
+
+void MeshletCuller::ExtractFrustumPlanes(const XMFLOAT4X4& m, XMFLOAT4 planes[6])
+{
+	// Clip space is position * matrix, so each clip coordinate is a column
+	planes[0] = XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41); // Left:   x >= -w
+	planes[1] = XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41); // Right:  x <= w
+	planes[2] = XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42); // Bottom: y >= -w
+	planes[3] = XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42); // Top:    y <= w
+	planes[4] = XMFLOAT4(m._13, m._23, m._33, m._43);                                 // Near:   z >= 0
+	planes[5] = XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43); // Far:    z <= w
+
+	for (int i = 0; i < 6; i++)
+	{
+		float length = sqrtf(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+		if (length > 0.0f)
+		{
+			planes[i].x /= length; planes[i].y /= length; planes[i].z /= length; planes[i].w /= length;
+		}
+	}
+}
+
+MeshletCullStats MeshletCuller::Cull(const std::vector<Meshlet>& meshlets, const XMFLOAT4X4& world,
+	const XMFLOAT4X4& viewProjection, const XMFLOAT3& cameraPosition, std::vector<SubMesh>& draws)
+{
+	MeshletCullStats stats = {};
+
+	XMFLOAT4 planes[6];
+	ExtractFrustumPlanes(viewProjection, planes);
+
+	// Spheres grow by the largest scale.  Cones only survive a uniform
+	// scale, so the back face test is skipped for anything else.
+	float scaleX = sqrtf(world._11 * world._11 + world._12 * world._12 + world._13 * world._13);
+	float scaleY = sqrtf(world._21 * world._21 + world._22 * world._22 + world._23 * world._23);
+	float scaleZ = sqrtf(world._31 * world._31 + world._32 * world._32 + world._33 * world._33);
+	float maxScale = fmaxf(scaleX, fmaxf(scaleY, scaleZ));
+	float minScale = fminf(scaleX, fminf(scaleY, scaleZ));
+	bool uniformScale = maxScale - minScale <= maxScale * 0.001f;
+
+	size_t firstDraw = draws.size();
+	for (const Meshlet& meshlet : meshlets)
+	{
+		const XMFLOAT3& c = meshlet.Center;
+		XMFLOAT3 center(
+			c.x * world._11 + c.y * world._21 + c.z * world._31 + world._41,
+			c.x * world._12 + c.y * world._22 + c.z * world._32 + world._42,
+			c.x * world._13 + c.y * world._23 + c.z * world._33 + world._43);
+		float radius = meshlet.Radius * maxScale;
+
+		bool outside = false;
+		for (int i = 0; i < 6 && !outside; i++)
+		{
+			outside = planes[i].x * center.x + planes[i].y * center.y + planes[i].z * center.z + planes[i].w < -radius;
+		}
+		if (outside)
+		{
+			stats.OutsideFrustum++;
+			continue;
+		}
+
+		// Every triangle faces away if the direction to the meshlet is
+		// within (90 degrees - the cone's spread) of the axis
+		if (uniformScale && meshlet.ConeCutoff < 1.0f)
+		{
+			const XMFLOAT3& a = meshlet.ConeAxis;
+			XMFLOAT3 axis(
+				(a.x * world._11 + a.y * world._21 + a.z * world._31) / scaleX,
+				(a.x * world._12 + a.y * world._22 + a.z * world._32) / scaleX,
+				(a.x * world._13 + a.y * world._23 + a.z * world._33) / scaleX);
+
+			XMFLOAT3 toCenter(center.x - cameraPosition.x, center.y - cameraPosition.y, center.z - cameraPosition.z);
+			float distance = sqrtf(toCenter.x * toCenter.x + toCenter.y * toCenter.y + toCenter.z * toCenter.z);
+			if (toCenter.x * axis.x + toCenter.y * axis.y + toCenter.z * axis.z >= meshlet.ConeCutoff * distance + radius)
+			{
+				stats.BackFacing++;
+				continue;
+			}
+		}
+
+		stats.Visible++;
+
+		// Extend the last draw if this meshlet follows right after it
+		if (draws.size() > firstDraw)
+		{
+			SubMesh& last = draws.back();
+			if (last.BaseVertex == meshlet.BaseVertex && last.StartIndex + last.IndexCount == meshlet.StartIndex)
+			{
+				last.IndexCount += meshlet.IndexCount;
+				continue;
+			}
+		}
+
+		SubMesh draw = { meshlet.StartIndex, meshlet.IndexCount, meshlet.BaseVertex };
+		draws.push_back(draw);
+	}
+
+	return stats;
+}
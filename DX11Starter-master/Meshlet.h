@@ -0,0 +1,61 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+#include "SubMesh.h"
+
+// --------------------------------------------------------
+// A small cluster of a mesh's triangles, with the bounds
+// needed to cull it on its own
+// --------------------------------------------------------
+struct Meshlet
+{
+	unsigned int StartIndex;    // Range of the mesh's index buffer
+	unsigned int IndexCount;
+	int BaseVertex;             // Of the sub-mesh the meshlet is part of
+
+	DirectX::XMFLOAT3 Center;   // Bounding sphere
+	float Radius;
+
+	DirectX::XMFLOAT3 ConeAxis; // Average facing of the triangles
+	float ConeCutoff;           // Sine of the widest angle between the axis and a triangle's
+	                            // normal, or 1 if the triangles face too many ways to cull
+};
+
+struct MeshletCullStats
+{
+	unsigned int Visible;
+	unsigned int OutsideFrustum;
+	unsigned int BackFacing;
+};
+
+// --------------------------------------------------------
+// Splits triangles into meshlets in their existing order,
+// so each meshlet is a contiguous range of the index buffer
+// and the vertex cache order from MeshOptimizer is kept
+// --------------------------------------------------------
+class MeshletBuilder
+{
+public:
+	static void Build(const Vertex* vertices, const unsigned int* indices, const std::vector<SubMesh>& subMeshes,
+		std::vector<Meshlet>& meshlets, unsigned int maxVertices = MaxVertices, unsigned int maxTriangles = MaxTriangles);
+
+	static const unsigned int MaxVertices = 64;
+	static const unsigned int MaxTriangles = 124;
+};
+
+// --------------------------------------------------------
+// Tests meshlets against the view frustum and their normal
+// cones, producing index ranges for just the visible ones
+// --------------------------------------------------------
+class MeshletCuller
+{
+public:
+	// Appends a draw for each run of visible meshlets that are next to each other
+	static MeshletCullStats Cull(const std::vector<Meshlet>& meshlets, const DirectX::XMFLOAT4X4& world,
+		const DirectX::XMFLOAT4X4& viewProjection, const DirectX::XMFLOAT3& cameraPosition, std::vector<SubMesh>& draws);
+
+	// Left, right, bottom, top, near and far planes (xyz normal, w distance)
+	// of a row-vector view projection matrix, with normals facing inwards
+	static void ExtractFrustumPlanes(const DirectX::XMFLOAT4X4& viewProjection, DirectX::XMFLOAT4 planes[6]);
+};
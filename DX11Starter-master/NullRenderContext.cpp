@@ -0,0 +1,537 @@
+#include "NullRenderContext.h"
+#include <string.h>
+
+// --------------------------------------------------------
+// The COM and device child parts every stand-in shares.
+// Base is the interface between the one handed out and
+// ID3D11DeviceChild (if any), so both can be asked for.
+// --------------------------------------------------------
+template<typename Interface, typename Base = ID3D11DeviceChild>
+class NullChild : public Interface
+{
+public:
+	NullChild()
+	{
+		references = 1;
+	}
+
+	virtual ~NullChild()
+	{
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object)
+	{
+		if (!object)
+			return E_POINTER;
+
+		if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D11DeviceChild) ||
+			riid == __uuidof(Base) || riid == __uuidof(Interface))
+		{
+			AddRef();
+			*object = static_cast<Interface*>(this);
+			return S_OK;
+		}
+
+		*object = 0;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef()
+	{
+		return (ULONG)InterlockedIncrement(&references);
+	}
+
+	ULONG STDMETHODCALLTYPE Release()
+	{
+		ULONG count = (ULONG)InterlockedDecrement(&references);
+		if (count == 0)
+			delete this;
+		return count;
+	}
+
+	// There's no device, and nothing to attach data to
+	void STDMETHODCALLTYPE GetDevice(ID3D11Device** device) { *device = 0; }
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT* dataSize, void*) { *dataSize = 0; return DXGI_ERROR_NOT_FOUND; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) { return S_OK; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) { return S_OK; }
+
+private:
+	LONG references;
+};
+
+// --------------------------------------------------------
+// A buffer or texture with no memory behind it, which only
+// knows its description
+// --------------------------------------------------------
+template<typename Interface, typename Desc, D3D11_RESOURCE_DIMENSION Dimension>
+class NullResource : public NullChild<Interface, ID3D11Resource>
+{
+public:
+	NullResource(const Desc& desc)
+	{
+		this->desc = desc;
+		evictionPriority = 0;
+	}
+
+	void STDMETHODCALLTYPE GetType(D3D11_RESOURCE_DIMENSION* dimension) { *dimension = Dimension; }
+	void STDMETHODCALLTYPE SetEvictionPriority(UINT priority) { evictionPriority = priority; }
+	UINT STDMETHODCALLTYPE GetEvictionPriority() { return evictionPriority; }
+	void STDMETHODCALLTYPE GetDesc(Desc* desc) { *desc = this->desc; }
+
+private:
+	Desc desc;
+	UINT evictionPriority;
+};
+
+typedef NullResource<ID3D11Buffer, D3D11_BUFFER_DESC, D3D11_RESOURCE_DIMENSION_BUFFER> NullBuffer;
+typedef NullResource<ID3D11Texture2D, D3D11_TEXTURE2D_DESC, D3D11_RESOURCE_DIMENSION_TEXTURE2D> NullTexture2D;
+
+// --------------------------------------------------------
+// A view, holding onto its resource as Direct3D does
+// --------------------------------------------------------
+class NullShaderResourceView : public NullChild<ID3D11ShaderResourceView, ID3D11View>
+{
+public:
+	NullShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC& desc)
+	{
+		this->resource = resource;
+		this->desc = desc;
+	}
+
+	void STDMETHODCALLTYPE GetResource(ID3D11Resource** resource)
+	{
+		*resource = this->resource.Get();
+		(*resource)->AddRef();
+	}
+
+	void STDMETHODCALLTYPE GetDesc(D3D11_SHADER_RESOURCE_VIEW_DESC* desc) { *desc = this->desc; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+	D3D11_SHADER_RESOURCE_VIEW_DESC desc;
+};
+
+// --------------------------------------------------------
+// A sampler, rasterizer or depth stencil state
+// --------------------------------------------------------
+template<typename Interface, typename Desc>
+class NullState : public NullChild<Interface>
+{
+public:
+	NullState(const Desc& desc)
+	{
+		this->desc = desc;
+	}
+
+	void STDMETHODCALLTYPE GetDesc(Desc* desc) { *desc = this->desc; }
+
+private:
+	Desc desc;
+};
+
+// --------------------------------------------------------
+// Levels in a full mip chain, for textures asking for one
+// --------------------------------------------------------
+static UINT GetMipCount(UINT width, UINT height)
+{
+	UINT levels = 1;
+	for (UINT size = width > height ? width : height; size > 1; size /= 2)
+		levels++;
+	return levels;
+}
+
+NullRenderContext::NullRenderContext()
+{
+}
+
+NullRenderContext::~NullRenderContext()
+{
+}
+
+HRESULT NullRenderContext::CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer)
+{
+	if (!desc || desc->ByteWidth == 0)
+		return E_INVALIDARG;
+
+	// Immutable buffers can only get their contents here
+	if ((initialData && !initialData->pSysMem) || (!initialData && desc->Usage == D3D11_USAGE_IMMUTABLE))
+		return E_INVALIDARG;
+
+	// Just validating the arguments, like Direct3D does
+	if (!buffer)
+		return S_FALSE;
+
+	*buffer = new NullBuffer(*desc);
+	Record(RenderCommand::CreateBuffer, ShaderStage::Count, 0, desc->ByteWidth, *buffer);
+	return S_OK;
+}
+
+HRESULT NullRenderContext::CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture)
+{
+	if (!desc || desc->Width == 0 || desc->Height == 0 || desc->ArraySize == 0)
+		return E_INVALIDARG;
+	if ((initialData && !initialData->pSysMem) || (!initialData && desc->Usage == D3D11_USAGE_IMMUTABLE))
+		return E_INVALIDARG;
+
+	if (!texture)
+		return S_FALSE;
+
+	// Filled in the way Direct3D would, so sizes work out
+	D3D11_TEXTURE2D_DESC filled = *desc;
+	if (filled.MipLevels == 0)
+		filled.MipLevels = GetMipCount(filled.Width, filled.Height);
+
+	*texture = new NullTexture2D(filled);
+	Record(RenderCommand::CreateTexture, ShaderStage::Count, 0, 1, *texture);
+	return S_OK;
+}
+
+HRESULT NullRenderContext::CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view)
+{
+	if (!resource)
+		return E_INVALIDARG;
+
+	if (!view)
+		return S_FALSE;
+
+	// With no description, the view covers the whole resource
+	D3D11_SHADER_RESOURCE_VIEW_DESC filled = {};
+	if (desc)
+	{
+		filled = *desc;
+	}
+	else
+	{
+		D3D11_RESOURCE_DIMENSION dimension;
+		resource->GetType(&dimension);
+		if (dimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+		{
+			D3D11_TEXTURE2D_DESC textureDesc;
+			static_cast<ID3D11Texture2D*>(resource)->GetDesc(&textureDesc);
+			filled.Format = textureDesc.Format;
+			filled.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			filled.Texture2D.MipLevels = textureDesc.MipLevels;
+		}
+		else
+		{
+			filled.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		}
+	}
+
+	*view = new NullShaderResourceView(resource, filled);
+	Record(RenderCommand::CreateView, ShaderStage::Count, 0, 1, *view);
+	return S_OK;
+}
+
+HRESULT NullRenderContext::CreateShader(ShaderStage stage, const void* bytecode, SIZE_T length, ID3D11DeviceChild** shader)
+{
+	if (!bytecode || length == 0)
+		return E_INVALIDARG;
+
+	if (!shader)
+		return S_FALSE;
+
+	switch (stage)
+	{
+	case ShaderStage::Vertex:   *shader = new NullChild<ID3D11VertexShader>(); break;
+	case ShaderStage::Hull:     *shader = new NullChild<ID3D11HullShader>(); break;
+	case ShaderStage::Domain:   *shader = new NullChild<ID3D11DomainShader>(); break;
+	case ShaderStage::Geometry: *shader = new NullChild<ID3D11GeometryShader>(); break;
+	case ShaderStage::Pixel:    *shader = new NullChild<ID3D11PixelShader>(); break;
+	case ShaderStage::Compute:  *shader = new NullChild<ID3D11ComputeShader>(); break;
+	default: return E_INVALIDARG;
+	}
+
+	Record(RenderCommand::CreateShader, stage, 0, (UINT)length, *shader);
+	return S_OK;
+}
+
+HRESULT NullRenderContext::CreateGeometryShaderWithStreamOutput(const void* bytecode, SIZE_T length, const D3D11_SO_DECLARATION_ENTRY* declaration, UINT entryCount,
+	const UINT* strides, UINT strideCount, UINT rasterizedStream, ID3D11ClassLinkage* /*classLinkage*/, ID3D11GeometryShader** shader)
+{
+	if (!bytecode || length == 0 || !declaration || entryCount == 0)
+		return E_INVALIDARG;
+	if (strideCount > D3D11_SO_BUFFER_SLOT_COUNT || (strideCount > 0 && !strides))
+		return E_INVALIDARG;
+	if (rasterizedStream != D3D11_SO_NO_RASTERIZED_STREAM && rasterizedStream >= D3D11_SO_STREAM_COUNT)
+		return E_INVALIDARG;
+
+	if (!shader)
+		return S_FALSE;
+
+	*shader = new NullChild<ID3D11GeometryShader>();
+	Record(RenderCommand::CreateShader, ShaderStage::Geometry, 0, (UINT)length, *shader);
+	return S_OK;
+}
+
+HRESULT NullRenderContext::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* bytecode, SIZE_T length, ID3D11InputLayout** inputLayout)
+{
+	if (!elements || elementCount == 0 || !bytecode || length == 0)
+		return E_INVALIDARG;
+
+	if (!inputLayout)
+		return S_FALSE;
+
+	*inputLayout = new NullChild<ID3D11InputLayout>();
+	Record(RenderCommand::CreateInputLayout, ShaderStage::Count, 0, elementCount, *inputLayout);
+	return S_OK;
+}
+
+HRESULT NullRenderContext::CreateSamplerState(const D3D11_SAMPLER_DESC* desc, ID3D11SamplerState** state)
+{
+	if (!desc)
+		return E_INVALIDARG;
+
+	if (!state)
+		return S_FALSE;
+
+	*state = new NullState<ID3D11SamplerState, D3D11_SAMPLER_DESC>(*desc);
+	Record(RenderCommand::CreateState, ShaderStage::Count, 0, 1, *state);
+	return S_OK;
+}
+
+HRESULT NullRenderContext::CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** state)
+{
+	if (!desc)
+		return E_INVALIDARG;
+
+	if (!state)
+		return S_FALSE;
+
+	*state = new NullState<ID3D11RasterizerState, D3D11_RASTERIZER_DESC>(*desc);
+	Record(RenderCommand::CreateState, ShaderStage::Count, 0, 1, *state);
+	return S_OK;
+}
+
+HRESULT NullRenderContext::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** state)
+{
+	if (!desc)
+		return E_INVALIDARG;
+
+	if (!state)
+		return S_FALSE;
+
+	*state = new NullState<ID3D11DepthStencilState, D3D11_DEPTH_STENCIL_DESC>(*desc);
+	Record(RenderCommand::CreateState, ShaderStage::Count, 0, 1, *state);
+	return S_OK;
+}
+
+// --------------------------------------------------------
+// Only the header is read, for the size, format and mip
+// count.  Older files name their format with a FourCC:
+// the block compressed ones are recognised, and anything
+// else is taken as 32 bits a pixel.
+// --------------------------------------------------------
+HRESULT NullRenderContext::CreateTextureFromDDS(const void* data, size_t size, ID3D11ShaderResourceView** view)
+{
+	const size_t HeaderSize = 128; // Magic number, then the 124 byte header
+	const size_t DX10HeaderSize = 20;
+	const unsigned char* bytes = (const unsigned char*)data;
+	if (!data || size < HeaderSize || memcmp(bytes, "DDS ", 4) != 0)
+		return E_FAIL;
+
+	UINT height, width, mipCount, fourCC, caps2;
+	memcpy(&height, bytes + 12, sizeof(UINT));
+	memcpy(&width, bytes + 16, sizeof(UINT));
+	memcpy(&mipCount, bytes + 28, sizeof(UINT));
+	memcpy(&fourCC, bytes + 84, sizeof(UINT));
+	memcpy(&caps2, bytes + 112, sizeof(UINT));
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = mipCount > 0 ? mipCount : 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bool cube = (caps2 & 0x200) != 0; // DDSCAPS2_CUBEMAP
+
+	if (memcmp(&fourCC, "DXT1", 4) == 0)
+		desc.Format = DXGI_FORMAT_BC1_UNORM;
+	else if (memcmp(&fourCC, "DXT3", 4) == 0)
+		desc.Format = DXGI_FORMAT_BC2_UNORM;
+	else if (memcmp(&fourCC, "DXT5", 4) == 0)
+		desc.Format = DXGI_FORMAT_BC3_UNORM;
+	else if (memcmp(&fourCC, "DX10", 4) == 0)
+	{
+		if (size < HeaderSize + DX10HeaderSize)
+			return E_FAIL;
+
+		UINT format, miscFlags, arraySize;
+		memcpy(&format, bytes + HeaderSize, sizeof(UINT));
+		memcpy(&miscFlags, bytes + HeaderSize + 8, sizeof(UINT));
+		memcpy(&arraySize, bytes + HeaderSize + 12, sizeof(UINT));
+		desc.Format = (DXGI_FORMAT)format;
+		desc.ArraySize = arraySize > 0 ? arraySize : 1;
+		cube = (miscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE) != 0;
+	}
+
+	if (cube)
+	{
+		desc.ArraySize *= 6;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	HRESULT hr = CreateTexture2D(&desc, 0, texture.GetAddressOf());
+	if (FAILED(hr))
+		return hr;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+	viewDesc.Format = desc.Format;
+	if (cube)
+	{
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		viewDesc.TextureCube.MipLevels = desc.MipLevels;
+	}
+	else
+	{
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		viewDesc.Texture2D.MipLevels = desc.MipLevels;
+	}
+	return CreateShaderResourceView(texture.Get(), &viewDesc, view);
+}
+
+void NullRenderContext::UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box, const void* /*data*/, UINT /*rowPitch*/, UINT /*depthPitch*/)
+{
+	Record(RenderCommand::UpdateSubresource, ShaderStage::Count, subresource, GetUpdateSize(resource, box), resource);
+}
+
+void NullRenderContext::CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT /*x*/, UINT /*y*/, UINT /*z*/,
+	ID3D11Resource* /*source*/, UINT /*sourceSubresource*/, const D3D11_BOX* box)
+{
+	Record(RenderCommand::CopySubresourceRegion, ShaderStage::Count, destinationSubresource, box ? box->right - box->left : 0, destination);
+}
+
+HRESULT NullRenderContext::Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT /*flags*/, D3D11_MAPPED_SUBRESOURCE* mapped)
+{
+	Record(RenderCommand::Map, ShaderStage::Count, subresource, (UINT)mapType, resource);
+
+	// Only buffers are ever mapped, so the size is in the description
+	D3D11_BUFFER_DESC desc;
+	static_cast<ID3D11Buffer*>(resource)->GetDesc(&desc);
+	if (mapMemory.size() < desc.ByteWidth)
+		mapMemory.resize(desc.ByteWidth);
+
+	mapped->pData = mapMemory.data();
+	mapped->RowPitch = desc.ByteWidth;
+	mapped->DepthPitch = desc.ByteWidth;
+	return S_OK;
+}
+
+void NullRenderContext::Unmap(ID3D11Resource* resource, UINT subresource)
+{
+	Record(RenderCommand::Unmap, ShaderStage::Count, subresource, 1, resource);
+}
+
+void NullRenderContext::IASetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	Record(RenderCommand::SetInputLayout, ShaderStage::Count, 0, 1, inputLayout);
+}
+
+void NullRenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	Record(RenderCommand::SetPrimitiveTopology, ShaderStage::Count, (UINT)topology, 1, 0);
+}
+
+void NullRenderContext::IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* /*strides*/, const UINT* /*offsets*/)
+{
+	Record(RenderCommand::SetVertexBuffers, ShaderStage::Count, startSlot, count, count > 0 ? buffers[0] : 0);
+}
+
+void NullRenderContext::IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT /*format*/, UINT offset)
+{
+	Record(RenderCommand::SetIndexBuffer, ShaderStage::Count, offset, 1, buffer);
+}
+
+void NullRenderContext::SetShader(ShaderStage stage, ID3D11DeviceChild* shader)
+{
+	Record(RenderCommand::SetShader, stage, 0, 1, shader);
+}
+
+void NullRenderContext::SetConstantBuffers(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	Record(RenderCommand::SetConstantBuffers, stage, startSlot, count, count > 0 ? buffers[0] : 0);
+}
+
+void NullRenderContext::SetConstantBuffers1(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* /*firstConstants*/, const UINT* /*constantCounts*/)
+{
+	Record(RenderCommand::SetConstantBuffers, stage, startSlot, count, count > 0 ? buffers[0] : 0);
+}
+
+void NullRenderContext::SetShaderResources(ShaderStage stage, UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views)
+{
+	Record(RenderCommand::SetShaderResources, stage, startSlot, count, count > 0 ? views[0] : 0);
+}
+
+void NullRenderContext::SetSamplers(ShaderStage stage, UINT startSlot, UINT count, ID3D11SamplerState* const* samplers)
+{
+	Record(RenderCommand::SetSamplers, stage, startSlot, count, count > 0 ? samplers[0] : 0);
+}
+
+void NullRenderContext::CSSetUnorderedAccessViews(UINT startSlot, UINT count, ID3D11UnorderedAccessView* const* views, const UINT* /*initialCounts*/)
+{
+	Record(RenderCommand::SetUnorderedAccessViews, ShaderStage::Compute, startSlot, count, count > 0 ? views[0] : 0);
+}
+
+void NullRenderContext::SOSetTargets(UINT count, ID3D11Buffer* const* buffers, const UINT* /*offsets*/)
+{
+	Record(RenderCommand::SetStreamOutTargets, ShaderStage::Count, 0, count, count > 0 ? buffers[0] : 0);
+}
+
+void NullRenderContext::RSSetState(ID3D11RasterizerState* state)
+{
+	Record(RenderCommand::SetRasterizerState, ShaderStage::Count, 0, 1, state);
+}
+
+void NullRenderContext::RSSetViewports(UINT count, const D3D11_VIEWPORT* /*viewports*/)
+{
+	Record(RenderCommand::SetViewports, ShaderStage::Count, 0, count, 0);
+}
+
+void NullRenderContext::OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+{
+	Record(RenderCommand::SetDepthStencilState, ShaderStage::Count, stencilRef, 1, state);
+}
+
+void NullRenderContext::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* renderTargets, ID3D11DepthStencilView* /*depthStencil*/)
+{
+	Record(RenderCommand::SetRenderTargets, ShaderStage::Count, 0, count, count > 0 ? renderTargets[0] : 0);
+}
+
+void NullRenderContext::ClearRenderTargetView(ID3D11RenderTargetView* renderTarget, const FLOAT /*color*/[4])
+{
+	Record(RenderCommand::ClearRenderTarget, ShaderStage::Count, 0, 1, renderTarget);
+}
+
+void NullRenderContext::ClearDepthStencilView(ID3D11DepthStencilView* depthStencil, UINT /*flags*/, FLOAT /*depth*/, UINT8 /*stencil*/)
+{
+	Record(RenderCommand::ClearDepthStencil, ShaderStage::Count, 0, 1, depthStencil);
+}
+
+void NullRenderContext::DrawIndexed(UINT indexCount, UINT startIndex, INT /*baseVertex*/)
+{
+	Record(RenderCommand::DrawIndexed, ShaderStage::Count, startIndex, indexCount, 0);
+}
+
+void NullRenderContext::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex, INT /*baseVertex*/, UINT /*startInstance*/)
+{
+	Record(RenderCommand::DrawIndexedInstanced, ShaderStage::Count, startIndex, indexCountPerInstance * instanceCount, 0);
+}
+
+void NullRenderContext::Dispatch(UINT groupsX, UINT groupsY, UINT groupsZ)
+{
+	Record(RenderCommand::Dispatch, ShaderStage::Compute, 0, groupsX * groupsY * groupsZ, 0);
+}
+
+void NullRenderContext::GenerateMips(ID3D11ShaderResourceView* view)
+{
+	Record(RenderCommand::GenerateMips, ShaderStage::Count, 0, 1, view);
+}
+
+bool NullRenderContext::SupportsConstantBufferOffsets()
+{
+	return true;
+}
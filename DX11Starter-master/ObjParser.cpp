@@ -0,0 +1,491 @@
+#include "ObjParser.h"
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <algorithm>
+#include <limits.h>
+#include "ThreadPool.h"
+using namespace DirectX;
+
+// Powers of ten that are exactly representable as doubles
+static const double powersOfTen[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+	1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+static inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+static inline bool IsLineEnd(char c) { return c == '\n' || c == '\r' || c == '\0'; }
+
+static inline const char* SkipSpaces(const char* p)
+{
+	while(IsSpace(*p)) { p++; }
+	return p;
+}
+
+// --------------------------------------------------------
+// Parses a float starting at p (after any spaces) and
+// returns the position just past it. Common decimal forms
+// take a fast path, anything unusual (huge exponents,
+// very long mantissas, inf/nan) falls back to strtod.
+// --------------------------------------------------------
+static const char* ParseFloat(const char* p, float& out)
+{
+	p = SkipSpaces(p);
+	const char* start = p;
+	out = 0.0f;
+
+	if(IsLineEnd(*p)) {
+		return p;
+	}
+
+	bool negative = false;
+	if(*p == '-' || *p == '+') {
+		negative = *p == '-';
+		p++;
+	}
+
+	unsigned long long mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	while(IsDigit(*p)) {
+		if(significantDigits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			if(mantissa > 0) { significantDigits++; }
+		}
+		else {
+			exponent++;
+		}
+		anyDigits = true;
+		p++;
+	}
+
+	if(*p == '.') {
+		p++;
+		while(IsDigit(*p)) {
+			if(significantDigits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if(mantissa > 0) { significantDigits++; }
+				exponent--;
+			}
+			anyDigits = true;
+			p++;
+		}
+	}
+
+	if(anyDigits && (*p == 'e' || *p == 'E')) {
+		const char* expStart = p;
+		p++;
+		bool negativeExp = false;
+		if(*p == '-' || *p == '+') {
+			negativeExp = *p == '-';
+			p++;
+		}
+
+		if(IsDigit(*p)) {
+			int expValue = 0;
+			while(IsDigit(*p)) {
+				if(expValue < 10000) { expValue = expValue * 10 + (*p - '0'); }
+				p++;
+			}
+			exponent += negativeExp ? -expValue : expValue;
+		}
+		else {
+			p = expStart; // Not actually an exponent
+		}
+	}
+
+	if(!anyDigits || exponent < -22 || exponent > 22 || mantissa > (1ull << 53)) {
+		char* fallbackEnd;
+		out = (float)strtod(start, &fallbackEnd);
+		return fallbackEnd > start ? fallbackEnd : p;
+	}
+
+	double value = (double)mantissa;
+	value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+	out = (float)(negative ? -value : value);
+	return p;
+}
+
+// --------------------------------------------------------
+// Parses a (possibly negative) integer, returning 0 if
+// there are no digits at p.  Values too big for an int
+// stop at +/-INT_MAX, which is past any real index.
+// --------------------------------------------------------
+static const char* ParseInt(const char* p, int& out)
+{
+	bool negative = false;
+	if(*p == '-' || *p == '+') {
+		negative = *p == '-';
+		p++;
+	}
+
+	long long value = 0;
+	while(IsDigit(*p)) {
+		if(value < INT_MAX) { value = value * 10 + (*p - '0'); }
+		p++;
+	}
+	if(value > INT_MAX) { value = INT_MAX; }
+
+	out = negative ? -(int)value : (int)value;
+	return p;
+}
+
+// Where an index can't point at anything (0, or before the start of a
+// stream).  It's past the end of every stream, so BuildMesh drops its face.
+static const int InvalidIndex = INT_MAX;
+
+// Converts a 1-based (or negative, relative) OBJ index into a 0-based one
+static inline int ResolveIndex(int index, size_t count)
+{
+	if(index > 0) { return index - 1; }
+	if(index < 0) { return (int)count + index; }
+	return InvalidIndex;
+}
+
+bool ObjParser::ReadFile(const char* fileName, std::vector<char>& buffer)
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if(!file.is_open()) {
+		return false;
+	}
+
+	std::streamoff size = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	buffer.resize((size_t)size + 1);
+	file.read(buffer.data(), size);
+	buffer[(size_t)size] = '\0';
+	return true;
+}
+
+// --------------------------------------------------------
+// Reads one "pos/uv/normal", "pos//normal", "pos/uv" or
+// "pos" corner of a face
+// --------------------------------------------------------
+static const char* ParseCorner(const char* p, ObjChunk& chunk, ObjCorner& corner, unsigned int& relative)
+{
+	int index;
+	p = ParseInt(p, index);
+	corner.Position = ResolveIndex(index, chunk.Positions.size());
+	corner.UV = -1;
+	corner.Normal = -1;
+	relative = index < 0 ? OBJ_RELATIVE_POSITION : 0;
+
+	if(*p == '/') {
+		p++;
+		if(*p != '/') {
+			p = ParseInt(p, index);
+			corner.UV = ResolveIndex(index, chunk.UVs.size());
+			if(index < 0) { relative |= OBJ_RELATIVE_UV; }
+		}
+
+		if(*p == '/') {
+			p = ParseInt(p + 1, index);
+			corner.Normal = ResolveIndex(index, chunk.Normals.size());
+			if(index < 0) { relative |= OBJ_RELATIVE_NORMAL; }
+		}
+	}
+
+	return p;
+}
+
+static void PushCorner(ObjChunk& chunk, const ObjCorner& corner, unsigned int relative)
+{
+	if(relative) {
+		ObjRelativeCorner rel = { (unsigned int)chunk.Corners.size(), relative };
+		chunk.RelativeCorners.push_back(rel);
+	}
+	chunk.Corners.push_back(corner);
+}
+
+// --------------------------------------------------------
+// Fan-triangulates a face of any size, flipping the
+// winding order of each triangle for left-handed space
+// --------------------------------------------------------
+static void ParseFace(const char* p, ObjChunk& chunk)
+{
+	ObjCorner first, previous, current;
+	unsigned int firstRelative = 0, previousRelative = 0, currentRelative = 0;
+	int cornerCount = 0;
+
+	p = SkipSpaces(p);
+	while(!IsLineEnd(*p)) {
+		const char* next = ParseCorner(p, chunk, current, currentRelative);
+		if(next == p) {
+			break; // Not a corner, so stop reading this face
+		}
+		p = SkipSpaces(next);
+
+		if(cornerCount == 0) {
+			first = current;
+			firstRelative = currentRelative;
+		}
+		else if(cornerCount >= 2) {
+			PushCorner(chunk, first, firstRelative);
+			PushCorner(chunk, current, currentRelative);
+			PushCorner(chunk, previous, previousRelative);
+		}
+
+		previous = current;
+		previousRelative = currentRelative;
+		cornerCount++;
+	}
+}
+
+// --------------------------------------------------------
+// Parses every line in [start, end), where end is just
+// past a newline or at the end of the file
+// --------------------------------------------------------
+void ObjParser::ParseChunk(const char* start, const char* end, ObjChunk& chunk)
+{
+	// Count the records first so nothing reallocates while parsing
+	size_t positionCount = 0, normalCount = 0, uvCount = 0, triangleCount = 0;
+	for(const char* p = start; p < end;) {
+		p = SkipSpaces(p);
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if(!lineEnd) { lineEnd = end; }
+
+		if(p[0] == 'v') {
+			if(IsSpace(p[1])) { positionCount++; }
+			else if(p[1] == 'n') { normalCount++; }
+			else if(p[1] == 't') { uvCount++; }
+		}
+		else if(p[0] == 'f' && IsSpace(p[1])) {
+			// Each corner after the second adds a triangle
+			int cornerCount = 0;
+			for(const char* c = p + 1; c < lineEnd; c++) {
+				if(IsSpace(c[0]) && !IsSpace(c[1]) && !IsLineEnd(c[1])) { cornerCount++; }
+			}
+			if(cornerCount > 2) { triangleCount += cornerCount - 2; }
+		}
+
+		p = lineEnd < end ? lineEnd + 1 : end;
+	}
+
+	chunk.Positions.reserve(positionCount);
+	chunk.Normals.reserve(normalCount);
+	chunk.UVs.reserve(uvCount);
+	chunk.Corners.reserve(triangleCount * 3);
+
+	for(const char* p = start; p < end;) {
+		p = SkipSpaces(p);
+
+		if(p[0] == 'v' && IsSpace(p[1])) {
+			XMFLOAT3 pos;
+			const char* c = ParseFloat(p + 1, pos.x);
+			c = ParseFloat(c, pos.y);
+			ParseFloat(c, pos.z);
+
+			// Flip Z (LH vs. RH)
+			pos.z *= -1.0f;
+			chunk.Positions.push_back(pos);
+		}
+		else if(p[0] == 'v' && p[1] == 'n') {
+			XMFLOAT3 norm;
+			const char* c = ParseFloat(p + 2, norm.x);
+			c = ParseFloat(c, norm.y);
+			ParseFloat(c, norm.z);
+
+			// Flip normal's Z
+			norm.z *= -1.0f;
+			chunk.Normals.push_back(norm);
+		}
+		else if(p[0] == 'v' && p[1] == 't') {
+			XMFLOAT2 uv;
+			const char* c = ParseFloat(p + 2, uv.x);
+			ParseFloat(c, uv.y);
+
+			// Flip the UV's since they're probably "upside down"
+			uv.y = 1.0f - uv.y;
+			chunk.UVs.push_back(uv);
+		}
+		else if(p[0] == 'f' && IsSpace(p[1])) {
+			ParseFace(p + 1, chunk);
+		}
+
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		p = lineEnd ? lineEnd + 1 : end;
+	}
+}
+
+void ObjParser::Parse(const char* data, size_t size, unsigned int threadCount)
+{
+	// Small files aren't worth splitting up
+	const size_t minChunkSize = 1 << 20;
+	size_t chunkCount = size / minChunkSize;
+	if(chunkCount > threadCount) { chunkCount = threadCount; }
+	if(chunkCount < 1) { chunkCount = 1; }
+
+	// Split at the first newline after each even division of the file
+	std::vector<const char*> boundaries(chunkCount + 1);
+	boundaries[0] = data;
+	boundaries[chunkCount] = data + size;
+	for(size_t i = 1; i < chunkCount; i++) {
+		const char* split = data + size * i / chunkCount;
+		if(split < boundaries[i - 1]) { split = boundaries[i - 1]; }
+
+		const char* newline = (const char*)memchr(split, '\n', data + size - split);
+		boundaries[i] = newline ? newline + 1 : data + size;
+	}
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	ThreadPool::GetInstance().ParallelFor(chunkCount, [&](size_t i) {
+		ParseChunk(boundaries[i], boundaries[i + 1], chunks[i]);
+	}, threadCount);
+
+	StitchChunks(chunks, threadCount);
+}
+
+// Moves a relative index resolved within a chunk to where the chunk starts
+static inline int ResolveRelative(int index, size_t offset)
+{
+	long long resolved = (long long)index + (long long)offset;
+	return resolved < 0 ? InvalidIndex : (int)resolved;
+}
+
+// --------------------------------------------------------
+// Joins the chunks in file order.  Prefix sums of each
+// chunk's counts give where its records land in the final
+// arrays, and the offsets that relative indices need.
+// --------------------------------------------------------
+void ObjParser::StitchChunks(std::vector<ObjChunk>& chunks, unsigned int threadCount)
+{
+	size_t chunkCount = chunks.size();
+	std::vector<size_t> positionOffsets(chunkCount + 1, 0);
+	std::vector<size_t> normalOffsets(chunkCount + 1, 0);
+	std::vector<size_t> uvOffsets(chunkCount + 1, 0);
+	std::vector<size_t> cornerOffsets(chunkCount + 1, 0);
+	for(size_t i = 0; i < chunkCount; i++) {
+		positionOffsets[i + 1] = positionOffsets[i] + chunks[i].Positions.size();
+		normalOffsets[i + 1] = normalOffsets[i] + chunks[i].Normals.size();
+		uvOffsets[i + 1] = uvOffsets[i] + chunks[i].UVs.size();
+		cornerOffsets[i + 1] = cornerOffsets[i] + chunks[i].Corners.size();
+	}
+
+	positions.resize(positionOffsets[chunkCount]);
+	normals.resize(normalOffsets[chunkCount]);
+	uvs.resize(uvOffsets[chunkCount]);
+	corners.resize(cornerOffsets[chunkCount]);
+
+	ThreadPool::GetInstance().ParallelFor(chunkCount, [&](size_t i) {
+		ObjChunk& chunk = chunks[i];
+		std::copy(chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + positionOffsets[i]);
+		std::copy(chunk.Normals.begin(), chunk.Normals.end(), normals.begin() + normalOffsets[i]);
+		std::copy(chunk.UVs.begin(), chunk.UVs.end(), uvs.begin() + uvOffsets[i]);
+		std::copy(chunk.Corners.begin(), chunk.Corners.end(), corners.begin() + cornerOffsets[i]);
+
+		// Anything still negative reached back past the start of the file
+		for(const ObjRelativeCorner& rel : chunk.RelativeCorners) {
+			ObjCorner& corner = corners[cornerOffsets[i] + rel.Corner];
+			if(rel.Components & OBJ_RELATIVE_POSITION) { corner.Position = ResolveRelative(corner.Position, positionOffsets[i]); }
+			if(rel.Components & OBJ_RELATIVE_UV) { corner.UV = ResolveRelative(corner.UV, uvOffsets[i]); }
+			if(rel.Components & OBJ_RELATIVE_NORMAL) { corner.Normal = ResolveRelative(corner.Normal, normalOffsets[i]); }
+		}
+
+		chunk = ObjChunk(); // Free this chunk's memory as soon as it's copied
+	}, threadCount);
+}
+
+// --------------------------------------------------------
+// Bitwise key for welding vertices with identical
+// position, normal and uv values
+// --------------------------------------------------------
+struct WeldKey
+{
+	unsigned int Bits[8];
+
+	WeldKey(const Vertex& v)
+	{
+		memcpy(&Bits[0], &v.Position, sizeof(XMFLOAT3));
+		memcpy(&Bits[3], &v.Normal, sizeof(XMFLOAT3));
+		memcpy(&Bits[6], &v.UV, sizeof(XMFLOAT2));
+	}
+
+	bool operator==(const WeldKey& other) const
+	{
+		return memcmp(Bits, other.Bits, sizeof(Bits)) == 0;
+	}
+};
+
+struct WeldKeyHash
+{
+	size_t operator()(const WeldKey& key) const
+	{
+		// FNV-1a over the 32-bit words
+		unsigned long long hash = 14695981039346656037ull;
+		for(int i = 0; i < 8; i++) {
+			hash = (hash ^ key.Bits[i]) * 1099511628211ull;
+		}
+		return (size_t)(hash ^ (hash >> 32));
+	}
+};
+
+// --------------------------------------------------------
+// Creates an indexed mesh, welding corners that share the
+// same position, normal and uv into a single vertex.
+// Corners that left out a uv or normal use the first one
+// in the file, or a default if the file has none at all.
+// Triangles with an index outside its stream are dropped,
+// and counted in GetSkippedTriangles().
+// --------------------------------------------------------
+void ObjParser::BuildMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	// Checked before the defaults below, so those can't be pointed at
+	size_t positionCount = positions.size();
+	size_t uvCount = uvs.size();
+	size_t normalCount = normals.size();
+	auto inRange = [](int index, size_t count, bool optional) {
+		return (optional && index == -1) || (index >= 0 && (size_t)index < count);
+	};
+
+	if(uvs.size() == 0) {
+		uvs.push_back(XMFLOAT2(0.0f, 1.0f)); // (0, 0) after the vertical flip
+	}
+	if(normals.size() == 0) {
+		normals.push_back(XMFLOAT3(0.0f, 0.0f, 0.0f));
+	}
+
+	std::unordered_map<WeldKey, unsigned int, WeldKeyHash> weldedVertices;
+	weldedVertices.reserve(corners.size());
+	vertices.clear();
+	vertices.reserve(corners.size());
+	indices.clear();
+	indices.reserve(corners.size());
+	skippedTriangles = 0;
+
+	for(size_t t = 0; t + 2 < corners.size(); t += 3) {
+		bool valid = true;
+		for(size_t i = t; i < t + 3; i++) {
+			const ObjCorner& corner = corners[i];
+			valid = valid &&
+				inRange(corner.Position, positionCount, false) &&
+				inRange(corner.UV, uvCount, true) &&
+				inRange(corner.Normal, normalCount, true);
+		}
+		if(!valid) {
+			skippedTriangles++;
+			continue;
+		}
+
+		for(size_t i = t; i < t + 3; i++) {
+			const ObjCorner& corner = corners[i];
+			Vertex vertex;
+			vertex.Position = positions[corner.Position];
+			vertex.UV = uvs[corner.UV < 0 ? 0 : corner.UV];
+			vertex.Normal = normals[corner.Normal < 0 ? 0 : corner.Normal];
+			vertex.Tangent = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+			auto result = weldedVertices.insert({ WeldKey(vertex), (unsigned int)vertices.size() });
+			if(result.second) {
+				vertices.push_back(vertex);
+			}
+			indices.push_back(result.first->second);
+		}
+	}
+
+	vertices.shrink_to_fit();
+}
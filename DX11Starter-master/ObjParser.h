@@ -0,0 +1,80 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// One corner of a triangle as indices into the
+// position, uv and normal streams (-1 if not given)
+// --------------------------------------------------------
+struct ObjCorner
+{
+	int Position;
+	int UV;
+	int Normal;
+};
+
+// --------------------------------------------------------
+// A corner that used negative (relative) indices, which
+// can only be resolved once the counts from earlier
+// chunks of the file are known
+// --------------------------------------------------------
+#define OBJ_RELATIVE_POSITION 1
+#define OBJ_RELATIVE_UV 2
+#define OBJ_RELATIVE_NORMAL 4
+
+struct ObjRelativeCorner
+{
+	unsigned int Corner;
+	unsigned int Components;
+};
+
+// --------------------------------------------------------
+// Records parsed from one line-aligned piece of a file
+// --------------------------------------------------------
+struct ObjChunk
+{
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<DirectX::XMFLOAT3> Normals;
+	std::vector<DirectX::XMFLOAT2> UVs;
+	std::vector<ObjCorner> Corners; // 3 per triangle
+	std::vector<ObjRelativeCorner> RelativeCorners;
+};
+
+// --------------------------------------------------------
+// Parses OBJ text straight out of a whole-file buffer.
+//
+// - Lines are tokenized in place (no per-line copies) and
+//   numbers use a hand-written parser instead of sscanf
+// - Positions and normals are flipped to left-handed space
+//   and UVs are flipped vertically as they are read
+// - Triangles are stored with their winding already flipped
+// - Large files are split into line-aligned chunks that are
+//   parsed in parallel, then stitched back together in file
+//   order, so the result never depends on the thread count
+// - BuildMesh welds identical vertices into an indexed mesh
+// --------------------------------------------------------
+class ObjParser
+{
+public:
+	// Reads the whole file into buffer with a null terminator appended
+	static bool ReadFile(const char* fileName, std::vector<char>& buffer);
+
+	// data must be null terminated at data[size].  threadCount
+	// limits how many chunks are parsed at once (1 for serial)
+	void Parse(const char* data, size_t size, unsigned int threadCount = 1);
+	void BuildMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+	// Triangles BuildMesh dropped for pointing outside the file's data
+	unsigned int GetSkippedTriangles() { return skippedTriangles; }
+
+private:
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<DirectX::XMFLOAT2> uvs;
+	std::vector<ObjCorner> corners; // 3 per triangle
+	unsigned int skippedTriangles = 0;
+
+	static void ParseChunk(const char* start, const char* end, ObjChunk& chunk);
+	void StitchChunks(std::vector<ObjChunk>& chunks, unsigned int threadCount);
+};
@@ -0,0 +1,57 @@
+#include "ShaderStructs.hlsli"
+#include "PackedVertex.hlsli"
+
+// PackedVertexShader with InstancedVertexShader's per-instance
+// transforms.  Every instance in a draw shares the mesh, so the
+// bounds come once per draw (see InstanceBatcher).
+cbuffer PerFrame : register(b0) {
+	matrix view;
+	matrix projection;
+}
+
+cbuffer PerMesh : register(b1) {
+	float3 positionOffset; // Minimum corner of the mesh bounds
+	float3 positionScale;  // Size of the mesh bounds
+}
+
+struct VertexShaderInput
+{ 
+	float4 localPosition: POSITION_UNORM; // XYZ position within the bounds
+	float2 normal: NORMAL_SNORM;          // Octahedral encoded
+	float2 tangent: TANGENT_SNORM;        // Octahedral encoded
+	float2 uv: TEXCOORD_HALF;
+	float4 world0: WORLD_PER_INSTANCE0;
+	float4 world1: WORLD_PER_INSTANCE1;
+	float4 world2: WORLD_PER_INSTANCE2;
+	float4 world3: WORLD_PER_INSTANCE3;
+	float4 worldInverseTranspose0: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE0;
+	float4 worldInverseTranspose1: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE1;
+	float4 worldInverseTranspose2: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE2;
+	float4 worldInverseTranspose3: WORLD_INVERSE_TRANSPOSE_PER_INSTANCE3;
+};
+
+VertexToPixel main( VertexShaderInput input )
+{
+	// Set up output struct
+	VertexToPixel output;
+
+	matrix world = transpose(matrix(input.world0, input.world1, input.world2, input.world3));
+	matrix worldInverseTranspose = transpose(matrix(
+		input.worldInverseTranspose0,
+		input.worldInverseTranspose1,
+		input.worldInverseTranspose2,
+		input.worldInverseTranspose3));
+
+	// Rebuild the model space position from the bounds
+	float3 localPosition = input.localPosition.xyz * positionScale + positionOffset;
+
+	// Multiply the three matrices together first  
+	matrix wvp = mul(projection, mul(view, world));  
+	output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
+	output.normal = mul((float3x3)worldInverseTranspose, OctahedralDecode(input.normal));
+	output.tangent = mul((float3x3)worldInverseTranspose, OctahedralDecode(input.tangent));
+	output.worldPosition = mul(world, float4(localPosition, 1)).xyz;
+	output.uv = input.uv;
+
+	return output;
+}
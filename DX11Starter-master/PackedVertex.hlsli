@@ -0,0 +1,13 @@
+#ifndef __GGP_PACKED_VERTEX_INCLUDES__
+#define __GGP_PACKED_VERTEX_INCLUDES__
+
+// Unfolds a direction encoded by VertexPacking::OctahedralEncode
+float3 OctahedralDecode(float2 encoded)
+{
+	float3 direction = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-direction.z);
+	direction.xy += direction.xy >= 0.0f ? -fold : fold;
+	return normalize(direction);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include "ShaderStructs.hlsli"
+#include "PackedVertex.hlsli"
+
+cbuffer PerFrame : register(b0) {
+	matrix view;
+	matrix projection;
+}
+
+cbuffer PerObject : register(b1) {
+	matrix world;
+	matrix worldInverseTranspose;
+	float3 positionOffset; // Minimum corner of the mesh bounds
+	float3 positionScale;  // Size of the mesh bounds
+}
+
+// Matches PackedVertex, with 16-bit formats picked from the semantic
+// suffixes (which can't end in digits, as those are the semantic index)
+struct VertexShaderInput
+{ 
+	float4 localPosition: POSITION_UNORM; // XYZ position within the bounds
+	float2 normal: NORMAL_SNORM;          // Octahedral encoded
+	float2 tangent: TANGENT_SNORM;        // Octahedral encoded
+	float2 uv: TEXCOORD_HALF;
+};
+
+VertexToPixel main( VertexShaderInput input )
+{
+	// Set up output struct
+	VertexToPixel output;
+
+	// Rebuild the model space position from the bounds
+	float3 localPosition = input.localPosition.xyz * positionScale + positionOffset;
+
+	// Multiply the three matrices together first  
+	matrix wvp = mul(projection, mul(view, world));  
+	output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
+	output.normal = mul((float3x3)worldInverseTranspose, OctahedralDecode(input.normal));
+	output.tangent = mul((float3x3)worldInverseTranspose, OctahedralDecode(input.tangent));
+	output.worldPosition = mul(world, float4(localPosition, 1)).xyz;
+	output.uv = input.uv;
+
+	return output;
+}
@@ -1,11 +1,8 @@
 #include "ShaderStructs.hlsli"
 #include "Lighting.hlsli"
 
-cbuffer ExternalData : register(b0) {
-	float4 colorTint;
+cbuffer PerFrame : register(b0) {
 	float3 cameraPosition;
-	float roughness;
-	float uvScale;
 	float3 ambient;
 	Light directionalLight1;
 	Light redLight;
@@ -14,6 +11,12 @@ cbuffer ExternalData : register(b0) {
 	Light yellowPoint;
 }
 
+cbuffer PerMaterial : register(b1) {
+	float4 colorTint;
+	float roughness;
+	float uvScale;
+}
+
 Texture2D Albedo : register(t0);
 Texture2D NormalMap : register(t1);
 Texture2D RoughnessMap : register(t2);
@@ -0,0 +1,163 @@
+#include "RangeAllocator.h"
+#include <iterator>
+
+RangeAllocator::RangeAllocator(unsigned int capacity)
+{
+	this->capacity = 0;
+	used = 0;
+	Grow(capacity);
+}
+
+unsigned int RangeAllocator::Allocate(unsigned int size)
+{
+	if (size == 0)
+		return InvalidOffset;
+
+	// Smallest free range that fits
+	auto best = freeRangesBySize.lower_bound(size);
+	if (best == freeRangesBySize.end())
+		return InvalidOffset;
+
+	unsigned int offset = best->second;
+	unsigned int rangeSize = best->first;
+	RemoveFreeRange(freeRanges.find(offset));
+
+	// Return whatever is left over
+	if (rangeSize > size)
+		AddFreeRange(offset + size, rangeSize - size);
+
+	allocations[offset] = size;
+	used += size;
+	return offset;
+}
+
+void RangeAllocator::Free(unsigned int offset)
+{
+	auto allocation = allocations.find(offset);
+	if (allocation == allocations.end())
+		return;
+
+	unsigned int size = allocation->second;
+	allocations.erase(allocation);
+	used -= size;
+
+	// Merge with the free ranges on either side
+	auto next = freeRanges.lower_bound(offset);
+	if (next != freeRanges.end() && next->first == offset + size)
+	{
+		size += next->second;
+		auto merged = next++;
+		RemoveFreeRange(merged);
+	}
+	if (next != freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFreeRange(previous);
+		}
+	}
+
+	AddFreeRange(offset, size);
+}
+
+void RangeAllocator::Grow(unsigned int newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	unsigned int offset = capacity;
+	unsigned int size = newCapacity - capacity;
+	capacity = newCapacity;
+
+	// Extend a free range that already reaches the end
+	if (!freeRanges.empty())
+	{
+		auto last = std::prev(freeRanges.end());
+		if (last->first + last->second == offset)
+		{
+			offset = last->first;
+			size += last->second;
+			RemoveFreeRange(last);
+		}
+	}
+
+	AddFreeRange(offset, size);
+}
+
+void RangeAllocator::Compact(std::vector<RangeMove>& moves)
+{
+	moves.clear();
+	moves.reserve(allocations.size());
+
+	std::map<unsigned int, unsigned int> packed;
+	unsigned int next = 0;
+	for (auto& allocation : allocations)
+	{
+		RangeMove move = { allocation.first, next, allocation.second };
+		moves.push_back(move);
+		packed[next] = allocation.second;
+		next += allocation.second;
+	}
+
+	allocations.swap(packed);
+	freeRanges.clear();
+	freeRangesBySize.clear();
+	if (next < capacity)
+		AddFreeRange(next, capacity - next);
+}
+
+unsigned int RangeAllocator::GetCapacity()
+{
+	return capacity;
+}
+
+unsigned int RangeAllocator::GetUsed()
+{
+	return used;
+}
+
+unsigned int RangeAllocator::GetAllocationCount()
+{
+	return (unsigned int)allocations.size();
+}
+
+unsigned int RangeAllocator::GetFreeRangeCount()
+{
+	return (unsigned int)freeRanges.size();
+}
+
+unsigned int RangeAllocator::GetLargestFreeRange()
+{
+	return freeRangesBySize.empty() ? 0 : std::prev(freeRangesBySize.end())->first;
+}
+
+float RangeAllocator::GetFragmentation()
+{
+	unsigned int free = capacity - used;
+	if (free == 0)
+		return 0.0f;
+	return 1.0f - (float)GetLargestFreeRange() / free;
+}
+
+void RangeAllocator::AddFreeRange(unsigned int offset, unsigned int size)
+{
+	freeRanges[offset] = size;
+	freeRangesBySize.insert(std::make_pair(size, offset));
+}
+
+void RangeAllocator::RemoveFreeRange(std::map<unsigned int, unsigned int>::iterator range)
+{
+	auto bySize = freeRangesBySize.equal_range(range->second);
+	for (auto i = bySize.first; i != bySize.second; ++i)
+	{
+		if (i->second == range->first)
+		{
+			freeRangesBySize.erase(i);
+			break;
+		}
+	}
+	freeRanges.erase(range);
+}
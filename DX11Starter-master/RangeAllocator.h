@@ -0,0 +1,55 @@
+#pragma once
+#include <map>
+#include <vector>
+
+// Where one allocation ended up after compacting
+struct RangeMove
+{
+	unsigned int From;
+	unsigned int To;
+	unsigned int Size;
+};
+
+// --------------------------------------------------------
+// Hands out ranges of a linear space (like elements of a
+// buffer) without touching any memory itself.  Allocation
+// is best fit, and freed ranges merge with free neighbors.
+// --------------------------------------------------------
+class RangeAllocator
+{
+public:
+	RangeAllocator(unsigned int capacity = 0);
+
+	// Returns InvalidOffset if no free range is large enough
+	unsigned int Allocate(unsigned int size);
+	void Free(unsigned int offset);
+
+	// Adds space at the end, which merges with a free range there
+	void Grow(unsigned int newCapacity);
+
+	// Packs every allocation to the front in offset order, and
+	// reports where each one moved (including those that didn't)
+	void Compact(std::vector<RangeMove>& moves);
+
+	unsigned int GetCapacity();
+	unsigned int GetUsed();
+	unsigned int GetAllocationCount();
+	unsigned int GetFreeRangeCount();
+	unsigned int GetLargestFreeRange();
+
+	// 0 when all free space is in one range, approaching 1 as it splinters
+	float GetFragmentation();
+
+	static const unsigned int InvalidOffset = 0xFFFFFFFF;
+
+private:
+	void AddFreeRange(unsigned int offset, unsigned int size);
+	void RemoveFreeRange(std::map<unsigned int, unsigned int>::iterator range);
+
+	unsigned int capacity;
+	unsigned int used;
+
+	std::map<unsigned int, unsigned int> allocations; // Offset to size
+	std::map<unsigned int, unsigned int> freeRanges;  // Offset to size
+	std::multimap<unsigned int, unsigned int> freeRangesBySize; // Size to offset, for best fit
+};
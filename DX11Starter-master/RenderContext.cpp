@@ -0,0 +1,122 @@
+#include "RenderContext.h"
+#include <string.h>
+
+RenderContext::RenderContext()
+{
+	recording = false;
+	ResetStats();
+}
+
+RenderContext::~RenderContext()
+{
+}
+
+const RenderStats& RenderContext::GetStats()
+{
+	return stats;
+}
+
+void RenderContext::ResetStats()
+{
+	memset(&stats, 0, sizeof(RenderStats));
+}
+
+void RenderContext::SetRecording(bool recording)
+{
+	this->recording = recording;
+}
+
+bool RenderContext::IsRecording()
+{
+	return recording;
+}
+
+const std::vector<RecordedCommand>& RenderContext::GetCommands()
+{
+	return commands;
+}
+
+void RenderContext::ClearCommands()
+{
+	commands.clear();
+}
+
+const char* RenderContext::GetCommandName(RenderCommand command)
+{
+	switch (command)
+	{
+	case RenderCommand::CreateBuffer:            return "CreateBuffer";
+	case RenderCommand::CreateTexture:           return "CreateTexture";
+	case RenderCommand::CreateView:              return "CreateView";
+	case RenderCommand::CreateShader:            return "CreateShader";
+	case RenderCommand::CreateInputLayout:       return "CreateInputLayout";
+	case RenderCommand::CreateState:             return "CreateState";
+	case RenderCommand::UpdateSubresource:       return "UpdateSubresource";
+	case RenderCommand::CopySubresourceRegion:   return "CopySubresourceRegion";
+	case RenderCommand::Map:                     return "Map";
+	case RenderCommand::Unmap:                   return "Unmap";
+	case RenderCommand::SetInputLayout:          return "SetInputLayout";
+	case RenderCommand::SetPrimitiveTopology:    return "SetPrimitiveTopology";
+	case RenderCommand::SetVertexBuffers:        return "SetVertexBuffers";
+	case RenderCommand::SetIndexBuffer:          return "SetIndexBuffer";
+	case RenderCommand::SetShader:               return "SetShader";
+	case RenderCommand::SetConstantBuffers:      return "SetConstantBuffers";
+	case RenderCommand::SetShaderResources:      return "SetShaderResources";
+	case RenderCommand::SetSamplers:             return "SetSamplers";
+	case RenderCommand::SetUnorderedAccessViews: return "SetUnorderedAccessViews";
+	case RenderCommand::SetStreamOutTargets:     return "SetStreamOutTargets";
+	case RenderCommand::SetRasterizerState:      return "SetRasterizerState";
+	case RenderCommand::SetDepthStencilState:    return "SetDepthStencilState";
+	case RenderCommand::SetRenderTargets:        return "SetRenderTargets";
+	case RenderCommand::SetViewports:            return "SetViewports";
+	case RenderCommand::ClearRenderTarget:       return "ClearRenderTarget";
+	case RenderCommand::ClearDepthStencil:       return "ClearDepthStencil";
+	case RenderCommand::DrawIndexed:             return "DrawIndexed";
+	case RenderCommand::DrawIndexedInstanced:    return "DrawIndexedInstanced";
+	case RenderCommand::Dispatch:                return "Dispatch";
+	case RenderCommand::GenerateMips:            return "GenerateMips";
+	default:                                     return "Unknown";
+	}
+}
+
+// --------------------------------------------------------
+// Counts a call, and keeps it if recording.  Count means
+// bytes for buffer creation and updates, and indices for
+// draws, so those are totalled too.
+// --------------------------------------------------------
+void RenderContext::Record(RenderCommand command, ShaderStage stage, UINT slot, UINT count, const void* object)
+{
+	stats.Calls[(int)command]++;
+	switch (command)
+	{
+	case RenderCommand::CreateBuffer:         stats.BytesCreated += count; break;
+	case RenderCommand::UpdateSubresource:    stats.BytesUpdated += count; break;
+	case RenderCommand::DrawIndexed:          stats.IndicesDrawn += count; break;
+	case RenderCommand::DrawIndexedInstanced: stats.IndicesDrawn += count; break;
+	default: break;
+	}
+
+	if (recording)
+	{
+		RecordedCommand recorded = { command, stage, slot, count, object };
+		commands.push_back(recorded);
+	}
+}
+
+UINT RenderContext::GetUpdateSize(ID3D11Resource* resource, const D3D11_BOX* box)
+{
+	if (!resource)
+		return 0;
+
+	D3D11_RESOURCE_DIMENSION dimension;
+	resource->GetType(&dimension);
+	if (dimension != D3D11_RESOURCE_DIMENSION_BUFFER)
+		return 0;
+
+	if (box)
+		return box->right - box->left;
+
+	D3D11_BUFFER_DESC desc;
+	static_cast<ID3D11Buffer*>(resource)->GetDesc(&desc);
+	return desc.ByteWidth;
+}
@@ -0,0 +1,227 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+
+enum class ShaderStage
+{
+	Vertex,
+	Hull,
+	Domain,
+	Geometry,
+	Pixel,
+	Compute,
+	Count
+};
+
+// --------------------------------------------------------
+// Every kind of call a RenderContext accepts
+// --------------------------------------------------------
+enum class RenderCommand
+{
+	CreateBuffer,
+	CreateTexture,
+	CreateView,
+	CreateShader,
+	CreateInputLayout,
+	CreateState,
+	UpdateSubresource,
+	CopySubresourceRegion,
+	Map,
+	Unmap,
+	SetInputLayout,
+	SetPrimitiveTopology,
+	SetVertexBuffers,
+	SetIndexBuffer,
+	SetShader,
+	SetConstantBuffers,
+	SetShaderResources,
+	SetSamplers,
+	SetUnorderedAccessViews,
+	SetStreamOutTargets,
+	SetRasterizerState,
+	SetDepthStencilState,
+	SetRenderTargets,
+	SetViewports,
+	ClearRenderTarget,
+	ClearDepthStencil,
+	DrawIndexed,
+	DrawIndexedInstanced,
+	Dispatch,
+	GenerateMips,
+	Count
+};
+
+struct RenderStats
+{
+	unsigned int Calls[(int)RenderCommand::Count];
+	unsigned long long BytesCreated;  // Buffer memory
+	unsigned long long BytesUpdated;  // Buffer data uploaded with UpdateSubresource
+	unsigned long long IndicesDrawn;
+};
+
+// --------------------------------------------------------
+// One call, as kept while recording
+// --------------------------------------------------------
+struct RecordedCommand
+{
+	RenderCommand Command;
+	ShaderStage Stage;   // For shader binds, otherwise Count
+	unsigned int Slot;   // First slot bound, or first index drawn
+	unsigned int Count;  // Slots bound, bytes created or updated, bytecode size, layout elements, map type, or indices drawn (across all instances)
+	const void* Object;  // First object bound, or the object created or updated
+};
+
+// --------------------------------------------------------
+// The part of Direct3D the engine renders through, so the
+// frame can be sent somewhere other than the GPU.  Every
+// resource the engine makes (buffers, textures, shaders,
+// input layouts and states) is made here too, so nothing
+// outside an implementation needs an ID3D11Device.
+//
+// Implementations call Record once for each call they
+// accept, which keeps the counts and the recording.
+// --------------------------------------------------------
+class RenderContext
+{
+public:
+	RenderContext();
+	virtual ~RenderContext();
+
+	// Creation
+	virtual HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) = 0;
+	virtual HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture) = 0;
+	virtual HRESULT CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view) = 0;
+	virtual HRESULT CreateShader(ShaderStage stage, const void* bytecode, SIZE_T length, ID3D11DeviceChild** shader) = 0;
+	virtual HRESULT CreateGeometryShaderWithStreamOutput(const void* bytecode, SIZE_T length, const D3D11_SO_DECLARATION_ENTRY* declaration, UINT entryCount,
+		const UINT* strides, UINT strideCount, UINT rasterizedStream, ID3D11ClassLinkage* classLinkage, ID3D11GeometryShader** shader) = 0;
+	virtual HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* bytecode, SIZE_T length, ID3D11InputLayout** inputLayout) = 0;
+	virtual HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC* desc, ID3D11SamplerState** state) = 0;
+	virtual HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** state) = 0;
+	virtual HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** state) = 0;
+
+	// A texture (and a view of it) from the contents of a .dds file,
+	// generating any mips the file is missing
+	virtual HRESULT CreateTextureFromDDS(const void* data, size_t size, ID3D11ShaderResourceView** view) = 0;
+
+	// Resources
+	virtual void UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box, const void* data, UINT rowPitch, UINT depthPitch) = 0;
+	virtual void CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y, UINT z,
+		ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* box) = 0;
+	virtual HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT flags, D3D11_MAPPED_SUBRESOURCE* mapped) = 0;
+	virtual void Unmap(ID3D11Resource* resource, UINT subresource) = 0;
+
+	// Input assembler
+	virtual void IASetInputLayout(ID3D11InputLayout* inputLayout) = 0;
+	virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+	virtual void IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets) = 0;
+	virtual void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset) = 0;
+
+	// Shader stages
+	virtual void SetShader(ShaderStage stage, ID3D11DeviceChild* shader) = 0;
+	virtual void SetConstantBuffers(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers) = 0;
+	virtual void SetConstantBuffers1(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts) = 0;
+	virtual void SetShaderResources(ShaderStage stage, UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views) = 0;
+	virtual void SetSamplers(ShaderStage stage, UINT startSlot, UINT count, ID3D11SamplerState* const* samplers) = 0;
+	virtual void CSSetUnorderedAccessViews(UINT startSlot, UINT count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts) = 0;
+	virtual void SOSetTargets(UINT count, ID3D11Buffer* const* buffers, const UINT* offsets) = 0;
+
+	// Fixed function state and output
+	virtual void RSSetState(ID3D11RasterizerState* state) = 0;
+	virtual void RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports) = 0;
+	virtual void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef) = 0;
+	virtual void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* renderTargets, ID3D11DepthStencilView* depthStencil) = 0;
+	virtual void ClearRenderTargetView(ID3D11RenderTargetView* renderTarget, const FLOAT color[4]) = 0;
+	virtual void ClearDepthStencilView(ID3D11DepthStencilView* depthStencil, UINT flags, FLOAT depth, UINT8 stencil) = 0;
+
+	// Work
+	virtual void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex) = 0;
+	virtual void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) = 0;
+	virtual void Dispatch(UINT groupsX, UINT groupsY, UINT groupsZ) = 0;
+	virtual void GenerateMips(ID3D11ShaderResourceView* view) = 0;
+
+	// Whether SetConstantBuffers1 binds at an offset, and dynamic constant
+	// buffers can be mapped with NO_OVERWRITE (both need Direct3D 11.1)
+	virtual bool SupportsConstantBufferOffsets() = 0;
+
+	// Shader creation under the device's names.  Class linkage is ignored.
+	HRESULT CreateVertexShader(const void* bytecode, SIZE_T length, ID3D11ClassLinkage*, ID3D11VertexShader** shader) { return CreateStageShader(ShaderStage::Vertex, bytecode, length, shader); }
+	HRESULT CreateHullShader(const void* bytecode, SIZE_T length, ID3D11ClassLinkage*, ID3D11HullShader** shader) { return CreateStageShader(ShaderStage::Hull, bytecode, length, shader); }
+	HRESULT CreateDomainShader(const void* bytecode, SIZE_T length, ID3D11ClassLinkage*, ID3D11DomainShader** shader) { return CreateStageShader(ShaderStage::Domain, bytecode, length, shader); }
+	HRESULT CreateGeometryShader(const void* bytecode, SIZE_T length, ID3D11ClassLinkage*, ID3D11GeometryShader** shader) { return CreateStageShader(ShaderStage::Geometry, bytecode, length, shader); }
+	HRESULT CreatePixelShader(const void* bytecode, SIZE_T length, ID3D11ClassLinkage*, ID3D11PixelShader** shader) { return CreateStageShader(ShaderStage::Pixel, bytecode, length, shader); }
+	HRESULT CreateComputeShader(const void* bytecode, SIZE_T length, ID3D11ClassLinkage*, ID3D11ComputeShader** shader) { return CreateStageShader(ShaderStage::Compute, bytecode, length, shader); }
+
+	// The per-stage binds under their Direct3D names, so code written
+	// against ID3D11DeviceContext works as is.  Class instances are ignored.
+	void VSSetShader(ID3D11VertexShader* shader, ID3D11ClassInstance* const*, UINT) { SetShader(ShaderStage::Vertex, shader); }
+	void HSSetShader(ID3D11HullShader* shader, ID3D11ClassInstance* const*, UINT) { SetShader(ShaderStage::Hull, shader); }
+	void DSSetShader(ID3D11DomainShader* shader, ID3D11ClassInstance* const*, UINT) { SetShader(ShaderStage::Domain, shader); }
+	void GSSetShader(ID3D11GeometryShader* shader, ID3D11ClassInstance* const*, UINT) { SetShader(ShaderStage::Geometry, shader); }
+	void PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const*, UINT) { SetShader(ShaderStage::Pixel, shader); }
+	void CSSetShader(ID3D11ComputeShader* shader, ID3D11ClassInstance* const*, UINT) { SetShader(ShaderStage::Compute, shader); }
+
+	void VSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) { SetConstantBuffers(ShaderStage::Vertex, startSlot, count, buffers); }
+	void HSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) { SetConstantBuffers(ShaderStage::Hull, startSlot, count, buffers); }
+	void DSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) { SetConstantBuffers(ShaderStage::Domain, startSlot, count, buffers); }
+	void GSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) { SetConstantBuffers(ShaderStage::Geometry, startSlot, count, buffers); }
+	void PSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) { SetConstantBuffers(ShaderStage::Pixel, startSlot, count, buffers); }
+	void CSSetConstantBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers) { SetConstantBuffers(ShaderStage::Compute, startSlot, count, buffers); }
+
+	void VSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts) { SetConstantBuffers1(ShaderStage::Vertex, startSlot, count, buffers, firstConstants, constantCounts); }
+	void HSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts) { SetConstantBuffers1(ShaderStage::Hull, startSlot, count, buffers, firstConstants, constantCounts); }
+	void DSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts) { SetConstantBuffers1(ShaderStage::Domain, startSlot, count, buffers, firstConstants, constantCounts); }
+	void GSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts) { SetConstantBuffers1(ShaderStage::Geometry, startSlot, count, buffers, firstConstants, constantCounts); }
+	void PSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts) { SetConstantBuffers1(ShaderStage::Pixel, startSlot, count, buffers, firstConstants, constantCounts); }
+	void CSSetConstantBuffers1(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts) { SetConstantBuffers1(ShaderStage::Compute, startSlot, count, buffers, firstConstants, constantCounts); }
+
+	void VSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views) { SetShaderResources(ShaderStage::Vertex, startSlot, count, views); }
+	void HSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views) { SetShaderResources(ShaderStage::Hull, startSlot, count, views); }
+	void DSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views) { SetShaderResources(ShaderStage::Domain, startSlot, count, views); }
+	void GSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views) { SetShaderResources(ShaderStage::Geometry, startSlot, count, views); }
+	void PSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views) { SetShaderResources(ShaderStage::Pixel, startSlot, count, views); }
+	void CSSetShaderResources(UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views) { SetShaderResources(ShaderStage::Compute, startSlot, count, views); }
+
+	void VSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers) { SetSamplers(ShaderStage::Vertex, startSlot, count, samplers); }
+	void HSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers) { SetSamplers(ShaderStage::Hull, startSlot, count, samplers); }
+	void DSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers) { SetSamplers(ShaderStage::Domain, startSlot, count, samplers); }
+	void GSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers) { SetSamplers(ShaderStage::Geometry, startSlot, count, samplers); }
+	void PSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers) { SetSamplers(ShaderStage::Pixel, startSlot, count, samplers); }
+	void CSSetSamplers(UINT startSlot, UINT count, ID3D11SamplerState* const* samplers) { SetSamplers(ShaderStage::Compute, startSlot, count, samplers); }
+
+	// Totals since the last reset
+	const RenderStats& GetStats();
+	void ResetStats();
+
+	// While recording, each call is also kept in order
+	void SetRecording(bool recording);
+	bool IsRecording();
+	const std::vector<RecordedCommand>& GetCommands();
+	void ClearCommands();
+
+	static const char* GetCommandName(RenderCommand command);
+
+protected:
+	void Record(RenderCommand command, ShaderStage stage, UINT slot, UINT count, const void* object);
+
+	// Bytes written by an UpdateSubresource call, for buffers
+	static UINT GetUpdateSize(ID3D11Resource* resource, const D3D11_BOX* box);
+
+private:
+	// What each stage's shader is made as, from what CreateShader hands back
+	template<typename T>
+	HRESULT CreateStageShader(ShaderStage stage, const void* bytecode, SIZE_T length, T** shader)
+	{
+		if (!shader)
+			return CreateShader(stage, bytecode, length, 0);
+
+		ID3D11DeviceChild* created = 0;
+		HRESULT hr = CreateShader(stage, bytecode, length, &created);
+		*shader = static_cast<T*>(created);
+		return hr;
+	}
+
+	RenderStats stats;
+	bool recording;
+	std::vector<RecordedCommand> commands;
+};
@@ -0,0 +1,103 @@
+#include "RingAllocator.h"
+#include <string.h>
+
+RingAllocator::RingAllocator(unsigned int capacity, unsigned int alignment)
+{
+	this->alignment = alignment > 0 ? alignment : 1;
+	this->capacity = (capacity / this->alignment) * this->alignment;
+	head = 0;
+	generation = 1;
+	discardNext = true;
+	ResetStats();
+}
+
+// --------------------------------------------------------
+// Takes the next slice big enough for size bytes, starting
+// a new fill if the rest of this one is too small.  Fails
+// only if the slice wouldn't fit in the whole buffer.
+// --------------------------------------------------------
+bool RingAllocator::Allocate(unsigned int size, RingAllocation& allocation)
+{
+	if (size == 0 || size > capacity)
+	{
+		stats.Failures++;
+		return false;
+	}
+
+	// Quick and dirty alignment using integer division
+	unsigned int alignedSize = ((size + alignment - 1) / alignment) * alignment;
+	if (alignedSize > capacity - head)
+	{
+		StartFill();
+		stats.Wraps++;
+	}
+
+	allocation.Offset = head;
+	allocation.Size = alignedSize;
+	allocation.Generation = generation;
+	allocation.Discard = discardNext;
+
+	if (discardNext)
+		stats.Discards++;
+
+	discardNext = false;
+	head += alignedSize;
+
+	stats.Allocations++;
+	stats.BytesAllocated += alignedSize;
+	return true;
+}
+
+// --------------------------------------------------------
+// Starts a new fill, such as at the start of a frame
+// --------------------------------------------------------
+void RingAllocator::Reset()
+{
+	StartFill();
+}
+
+bool RingAllocator::IsCurrent(unsigned int generation)
+{
+	return generation != 0 && generation == this->generation;
+}
+
+unsigned int RingAllocator::GetCapacity()
+{
+	return capacity;
+}
+
+unsigned int RingAllocator::GetAlignment()
+{
+	return alignment;
+}
+
+unsigned int RingAllocator::GetGeneration()
+{
+	return generation;
+}
+
+unsigned int RingAllocator::GetUsed()
+{
+	return head;
+}
+
+const RingAllocatorStats& RingAllocator::GetStats()
+{
+	return stats;
+}
+
+void RingAllocator::ResetStats()
+{
+	memset(&stats, 0, sizeof(RingAllocatorStats));
+}
+
+void RingAllocator::StartFill()
+{
+	head = 0;
+	discardNext = true;
+
+	// Skipping zero when it wraps around, as that means "none"
+	generation++;
+	if (generation == 0)
+		generation = 1;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// --------------------------------------------------------
+// One slice handed out by a RingAllocator
+// --------------------------------------------------------
+struct RingAllocation
+{
+	unsigned int Offset;     // Bytes from the start of the buffer
+	unsigned int Size;       // Bytes, rounded up to the alignment
+	unsigned int Generation; // Which fill of the buffer it belongs to
+	bool Discard;            // First slice of a fill, so the buffer's memory must be replaced
+};
+
+struct RingAllocatorStats
+{
+	unsigned int Allocations;
+	unsigned int Failures; // Requests bigger than the whole buffer
+	unsigned int Discards; // Fills started: one a frame, plus any wraps
+	unsigned int Wraps;    // Fills started because a frame ran off the end
+	unsigned long long BytesAllocated;
+};
+
+// --------------------------------------------------------
+// Hands out aligned slices of a fixed size buffer in order,
+// never freeing any of them.  Each frame (Reset), or when
+// what's left is too small, it starts a new fill from the
+// front.
+//
+// A new fill bumps the generation and flags its first slice
+// as a discard: the GPU may still be reading the last fill,
+// so the memory behind the buffer has to be replaced (Map
+// with DISCARD) rather than written over.  Slices from older
+// generations are gone.  Later slices in a fill never
+// overlap one another, so they can be written without
+// waiting (Map with NO_OVERWRITE).
+//
+// Only the bookkeeping lives here, so it can be run and
+// checked without a GPU; see ConstantBufferRing.
+// --------------------------------------------------------
+class RingAllocator
+{
+public:
+	RingAllocator(unsigned int capacity, unsigned int alignment);
+
+	bool Allocate(unsigned int size, RingAllocation& allocation);
+	void Reset();
+
+	// Whether a slice from the given generation is still there.
+	// Zero is never a live generation, so it can mean "none".
+	bool IsCurrent(unsigned int generation);
+
+	unsigned int GetCapacity();
+	unsigned int GetAlignment();
+	unsigned int GetGeneration();
+	unsigned int GetUsed();
+
+	const RingAllocatorStats& GetStats();
+	void ResetStats();
+
+private:
+	void StartFill();
+
+	unsigned int capacity;
+	unsigned int alignment;
+	unsigned int head;
+	unsigned int generation;
+	bool discardNext;
+	RingAllocatorStats stats;
+};
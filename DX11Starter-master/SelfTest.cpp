@@ -0,0 +1,1211 @@
+#include "SelfTest.h"
+#include "Transform.h"
+#include "RangeAllocator.h"
+#include "RingAllocator.h"
+#include "ConstantBufferRing.h"
+#include "NullRenderContext.h"
+#include "StateCache.h"
+#include "VertexPacking.h"
+#include "Mesh.h"
+#include "MeshSimplifier.h"
+#include "Meshlet.h"
+#include "GeometryArena.h"
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+// Counts and reports a failed check, but keeps going
+#define SELF_TEST_CHECK(condition) \
+	do { if (!(condition)) { printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+// Largest difference between any two elements
+static float MatrixDifference(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+{
+	float largest = 0;
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			largest = fmaxf(largest, fabsf(a.m[r][c] - b.m[r][c]));
+	return largest;
+}
+
+// A transform's own matrix, built the long way
+static XMMATRIX LocalMatrix(Transform& transform)
+{
+	XMFLOAT3 position = transform.GetPosition();
+	XMFLOAT3 pitchYawRoll = transform.GetPitchYawRoll();
+	XMFLOAT3 scale = transform.GetScale();
+	return
+		XMMatrixScalingFromVector(XMLoadFloat3(&scale)) *
+		XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)) *
+		XMMatrixTranslationFromVector(XMLoadFloat3(&position));
+}
+
+// A chain's world matrices, walking down from the root by hand
+static float ChainDifference(std::vector<Transform>& chain)
+{
+	float largest = 0;
+	XMMATRIX world = XMMatrixIdentity();
+	for (Transform& transform : chain)
+	{
+		world = LocalMatrix(transform) * world;
+		XMFLOAT4X4 expected;
+		XMStoreFloat4x4(&expected, world);
+		largest = fmaxf(largest, MatrixDifference(expected, transform.GetWorldMatrix()));
+	}
+	return largest;
+}
+
+unsigned int SelfTest::TransformHierarchy()
+{
+	unsigned int failures = 0;
+	TransformSystem& system = TransformSystem::GetInstance();
+	unsigned int startCount = system.GetCount();
+	system.UpdateMatrices();
+
+	// Deep: a chain 2000 transforms long
+	{
+		const unsigned int depth = 2000;
+		std::vector<Transform> chain(depth);
+		for (unsigned int i = 1; i < depth; i++)
+		{
+			SELF_TEST_CHECK(chain[i].SetParent(&chain[i - 1]));
+		}
+		for (Transform& transform : chain)
+		{
+			transform.SetPosition(0.01f, 0.0f, 0.0f);
+			transform.SetPitchYawRoll(0.0f, 0.001f, 0.0f);
+		}
+
+		SELF_TEST_CHECK(system.UpdateMatrices() == depth);
+		SELF_TEST_CHECK(ChainDifference(chain) < 1e-3f);
+
+		// Nothing changed, so nothing is rebuilt
+		SELF_TEST_CHECK(system.UpdateMatrices() == 0);
+
+		// Only the changed transform's subtree is rebuilt
+		chain[1500].Rotate(0.0f, 0.5f, 0.0f);
+		SELF_TEST_CHECK(system.UpdateMatrices() == depth - 1500);
+		SELF_TEST_CHECK(ChainDifference(chain) < 1e-3f);
+
+		// Cycles are rejected
+		SELF_TEST_CHECK(!chain[0].SetParent(&chain[5]));
+		SELF_TEST_CHECK(!chain[5].SetParent(&chain[5]));
+
+		// Reading a deep matrix after a change far above it
+		chain[10].SetPosition(1.0f, 2.0f, 3.0f);
+		XMFLOAT4X4 lazy = chain[depth - 1].GetWorldMatrix();
+		XMMATRIX world = XMMatrixIdentity();
+		for (Transform& transform : chain)
+			world = LocalMatrix(transform) * world;
+		XMFLOAT4X4 expected;
+		XMStoreFloat4x4(&expected, world);
+		SELF_TEST_CHECK(MatrixDifference(expected, lazy) < 1e-3f);
+		system.UpdateMatrices();
+	}
+	SELF_TEST_CHECK(system.GetCount() == startCount);
+
+	// Wide: one root with 50,000 children, some with children of their own
+	{
+		const unsigned int width = 50000;
+		Transform root;
+		std::vector<Transform> children(width);
+		std::vector<Transform> grandchildren(width / 100);
+		for (unsigned int i = 0; i < width; i++)
+		{
+			children[i].SetParent(&root);
+			children[i].SetPosition((float)i, 0.0f, 0.0f);
+		}
+		for (unsigned int i = 0; i < width / 100; i++)
+		{
+			grandchildren[i].SetParent(&children[i * 100]);
+			grandchildren[i].SetPosition(0.0f, 1.0f, 0.0f);
+		}
+		root.SetScale(2.0f, 2.0f, 2.0f);
+
+		SELF_TEST_CHECK(system.UpdateMatrices() == 1 + width + width / 100);
+		SELF_TEST_CHECK(fabsf(children[123].GetWorldMatrix()._41 - 246.0f) < 1e-3f);
+		SELF_TEST_CHECK(fabsf(grandchildren[3].GetWorldMatrix()._41 - 600.0f) < 1e-3f);
+		SELF_TEST_CHECK(fabsf(grandchildren[3].GetWorldMatrix()._42 - 2.0f) < 1e-3f);
+
+		// A child and its own child
+		children[300].SetPosition(-1.0f, 0.0f, 0.0f);
+		SELF_TEST_CHECK(system.UpdateMatrices() == 2);
+		SELF_TEST_CHECK(fabsf(grandchildren[3].GetWorldMatrix()._41 + 2.0f) < 1e-3f);
+
+		// Reparenting
+		SELF_TEST_CHECK(grandchildren[3].SetParent(&children[1]));
+		SELF_TEST_CHECK(system.UpdateMatrices() == 1);
+		SELF_TEST_CHECK(fabsf(grandchildren[3].GetWorldMatrix()._41 - 2.0f) < 1e-3f);
+
+		// Detaching keeps the local position, now relative to the world
+		SELF_TEST_CHECK(grandchildren[3].SetParent(0));
+		system.UpdateMatrices();
+		SELF_TEST_CHECK(fabsf(grandchildren[3].GetWorldMatrix()._41) < 1e-3f);
+		SELF_TEST_CHECK(fabsf(grandchildren[3].GetWorldMatrix()._42 - 1.0f) < 1e-3f);
+
+		// Destroying a parent leaves its child as a root
+		{
+			Transform destroyed = std::move(children[500]);
+		}
+		SELF_TEST_CHECK(system.UpdateMatrices() == 1);
+		SELF_TEST_CHECK(fabsf(grandchildren[5].GetWorldMatrix()._41) < 1e-3f);
+		SELF_TEST_CHECK(fabsf(grandchildren[5].GetWorldMatrix()._42 - 1.0f) < 1e-3f);
+
+		// Creating and changing transforms while the order is out of date
+		SELF_TEST_CHECK(children[7].SetParent(&children[8]));
+		Transform created;
+		created.SetPosition(9.0f, 9.0f, 9.0f);
+		children[9].SetPosition(1.0f, 1.0f, 1.0f);
+		SELF_TEST_CHECK(system.UpdateMatrices() == 3);
+		SELF_TEST_CHECK(fabsf(created.GetWorldMatrix()._41 - 9.0f) < 1e-3f);
+		SELF_TEST_CHECK(fabsf(children[7].GetWorldMatrix()._41 - 30.0f) < 1e-3f);
+	}
+	SELF_TEST_CHECK(system.GetCount() == startCount);
+
+	return failures;
+}
+
+// Small deterministic generator, so every run does the same operations
+static unsigned int NextRandom(uint64_t& state)
+{
+	state = state * 6364136223846793005ull + 1442695040888963407ull;
+	return (unsigned int)(state >> 33);
+}
+
+unsigned int SelfTest::RangeAllocatorChurn()
+{
+	unsigned int failures = 0;
+
+	// About 2000 ranges stay live, filling around 70% of the space, so the
+	// free space is always split up; the seed below peaks at 0.72
+	const unsigned int operations = 200000;
+	const unsigned int maxSize = 4096;
+	const unsigned int capacity = 1 << 20;
+	const float maxFragmentation = 0.8f;
+	RangeAllocator allocator(capacity);
+	std::map<unsigned int, unsigned int> live; // Offset to size, kept alongside
+	std::vector<unsigned int> liveOffsets;
+	uint64_t random = 12345;
+	float worstFragmentation = 0;
+	unsigned int overlaps = 0;
+
+	for (unsigned int op = 0; op < operations; op++)
+	{
+		// Lean towards allocating until there's a working set to churn
+		bool allocate = liveOffsets.empty() || NextRandom(random) % 100 < (liveOffsets.size() < 2000 ? 60u : 48u);
+		if (allocate)
+		{
+			// Mostly small meshes, sometimes a large one
+			unsigned int size = NextRandom(random) % 8 == 0 ? 1 + NextRandom(random) % maxSize : 1 + NextRandom(random) % (maxSize / 16);
+			unsigned int offset = allocator.Allocate(size);
+			if (offset == RangeAllocator::InvalidOffset)
+			{
+				allocator.Grow(allocator.GetCapacity() * 2);
+				offset = allocator.Allocate(size);
+			}
+			if (offset == RangeAllocator::InvalidOffset)
+			{
+				failures++;
+				printf("  FAIL %s:%d: no room for %u after growing\n", __FILE__, __LINE__, size);
+				continue;
+			}
+
+			// Neither neighbor may reach into the new range
+			auto next = live.lower_bound(offset);
+			if (next != live.end() && next->first < offset + size)
+				overlaps++;
+			if (next != live.begin() && std::prev(next)->first + std::prev(next)->second > offset)
+				overlaps++;
+			if (offset + size > allocator.GetCapacity())
+				overlaps++;
+
+			live[offset] = size;
+			liveOffsets.push_back(offset);
+		}
+		else
+		{
+			unsigned int index = NextRandom(random) % liveOffsets.size();
+			unsigned int offset = liveOffsets[index];
+			liveOffsets[index] = liveOffsets.back();
+			liveOffsets.pop_back();
+			live.erase(offset);
+			allocator.Free(offset);
+		}
+
+		// Only meaningful once a good share of the space is free
+		if (allocator.GetCapacity() - allocator.GetUsed() >= allocator.GetCapacity() / 4)
+			worstFragmentation = fmaxf(worstFragmentation, allocator.GetFragmentation());
+	}
+
+	SELF_TEST_CHECK(overlaps == 0);
+	SELF_TEST_CHECK(allocator.GetAllocationCount() == live.size());
+
+	// Best fit always found room without growing
+	SELF_TEST_CHECK(allocator.GetCapacity() == capacity);
+	SELF_TEST_CHECK(worstFragmentation <= maxFragmentation);
+	printf("  Worst fragmentation %.3f (limit %.2f)\n", worstFragmentation, maxFragmentation);
+
+	// Compacting packs everything in offset order, leaving one free range
+	std::vector<RangeMove> moves;
+	allocator.Compact(moves);
+	SELF_TEST_CHECK(moves.size() == live.size());
+	SELF_TEST_CHECK(allocator.GetFreeRangeCount() == (allocator.GetUsed() < allocator.GetCapacity() ? 1u : 0u));
+	SELF_TEST_CHECK(allocator.GetLargestFreeRange() == allocator.GetCapacity() - allocator.GetUsed());
+	unsigned int packedEnd = 0;
+	bool movesMatch = true;
+	auto original = live.begin();
+	for (const RangeMove& move : moves)
+	{
+		movesMatch = movesMatch && original != live.end() && move.From == original->first &&
+			move.Size == original->second && move.To == packedEnd;
+		packedEnd += move.Size;
+		if (original != live.end())
+			original++;
+	}
+	SELF_TEST_CHECK(movesMatch);
+	SELF_TEST_CHECK(packedEnd == allocator.GetUsed());
+
+	return failures;
+}
+
+// Largest difference relative to the size of the expected element,
+// since translations make some elements far larger than others
+static float RelativeMatrixDifference(const XMFLOAT4X4& expected, const XMFLOAT4X4& actual)
+{
+	float largest = 0;
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			largest = fmaxf(largest, fabsf(expected.m[r][c] - actual.m[r][c]) / fmaxf(1.0f, fabsf(expected.m[r][c])));
+	return largest;
+}
+
+// The inverse transpose the slow way, for comparison
+static XMFLOAT4X4 GeneralInverseTranspose(const XMFLOAT4X4& world)
+{
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&world))));
+	return result;
+}
+
+unsigned int SelfTest::InverseTranspose()
+{
+	unsigned int failures = 0;
+	const float tolerance = 1e-4f;
+
+	// A spread of scales, rotations and translations on their own
+	float largest = 0;
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		float t = (float)i;
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world,
+			XMMatrixScaling(0.5f + fmodf(t * 0.37f, 2.0f), 0.5f + fmodf(t * 0.53f, 2.0f), 0.5f + fmodf(t * 0.71f, 2.0f)) *
+			XMMatrixRotationRollPitchYaw(t * 0.013f, t * 0.029f, t * 0.041f) *
+			XMMatrixTranslation(fmodf(t, 100.0f), fmodf(t * 0.5f, 100.0f), fmodf(t * 0.25f, 100.0f)));
+		XMFLOAT4X4 trs;
+		XMStoreFloat4x4(&trs, TransformSystem::InverseTransposeTRS(XMLoadFloat4x4(&world)));
+		largest = fmaxf(largest, RelativeMatrixDifference(GeneralInverseTranspose(world), trs));
+	}
+	SELF_TEST_CHECK(largest <= tolerance);
+
+	// Four levels of rotated, non-uniform scales, so the worlds below the
+	// first are sheared and only the product of inverse transposes works.
+	// UpdateMatrices rebuilds all four together, parents first.
+	{
+		Transform a;
+		Transform b;
+		Transform c;
+		Transform d;
+		a.SetScale(1.0f, 3.0f, 0.5f);
+		a.SetPitchYawRoll(0.3f, 0.9f, -0.2f);
+		a.SetPosition(4.0f, 5.0f, 6.0f);
+		SELF_TEST_CHECK(b.SetParent(&a));
+		b.SetScale(2.0f, 0.7f, 1.5f);
+		b.SetPitchYawRoll(-0.6f, 0.1f, 1.2f);
+		b.SetPosition(-1.0f, 2.0f, 0.5f);
+		SELF_TEST_CHECK(c.SetParent(&b));
+		c.SetScale(0.3f, 0.3f, 4.0f);
+		c.SetPitchYawRoll(1.0f, -2.0f, 0.4f);
+		c.SetPosition(0.0f, 0.0f, 3.0f);
+		SELF_TEST_CHECK(d.SetParent(&c));
+		d.SetScale(1.5f, 0.8f, 2.5f);
+		d.SetPitchYawRoll(-0.4f, 0.7f, 2.1f);
+		d.SetPosition(2.0f, -1.0f, 1.0f);
+		SELF_TEST_CHECK(TransformSystem::GetInstance().UpdateMatrices() == 4);
+
+		for (Transform* transform : { &a, &b, &c, &d })
+		{
+			float difference = RelativeMatrixDifference(GeneralInverseTranspose(transform->GetWorldMatrix()), transform->GetWorldInverseTransposeMatrix());
+			SELF_TEST_CHECK(difference <= tolerance);
+		}
+	}
+
+	// Zero scale has no inverse, so it falls back to exactly what the
+	// general inverse gives, whatever that is
+	{
+		XMMATRIX world = XMMatrixScaling(0.0f, 1.0f, 1.0f) * XMMatrixRotationRollPitchYaw(0.2f, 0.4f, 0.6f) * XMMatrixTranslation(1.0f, 2.0f, 3.0f);
+		XMFLOAT4X4 general;
+		XMFLOAT4X4 trs;
+		XMStoreFloat4x4(&general, XMMatrixInverse(0, XMMatrixTranspose(world)));
+		XMStoreFloat4x4(&trs, TransformSystem::InverseTransposeTRS(world));
+		SELF_TEST_CHECK(memcmp(&general, &trs, sizeof(XMFLOAT4X4)) == 0);
+
+		Transform flat;
+		flat.SetScale(0.0f, 1.0f, 1.0f);
+		XMFLOAT4X4 flatWorld = flat.GetWorldMatrix();
+		XMFLOAT4X4 expected = GeneralInverseTranspose(flatWorld);
+		XMFLOAT4X4 actual = flat.GetWorldInverseTransposeMatrix();
+		SELF_TEST_CHECK(memcmp(&expected, &actual, sizeof(XMFLOAT4X4)) == 0);
+
+		// And the same when it's rebuilt along with three others
+		Transform others[3];
+		flat.SetPosition(1.0f, 0.0f, 0.0f);
+		for (Transform& other : others)
+			other.SetScale(2.0f, 2.0f, 2.0f);
+		SELF_TEST_CHECK(TransformSystem::GetInstance().UpdateMatrices() == 4);
+		flatWorld = flat.GetWorldMatrix();
+		expected = GeneralInverseTranspose(flatWorld);
+		actual = flat.GetWorldInverseTransposeMatrix();
+		SELF_TEST_CHECK(memcmp(&expected, &actual, sizeof(XMFLOAT4X4)) == 0);
+		for (Transform& other : others)
+			SELF_TEST_CHECK(RelativeMatrixDifference(GeneralInverseTranspose(other.GetWorldMatrix()), other.GetWorldInverseTransposeMatrix()) <= tolerance);
+	}
+
+	return failures;
+}
+
+// A uniformly random direction
+static XMFLOAT3 RandomDirection(uint64_t& state)
+{
+	float z = NextRandom(state) / 2147483648.0f - 1.0f;
+	float angle = NextRandom(state) / 2147483648.0f * XM_PI;
+	float radius = sqrtf(fmaxf(0.0f, 1.0f - z * z));
+	return XMFLOAT3(radius * cosf(angle), radius * sinf(angle), z);
+}
+
+unsigned int SelfTest::VertexPackingRoundTrip()
+{
+	unsigned int failures = 0;
+	SELF_TEST_CHECK(sizeof(PackedVertex) == 20);
+
+	// Random vertices in uneven bounds, with directions from
+	// every part of the sphere and uv's across [0, 1]
+	const unsigned int count = 100000;
+	uint64_t state = 23;
+	std::vector<Vertex> vertices(count);
+	for (Vertex& vertex : vertices)
+	{
+		vertex.Position = XMFLOAT3(
+			NextRandom(state) / 4294967296.0f * 20.0f - 10.0f,
+			NextRandom(state) / 4294967296.0f * 0.5f,
+			NextRandom(state) / 4294967296.0f * 8.0f - 3.0f);
+		vertex.Normal = RandomDirection(state);
+		vertex.Tangent = RandomDirection(state);
+		vertex.UV = XMFLOAT2(NextRandom(state) / 4294967296.0f, NextRandom(state) / 4294967296.0f);
+	}
+
+	// The axes and the folded corners of the octahedron, exactly
+	const XMFLOAT3 extremes[] =
+	{
+		XMFLOAT3(1, 0, 0), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, -1, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, -1),
+		XMFLOAT3(0.57735f, 0.57735f, -0.57735f), XMFLOAT3(-0.57735f, -0.57735f, -0.57735f),
+	};
+	for (unsigned int i = 0; i < sizeof(extremes) / sizeof(extremes[0]); i++)
+	{
+		vertices[i].Normal = extremes[i];
+		vertices[i].Tangent = extremes[i];
+	}
+
+	BoundingBox bounds;
+	BoundingBox::CreateFromPoints(bounds, count, &vertices[0].Position, sizeof(Vertex));
+	VertexPackingError error = VertexPacking::MeasureError(vertices.data(), count, bounds);
+	printf("  Worst round trip error: position %g, normal %.4f deg, tangent %.4f deg, uv %g\n",
+		error.MaxPositionError, error.MaxNormalAngle, error.MaxTangentAngle, error.MaxUVError);
+
+	// Each axis rounds to within half a step of 1/65535 of the bounds
+	XMFLOAT3 scale = VertexPacking::GetPositionScale(bounds);
+	float step = fmaxf(scale.x, fmaxf(scale.y, scale.z)) / 65535.0f;
+	SELF_TEST_CHECK(error.MaxPositionError <= step);
+
+	// 16-bit octahedral directions are good to a few thousandths of
+	// a degree, and half floats to 11 bits below 1
+	SELF_TEST_CHECK(error.MaxNormalAngle < 0.01f);
+	SELF_TEST_CHECK(error.MaxTangentAngle < 0.01f);
+	SELF_TEST_CHECK(error.MaxUVError <= 1.0f / 2048.0f);
+
+	// Flat bounds still round trip
+	{
+		Vertex flat[2] = {};
+		flat[1].Position = XMFLOAT3(1.0f, 0.0f, 1.0f);
+		BoundingBox flatBounds;
+		BoundingBox::CreateFromPoints(flatBounds, 2, &flat[0].Position, sizeof(Vertex));
+		SELF_TEST_CHECK(VertexPacking::MeasureError(flat, 2, flatBounds).MaxPositionError <= 1.0f / 65535.0f);
+	}
+
+	return failures;
+}
+
+// The map types recorded since the last ClearCommands, in order
+static std::vector<D3D11_MAP> RecordedMapTypes(RenderContext& context)
+{
+	std::vector<D3D11_MAP> mapTypes;
+	for (const RecordedCommand& command : context.GetCommands())
+	{
+		if (command.Command == RenderCommand::Map)
+			mapTypes.push_back((D3D11_MAP)command.Count);
+	}
+	return mapTypes;
+}
+
+unsigned int SelfTest::RingAllocatorFills()
+{
+	unsigned int failures = 0;
+
+	// Sizes round up to the alignment, and so does the capacity (down)
+	{
+		RingAllocator ring(1000, 256);
+		SELF_TEST_CHECK(ring.GetCapacity() == 768);
+
+		RingAllocation allocation;
+		const unsigned int sizes[] = { 1, 256, 257 };
+		const unsigned int alignedSizes[] = { 256, 256, 512 };
+		ring.Reset();
+		for (int i = 0; i < 2; i++)
+		{
+			SELF_TEST_CHECK(ring.Allocate(sizes[i], allocation));
+			SELF_TEST_CHECK(allocation.Offset % 256 == 0 && allocation.Size == alignedSizes[i]);
+		}
+		SELF_TEST_CHECK(ring.Allocate(sizes[2], allocation) && allocation.Size == alignedSizes[2] && allocation.Offset == 0);
+		SELF_TEST_CHECK(!ring.Allocate(769, allocation) && !ring.Allocate(0, allocation));
+		SELF_TEST_CHECK(ring.GetStats().Failures == 2);
+	}
+
+	// Only the first slice of each fill discards, each fill has a new
+	// generation, and running off the end starts one mid-frame
+	{
+		RingAllocator ring(4096, 256);
+		RingAllocation allocation;
+		unsigned int firstGeneration = ring.GetGeneration();
+		SELF_TEST_CHECK(firstGeneration != 0 && ring.IsCurrent(firstGeneration) && !ring.IsCurrent(0));
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			SELF_TEST_CHECK(ring.Allocate(200, allocation));
+			SELF_TEST_CHECK(allocation.Offset == i * 256 && allocation.Discard == (i == 0));
+			SELF_TEST_CHECK(allocation.Generation == firstGeneration);
+		}
+		SELF_TEST_CHECK(ring.GetUsed() == 4096);
+
+		SELF_TEST_CHECK(ring.Allocate(200, allocation));
+		SELF_TEST_CHECK(allocation.Offset == 0 && allocation.Discard);
+		SELF_TEST_CHECK(allocation.Generation == firstGeneration + 1);
+		SELF_TEST_CHECK(!ring.IsCurrent(firstGeneration) && ring.IsCurrent(allocation.Generation));
+		SELF_TEST_CHECK(ring.GetStats().Wraps == 1 && ring.GetStats().Discards == 2);
+
+		ring.Reset();
+		SELF_TEST_CHECK(ring.Allocate(200, allocation) && allocation.Offset == 0 && allocation.Discard);
+		SELF_TEST_CHECK(allocation.Generation == firstGeneration + 2 && ring.GetStats().Wraps == 1);
+	}
+
+	// Through ConstantBufferRing: the first write of each fill maps
+	// with DISCARD and the rest with NO_OVERWRITE, each lands at its
+	// slice's offset, and slices from before a wrap stop being current
+	{
+		std::shared_ptr<NullRenderContext> context = std::make_shared<NullRenderContext>();
+		ConstantBufferRing ring(context, 1024);
+		SELF_TEST_CHECK(ring.IsValid());
+
+		context->SetRecording(true);
+		ring.BeginFrame();
+		ConstantBufferSlice slices[5];
+		for (unsigned int i = 0; i < 5; i++)
+		{
+			unsigned char data[64];
+			memset(data, (int)(i + 1), sizeof(data));
+			SELF_TEST_CHECK(ring.Write(data, sizeof(data), slices[i]));
+
+			// Every buffer maps to the same scratch memory in the null context
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			context->Map(ring.GetBuffer(), 0, D3D11_MAP_READ, 0, &mapped);
+			SELF_TEST_CHECK(memcmp((unsigned char*)mapped.pData + slices[i].FirstConstant * 16, data, sizeof(data)) == 0);
+			context->Unmap(ring.GetBuffer(), 0);
+		}
+
+		const D3D11_MAP expected[] =
+		{
+			D3D11_MAP_WRITE_DISCARD, D3D11_MAP_READ,
+			D3D11_MAP_WRITE_NO_OVERWRITE, D3D11_MAP_READ,
+			D3D11_MAP_WRITE_NO_OVERWRITE, D3D11_MAP_READ,
+			D3D11_MAP_WRITE_NO_OVERWRITE, D3D11_MAP_READ,
+			D3D11_MAP_WRITE_DISCARD, D3D11_MAP_READ,
+		};
+		std::vector<D3D11_MAP> mapTypes = RecordedMapTypes(*context);
+		SELF_TEST_CHECK(mapTypes.size() == sizeof(expected) / sizeof(expected[0]) &&
+			std::equal(mapTypes.begin(), mapTypes.end(), expected));
+
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			SELF_TEST_CHECK(slices[i].FirstConstant == i * 16 && slices[i].ConstantCount == 16);
+			SELF_TEST_CHECK(!ring.IsCurrent(slices[i]));
+		}
+		SELF_TEST_CHECK(slices[4].FirstConstant == 0 && ring.IsCurrent(slices[4]));
+		SELF_TEST_CHECK(ring.GetStats().Wraps == 1);
+
+		// A new frame discards again
+		context->ClearCommands();
+		ring.BeginFrame();
+		SELF_TEST_CHECK(ring.Write("x", 1, slices[0]) && !ring.IsCurrent(slices[4]));
+		mapTypes = RecordedMapTypes(*context);
+		SELF_TEST_CHECK(mapTypes.size() == 1 && mapTypes[0] == D3D11_MAP_WRITE_DISCARD);
+	}
+
+	return failures;
+}
+
+unsigned int SelfTest::FailedMeshLoads()
+{
+	unsigned int failures = 0;
+	for (int packed = 0; packed < 2; packed++)
+	{
+		// Deferred, so nothing touches the arena's render context
+		Mesh mesh("SelfTestMissingFile.obj", packed != 0, true);
+		mesh.Upload();
+		SELF_TEST_CHECK(mesh.GetGeometry() == GeometryArena::InvalidHandle);
+		SELF_TEST_CHECK(mesh.GetIndexCount() == 0);
+		SELF_TEST_CHECK(mesh.GetIndexFormat() == DXGI_FORMAT_R32_UINT);
+		SELF_TEST_CHECK(mesh.GetSubMeshes().empty());
+		SELF_TEST_CHECK(mesh.GetMeshlets().empty());
+		SELF_TEST_CHECK(mesh.GetLODCount() == 1 && mesh.GetLOD(1) == &mesh);
+		SELF_TEST_CHECK(mesh.GetMemoryFootprint() == 0);
+		SELF_TEST_CHECK(mesh.GetSourceHash() == 0);
+		SELF_TEST_CHECK(mesh.IsPacked() == (packed != 0));
+	}
+	return failures;
+}
+
+// Binds the same state twice through the cache, so the second of each
+// should be dropped before reaching the target
+static void BindEverything(RenderContext& context, ID3D11VertexShader* vertexShader, ID3D11PixelShader* pixelShader,
+	ID3D11InputLayout* inputLayout, ID3D11Buffer* const* buffers, ID3D11ShaderResourceView* const* views,
+	ID3D11SamplerState* sampler, ID3D11RasterizerState* rasterizerState, ID3D11DepthStencilState* depthStencilState)
+{
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	context.VSSetShader(vertexShader, 0, 0);
+	context.PSSetShader(pixelShader, 0, 0);
+	context.IASetInputLayout(inputLayout);
+	context.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context.IASetVertexBuffers(0, 1, &buffers[0], &stride, &offset);
+	context.IASetIndexBuffer(buffers[1], DXGI_FORMAT_R32_UINT, 0);
+	context.VSSetConstantBuffers(0, 2, buffers);
+	context.PSSetShaderResources(0, 2, views);
+	context.PSSetSamplers(0, 1, &sampler);
+	context.RSSetState(rasterizerState);
+	context.OMSetDepthStencilState(depthStencilState, 0);
+}
+
+unsigned int SelfTest::StateCacheFiltering()
+{
+	unsigned int failures = 0;
+
+	std::shared_ptr<NullRenderContext> target = std::make_shared<NullRenderContext>();
+	StateCache cache(target);
+	const RenderStats& forwarded = target->GetStats();
+	const StateCacheStats& cacheStats = cache.GetCacheStats();
+
+	// Something of each kind to bind, made through the cache
+	const unsigned char bytecode[16] = { 1 };
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader;
+	SELF_TEST_CHECK(SUCCEEDED(cache.CreateVertexShader(bytecode, sizeof(bytecode), 0, vertexShader.GetAddressOf())));
+	SELF_TEST_CHECK(SUCCEEDED(cache.CreatePixelShader(bytecode, sizeof(bytecode), 0, pixelShader.GetAddressOf())));
+
+	D3D11_INPUT_ELEMENT_DESC element = { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	SELF_TEST_CHECK(SUCCEEDED(cache.CreateInputLayout(&element, 1, bytecode, sizeof(bytecode), inputLayout.GetAddressOf())));
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = 256;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffers[2];
+	for (Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer : buffers)
+		SELF_TEST_CHECK(SUCCEEDED(cache.CreateBuffer(&bufferDesc, 0, buffer.GetAddressOf())));
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = 4;
+	textureDesc.Height = 4;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.SampleDesc.Count = 1;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> views[2];
+	SELF_TEST_CHECK(SUCCEEDED(cache.CreateTexture2D(&textureDesc, 0, texture.GetAddressOf())));
+	for (Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& view : views)
+		SELF_TEST_CHECK(SUCCEEDED(cache.CreateShaderResourceView(texture.Get(), 0, view.GetAddressOf())));
+
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	D3D11_RASTERIZER_DESC rasterizerDesc = {};
+	D3D11_DEPTH_STENCIL_DESC depthStencilDesc = {};
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
+	SELF_TEST_CHECK(SUCCEEDED(cache.CreateSamplerState(&samplerDesc, sampler.GetAddressOf())));
+	SELF_TEST_CHECK(SUCCEEDED(cache.CreateRasterizerState(&rasterizerDesc, rasterizerState.GetAddressOf())));
+	SELF_TEST_CHECK(SUCCEEDED(cache.CreateDepthStencilState(&depthStencilDesc, depthStencilState.GetAddressOf())));
+
+	ID3D11Buffer* const bufferPointers[2] = { buffers[0].Get(), buffers[1].Get() };
+	ID3D11ShaderResourceView* const viewPointers[2] = { views[0].Get(), views[1].Get() };
+	const RenderCommand filteredCommands[] =
+	{
+		RenderCommand::SetShader, RenderCommand::SetInputLayout, RenderCommand::SetPrimitiveTopology,
+		RenderCommand::SetVertexBuffers, RenderCommand::SetIndexBuffer, RenderCommand::SetConstantBuffers,
+		RenderCommand::SetShaderResources, RenderCommand::SetSamplers, RenderCommand::SetRasterizerState,
+		RenderCommand::SetDepthStencilState,
+	};
+
+	// Everything bound twice, with draws (which always go through) after
+	// each: only the first of each bind reaches the target
+	target->ResetStats();
+	cache.ResetCacheStats();
+	for (int pass = 0; pass < 2; pass++)
+	{
+		BindEverything(cache, vertexShader.Get(), pixelShader.Get(), inputLayout.Get(), bufferPointers, viewPointers,
+			sampler.Get(), rasterizerState.Get(), depthStencilState.Get());
+		cache.DrawIndexed(36, 0, 0);
+	}
+	for (RenderCommand command : filteredCommands)
+	{
+		// Two shaders are set each pass, one per stage
+		unsigned int perPass = command == RenderCommand::SetShader ? 2 : 1;
+		SELF_TEST_CHECK(cacheStats.Issued[(int)command] == perPass && cacheStats.Skipped[(int)command] == perPass);
+		SELF_TEST_CHECK(forwarded.Calls[(int)command] == perPass);
+	}
+	SELF_TEST_CHECK(cacheStats.Issued[(int)RenderCommand::DrawIndexed] == 2 && forwarded.Calls[(int)RenderCommand::DrawIndexed] == 2);
+	SELF_TEST_CHECK(cacheStats.Skipped[(int)RenderCommand::DrawIndexed] == 0);
+
+	// Changing one slot of a range passes on just that slot, and a
+	// new stencil reference or vertex buffer offset counts as a change
+	target->SetRecording(true);
+	target->ClearCommands();
+	ID3D11ShaderResourceView* const oneChanged[2] = { views[0].Get(), views[0].Get() };
+	cache.PSSetShaderResources(0, 2, oneChanged);
+	cache.OMSetDepthStencilState(depthStencilState.Get(), 1);
+	UINT stride = sizeof(Vertex);
+	UINT offset = 64;
+	cache.IASetVertexBuffers(0, 1, bufferPointers, &stride, &offset);
+	const std::vector<RecordedCommand>& commands = target->GetCommands();
+	SELF_TEST_CHECK(commands.size() == 3);
+	if (commands.size() == 3)
+	{
+		SELF_TEST_CHECK(commands[0].Command == RenderCommand::SetShaderResources && commands[0].Slot == 1 && commands[0].Count == 1);
+		SELF_TEST_CHECK(commands[0].Object == views[0].Get());
+		SELF_TEST_CHECK(commands[1].Command == RenderCommand::SetDepthStencilState && commands[1].Slot == 1);
+		SELF_TEST_CHECK(commands[2].Command == RenderCommand::SetVertexBuffers);
+	}
+	target->SetRecording(false);
+
+	// Binding render targets can unbind shader resources, so the cache
+	// forgets them, and invalidating forgets everything
+	target->ResetStats();
+	cache.ResetCacheStats();
+	cache.OMSetRenderTargets(0, 0, 0);
+	cache.PSSetShaderResources(0, 2, oneChanged);
+	cache.PSSetSamplers(0, 1, sampler.GetAddressOf());
+	SELF_TEST_CHECK(forwarded.Calls[(int)RenderCommand::SetShaderResources] == 1);
+	SELF_TEST_CHECK(forwarded.Calls[(int)RenderCommand::SetSamplers] == 0);
+
+	target->ResetStats();
+	cache.Invalidate();
+	BindEverything(cache, vertexShader.Get(), pixelShader.Get(), inputLayout.Get(), bufferPointers, viewPointers,
+		sampler.Get(), rasterizerState.Get(), depthStencilState.Get());
+	for (RenderCommand command : filteredCommands)
+		SELF_TEST_CHECK(forwarded.Calls[(int)command] == (command == RenderCommand::SetShader ? 2u : 1u));
+
+	// While disabled nothing is dropped
+	target->ResetStats();
+	cache.ResetCacheStats();
+	cache.SetEnabled(false);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		BindEverything(cache, vertexShader.Get(), pixelShader.Get(), inputLayout.Get(), bufferPointers, viewPointers,
+			sampler.Get(), rasterizerState.Get(), depthStencilState.Get());
+	}
+	for (RenderCommand command : filteredCommands)
+	{
+		unsigned int calls = command == RenderCommand::SetShader ? 4 : 2;
+		SELF_TEST_CHECK(forwarded.Calls[(int)command] == calls && cacheStats.Skipped[(int)command] == 0);
+	}
+
+	return failures;
+}
+
+// --------------------------------------------------------
+// A unit UV sphere, centered on the origin, with its own
+// vertices along the u = 0/1 seam and at each pole, as an
+// OBJ export would have.  No triangles are made between
+// two vertices at the same pole.
+// --------------------------------------------------------
+static void BuildSphere(int rings, int segments, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	for (int r = 0; r <= rings; r++)
+	{
+		float theta = XM_PI * r / rings;
+		for (int s = 0; s <= segments; s++)
+		{
+			float phi = XM_2PI * s / segments;
+			Vertex vertex = {};
+			vertex.Position = XMFLOAT3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+			vertex.Normal = vertex.Position;
+			vertex.UV = XMFLOAT2((float)s / segments, (float)r / rings);
+			vertices.push_back(vertex);
+		}
+	}
+
+	for (int r = 0; r < rings; r++)
+	{
+		for (int s = 0; s < segments; s++)
+		{
+			unsigned int a = r * (segments + 1) + s;
+			unsigned int b = a + 1;
+			unsigned int c = a + segments + 1;
+			unsigned int d = c + 1;
+			if (r > 0)
+				indices.insert(indices.end(), { a, b, c });
+			if (r < rings - 1)
+				indices.insert(indices.end(), { b, d, c });
+		}
+	}
+}
+
+// Whether a triangle faces away from the origin.  Front faces
+// are clockwise, as Direct3D and the OBJ loader have them, so
+// cross(p1 - p0, p2 - p0) points out of the front.
+static bool FacesOutward(const std::vector<Vertex>& vertices, const unsigned int* triangle)
+{
+	XMVECTOR a = XMLoadFloat3(&vertices[triangle[0]].Position);
+	XMVECTOR b = XMLoadFloat3(&vertices[triangle[1]].Position);
+	XMVECTOR c = XMLoadFloat3(&vertices[triangle[2]].Position);
+	XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+	return XMVectorGetX(XMVector3Dot(normal, XMVectorAdd(a, XMVectorAdd(b, c)))) > 0.0f;
+}
+
+// Furthest any triangle's centroid sits inside the unit sphere,
+// which grows as triangles get larger and flatter
+static float SphereDeviation(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	float largest = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		XMVECTOR centroid = XMVectorScale(XMVectorAdd(XMLoadFloat3(&vertices[indices[i]].Position),
+			XMVectorAdd(XMLoadFloat3(&vertices[indices[i + 1]].Position), XMLoadFloat3(&vertices[indices[i + 2]].Position))), 1.0f / 3.0f);
+		largest = fmaxf(largest, 1.0f - XMVectorGetX(XMVector3Length(centroid)));
+	}
+	return largest;
+}
+
+// Problems with an index list: out of range or repeated
+// indices, and triangles facing the wrong way
+static unsigned int CheckSphereTriangles(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	unsigned int failures = 0;
+	SELF_TEST_CHECK(indices.size() % 3 == 0);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const unsigned int* triangle = &indices[i];
+		SELF_TEST_CHECK(triangle[0] < vertices.size() && triangle[1] < vertices.size() && triangle[2] < vertices.size());
+		SELF_TEST_CHECK(triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[0] != triangle[2]);
+		if (failures > 0)
+			return failures;
+		SELF_TEST_CHECK(FacesOutward(vertices, triangle));
+		if (failures > 0)
+			return failures;
+	}
+	return failures;
+}
+
+unsigned int SelfTest::MeshSimplification()
+{
+	unsigned int failures = 0;
+
+	std::vector<Vertex> sphere;
+	std::vector<unsigned int> sphereIndices;
+	BuildSphere(64, 128, sphere, sphereIndices);
+	SELF_TEST_CHECK(CheckSphereTriangles(sphere, sphereIndices) == 0);
+	const unsigned int triangles = (unsigned int)sphereIndices.size() / 3;
+
+	// The vertices along the u = 0/1 seam must all still be used at
+	// every level of detail.  (Those at the poles can go unused once
+	// the ring next to them thins out, which leaves no gap.)
+	std::vector<unsigned int> seamVertices;
+	for (unsigned int r = 1; r < 64; r++)
+	{
+		seamVertices.push_back(r * 129);
+		seamVertices.push_back(r * 129 + 128);
+	}
+
+	// Each ratio lands at or under its target, keeps every triangle
+	// facing out and every seam vertex, and costs more error (and
+	// strays further from the sphere) than the one before it
+	const float ratios[] = { 0.5f, 0.25f, 0.125f };
+	float lastError = 0;
+	float lastDeviation = SphereDeviation(sphere, sphereIndices);
+	for (float ratio : ratios)
+	{
+		unsigned int target = (unsigned int)(triangles * ratio) * 3;
+		std::vector<unsigned int> lod;
+		float error = MeshSimplifier::Simplify(sphere, sphereIndices, target, lod);
+		float deviation = SphereDeviation(sphere, lod);
+		printf("  %.3f of %u triangles: %zu triangles, quadric error %g, sphere deviation %.5f\n",
+			ratio, triangles, lod.size() / 3, error, deviation);
+
+		SELF_TEST_CHECK(lod.size() <= target && lod.size() >= target * 9 / 10);
+		SELF_TEST_CHECK(CheckSphereTriangles(sphere, lod) == 0);
+		SELF_TEST_CHECK(error > lastError && deviation > lastDeviation);
+
+		// A level an eighth the size is still within 2% of the radius
+		SELF_TEST_CHECK(deviation < 0.02f);
+
+		std::vector<bool> used(sphere.size(), false);
+		for (unsigned int index : lod)
+			used[index] = true;
+		unsigned int lostSeamVertices = 0;
+		for (unsigned int v : seamVertices)
+		{
+			if (!used[v])
+				lostSeamVertices++;
+		}
+		SELF_TEST_CHECK(lostSeamVertices == 0);
+
+		lastError = error;
+		lastDeviation = deviation;
+	}
+
+	// With no triangle target, only the error limit stops it, and
+	// no collapse past the limit is made
+	{
+		std::vector<unsigned int> half;
+		float halfError = MeshSimplifier::Simplify(sphere, sphereIndices, (unsigned int)(triangles / 2) * 3, half);
+		std::vector<unsigned int> lod;
+		float error = MeshSimplifier::Simplify(sphere, sphereIndices, 0, lod, halfError);
+		SELF_TEST_CHECK(error <= halfError && lod.size() > 0 && lod.size() < sphereIndices.size());
+		SELF_TEST_CHECK(CheckSphereTriangles(sphere, lod) == 0);
+	}
+
+	// A flat grid's interior collapses at no cost at all, down
+	// to far fewer triangles, without moving off the plane
+	{
+		const int size = 32;
+		std::vector<Vertex> grid;
+		std::vector<unsigned int> gridIndices;
+		for (int z = 0; z <= size; z++)
+		{
+			for (int x = 0; x <= size; x++)
+			{
+				Vertex vertex = {};
+				vertex.Position = XMFLOAT3((float)x, 0.0f, (float)z);
+				vertex.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				vertex.UV = XMFLOAT2((float)x / size, (float)z / size);
+				grid.push_back(vertex);
+			}
+		}
+		for (int z = 0; z < size; z++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				unsigned int a = z * (size + 1) + x;
+				unsigned int c = a + size + 1;
+				gridIndices.insert(gridIndices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+			}
+		}
+
+		std::vector<unsigned int> lod;
+		float error = MeshSimplifier::Simplify(grid, gridIndices, 0, lod, 1e-6f);
+		SELF_TEST_CHECK(error <= 1e-6f);
+		SELF_TEST_CHECK(lod.size() > 0 && lod.size() < gridIndices.size() / 4);
+	}
+
+	// The chain gets smaller at every level
+	{
+		std::vector<std::vector<unsigned int>> lods;
+		MeshSimplifier::BuildLODChain(sphere, sphereIndices, std::vector<float>(ratios, ratios + 3), lods);
+		SELF_TEST_CHECK(lods.size() == 3);
+		size_t previous = sphereIndices.size();
+		for (size_t level = 0; level < lods.size(); level++)
+		{
+			SELF_TEST_CHECK(lods[level].size() < previous);
+			SELF_TEST_CHECK(lods[level].size() <= (size_t)(triangles * ratios[level]) * 3);
+			SELF_TEST_CHECK(CheckSphereTriangles(sphere, lods[level]) == 0);
+			previous = lods[level].size();
+		}
+	}
+
+	return failures;
+}
+
+// Whether a triangle's front faces a point
+static bool FacesPoint(const std::vector<Vertex>& vertices, const unsigned int* triangle, const XMFLOAT3& point)
+{
+	XMVECTOR a = XMLoadFloat3(&vertices[triangle[0]].Position);
+	XMVECTOR b = XMLoadFloat3(&vertices[triangle[1]].Position);
+	XMVECTOR c = XMLoadFloat3(&vertices[triangle[2]].Position);
+	XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+	return XMVectorGetX(XMVector3Dot(normal, XMVectorSubtract(XMLoadFloat3(&point), a))) > 0.0f;
+}
+
+unsigned int SelfTest::MeshletCulling()
+{
+	unsigned int failures = 0;
+
+	std::vector<Vertex> sphere;
+	std::vector<unsigned int> indices;
+	BuildSphere(64, 128, sphere, indices);
+	std::vector<SubMesh> subMeshes = { { 0, (unsigned int)indices.size(), 0 } };
+	std::vector<Meshlet> meshlets;
+	MeshletBuilder::Build(sphere.data(), indices.data(), subMeshes, meshlets);
+	SELF_TEST_CHECK(meshlets.size() >= indices.size() / 3 / MeshletBuilder::MaxTriangles);
+
+	// Meshlets cover the index buffer in order, within the size limits,
+	// with every vertex inside the sphere and every triangle inside the cone
+	unsigned int nextIndex = 0;
+	unsigned int cullableCones = 0;
+	for (const Meshlet& meshlet : meshlets)
+	{
+		SELF_TEST_CHECK(meshlet.StartIndex == nextIndex && meshlet.IndexCount % 3 == 0 && meshlet.BaseVertex == 0);
+		SELF_TEST_CHECK(meshlet.IndexCount > 0 && meshlet.IndexCount / 3 <= MeshletBuilder::MaxTriangles);
+		nextIndex = meshlet.StartIndex + meshlet.IndexCount;
+
+		std::vector<unsigned int> used(&indices[meshlet.StartIndex], &indices[meshlet.StartIndex] + meshlet.IndexCount);
+		std::sort(used.begin(), used.end());
+		SELF_TEST_CHECK(std::unique(used.begin(), used.end()) - used.begin() <= (int)MeshletBuilder::MaxVertices);
+
+		XMVECTOR center = XMLoadFloat3(&meshlet.Center);
+		XMVECTOR axis = XMLoadFloat3(&meshlet.ConeAxis);
+		float minCosine = sqrtf(fmaxf(0.0f, 1.0f - meshlet.ConeCutoff * meshlet.ConeCutoff));
+		bool outsideSphere = false;
+		bool outsideCone = false;
+		for (unsigned int i = meshlet.StartIndex; i < nextIndex; i += 3)
+		{
+			XMVECTOR corners[3];
+			for (int c = 0; c < 3; c++)
+			{
+				corners[c] = XMLoadFloat3(&sphere[indices[i + c]].Position);
+				if (XMVectorGetX(XMVector3Length(XMVectorSubtract(corners[c], center))) > meshlet.Radius * 1.0001f)
+					outsideSphere = true;
+			}
+
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(corners[1], corners[0]), XMVectorSubtract(corners[2], corners[0]));
+			if (meshlet.ConeCutoff < 1.0f && XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f &&
+				XMVectorGetX(XMVector3Dot(XMVector3Normalize(normal), axis)) < minCosine - 0.0001f)
+				outsideCone = true;
+		}
+		SELF_TEST_CHECK(!outsideSphere && !outsideCone);
+		if (meshlet.ConeCutoff < 1.0f)
+			cullableCones++;
+	}
+	SELF_TEST_CHECK(nextIndex == indices.size());
+	SELF_TEST_CHECK(cullableCones > meshlets.size() / 2);
+
+	// Looking at the sphere from 5 units away, about half of it faces
+	// away, but no triangle facing the camera is culled
+	XMFLOAT3 cameraPosition(0.0f, 0.0f, -5.0f);
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection,
+		XMMatrixLookToLH(XMLoadFloat3(&cameraPosition), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)) *
+		XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 100.0f));
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+
+	std::vector<SubMesh> draws;
+	MeshletCullStats stats = MeshletCuller::Cull(meshlets, world, viewProjection, cameraPosition, draws);
+	printf("  %zu meshlets from %zu triangles: %u visible, %u back facing, %u outside, in %zu draws\n",
+		meshlets.size(), indices.size() / 3, stats.Visible, stats.BackFacing, stats.OutsideFrustum, draws.size());
+	SELF_TEST_CHECK(stats.Visible + stats.BackFacing + stats.OutsideFrustum == meshlets.size());
+	SELF_TEST_CHECK(stats.OutsideFrustum == 0 && stats.BackFacing > meshlets.size() / 4);
+
+	std::vector<bool> drawn(indices.size() / 3, false);
+	unsigned int drawnIndices = 0;
+	for (size_t d = 0; d < draws.size(); d++)
+	{
+		// In order, with neighbors merged into one draw
+		SELF_TEST_CHECK(d == 0 || draws[d].StartIndex > draws[d - 1].StartIndex + draws[d - 1].IndexCount);
+		for (unsigned int i = draws[d].StartIndex; i < draws[d].StartIndex + draws[d].IndexCount; i += 3)
+			drawn[i / 3] = true;
+		drawnIndices += draws[d].IndexCount;
+	}
+	unsigned int lostTriangles = 0;
+	for (size_t t = 0; t < drawn.size(); t++)
+	{
+		if (!drawn[t] && FacesPoint(sphere, &indices[t * 3], cameraPosition))
+			lostTriangles++;
+	}
+	SELF_TEST_CHECK(lostTriangles == 0);
+	SELF_TEST_CHECK(drawnIndices < indices.size() * 3 / 4);
+
+	// Off to the side, everything is outside the frustum
+	draws.clear();
+	XMStoreFloat4x4(&world, XMMatrixTranslation(100.0f, 0.0f, 0.0f));
+	stats = MeshletCuller::Cull(meshlets, world, viewProjection, cameraPosition, draws);
+	SELF_TEST_CHECK(stats.OutsideFrustum == meshlets.size() && draws.empty());
+
+	// A non-uniform scale bends the cones, so none are used
+	draws.clear();
+	XMStoreFloat4x4(&world, XMMatrixScaling(1.0f, 2.0f, 1.0f));
+	stats = MeshletCuller::Cull(meshlets, world, viewProjection, cameraPosition, draws);
+	SELF_TEST_CHECK(stats.BackFacing == 0 && stats.Visible + stats.OutsideFrustum == meshlets.size());
+
+	return failures;
+}
+
+// Whether any two live ranges in the same arena buffer overlap
+static bool ArenaRangesOverlap(GeometryArena& arena, const std::vector<unsigned int>& handles)
+{
+	// Start and end of each range, per buffer
+	std::map<ID3D11Buffer*, std::vector<std::pair<unsigned int, unsigned int>>> ranges;
+	for (unsigned int handle : handles)
+	{
+		const GeometryRange& range = arena.GetRange(handle);
+		ranges[arena.GetVertexBuffer(handle).Get()].push_back({ (unsigned int)range.BaseVertex, range.BaseVertex + range.VertexCount });
+		ranges[arena.GetIndexBuffer(handle).Get()].push_back({ range.FirstIndex, range.FirstIndex + range.IndexCount });
+	}
+
+	for (auto& buffer : ranges)
+	{
+		std::sort(buffer.second.begin(), buffer.second.end());
+		for (size_t i = 1; i < buffer.second.size(); i++)
+		{
+			if (buffer.second[i].first < buffer.second[i - 1].second)
+				return true;
+		}
+	}
+	return false;
+}
+
+unsigned int SelfTest::GeometryArenaChurn()
+{
+	unsigned int failures = 0;
+
+	// A context of its own, detached again at the end
+	GeometryArena& arena = GeometryArena::GetInstance();
+	arena.Initialize(std::make_shared<NullRenderContext>());
+
+	// Meshes of a hundred to 20,000 vertices, in both vertex formats
+	// and index sizes, loaded and unloaded as levels stream in and out.
+	// Their data doesn't matter, since the null context drops it.
+	struct LiveMesh
+	{
+		unsigned int Handle;
+		unsigned long long Bytes;
+		GeometryRange Range;
+	};
+	std::vector<LiveMesh> live;
+	std::vector<unsigned char> data(20100 * 3 * sizeof(unsigned int));
+	unsigned long long liveBytes = 0;
+	uint64_t state = 41;
+	for (int step = 0; step < 4000; step++)
+	{
+		if (live.size() < 16 || (live.size() < 200 && NextRandom(state) % 3 != 0))
+		{
+			unsigned int vertexCount = 100 + NextRandom(state) % 20000;
+			unsigned int indexCount = vertexCount * 3;
+			unsigned int stride = NextRandom(state) % 2 ? sizeof(PackedVertex) : sizeof(Vertex);
+			bool shortIndices = NextRandom(state) % 2 != 0;
+			DXGI_FORMAT indexFormat = shortIndices ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+			LiveMesh mesh;
+			mesh.Handle = arena.Allocate(data.data(), stride, vertexCount, data.data(), indexFormat, indexCount);
+			SELF_TEST_CHECK(mesh.Handle != GeometryArena::InvalidHandle);
+			if (mesh.Handle == GeometryArena::InvalidHandle)
+				break;
+			mesh.Bytes = (unsigned long long)vertexCount * stride + (unsigned long long)indexCount * (shortIndices ? 2 : 4);
+			mesh.Range = arena.GetRange(mesh.Handle);
+			live.push_back(mesh);
+			liveBytes += mesh.Bytes;
+		}
+		else
+		{
+			size_t victim = NextRandom(state) % live.size();
+			arena.Free(live[victim].Handle);
+			liveBytes -= live[victim].Bytes;
+			live[victim] = live.back();
+			live.pop_back();
+		}
+	}
+
+	std::vector<unsigned int> handles;
+	for (const LiveMesh& mesh : live)
+		handles.push_back(mesh.Handle);
+
+	// Churn leaves holes, but never overlaps or loses track of bytes
+	arena.PrintReport();
+	GeometryArenaStats stats = arena.GetStats();
+	SELF_TEST_CHECK(stats.Buffers == 4 && stats.Allocations == live.size());
+	SELF_TEST_CHECK(stats.UsedBytes == liveBytes && stats.UsedBytes <= stats.CapacityBytes);
+	SELF_TEST_CHECK(stats.WorstFragmentation > 0.0f);
+	SELF_TEST_CHECK(!ArenaRangesOverlap(arena, handles));
+
+	// Compacting gathers each buffer's free space into one range,
+	// moving ranges but keeping handles and sizes
+	arena.Compact();
+	GeometryArenaStats compacted = arena.GetStats();
+	printf("  After compacting: worst fragmentation %.3f, %.2f of %.2f MB used\n", compacted.WorstFragmentation,
+		compacted.UsedBytes / (1024.0 * 1024.0), compacted.CapacityBytes / (1024.0 * 1024.0));
+	SELF_TEST_CHECK(compacted.WorstFragmentation == 0.0f);
+	SELF_TEST_CHECK(compacted.UsedBytes == stats.UsedBytes && compacted.Allocations == stats.Allocations);
+	SELF_TEST_CHECK(!ArenaRangesOverlap(arena, handles));
+	for (const LiveMesh& mesh : live)
+	{
+		const GeometryRange& range = arena.GetRange(mesh.Handle);
+		SELF_TEST_CHECK(range.VertexCount == mesh.Range.VertexCount && range.IndexCount == mesh.Range.IndexCount);
+	}
+
+	for (const LiveMesh& mesh : live)
+		arena.Free(mesh.Handle);
+	SELF_TEST_CHECK(arena.GetStats().Allocations == 0 && arena.GetStats().UsedBytes == 0);
+
+	arena.Initialize(0);
+	return failures;
+}
+
+unsigned int SelfTest::RunAll()
+{
+	struct SelfTestGroup
+	{
+		const char* Name;
+		unsigned int (*Run)();
+	};
+	const SelfTestGroup groups[] =
+	{
+		{ "Transform hierarchy", TransformHierarchy },
+		{ "Range allocator churn", RangeAllocatorChurn },
+		{ "Inverse transposes", InverseTranspose },
+		{ "Vertex packing round trip", VertexPackingRoundTrip },
+		{ "Failed mesh loads", FailedMeshLoads },
+		{ "Ring allocator fills", RingAllocatorFills },
+		{ "State cache filtering", StateCacheFiltering },
+		{ "Mesh simplification", MeshSimplification },
+		{ "Meshlet culling", MeshletCulling },
+		{ "Geometry arena churn", GeometryArenaChurn },
+	};
+	const unsigned int groupCount = (unsigned int)(sizeof(groups) / sizeof(groups[0]));
+
+	unsigned int failedGroups = 0;
+	for (const SelfTestGroup& group : groups)
+	{
+		unsigned int failures = group.Run();
+		if (failures > 0)
+			failedGroups++;
+		printf("%s %s (%u failed checks)\n", failures > 0 ? "FAIL" : "PASS", group.Name, failures);
+	}
+
+	printf("%u of %u groups passed\n", groupCount - failedGroups, groupCount);
+	return failedGroups;
+}
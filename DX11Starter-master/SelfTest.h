@@ -0,0 +1,59 @@
+#pragma once
+
+// --------------------------------------------------------
+// Checks of the CPU-side systems, run by the -selftest
+// command line flag so build machines can run them with
+// no window or GPU.  Each group prints the checks that
+// failed and returns how many there were.
+// --------------------------------------------------------
+class SelfTest
+{
+public:
+	// Runs every group, even after one fails, printing PASS or FAIL
+	// for each, and returns how many groups failed
+	static unsigned int RunAll();
+
+	// Deep and wide parent/child hierarchies against matrices built by
+	// hand, plus reparenting, destroying and cycle rejection
+	static unsigned int TransformHierarchy();
+
+	// 200,000 random allocations and frees: ranges never overlap, free
+	// space stays in few enough pieces, and compacting leaves one
+	static unsigned int RangeAllocatorChurn();
+
+	// TransformSystem's inverse transposes against the general inverse,
+	// through nested non-uniform scales and at zero scale
+	static unsigned int InverseTranspose();
+
+	// Vertex to PackedVertex and back for random positions, directions
+	// and uv's, within what 16-bit and half precision can hold
+	static unsigned int VertexPackingRoundTrip();
+
+	// A Mesh whose file is missing is empty but safe to query and upload
+	static unsigned int FailedMeshLoads();
+
+	// RingAllocator's alignment, wraps and generations, and through
+	// ConstantBufferRing on a NullRenderContext, which writes map
+	// with DISCARD and which with NO_OVERWRITE
+	static unsigned int RingAllocatorFills();
+
+	// Duplicate binds of each kind through StateCache on a NullRenderContext:
+	// how many it drops and how many reach the target, including partly
+	// changed ranges and after it's invalidated or disabled
+	static unsigned int StateCacheFiltering();
+
+	// MeshSimplifier on a UV sphere: each level meets its triangle target,
+	// keeps its seams and winding, and costs more quadric error and sphere
+	// deviation than the last, and error limits are respected
+	static unsigned int MeshSimplification();
+
+	// Meshlets of a UV sphere stay in order and within their size limits,
+	// bounds and cones hold their triangles, and culling from a camera
+	// rejects about half of them without losing a front facing triangle
+	static unsigned int MeshletCulling();
+
+	// Meshes of every format loaded and unloaded through GeometryArena on
+	// a NullRenderContext: its report, ranges that never overlap, and
+	// Compact gathering the free space without losing a mesh
+	static unsigned int GeometryArenaChurn();
+};
@@ -11,18 +11,20 @@ bool ISimpleShader::ReportWarnings = false;
 // ISimpleShader::ReportErrors = true;
 // ISimpleShader::ReportWarnings = true;
 
+SimpleShaderUploadStats ISimpleShader::uploadStats = {};
+std::shared_ptr<ConstantBufferRing> ISimpleShader::constantBufferRing;
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
 ///////////////////////////////////////////////////////////////////////////////
 
 // --------------------------------------------------------
-// Constructor accepts Direct3D device & context
+// Constructor accepts the render context
 // --------------------------------------------------------
-ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+ISimpleShader::ISimpleShader(std::shared_ptr<RenderContext> context)
 {
-	// Save the device
-	this->device = device;
+	// Save the render context
 	this->deviceContext = context;
 
 	// Set up fields
@@ -68,6 +70,8 @@ void ISimpleShader::CleanUp()
 	cbTable.clear();
 	samplerTable.clear();
 	textureTable.clear();
+	variables.clear();
+	names.clear();
 }
 
 // --------------------------------------------------------
@@ -145,7 +149,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
 			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
 
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
+			textureTable.insert(std::pair<std::string_view, SimpleSRV*>(StoreName(resourceDesc.Name), srv));
 			shaderResourceViews.push_back(srv);
 		}
 			break;
@@ -157,7 +161,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
 			samp->Index = (unsigned int)samplerStates.size();	// Raw index
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
+			samplerTable.insert(std::pair<std::string_view, SimpleSampler*>(StoreName(resourceDesc.Name), samp));
 			samplerStates.push_back(samp);
 		}
 			break;
@@ -186,7 +190,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		// Set up the buffer and put its pointer in the table
 		constantBuffers[b].BindIndex = bindDesc.BindPoint;
 		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		cbTable.insert(std::pair<std::string_view, SimpleConstantBuffer*>(StoreName(bufferDesc.Name), &constantBuffers[b]));
 
 		// Create this constant buffer
 		D3D11_BUFFER_DESC newBuffDesc = {};
@@ -196,7 +200,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		newBuffDesc.CPUAccessFlags = 0;
 		newBuffDesc.MiscFlags = 0;
 		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
+		deviceContext->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
 
 		// Set up the data buffer for this constant buffer
 		constantBuffers[b].Size = bufferDesc.Size;
@@ -219,12 +223,11 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			varStruct.ConstantBufferIndex = b;
 			varStruct.ByteOffset = varDesc.StartOffset;
 			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
 
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			// Add this variable to the table and the constant buffer,
+			// with its index in the variable list as its handle
+			varTable.insert(std::pair<std::string_view, unsigned int>(StoreName(varDesc.Name), (unsigned int)variables.size()));
+			variables.push_back(varStruct);
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
@@ -240,18 +243,18 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+SimpleShaderVariable* ISimpleShader::FindVariable(std::string_view name, int size)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
+	std::unordered_map<std::string_view, unsigned int>::iterator result =
 		varTable.find(name);
 
 	// Did we find the key?
 	if (result == varTable.end())
 		return 0;
 
-	// Grab the result from the iterator
-	SimpleShaderVariable* var = &(result->second);
+	// Grab the variable the key refers to
+	SimpleShaderVariable* var = &variables[result->second];
 
 	// Is the data size correct ?
 	if (size > 0 && var->Size != size)
@@ -264,10 +267,10 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 // Helper for looking up a constant buffer by name
 // --------------------------------------------------------
-SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
+SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
+	std::unordered_map<std::string_view, SimpleConstantBuffer*>::iterator result =
 		cbTable.find(name);
 
 	// Did we find the key?
@@ -278,6 +281,15 @@ SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
 	return result->second;
 }
 
+// --------------------------------------------------------
+// Keeps a copy of a name for the lookup tables to refer to
+// --------------------------------------------------------
+std::string_view ISimpleShader::StoreName(const char* name)
+{
+	names.emplace_back(name);
+	return names.back();
+}
+
 // --------------------------------------------------------
 // Prints the specified message to the console with the 
 // given color and Visual Studio's output window
@@ -332,6 +344,7 @@ void ISimpleShader::SetShader()
 
 	// Set the shader and any relevant constant buffers, which
 	// is an overloaded method in a subclass
+	RefreshRingSlices();
 	SetShaderAndCBs();
 }
 
@@ -348,10 +361,7 @@ void ISimpleShader::CopyAllBufferData()
 	// Loop through the constant buffers and copy all data
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -380,9 +390,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -392,7 +400,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 //              Useful for updating more frequently-changing
 //              variables without having to re-copy all buffers.
 // --------------------------------------------------------
-void ISimpleShader::CopyBufferData(std::string bufferName)
+void ISimpleShader::CopyBufferData(std::string_view bufferName)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -402,9 +410,93 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Copies a buffer's local data to the GPU, unless nothing
+// has been set since the last copy.  The whole buffer goes
+// up, as constant buffers can't be partially updated.
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	// With the ring, unchanged data still needs copying again
+	// if its slice is from before the ring last started over
+	bool sliceLost = constantBufferRing && cb->Slice.Generation != 0 && !constantBufferRing->IsCurrent(cb->Slice);
+	if (!cb->Dirty && !sliceLost)
+	{
+		uploadStats.Skipped++;
+		return;
+	}
+
+	// Each copy into the ring goes to a new slice, leaving the old
+	// one to any draws still using it.  Anything too big for the
+	// ring goes to the buffer's own memory instead.
+	if (!constantBufferRing || !constantBufferRing->Write(cb->LocalDataBuffer, cb->Size, cb->Slice))
+	{
+		cb->Slice = {};
+		deviceContext->UpdateSubresource(
+			cb->ConstantBuffer.Get(), 0, 0,
+			cb->LocalDataBuffer, 0, 0);
+	}
+	cb->Dirty = false;
+
+	uploadStats.Uploads++;
+	uploadStats.BytesUploaded += cb->Size;
+}
+
+// --------------------------------------------------------
+// Copies data to the ring again for any buffer whose slice
+// has been lost to the ring starting over (at a new frame,
+// or when it fills up).  Copying can itself make the ring
+// start over, losing the slices copied before it, so that
+// gets one more pass.
+// --------------------------------------------------------
+void ISimpleShader::RefreshRingSlices()
+{
+	if (!constantBufferRing)
+		return;
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		unsigned int generation = constantBufferRing->GetGeneration();
+		for (unsigned int i = 0; i < constantBufferCount; i++)
+		{
+			// Data that never went into the ring stays in the buffer's own memory
+			SimpleConstantBuffer* cb = &constantBuffers[i];
+			if (cb->Slice.Generation != 0 && !constantBufferRing->IsCurrent(cb->Slice))
+				UploadBuffer(cb);
+		}
+
+		if (generation == constantBufferRing->GetGeneration())
+			break;
+	}
+}
+
+// --------------------------------------------------------
+// Binds a constant buffer to the given stage: its slice of
+// the ring if it has one, otherwise the buffer itself
+// --------------------------------------------------------
+void ISimpleShader::BindConstantBuffer(ShaderStage stage, SimpleConstantBuffer* cb)
+{
+	if (constantBufferRing && constantBufferRing->IsCurrent(cb->Slice))
+	{
+		ID3D11Buffer* ring = constantBufferRing->GetBuffer();
+		deviceContext->SetConstantBuffers1(
+			stage,
+			cb->BindIndex,
+			1,
+			&ring,
+			&cb->Slice.FirstConstant,
+			&cb->Slice.ConstantCount);
+		return;
+	}
+
+	deviceContext->SetConstantBuffers(
+		stage,
+		cb->BindIndex,
+		1,
+		cb->ConstantBuffer.GetAddressOf());
 }
 
 
@@ -417,7 +509,7 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 //
 // Returns true if data is copied, false if variable doesn't exist
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(std::string_view name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
 	SimpleShaderVariable* var = FindVariable(name, -1);
@@ -426,7 +518,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleShader::SetData() - Shader variable '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' not found. Ensure the name is spelled correctly and that it exists in a constant buffer in the shader.\n");
 		}
 		return false;
@@ -439,26 +531,65 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleShader::SetData() - Shader variable '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' is smaller than the size of the data being set. Ensure the variable is large enough for the specified data.\n");
 		}
 		return false;
 	}
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteVariable(*var, data, size);
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a variable by index with arbitrary data of the specified size.
+// Faster than setting by name, as there's no lookup - resolve the
+// index once with GetVariableIndex() and keep it.
+//
+// index - The index of the shader variable
+// data - The data to set in the buffer
+// size - The size of the data (this must be less than or equal to the variable's size)
+//
+// Returns true if data is copied, false if the index or size is invalid
+// --------------------------------------------------------
+bool ISimpleShader::SetData(unsigned int index, const void* data, unsigned int size)
+{
+	// Validate the index and size
+	if (index >= variables.size() || size > variables[index].Size)
+		return false;
+
+	// Set the data in the local data buffer
+	WriteVariable(variables[index], data, size);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Copies data into a variable's spot in the local data buffer,
+// noting whether it actually changed so unchanged buffers
+// aren't copied
+// --------------------------------------------------------
+void ISimpleShader::WriteVariable(const SimpleShaderVariable& var, const void* data, unsigned int size)
+{
+	SimpleConstantBuffer* cb = &constantBuffers[var.ConstantBufferIndex];
+	if (memcmp(cb->LocalDataBuffer + var.ByteOffset, data, size) != 0)
+	{
+		memcpy(
+			cb->LocalDataBuffer + var.ByteOffset,
+			data,
+			size);
+		cb->Dirty = true;
+	}
+}
+
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(std::string_view name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -466,7 +597,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(std::string_view name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -474,7 +605,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(std::string_view name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -482,7 +613,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(std::string_view name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -490,7 +621,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(std::string_view name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -498,7 +629,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(std::string_view name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -506,7 +637,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(std::string_view name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -514,7 +645,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(std::string_view name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -522,7 +653,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(std::string_view name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -530,16 +661,96 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(std::string_view name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Sets INTEGER data by index
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(unsigned int index, int data)
+{
+	return this->SetData(index, (void*)(&data), sizeof(int));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT variable by index in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat(unsigned int index, float data)
+{
+	return this->SetData(index, (void*)(&data), sizeof(float));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT2 variable by index in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat2(unsigned int index, const float data[2])
+{
+	return this->SetData(index, (void*)data, sizeof(float) * 2);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT2 variable by index in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat2(unsigned int index, const DirectX::XMFLOAT2 data)
+{
+	return this->SetData(index, &data, sizeof(float) * 2);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT3 variable by index in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat3(unsigned int index, const float data[3])
+{
+	return this->SetData(index, (void*)data, sizeof(float) * 3);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT3 variable by index in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat3(unsigned int index, const DirectX::XMFLOAT3 data)
+{
+	return this->SetData(index, &data, sizeof(float) * 3);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable by index in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(unsigned int index, const float data[4])
+{
+	return this->SetData(index, (void*)data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable by index in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(unsigned int index, const DirectX::XMFLOAT4 data)
+{
+	return this->SetData(index, &data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable by index in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(unsigned int index, const float data[16])
+{
+	return this->SetData(index, (void*)data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable by index in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(unsigned int index, const DirectX::XMFLOAT4X4 data)
+{
+	return this->SetData(index, &data, sizeof(float) * 16);
+}
+
 // --------------------------------------------------------
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
 // --------------------------------------------------------
-bool ISimpleShader::HasVariable(std::string name)
+bool ISimpleShader::HasVariable(std::string_view name)
 {
 	return FindVariable(name, -1) != 0;
 }
@@ -547,7 +758,7 @@ bool ISimpleShader::HasVariable(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified SRV
 // --------------------------------------------------------
-bool ISimpleShader::HasShaderResourceView(std::string name)
+bool ISimpleShader::HasShaderResourceView(std::string_view name)
 {
 	return GetShaderResourceViewInfo(name) != 0;
 }
@@ -555,15 +766,53 @@ bool ISimpleShader::HasShaderResourceView(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified sampler
 // --------------------------------------------------------
-bool ISimpleShader::HasSamplerState(std::string name)
+bool ISimpleShader::HasSamplerState(std::string_view name)
 {
 	return GetSamplerInfo(name) != 0;
 }
 
+// --------------------------------------------------------
+// Gets the index of a shader variable, for setting it
+// without a lookup (or -1)
+// --------------------------------------------------------
+int ISimpleShader::GetVariableIndex(std::string_view name)
+{
+	// Look for the key
+	std::unordered_map<std::string_view, unsigned int>::iterator result =
+		varTable.find(name);
+
+	// Did we find the key?
+	if (result == varTable.end())
+		return -1;
+
+	// Success
+	return result->second;
+}
+
+// --------------------------------------------------------
+// Gets the index of an SRV, for setting it without
+// a lookup (or -1)
+// --------------------------------------------------------
+int ISimpleShader::GetShaderResourceViewIndex(std::string_view name)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	return srvInfo == 0 ? -1 : srvInfo->Index;
+}
+
+// --------------------------------------------------------
+// Gets the index of a sampler, for setting it without
+// a lookup (or -1)
+// --------------------------------------------------------
+int ISimpleShader::GetSamplerIndex(std::string_view name)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	return sampInfo == 0 ? -1 : sampInfo->Index;
+}
+
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string_view name)
 {
 	return FindVariable(name, -1);
 }
@@ -573,10 +822,10 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 //
 // name - the name of the SRV
 // --------------------------------------------------------
-const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
+	std::unordered_map<std::string_view, SimpleSRV*>::iterator result =
 		textureTable.find(name);
 
 	// Did we find the key?
@@ -608,10 +857,10 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // 
 // name - the name of the sampler
 // --------------------------------------------------------
-const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
+const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
+	std::unordered_map<std::string_view, SimpleSampler*>::iterator result =
 		samplerTable.find(name);
 
 	// Did we find the key?
@@ -661,7 +910,7 @@ unsigned int ISimpleShader::GetBufferSize(unsigned int index)
 // Gets info about a particular constant buffer 
 // by name, if it exists
 // --------------------------------------------------------
-const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string name)
+const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string_view name)
 {
 	return FindConstantBuffer(name);
 }
@@ -691,8 +940,8 @@ const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(unsigned int index)
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimpleVertexShader::SimpleVertexShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile)
-	: ISimpleShader(device, context) 
+SimpleVertexShader::SimpleVertexShader(std::shared_ptr<RenderContext> context, LPCWSTR shaderFile)
+	: ISimpleShader(context) 
 { 
 	// Ensure we set to zero to successfully trigger
 	// the Input Layout creation during LoadShaderFile()
@@ -708,8 +957,8 @@ SimpleVertexShader::SimpleVertexShader(Microsoft::WRL::ComPtr<ID3D11Device> devi
 // Passing in a valid input layout will stop LoadShaderFile()
 // from creating an input layout from shader reflection
 // --------------------------------------------------------
-SimpleVertexShader::SimpleVertexShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile, Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout, bool perInstanceCompatible)
-	: ISimpleShader(device, context)
+SimpleVertexShader::SimpleVertexShader(std::shared_ptr<RenderContext> context, LPCWSTR shaderFile, Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout, bool perInstanceCompatible)
+	: ISimpleShader(context)
 {
 	// Save the custom input layout
 	this->inputLayout = inputLayout;
@@ -751,7 +1000,7 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 	this->CleanUp();
 
 	// Create the shader from the blob
-	HRESULT result = device->CreateVertexShader(
+	HRESULT result = deviceContext->CreateVertexShader(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		0,
@@ -843,12 +1092,39 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 		}
 
+		// Check the semantic name for a 16-bit packed format ("_UNORM",
+		// "_SNORM" or "_HALF"), which can come before "_PER_INSTANCE".
+		// Digits on the end of a semantic are its index, so the suffixes
+		// can't say "16".  There are no three component 16-bit formats,
+		// so those inputs need 1, 2 or 4.
+		if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32)
+		{
+			if (sem.find("_UNORM") != std::string::npos)
+			{
+				if (paramDesc.Mask == 1) elementDesc.Format = DXGI_FORMAT_R16_UNORM;
+				else if (paramDesc.Mask <= 3) elementDesc.Format = DXGI_FORMAT_R16G16_UNORM;
+				else elementDesc.Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+			}
+			else if (sem.find("_SNORM") != std::string::npos)
+			{
+				if (paramDesc.Mask == 1) elementDesc.Format = DXGI_FORMAT_R16_SNORM;
+				else if (paramDesc.Mask <= 3) elementDesc.Format = DXGI_FORMAT_R16G16_SNORM;
+				else elementDesc.Format = DXGI_FORMAT_R16G16B16A16_SNORM;
+			}
+			else if (sem.find("_HALF") != std::string::npos)
+			{
+				if (paramDesc.Mask == 1) elementDesc.Format = DXGI_FORMAT_R16_FLOAT;
+				else if (paramDesc.Mask <= 3) elementDesc.Format = DXGI_FORMAT_R16G16_FLOAT;
+				else elementDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+			}
+		}
+
 		// Save element desc
 		inputLayoutDesc.push_back(elementDesc);
 	}
 
 	// Try to create Input Layout
-	HRESULT hr = device->CreateInputLayout(
+	HRESULT hr = deviceContext->CreateInputLayout(
 		&inputLayoutDesc[0], 
 		(unsigned int)inputLayoutDesc.size(), 
 		shaderBlob->GetBufferPointer(), 
@@ -880,10 +1156,7 @@ void SimpleVertexShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(ShaderStage::Vertex, &constantBuffers[i]);
 	}
 }
 
@@ -895,7 +1168,7 @@ void SimpleVertexShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleVertexShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -904,7 +1177,7 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleVertexShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -925,7 +1198,7 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleVertexShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -934,7 +1207,7 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleVertexShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -947,6 +1220,72 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a shader resource view by index in the vertex shader stage
+//
+// index - The index of the SRV (see GetShaderResourceViewIndex())
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleVertexShader::SetShaderResourceView(unsigned int index, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	// Validate the index
+	if (index >= shaderResourceViews.size())
+		return false;
+
+	// Set the shader resource view
+	deviceContext->VSSetShaderResources(shaderResourceViews[index]->BindIndex, 1, srv.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by index in the vertex shader stage
+//
+// index - The index of the sampler (see GetSamplerIndex())
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleVertexShader::SetSamplerState(unsigned int index, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	// Validate the index
+	if (index >= samplerStates.size())
+		return false;
+
+	// Set the sampler state
+	deviceContext->VSSetSamplers(samplerStates[index]->BindIndex, 1, samplerState.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a range of shader resource views in the vertex shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// srvs - One SRV (or null) per register
+// --------------------------------------------------------
+void SimpleVertexShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->VSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a range of sampler states in the vertex shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// samplers - One sampler state (or null) per register
+// --------------------------------------------------------
+void SimpleVertexShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplers)
+{
+	deviceContext->VSSetSamplers(startSlot, count, samplers);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ SIMPLE PIXEL SHADER -------------------------------------------------
@@ -955,8 +1294,8 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimplePixelShader::SimplePixelShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile)
-	: ISimpleShader(device, context) 
+SimplePixelShader::SimplePixelShader(std::shared_ptr<RenderContext> context, LPCWSTR shaderFile)
+	: ISimpleShader(context) 
 { 
 	// Load the actual compiled shader file
 	this->LoadShaderFile(shaderFile);
@@ -992,7 +1331,7 @@ bool SimplePixelShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob
 	this->CleanUp();
 
 	// Create the shader from the blob
-	HRESULT result = device->CreatePixelShader(
+	HRESULT result = deviceContext->CreatePixelShader(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		0,
@@ -1022,10 +1361,7 @@ void SimplePixelShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(ShaderStage::Pixel, &constantBuffers[i]);
 	}
 }
 
@@ -1037,7 +1373,7 @@ void SimplePixelShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimplePixelShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1046,7 +1382,7 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 		if (ReportWarnings)
 		{
 			LogWarning("SimplePixelShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1067,7 +1403,7 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimplePixelShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1076,7 +1412,7 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 		if (ReportWarnings)
 		{
 			LogWarning("SimplePixelShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1089,6 +1425,72 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a shader resource view by index in the pixel shader stage
+//
+// index - The index of the SRV (see GetShaderResourceViewIndex())
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimplePixelShader::SetShaderResourceView(unsigned int index, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	// Validate the index
+	if (index >= shaderResourceViews.size())
+		return false;
+
+	// Set the shader resource view
+	deviceContext->PSSetShaderResources(shaderResourceViews[index]->BindIndex, 1, srv.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by index in the pixel shader stage
+//
+// index - The index of the sampler (see GetSamplerIndex())
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimplePixelShader::SetSamplerState(unsigned int index, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	// Validate the index
+	if (index >= samplerStates.size())
+		return false;
+
+	// Set the sampler state
+	deviceContext->PSSetSamplers(samplerStates[index]->BindIndex, 1, samplerState.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a range of shader resource views in the pixel shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// srvs - One SRV (or null) per register
+// --------------------------------------------------------
+void SimplePixelShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->PSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a range of sampler states in the pixel shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// samplers - One sampler state (or null) per register
+// --------------------------------------------------------
+void SimplePixelShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplers)
+{
+	deviceContext->PSSetSamplers(startSlot, count, samplers);
+}
+
 
 
 
@@ -1099,8 +1501,8 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimpleDomainShader::SimpleDomainShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile)
-	: ISimpleShader(device, context) 
+SimpleDomainShader::SimpleDomainShader(std::shared_ptr<RenderContext> context, LPCWSTR shaderFile)
+	: ISimpleShader(context) 
 { 
 	// Load the actual compiled shader file
 	this->LoadShaderFile(shaderFile);
@@ -1136,7 +1538,7 @@ bool SimpleDomainShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 	this->CleanUp();
 
 	// Create the shader from the blob
-	HRESULT result = device->CreateDomainShader(
+	HRESULT result = deviceContext->CreateDomainShader(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		0,
@@ -1166,10 +1568,7 @@ void SimpleDomainShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(ShaderStage::Domain, &constantBuffers[i]);
 	}
 }
 
@@ -1181,7 +1580,7 @@ void SimpleDomainShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleDomainShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1190,7 +1589,7 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleDomainShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1211,7 +1610,7 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleDomainShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1220,7 +1619,7 @@ bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleDomainShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1233,6 +1632,72 @@ bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a shader resource view by index in the domain shader stage
+//
+// index - The index of the SRV (see GetShaderResourceViewIndex())
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleDomainShader::SetShaderResourceView(unsigned int index, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	// Validate the index
+	if (index >= shaderResourceViews.size())
+		return false;
+
+	// Set the shader resource view
+	deviceContext->DSSetShaderResources(shaderResourceViews[index]->BindIndex, 1, srv.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by index in the domain shader stage
+//
+// index - The index of the sampler (see GetSamplerIndex())
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleDomainShader::SetSamplerState(unsigned int index, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	// Validate the index
+	if (index >= samplerStates.size())
+		return false;
+
+	// Set the sampler state
+	deviceContext->DSSetSamplers(samplerStates[index]->BindIndex, 1, samplerState.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a range of shader resource views in the domain shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// srvs - One SRV (or null) per register
+// --------------------------------------------------------
+void SimpleDomainShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->DSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a range of sampler states in the domain shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// samplers - One sampler state (or null) per register
+// --------------------------------------------------------
+void SimpleDomainShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplers)
+{
+	deviceContext->DSSetSamplers(startSlot, count, samplers);
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1242,8 +1707,8 @@ bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimpleHullShader::SimpleHullShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile)
-	: ISimpleShader(device, context) 
+SimpleHullShader::SimpleHullShader(std::shared_ptr<RenderContext> context, LPCWSTR shaderFile)
+	: ISimpleShader(context) 
 { 
 	// Load the actual compiled shader file
 	this->LoadShaderFile(shaderFile);
@@ -1279,7 +1744,7 @@ bool SimpleHullShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
 	this->CleanUp();
 
 	// Create the shader from the blob
-	HRESULT result = device->CreateHullShader(
+	HRESULT result = deviceContext->CreateHullShader(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		0,
@@ -1309,10 +1774,7 @@ void SimpleHullShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(ShaderStage::Hull, &constantBuffers[i]);
 	}
 }
 
@@ -1324,7 +1786,7 @@ void SimpleHullShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleHullShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1333,7 +1795,7 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleHullShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1354,7 +1816,7 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleHullShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1363,7 +1825,7 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleHullShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1376,6 +1838,72 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a shader resource view by index in the hull shader stage
+//
+// index - The index of the SRV (see GetShaderResourceViewIndex())
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleHullShader::SetShaderResourceView(unsigned int index, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	// Validate the index
+	if (index >= shaderResourceViews.size())
+		return false;
+
+	// Set the shader resource view
+	deviceContext->HSSetShaderResources(shaderResourceViews[index]->BindIndex, 1, srv.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by index in the hull shader stage
+//
+// index - The index of the sampler (see GetSamplerIndex())
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleHullShader::SetSamplerState(unsigned int index, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	// Validate the index
+	if (index >= samplerStates.size())
+		return false;
+
+	// Set the sampler state
+	deviceContext->HSSetSamplers(samplerStates[index]->BindIndex, 1, samplerState.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a range of shader resource views in the hull shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// srvs - One SRV (or null) per register
+// --------------------------------------------------------
+void SimpleHullShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->HSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a range of sampler states in the hull shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// samplers - One sampler state (or null) per register
+// --------------------------------------------------------
+void SimpleHullShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplers)
+{
+	deviceContext->HSSetSamplers(startSlot, count, samplers);
+}
+
 
 
 
@@ -1386,8 +1914,8 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 // --------------------------------------------------------
 // Constructor calls the base and sets up potential stream-out options
 // --------------------------------------------------------
-SimpleGeometryShader::SimpleGeometryShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile, bool useStreamOut, bool allowStreamOutRasterization)
-	: ISimpleShader(device, context) 
+SimpleGeometryShader::SimpleGeometryShader(std::shared_ptr<RenderContext> context, LPCWSTR shaderFile, bool useStreamOut, bool allowStreamOutRasterization)
+	: ISimpleShader(context) 
 { 
 	this->streamOutVertexSize = 0;
 	this->useStreamOut = useStreamOut;
@@ -1431,7 +1959,7 @@ bool SimpleGeometryShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderB
 		return this->CreateShaderWithStreamOut(shaderBlob);
 
 	// Create the shader from the blob
-	HRESULT result = device->CreateGeometryShader(
+	HRESULT result = deviceContext->CreateGeometryShader(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		0,
@@ -1498,7 +2026,7 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3D
 	unsigned int rast = allowStreamOutRasterization ? 0 : D3D11_SO_NO_RASTERIZED_STREAM;
 
 	// Create the shader
-	HRESULT result = device->CreateGeometryShaderWithStreamOutput(
+	HRESULT result = deviceContext->CreateGeometryShaderWithStreamOutput(
 		shaderBlob->GetBufferPointer(), // Shader blob pointer
 		shaderBlob->GetBufferSize(),    // Shader blob size
 		&soDecl[0],                     // Stream out declaration
@@ -1549,14 +2077,14 @@ bool SimpleGeometryShader::CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPt
 	desc.Usage               = D3D11_USAGE_DEFAULT;
 
 	// Attempt to create the buffer and return the result
-	HRESULT result = device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+	HRESULT result = deviceContext->CreateBuffer(&desc, 0, buffer.GetAddressOf());
 	return (result == S_OK);
 }
 
 // --------------------------------------------------------
 // Helper method to unbind all stream out buffers from the SO stage
 // --------------------------------------------------------
-void SimpleGeometryShader::UnbindStreamOutStage(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext)
+void SimpleGeometryShader::UnbindStreamOutStage(std::shared_ptr<RenderContext> deviceContext)
 {
 	unsigned int offset = 0;
 	ID3D11Buffer* unset[4] = { 0, 0, 0, 0 }; // Max of 4 output targets according to  Direct3D documentation
@@ -1583,10 +2111,7 @@ void SimpleGeometryShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(ShaderStage::Geometry, &constantBuffers[i]);
 	}
 }
 
@@ -1598,7 +2123,7 @@ void SimpleGeometryShader::SetShaderAndCBs()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleGeometryShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1607,7 +2132,7 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleGeometryShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1628,7 +2153,7 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleGeometryShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1637,7 +2162,7 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::Com
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleGeometryShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1650,6 +2175,72 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::Com
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a shader resource view by index in the Geometry shader stage
+//
+// index - The index of the SRV (see GetShaderResourceViewIndex())
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetShaderResourceView(unsigned int index, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	// Validate the index
+	if (index >= shaderResourceViews.size())
+		return false;
+
+	// Set the shader resource view
+	deviceContext->GSSetShaderResources(shaderResourceViews[index]->BindIndex, 1, srv.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by index in the Geometry shader stage
+//
+// index - The index of the sampler (see GetSamplerIndex())
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetSamplerState(unsigned int index, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	// Validate the index
+	if (index >= samplerStates.size())
+		return false;
+
+	// Set the sampler state
+	deviceContext->GSSetSamplers(samplerStates[index]->BindIndex, 1, samplerState.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a range of shader resource views in the geometry shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// srvs - One SRV (or null) per register
+// --------------------------------------------------------
+void SimpleGeometryShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->GSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a range of sampler states in the geometry shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// samplers - One sampler state (or null) per register
+// --------------------------------------------------------
+void SimpleGeometryShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplers)
+{
+	deviceContext->GSSetSamplers(startSlot, count, samplers);
+}
+
 // --------------------------------------------------------
 // Calculates the number of components specified by a parameter description mask
 //
@@ -1676,8 +2267,8 @@ unsigned int SimpleGeometryShader::CalcComponentCount(unsigned int mask)
 // --------------------------------------------------------
 // Constructor just calls the base
 // --------------------------------------------------------
-SimpleComputeShader::SimpleComputeShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, LPCWSTR shaderFile)
-	: ISimpleShader(device, context) 
+SimpleComputeShader::SimpleComputeShader(std::shared_ptr<RenderContext> context, LPCWSTR shaderFile)
+	: ISimpleShader(context) 
 { 
 	this->threadsTotal = 0;
 	this->threadsX = 0;
@@ -1720,7 +2311,7 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 	this->CleanUp();
 
 	// Create the shader from the blob
-	HRESULT result = device->CreateComputeShader(
+	HRESULT result = deviceContext->CreateComputeShader(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		0,
@@ -1765,7 +2356,7 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 		case D3D_SIT_UAV_RWSTRUCTURED:
 		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
 		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
+			uavTable.insert(std::pair<std::string_view, unsigned int>(StoreName(resourceDesc.Name), resourceDesc.BindPoint));
 		}
 	}
 
@@ -1793,10 +2384,7 @@ void SimpleComputeShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(ShaderStage::Compute, &constantBuffers[i]);
 	}
 }
 
@@ -1856,7 +2444,7 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 // --------------------------------------------------------
 // Determines if this shader has the specified UAV
 // --------------------------------------------------------
-bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
+bool SimpleComputeShader::HasUnorderedAccessView(std::string_view name)
 {
 	return GetUnorderedAccessViewIndex(name) != -1;
 }
@@ -1869,7 +2457,7 @@ bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleComputeShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1878,7 +2466,7 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleComputeShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1899,7 +2487,7 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleComputeShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1908,7 +2496,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleComputeShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1921,6 +2509,72 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a shader resource view by index in the Compute shader stage
+//
+// index - The index of the SRV (see GetShaderResourceViewIndex())
+// srv - The shader resource view of the texture in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleComputeShader::SetShaderResourceView(unsigned int index, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	// Validate the index
+	if (index >= shaderResourceViews.size())
+		return false;
+
+	// Set the shader resource view
+	deviceContext->CSSetShaderResources(shaderResourceViews[index]->BindIndex, 1, srv.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by index in the Compute shader stage
+//
+// index - The index of the sampler (see GetSamplerIndex())
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if the index is valid, false otherwise
+// --------------------------------------------------------
+bool SimpleComputeShader::SetSamplerState(unsigned int index, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	// Validate the index
+	if (index >= samplerStates.size())
+		return false;
+
+	// Set the sampler state
+	deviceContext->CSSetSamplers(samplerStates[index]->BindIndex, 1, samplerState.GetAddressOf());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a range of shader resource views in the compute shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// srvs - One SRV (or null) per register
+// --------------------------------------------------------
+void SimpleComputeShader::SetShaderResourceViews(unsigned int startSlot, unsigned int count, ID3D11ShaderResourceView* const* srvs)
+{
+	deviceContext->CSSetShaderResources(startSlot, count, srvs);
+}
+
+// --------------------------------------------------------
+// Sets a range of sampler states in the compute shader stage
+//
+// startSlot - The first register to set
+// count - How many registers to set
+// samplers - One sampler state (or null) per register
+// --------------------------------------------------------
+void SimpleComputeShader::SetSamplerStates(unsigned int startSlot, unsigned int count, ID3D11SamplerState* const* samplers)
+{
+	deviceContext->CSSetSamplers(startSlot, count, samplers);
+}
+
 // --------------------------------------------------------
 // Sets an unordered access view in the Compute shader stage
 //
@@ -1930,7 +2584,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 //
 // Returns true if a UAV of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
+bool SimpleComputeShader::SetUnorderedAccessView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
 {
 	// Look for the variable and verify
 	unsigned int bindIndex = GetUnorderedAccessViewIndex(name);
@@ -1939,7 +2593,7 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleComputeShader::SetUnorderedAccessView() - UAV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1955,10 +2609,10 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 // --------------------------------------------------------
 // Gets the index of the specified UAV (or -1)
 // --------------------------------------------------------
-int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
+int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, unsigned int>::iterator result =
+	std::unordered_map<std::string_view, unsigned int>::iterator result =
 		uavTable.find(name);
 
 	// Did we find the key?
@@ -1,6 +1,6 @@
 #include "Sky.h"
 
-Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, Microsoft::WRL::ComPtr<ID3D11Device> device, std::shared_ptr<SimpleVertexShader> vertexShader, std::shared_ptr<SimplePixelShader> pixelShader, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureSRV)
+Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, std::shared_ptr<RenderContext> context, std::shared_ptr<SimpleVertexShader> vertexShader, std::shared_ptr<SimplePixelShader> pixelShader, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureSRV)
 {
 	this->mesh = mesh;
 	this->samplerState = samplerState;
@@ -11,15 +11,15 @@ Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState>
 	D3D11_RASTERIZER_DESC rasterDescription = {};
 	rasterDescription.FillMode = D3D11_FILL_SOLID;
 	rasterDescription.CullMode = D3D11_CULL_FRONT;
-	device.Get()->CreateRasterizerState(&rasterDescription, &rasterizerState);
+	context->CreateRasterizerState(&rasterDescription, rasterizerState.GetAddressOf());
 
 	D3D11_DEPTH_STENCIL_DESC stencilDescription = {};
 	stencilDescription.DepthEnable = true;
 	stencilDescription.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	device.Get()->CreateDepthStencilState(&stencilDescription, &depthStencilState);
+	context->CreateDepthStencilState(&stencilDescription, depthStencilState.GetAddressOf());
 }
 
-void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera)
+void Sky::Draw(std::shared_ptr<RenderContext> context, std::shared_ptr<Camera> camera)
 {
 	context->RSSetState(rasterizerState.Get());
 	context->OMSetDepthStencilState(depthStencilState.Get(), 0);
@@ -34,8 +34,18 @@ void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_
 	pixelShader->CopyAllBufferData();
 	pixelShader->SetShader();
 
-	mesh->Draw();
+	mesh->Draw(context);
 
 	context->RSSetState(nullptr);
 	context->OMSetDepthStencilState(nullptr, 0);
 }
+
+void Sky::SetMesh(std::shared_ptr<Mesh> mesh)
+{
+	this->mesh = mesh;
+}
+
+void Sky::SetTexture(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureSRV)
+{
+	this->textureSRV = textureSRV;
+}
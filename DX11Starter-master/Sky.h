@@ -10,12 +10,14 @@ class Sky
 {
 public:
 	Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, 
-		Microsoft::WRL::ComPtr<ID3D11Device> device, 
+		std::shared_ptr<RenderContext> context, 
 		std::shared_ptr<SimpleVertexShader> vertexShader, 
 		std::shared_ptr<SimplePixelShader> pixelShader, 
 		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureSRV);
 
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera);
+	void Draw(std::shared_ptr<RenderContext> context, std::shared_ptr<Camera> camera);
+	void SetMesh(std::shared_ptr<Mesh> mesh);
+	void SetTexture(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureSRV);
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
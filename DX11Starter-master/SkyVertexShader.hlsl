@@ -1,4 +1,4 @@
-cbuffer ExternalData : register(b0) {
+cbuffer PerFrame : register(b0) {
 	matrix view;
 	matrix projection;
 }
@@ -0,0 +1,517 @@
+#include "StateCache.h"
+#include <string.h>
+
+StateCache::StateCache(std::shared_ptr<RenderContext> target)
+{
+	this->target = target;
+	enabled = true;
+	ResetCacheStats();
+	Invalidate();
+}
+
+StateCache::~StateCache()
+{
+}
+
+HRESULT StateCache::CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer)
+{
+	HRESULT hr = target->CreateBuffer(desc, initialData, buffer);
+	if (SUCCEEDED(hr) && buffer)
+		Record(RenderCommand::CreateBuffer, ShaderStage::Count, 0, desc->ByteWidth, *buffer);
+	Issue(RenderCommand::CreateBuffer);
+	return hr;
+}
+
+HRESULT StateCache::CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture)
+{
+	HRESULT hr = target->CreateTexture2D(desc, initialData, texture);
+	if (SUCCEEDED(hr) && texture)
+		Record(RenderCommand::CreateTexture, ShaderStage::Count, 0, 1, *texture);
+	Issue(RenderCommand::CreateTexture);
+	return hr;
+}
+
+HRESULT StateCache::CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view)
+{
+	HRESULT hr = target->CreateShaderResourceView(resource, desc, view);
+	if (SUCCEEDED(hr) && view)
+		Record(RenderCommand::CreateView, ShaderStage::Count, 0, 1, *view);
+	Issue(RenderCommand::CreateView);
+	return hr;
+}
+
+HRESULT StateCache::CreateShader(ShaderStage stage, const void* bytecode, SIZE_T length, ID3D11DeviceChild** shader)
+{
+	HRESULT hr = target->CreateShader(stage, bytecode, length, shader);
+	if (SUCCEEDED(hr) && shader)
+		Record(RenderCommand::CreateShader, stage, 0, (UINT)length, *shader);
+	Issue(RenderCommand::CreateShader);
+	return hr;
+}
+
+HRESULT StateCache::CreateGeometryShaderWithStreamOutput(const void* bytecode, SIZE_T length, const D3D11_SO_DECLARATION_ENTRY* declaration, UINT entryCount,
+	const UINT* strides, UINT strideCount, UINT rasterizedStream, ID3D11ClassLinkage* classLinkage, ID3D11GeometryShader** shader)
+{
+	HRESULT hr = target->CreateGeometryShaderWithStreamOutput(bytecode, length, declaration, entryCount, strides, strideCount, rasterizedStream, classLinkage, shader);
+	if (SUCCEEDED(hr) && shader)
+		Record(RenderCommand::CreateShader, ShaderStage::Geometry, 0, (UINT)length, *shader);
+	Issue(RenderCommand::CreateShader);
+	return hr;
+}
+
+HRESULT StateCache::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* bytecode, SIZE_T length, ID3D11InputLayout** inputLayout)
+{
+	HRESULT hr = target->CreateInputLayout(elements, elementCount, bytecode, length, inputLayout);
+	if (SUCCEEDED(hr) && inputLayout)
+		Record(RenderCommand::CreateInputLayout, ShaderStage::Count, 0, elementCount, *inputLayout);
+	Issue(RenderCommand::CreateInputLayout);
+	return hr;
+}
+
+HRESULT StateCache::CreateSamplerState(const D3D11_SAMPLER_DESC* desc, ID3D11SamplerState** state)
+{
+	HRESULT hr = target->CreateSamplerState(desc, state);
+	if (SUCCEEDED(hr) && state)
+		Record(RenderCommand::CreateState, ShaderStage::Count, 0, 1, *state);
+	Issue(RenderCommand::CreateState);
+	return hr;
+}
+
+HRESULT StateCache::CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** state)
+{
+	HRESULT hr = target->CreateRasterizerState(desc, state);
+	if (SUCCEEDED(hr) && state)
+		Record(RenderCommand::CreateState, ShaderStage::Count, 0, 1, *state);
+	Issue(RenderCommand::CreateState);
+	return hr;
+}
+
+HRESULT StateCache::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** state)
+{
+	HRESULT hr = target->CreateDepthStencilState(desc, state);
+	if (SUCCEEDED(hr) && state)
+		Record(RenderCommand::CreateState, ShaderStage::Count, 0, 1, *state);
+	Issue(RenderCommand::CreateState);
+	return hr;
+}
+
+HRESULT StateCache::CreateTextureFromDDS(const void* data, size_t size, ID3D11ShaderResourceView** view)
+{
+	HRESULT hr = target->CreateTextureFromDDS(data, size, view);
+	if (SUCCEEDED(hr) && view)
+		Record(RenderCommand::CreateTexture, ShaderStage::Count, 0, 1, *view);
+	Issue(RenderCommand::CreateTexture);
+	return hr;
+}
+
+void StateCache::UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box, const void* data, UINT rowPitch, UINT depthPitch)
+{
+	Record(RenderCommand::UpdateSubresource, ShaderStage::Count, subresource, GetUpdateSize(resource, box), resource);
+	Issue(RenderCommand::UpdateSubresource);
+	target->UpdateSubresource(resource, subresource, box, data, rowPitch, depthPitch);
+}
+
+void StateCache::CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y, UINT z,
+	ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* box)
+{
+	Record(RenderCommand::CopySubresourceRegion, ShaderStage::Count, destinationSubresource, box ? box->right - box->left : 0, destination);
+	Issue(RenderCommand::CopySubresourceRegion);
+	target->CopySubresourceRegion(destination, destinationSubresource, x, y, z, source, sourceSubresource, box);
+}
+
+HRESULT StateCache::Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT flags, D3D11_MAPPED_SUBRESOURCE* mapped)
+{
+	Record(RenderCommand::Map, ShaderStage::Count, subresource, (UINT)mapType, resource);
+	Issue(RenderCommand::Map);
+	return target->Map(resource, subresource, mapType, flags, mapped);
+}
+
+void StateCache::Unmap(ID3D11Resource* resource, UINT subresource)
+{
+	Record(RenderCommand::Unmap, ShaderStage::Count, subresource, 1, resource);
+	Issue(RenderCommand::Unmap);
+	target->Unmap(resource, subresource);
+}
+
+void StateCache::IASetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	Record(RenderCommand::SetInputLayout, ShaderStage::Count, 0, 1, inputLayout);
+	if (enabled && !Bind(this->inputLayout, inputLayout))
+	{
+		Skip(RenderCommand::SetInputLayout);
+		return;
+	}
+
+	Issue(RenderCommand::SetInputLayout);
+	target->IASetInputLayout(inputLayout);
+}
+
+void StateCache::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	Record(RenderCommand::SetPrimitiveTopology, ShaderStage::Count, (UINT)topology, 1, 0);
+	if (enabled && topologyKnown && this->topology == topology)
+	{
+		Skip(RenderCommand::SetPrimitiveTopology);
+		return;
+	}
+
+	topologyKnown = true;
+	this->topology = topology;
+	Issue(RenderCommand::SetPrimitiveTopology);
+	target->IASetPrimitiveTopology(topology);
+}
+
+void StateCache::IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets)
+{
+	Record(RenderCommand::SetVertexBuffers, ShaderStage::Count, startSlot, count, count > 0 ? buffers[0] : 0);
+
+	// Narrowed by hand, since the strides and offsets matter too
+	if (enabled && startSlot + count <= D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT)
+	{
+		int first = -1;
+		int last = -1;
+		for (UINT i = 0; i < count; i++)
+		{
+			if (Bind(vertexBuffers[startSlot + i], buffers[i], strides[i], offsets[i]))
+			{
+				if (first < 0)
+					first = (int)i;
+				last = (int)i;
+			}
+		}
+
+		if (first < 0)
+		{
+			Skip(RenderCommand::SetVertexBuffers);
+			return;
+		}
+
+		startSlot += first;
+		count = last - first + 1;
+		buffers += first;
+		strides += first;
+		offsets += first;
+	}
+	else
+	{
+		Forget(vertexBuffers, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+	}
+
+	Issue(RenderCommand::SetVertexBuffers);
+	target->IASetVertexBuffers(startSlot, count, buffers, strides, offsets);
+}
+
+void StateCache::IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	Record(RenderCommand::SetIndexBuffer, ShaderStage::Count, offset, 1, buffer);
+	if (enabled && !Bind(indexBuffer, buffer, (UINT)format, offset))
+	{
+		Skip(RenderCommand::SetIndexBuffer);
+		return;
+	}
+
+	Issue(RenderCommand::SetIndexBuffer);
+	target->IASetIndexBuffer(buffer, format, offset);
+}
+
+void StateCache::SetShader(ShaderStage stage, ID3D11DeviceChild* shader)
+{
+	Record(RenderCommand::SetShader, stage, 0, 1, shader);
+	if (enabled && !Bind(stages[(int)stage].Shader, shader))
+	{
+		Skip(RenderCommand::SetShader);
+		return;
+	}
+
+	Issue(RenderCommand::SetShader);
+	target->SetShader(stage, shader);
+}
+
+void StateCache::SetConstantBuffers(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers)
+{
+	Record(RenderCommand::SetConstantBuffers, stage, startSlot, count, count > 0 ? buffers[0] : 0);
+	if (enabled && !BindRange(stages[(int)stage].ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, startSlot, count, buffers))
+	{
+		Skip(RenderCommand::SetConstantBuffers);
+		return;
+	}
+
+	Issue(RenderCommand::SetConstantBuffers);
+	target->SetConstantBuffers(stage, startSlot, count, buffers);
+}
+
+// --------------------------------------------------------
+// Each slot remembers the range of the buffer it was bound
+// with (a whole-buffer bind is a range of zero), so moving
+// to another slice of the same buffer is passed on
+// --------------------------------------------------------
+void StateCache::SetConstantBuffers1(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts)
+{
+	Record(RenderCommand::SetConstantBuffers, stage, startSlot, count, count > 0 ? buffers[0] : 0);
+
+	// Narrowed by hand, since the ranges matter too
+	Slot* slots = stages[(int)stage].ConstantBuffers;
+	if (enabled && startSlot + count <= D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT)
+	{
+		int first = -1;
+		int last = -1;
+		for (UINT i = 0; i < count; i++)
+		{
+			UINT constantCount = constantCounts ? constantCounts[i] : 0;
+			UINT firstConstant = firstConstants ? firstConstants[i] : 0;
+			if (Bind(slots[startSlot + i], buffers[i], constantCount, firstConstant))
+			{
+				if (first < 0)
+					first = (int)i;
+				last = (int)i;
+			}
+		}
+
+		if (first < 0)
+		{
+			Skip(RenderCommand::SetConstantBuffers);
+			return;
+		}
+
+		startSlot += first;
+		count = last - first + 1;
+		buffers += first;
+		if (firstConstants)
+			firstConstants += first;
+		if (constantCounts)
+			constantCounts += first;
+	}
+	else
+	{
+		Forget(slots, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
+	}
+
+	Issue(RenderCommand::SetConstantBuffers);
+	target->SetConstantBuffers1(stage, startSlot, count, buffers, firstConstants, constantCounts);
+}
+
+void StateCache::SetShaderResources(ShaderStage stage, UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views)
+{
+	Record(RenderCommand::SetShaderResources, stage, startSlot, count, count > 0 ? views[0] : 0);
+	if (enabled && !BindRange(stages[(int)stage].ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT, startSlot, count, views))
+	{
+		Skip(RenderCommand::SetShaderResources);
+		return;
+	}
+
+	Issue(RenderCommand::SetShaderResources);
+	target->SetShaderResources(stage, startSlot, count, views);
+}
+
+void StateCache::SetSamplers(ShaderStage stage, UINT startSlot, UINT count, ID3D11SamplerState* const* samplers)
+{
+	Record(RenderCommand::SetSamplers, stage, startSlot, count, count > 0 ? samplers[0] : 0);
+	if (enabled && !BindRange(stages[(int)stage].Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, startSlot, count, samplers))
+	{
+		Skip(RenderCommand::SetSamplers);
+		return;
+	}
+
+	Issue(RenderCommand::SetSamplers);
+	target->SetSamplers(stage, startSlot, count, samplers);
+}
+
+// --------------------------------------------------------
+// Always passed on, since binding resets append and
+// consume counters.  Direct3D also unbinds any shader
+// resource whose resource is bound here, so those slots
+// are no longer known.
+// --------------------------------------------------------
+void StateCache::CSSetUnorderedAccessViews(UINT startSlot, UINT count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts)
+{
+	Record(RenderCommand::SetUnorderedAccessViews, ShaderStage::Compute, startSlot, count, count > 0 ? views[0] : 0);
+	for (StageState& stage : stages)
+		Forget(stage.ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT);
+
+	Issue(RenderCommand::SetUnorderedAccessViews);
+	target->CSSetUnorderedAccessViews(startSlot, count, views, initialCounts);
+}
+
+void StateCache::SOSetTargets(UINT count, ID3D11Buffer* const* buffers, const UINT* offsets)
+{
+	Record(RenderCommand::SetStreamOutTargets, ShaderStage::Count, 0, count, count > 0 ? buffers[0] : 0);
+
+	// Stream out buffers can't stay bound as vertex buffers
+	Forget(vertexBuffers, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+
+	Issue(RenderCommand::SetStreamOutTargets);
+	target->SOSetTargets(count, buffers, offsets);
+}
+
+void StateCache::RSSetState(ID3D11RasterizerState* state)
+{
+	Record(RenderCommand::SetRasterizerState, ShaderStage::Count, 0, 1, state);
+	if (enabled && !Bind(rasterizerState, state))
+	{
+		Skip(RenderCommand::SetRasterizerState);
+		return;
+	}
+
+	Issue(RenderCommand::SetRasterizerState);
+	target->RSSetState(state);
+}
+
+void StateCache::RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports)
+{
+	Record(RenderCommand::SetViewports, ShaderStage::Count, 0, count, 0);
+	Issue(RenderCommand::SetViewports);
+	target->RSSetViewports(count, viewports);
+}
+
+void StateCache::OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+{
+	Record(RenderCommand::SetDepthStencilState, ShaderStage::Count, stencilRef, 1, state);
+	if (enabled && !Bind(depthStencilState, state, 0, stencilRef))
+	{
+		Skip(RenderCommand::SetDepthStencilState);
+		return;
+	}
+
+	Issue(RenderCommand::SetDepthStencilState);
+	target->OMSetDepthStencilState(state, stencilRef);
+}
+
+// --------------------------------------------------------
+// Always passed on.  As with unordered access views, this
+// can unbind shader resources behind our back.
+// --------------------------------------------------------
+void StateCache::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* renderTargets, ID3D11DepthStencilView* depthStencil)
+{
+	Record(RenderCommand::SetRenderTargets, ShaderStage::Count, 0, count, count > 0 ? renderTargets[0] : 0);
+	for (StageState& stage : stages)
+		Forget(stage.ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT);
+
+	Issue(RenderCommand::SetRenderTargets);
+	target->OMSetRenderTargets(count, renderTargets, depthStencil);
+}
+
+void StateCache::ClearRenderTargetView(ID3D11RenderTargetView* renderTarget, const FLOAT color[4])
+{
+	Record(RenderCommand::ClearRenderTarget, ShaderStage::Count, 0, 1, renderTarget);
+	Issue(RenderCommand::ClearRenderTarget);
+	target->ClearRenderTargetView(renderTarget, color);
+}
+
+void StateCache::ClearDepthStencilView(ID3D11DepthStencilView* depthStencil, UINT flags, FLOAT depth, UINT8 stencil)
+{
+	Record(RenderCommand::ClearDepthStencil, ShaderStage::Count, 0, 1, depthStencil);
+	Issue(RenderCommand::ClearDepthStencil);
+	target->ClearDepthStencilView(depthStencil, flags, depth, stencil);
+}
+
+void StateCache::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	Record(RenderCommand::DrawIndexed, ShaderStage::Count, startIndex, indexCount, 0);
+	Issue(RenderCommand::DrawIndexed);
+	target->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void StateCache::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	Record(RenderCommand::DrawIndexedInstanced, ShaderStage::Count, startIndex, indexCountPerInstance * instanceCount, 0);
+	Issue(RenderCommand::DrawIndexedInstanced);
+	target->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void StateCache::Dispatch(UINT groupsX, UINT groupsY, UINT groupsZ)
+{
+	Record(RenderCommand::Dispatch, ShaderStage::Compute, 0, groupsX * groupsY * groupsZ, 0);
+	Issue(RenderCommand::Dispatch);
+	target->Dispatch(groupsX, groupsY, groupsZ);
+}
+
+void StateCache::GenerateMips(ID3D11ShaderResourceView* view)
+{
+	Record(RenderCommand::GenerateMips, ShaderStage::Count, 0, 1, view);
+	Issue(RenderCommand::GenerateMips);
+	target->GenerateMips(view);
+}
+
+bool StateCache::SupportsConstantBufferOffsets()
+{
+	return target->SupportsConstantBufferOffsets();
+}
+
+void StateCache::Invalidate()
+{
+	for (StageState& stage : stages)
+	{
+		Forget(&stage.Shader, 1);
+		Forget(stage.ConstantBuffers, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
+		Forget(stage.ShaderResources, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT);
+		Forget(stage.Samplers, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT);
+	}
+
+	Forget(&inputLayout, 1);
+	Forget(vertexBuffers, D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+	Forget(&indexBuffer, 1);
+	Forget(&rasterizerState, 1);
+	Forget(&depthStencilState, 1);
+	topologyKnown = false;
+	topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+}
+
+void StateCache::SetEnabled(bool enabled)
+{
+	// Binds made while disabled weren't tracked
+	if (enabled && !this->enabled)
+		Invalidate();
+
+	this->enabled = enabled;
+}
+
+bool StateCache::IsEnabled()
+{
+	return enabled;
+}
+
+std::shared_ptr<RenderContext> StateCache::GetTarget()
+{
+	return target;
+}
+
+const StateCacheStats& StateCache::GetCacheStats()
+{
+	return cacheStats;
+}
+
+void StateCache::ResetCacheStats()
+{
+	memset(&cacheStats, 0, sizeof(StateCacheStats));
+}
+
+bool StateCache::Bind(Slot& slot, ID3D11DeviceChild* object, UINT stride, UINT offset)
+{
+	if (slot.Known && slot.Object.Get() == object && slot.Stride == stride && slot.Offset == offset)
+		return false;
+
+	slot.Known = true;
+	slot.Object = object;
+	slot.Stride = stride;
+	slot.Offset = offset;
+	return true;
+}
+
+void StateCache::Forget(Slot* slots, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		slots[i].Known = false;
+		slots[i].Object.Reset();
+	}
+}
+
+void StateCache::Issue(RenderCommand command)
+{
+	cacheStats.Issued[(int)command]++;
+}
+
+void StateCache::Skip(RenderCommand command)
+{
+	cacheStats.Skipped[(int)command]++;
+}
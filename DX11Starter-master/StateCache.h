@@ -0,0 +1,164 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include "RenderContext.h"
+
+struct StateCacheStats
+{
+	unsigned int Issued[(int)RenderCommand::Count];  // Passed on to the target
+	unsigned int Skipped[(int)RenderCommand::Count]; // Dropped, since they'd change nothing
+};
+
+// --------------------------------------------------------
+// Sits in front of another RenderContext, remembering what
+// is bound and dropping binds that wouldn't change it:
+// shaders, constant buffers, shader resources and samplers
+// for every stage, plus the input layout, topology, vertex
+// and index buffers and rasterizer and depth stencil states.
+// When only some slots of a multi-slot bind change, just
+// those are passed on.
+//
+// Bound objects are held onto (as Direct3D itself does),
+// so a released one can't be mistaken for a new one
+// allocated at the same address.
+//
+// Anything else, like creation, draws and updates, goes straight
+// through.  If something binds state on the underlying
+// context directly, call Invalidate afterwards.
+// --------------------------------------------------------
+class StateCache : public RenderContext
+{
+public:
+	StateCache(std::shared_ptr<RenderContext> target);
+	~StateCache();
+
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer);
+	HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture);
+	HRESULT CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view);
+	HRESULT CreateShader(ShaderStage stage, const void* bytecode, SIZE_T length, ID3D11DeviceChild** shader);
+	HRESULT CreateGeometryShaderWithStreamOutput(const void* bytecode, SIZE_T length, const D3D11_SO_DECLARATION_ENTRY* declaration, UINT entryCount,
+		const UINT* strides, UINT strideCount, UINT rasterizedStream, ID3D11ClassLinkage* classLinkage, ID3D11GeometryShader** shader);
+	HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* bytecode, SIZE_T length, ID3D11InputLayout** inputLayout);
+	HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC* desc, ID3D11SamplerState** state);
+	HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** state);
+	HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** state);
+	HRESULT CreateTextureFromDDS(const void* data, size_t size, ID3D11ShaderResourceView** view);
+
+	void UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box, const void* data, UINT rowPitch, UINT depthPitch);
+	void CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y, UINT z,
+		ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* box);
+	HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP mapType, UINT flags, D3D11_MAPPED_SUBRESOURCE* mapped);
+	void Unmap(ID3D11Resource* resource, UINT subresource);
+
+	void IASetInputLayout(ID3D11InputLayout* inputLayout);
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void IASetVertexBuffers(UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets);
+	void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+
+	void SetShader(ShaderStage stage, ID3D11DeviceChild* shader);
+	void SetConstantBuffers(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers);
+	void SetConstantBuffers1(ShaderStage stage, UINT startSlot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstants, const UINT* constantCounts);
+	void SetShaderResources(ShaderStage stage, UINT startSlot, UINT count, ID3D11ShaderResourceView* const* views);
+	void SetSamplers(ShaderStage stage, UINT startSlot, UINT count, ID3D11SamplerState* const* samplers);
+	void CSSetUnorderedAccessViews(UINT startSlot, UINT count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts);
+	void SOSetTargets(UINT count, ID3D11Buffer* const* buffers, const UINT* offsets);
+
+	void RSSetState(ID3D11RasterizerState* state);
+	void RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports);
+	void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef);
+	void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* renderTargets, ID3D11DepthStencilView* depthStencil);
+	void ClearRenderTargetView(ID3D11RenderTargetView* renderTarget, const FLOAT color[4]);
+	void ClearDepthStencilView(ID3D11DepthStencilView* depthStencil, UINT flags, FLOAT depth, UINT8 stencil);
+
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+	void Dispatch(UINT groupsX, UINT groupsY, UINT groupsZ);
+	void GenerateMips(ID3D11ShaderResourceView* view);
+
+	bool SupportsConstantBufferOffsets();
+
+	// Forgets what's bound, so the next bind of everything is passed on
+	void Invalidate();
+
+	// While disabled, every call is passed on
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+
+	std::shared_ptr<RenderContext> GetTarget();
+
+	const StateCacheStats& GetCacheStats();
+	void ResetCacheStats();
+
+private:
+	// What one slot holds, if known
+	struct Slot
+	{
+		bool Known;
+		Microsoft::WRL::ComPtr<ID3D11DeviceChild> Object;
+		UINT Stride; // Or the format, for the index buffer, or the constant count
+		UINT Offset; // Or the stencil reference, for the depth stencil state, or the first constant
+	};
+
+	struct StageState
+	{
+		Slot Shader;
+		Slot ConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+		Slot ShaderResources[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+		Slot Samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+	};
+
+	// Updates the slot, returning whether it changed
+	static bool Bind(Slot& slot, ID3D11DeviceChild* object, UINT stride = 0, UINT offset = 0);
+	static void Forget(Slot* slots, unsigned int count);
+
+	// Binds a range of slots, narrowing it to the ones that change.
+	// Returns false if none do, otherwise the range to pass on.
+	template<typename T>
+	static bool BindRange(Slot* slots, unsigned int slotCount, UINT& startSlot, UINT& count, T* const*& objects)
+	{
+		// Past the end of what's tracked, so always pass it on
+		if (startSlot + count > slotCount)
+		{
+			for (UINT i = startSlot; i < slotCount; i++)
+				slots[i].Known = false;
+			return true;
+		}
+
+		int first = -1;
+		int last = -1;
+		for (UINT i = 0; i < count; i++)
+		{
+			if (Bind(slots[startSlot + i], objects[i]))
+			{
+				if (first < 0)
+					first = (int)i;
+				last = (int)i;
+			}
+		}
+
+		if (first < 0)
+			return false;
+
+		startSlot += first;
+		count = last - first + 1;
+		objects += first;
+		return true;
+	}
+
+	void Issue(RenderCommand command);
+	void Skip(RenderCommand command);
+
+	std::shared_ptr<RenderContext> target;
+	bool enabled;
+	StateCacheStats cacheStats;
+
+	StageState stages[(int)ShaderStage::Count];
+	Slot inputLayout;
+	Slot vertexBuffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+	Slot indexBuffer;
+	bool topologyKnown;
+	D3D11_PRIMITIVE_TOPOLOGY topology;
+	Slot rasterizerState;
+	Slot depthStencilState;
+};
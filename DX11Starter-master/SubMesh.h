@@ -0,0 +1,12 @@
+#pragma once
+
+// --------------------------------------------------------
+// A range of a mesh's index buffer, drawn with its own
+// base vertex so its indices can stay 16-bit
+// --------------------------------------------------------
+struct SubMesh
+{
+	unsigned int StartIndex;
+	unsigned int IndexCount;
+	int BaseVertex;
+};
@@ -0,0 +1,139 @@
+#include "ThreadPool.h"
+
+// Singleton requirement
+ThreadPool* ThreadPool::instance;
+
+// --------------------------------------------------------
+// Starts one worker per hardware thread, minus one for
+// the main thread which also helps out in ParallelFor.
+// A single core still gets one worker for Enqueue, but
+// counts as one thread, so ParallelFor runs serially.
+// --------------------------------------------------------
+ThreadPool::ThreadPool()
+{
+	stopping = false;
+
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	threadCount = hardwareThreads > 1 ? hardwareThreads : 1;
+	unsigned int workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+// --------------------------------------------------------
+// Finishes any queued work, then joins the workers
+// --------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(taskMutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+unsigned int ThreadPool::GetThreadCount()
+{
+	return threadCount;
+}
+
+void ThreadPool::Push(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(taskMutex);
+		tasks.push(std::move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(taskMutex);
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (stopping && tasks.empty())
+				return;
+
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+
+		task();
+	}
+}
+
+// --------------------------------------------------------
+// Shared between the caller and helper tasks of a single
+// ParallelFor.  Helpers may start after the loop is done,
+// so this outlives the call.
+// --------------------------------------------------------
+struct ParallelForState
+{
+	std::function<void(size_t)> Body;
+	size_t Count;
+	std::atomic<size_t> Next;
+	std::atomic<size_t> Done;
+	std::mutex DoneMutex;
+	std::condition_variable AllDone;
+
+	void Run()
+	{
+		size_t i;
+		while ((i = Next++) < Count)
+		{
+			Body(i);
+			if (++Done == Count)
+			{
+				std::lock_guard<std::mutex> lock(DoneMutex);
+				AllDone.notify_all();
+			}
+		}
+	}
+};
+
+void ThreadPool::ParallelFor(size_t count, std::function<void(size_t)> body, unsigned int maxThreads)
+{
+	if (count == 0)
+		return;
+
+	unsigned int threadCount = GetThreadCount();
+	if (maxThreads > 0 && maxThreads < threadCount)
+		threadCount = maxThreads;
+
+	// Not worth handing out a single item
+	if (count == 1 || threadCount == 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			body(i);
+		return;
+	}
+
+	std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+	state->Body = std::move(body);
+	state->Count = count;
+	state->Next = 0;
+	state->Done = 0;
+
+	size_t helpers = count - 1 < threadCount - 1 ? count - 1 : threadCount - 1;
+	for (size_t h = 0; h < helpers; h++)
+	{
+		Push([state]() { state->Run(); });
+	}
+
+	// The caller works too, so this can never wait on
+	// helpers that are stuck behind other queued tasks
+	state->Run();
+
+	std::unique_lock<std::mutex> lock(state->DoneMutex);
+	state->AllDone.wait(lock, [&state]() { return state->Done == state->Count; });
+}
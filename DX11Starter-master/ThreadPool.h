@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// Gets the one and only instance of this class
+	static ThreadPool& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new ThreadPool();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	ThreadPool(ThreadPool const&) = delete;
+	void operator=(ThreadPool const&) = delete;
+
+private:
+	static ThreadPool* instance;
+	ThreadPool();
+
+public:
+	~ThreadPool();
+
+	// Number of threads that work on a ParallelFor, including the caller
+	unsigned int GetThreadCount();
+
+	// Runs a task on a worker thread and returns a future for its result
+	template<typename Task>
+	auto Enqueue(Task task) -> std::future<decltype(task())>
+	{
+		using Result = decltype(task());
+		std::shared_ptr<std::packaged_task<Result()>> packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> result = packaged->get_future();
+		Push([packaged]() { (*packaged)(); });
+		return result;
+	}
+
+	// Calls body(i) for every i in [0, count) across the pool and the
+	// calling thread, returning once all of them have finished.
+	// maxThreads limits how many threads take part (0 for all of them).
+	void ParallelFor(size_t count, std::function<void(size_t)> body, unsigned int maxThreads = 0);
+
+private:
+	std::vector<std::thread> workers;
+	unsigned int threadCount;
+	std::queue<std::function<void()>> tasks;
+	std::mutex taskMutex;
+	std::condition_variable taskAvailable;
+	bool stopping;
+
+	void Push(std::function<void()> task);
+	void WorkerLoop();
+};
@@ -4,134 +4,150 @@ using namespace DirectX;
 
 Transform::Transform()
 {
-	position = XMFLOAT3(0.0f, 0.0f, 0.0f);
-	scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
-	pitchYawRoll = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	handle = TransformSystem::GetInstance().Create();
+}
+
+Transform::~Transform()
+{
+	if(handle != TransformSystem::InvalidHandle) {
+		TransformSystem::GetInstance().Destroy(handle);
+	}
+}
 
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTranspose, XMMatrixIdentity());
+Transform::Transform(Transform&& other) noexcept
+{
+	handle = other.handle;
+	other.handle = TransformSystem::InvalidHandle;
+}
 
-	needsUpdate = false;
+Transform& Transform::operator=(Transform&& other) noexcept
+{
+	// The old handle goes away with other
+	unsigned int old = handle;
+	handle = other.handle;
+	other.handle = old;
+	return *this;
 }
 
 void Transform::SetPosition(float x, float y, float z)
 {
-	position = XMFLOAT3(x, y, z);
-	needsUpdate = true;
+	TransformSystem::GetInstance().SetPosition(handle, XMFLOAT3(x, y, z));
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
-	scale = XMFLOAT3(x, y, z);
-	needsUpdate = true;
+	TransformSystem::GetInstance().SetScale(handle, XMFLOAT3(x, y, z));
+}
+
+void Transform::SetRotation(DirectX::XMFLOAT4 rotation)
+{
+	TransformSystem::GetInstance().SetRotation(handle, rotation);
 }
 
 void Transform::SetPitchYawRoll(float pitch, float yaw, float roll)
 {
-	pitchYawRoll = XMFLOAT3(pitch, yaw, roll);
-	needsUpdate = true;
+	TransformSystem::GetInstance().SetPitchYawRoll(handle, XMFLOAT3(pitch, yaw, roll));
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
 {
+	TransformSystem& system = TransformSystem::GetInstance();
 	XMVECTOR shift = XMVectorSet(x, y, z, 0);
-	XMVECTOR mathPos = XMLoadFloat3(&position);
-	XMStoreFloat3(&position, mathPos + shift);
+	XMVECTOR mathPos = XMLoadFloat3(&system.GetPosition(handle));
 
-	needsUpdate = true;
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, mathPos + shift);
+	system.SetPosition(handle, position);
 }
 
 void Transform::MoveRelative(float x, float y, float z)
 {
-	XMVECTOR mathPos = XMLoadFloat3(&position);
-	XMVECTOR shift = XMVector3Rotate(XMVectorSet(x, y, z, 0), XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)));
-	XMStoreFloat3(&position, mathPos + shift);
+	// Along the (already rotated) axes
+	TransformSystem& system = TransformSystem::GetInstance();
+	XMVECTOR mathPos = XMLoadFloat3(&system.GetPosition(handle));
+	XMVECTOR shift =
+		XMLoadFloat3(&system.GetRight(handle)) * x +
+		XMLoadFloat3(&system.GetUp(handle)) * y +
+		XMLoadFloat3(&system.GetForward(handle)) * z;
 
-	needsUpdate = true;
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, mathPos + shift);
+	system.SetPosition(handle, position);
 }
 
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
+	TransformSystem& system = TransformSystem::GetInstance();
 	XMVECTOR spin = XMVectorSet(pitch, yaw, roll, 0);
-	XMVECTOR mathPYR = XMLoadFloat3(&pitchYawRoll);
-	XMStoreFloat3(&pitchYawRoll, spin + mathPYR);
+	XMVECTOR mathPYR = XMLoadFloat3(&system.GetPitchYawRoll(handle));
 
-	needsUpdate = true;
+	XMFLOAT3 pitchYawRoll;
+	XMStoreFloat3(&pitchYawRoll, spin + mathPYR);
+	system.SetPitchYawRoll(handle, pitchYawRoll);
 }
 
 void Transform::Scale(float x, float y, float z)
 {
+	TransformSystem& system = TransformSystem::GetInstance();
 	XMVECTOR growth = XMVectorSet(x, y, z, 0);
-	XMVECTOR mathScale = XMLoadFloat3(&scale);
-	XMStoreFloat3(&scale, growth * mathScale);
+	XMVECTOR mathScale = XMLoadFloat3(&system.GetScale(handle));
 
-	needsUpdate = true;
+	XMFLOAT3 scale;
+	XMStoreFloat3(&scale, growth * mathScale);
+	system.SetScale(handle, scale);
 }
 
 DirectX::XMFLOAT3 Transform::GetPosition()
 {
-	return position;
+	return TransformSystem::GetInstance().GetPosition(handle);
+}
+
+DirectX::XMFLOAT4 Transform::GetRotation()
+{
+	return TransformSystem::GetInstance().GetRotation(handle);
 }
 
 DirectX::XMFLOAT3 Transform::GetPitchYawRoll()
 {
-	return pitchYawRoll;
+	return TransformSystem::GetInstance().GetPitchYawRoll(handle);
 }
 
 DirectX::XMFLOAT3 Transform::GetScale()
 {
-	return scale;
+	return TransformSystem::GetInstance().GetScale(handle);
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-	if(needsUpdate) {
-		UpdateMatrices();
-	}
-
-	return worldMatrix;
+	return TransformSystem::GetInstance().GetWorldMatrix(handle);
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
-	if(needsUpdate) {
-		UpdateMatrices();
-	}
-
-	return worldInverseTranspose;
+	return TransformSystem::GetInstance().GetWorldInverseTransposeMatrix(handle);
 }
 
 DirectX::XMFLOAT3 Transform::GetRight()
 {
-	XMFLOAT3 result;
-	XMStoreFloat3(&result, XMVector3Rotate(XMVectorSet(1, 0, 0, 0), XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll))));
-	return result;
+	return TransformSystem::GetInstance().GetRight(handle);
 }
 
 DirectX::XMFLOAT3 Transform::GetUp()
 {
-	XMFLOAT3 result;
-	XMStoreFloat3(&result, XMVector3Rotate(XMVectorSet(0, 1, 0, 0), XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll))));
-	return result;
+	return TransformSystem::GetInstance().GetUp(handle);
 }
 
 DirectX::XMFLOAT3 Transform::GetForward()
 {
-	XMFLOAT3 result;
-	XMStoreFloat3(&result, XMVector3Rotate(XMVectorSet(0, 0, 1, 0), XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll))));
-	return result;
+	return TransformSystem::GetInstance().GetForward(handle);
 }
 
-void Transform::UpdateMatrices()
+bool Transform::SetParent(Transform* parent)
 {
-	XMMATRIX translMat = XMMatrixTranslationFromVector(XMLoadFloat3(&position));
-	XMMATRIX rotMat = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-	XMMATRIX scaleMat = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
-
-	XMMATRIX world = scaleMat * rotMat * translMat;
-
-	XMStoreFloat4x4(&worldMatrix, world);
-	XMStoreFloat4x4(&worldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(world)));
+	return TransformSystem::GetInstance().SetParent(handle, parent ? parent->handle : TransformSystem::InvalidHandle);
+}
 
-	needsUpdate = false;
+unsigned int Transform::GetHandle()
+{
+	return handle;
 }
@@ -1,13 +1,25 @@
 #pragma once
 #include <DirectXMath.h>
+#include "TransformSystem.h"
 
+// --------------------------------------------------------
+// A handle to one transform in TransformSystem, which owns
+// the data.  Moving one hands over the handle; copying
+// isn't allowed, since two Transforms would share it.
+// --------------------------------------------------------
 class Transform
 {
 public:
 	Transform();
+	~Transform();
+	Transform(Transform&& other) noexcept;
+	Transform& operator=(Transform&& other) noexcept;
+	Transform(const Transform&) = delete;
+	Transform& operator=(const Transform&) = delete;
 
 	void SetPosition(float x, float y, float z);
 	void SetScale(float x, float y, float z);
+	void SetRotation(DirectX::XMFLOAT4 rotation); // A quaternion
 	void SetPitchYawRoll(float pitch, float yaw, float roll);
 
 	void MoveAbsolute(float x, float y, float z);
@@ -16,6 +28,7 @@ public:
 	void Scale(float x, float y, float z);
 
 	DirectX::XMFLOAT3 GetPosition();
+	DirectX::XMFLOAT4 GetRotation();
 	DirectX::XMFLOAT3 GetPitchYawRoll();
 	DirectX::XMFLOAT3 GetScale();
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
@@ -24,16 +37,13 @@ public:
 	DirectX::XMFLOAT3 GetUp();
 	DirectX::XMFLOAT3 GetForward();
 
-private:
-	void UpdateMatrices();
-
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTranspose;
+	// Makes position, rotation and scale relative to the parent (null
+	// detaches).  Returns false if the parent is this or under this.
+	bool SetParent(Transform* parent);
 
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 scale;
-	DirectX::XMFLOAT3 pitchYawRoll;
+	unsigned int GetHandle();
 
-	bool needsUpdate; // whether or not the world matrix needs to be updated
+private:
+	unsigned int handle;
 };
 
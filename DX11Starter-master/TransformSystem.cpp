@@ -0,0 +1,496 @@
+#include "TransformSystem.h"
+#include <math.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+// Singleton requirement
+TransformSystem* TransformSystem::instance;
+
+// Finds the lowest set bit, returning false if there isn't one
+static inline bool FindLowestBit(unsigned long bits, unsigned long& index)
+{
+#if defined(_MSC_VER)
+	return _BitScanForward(&index, bits) != 0;
+#else
+	if (bits == 0)
+		return false;
+	index = (unsigned long)__builtin_ctzl(bits);
+	return true;
+#endif
+}
+
+TransformSystem::TransformSystem()
+{
+	orderStale = false;
+}
+
+TransformSystem::~TransformSystem()
+{
+}
+
+unsigned int TransformSystem::Create()
+{
+	unsigned int handle;
+	if (freeHandles.size() > 0)
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else
+	{
+		// Everything's filled in below
+		handle = (unsigned int)positions.size();
+		positions.resize(handle + 1);
+		rotations.resize(handle + 1);
+		pitchYawRolls.resize(handle + 1);
+		scales.resize(handle + 1);
+		rights.resize(handle + 1);
+		ups.resize(handle + 1);
+		forwards.resize(handle + 1);
+		worldMatrices.resize(handle + 1);
+		worldInverseTransposes.resize(handle + 1);
+		parents.resize(handle + 1);
+		firstChildren.resize(handle + 1);
+		nextSiblings.resize(handle + 1);
+		live.resize(handle + 1);
+		orderIndices.resize(handle + 1);
+		subtreeSizes.resize(handle + 1);
+	}
+
+	positions[handle] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	rotations[handle] = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	pitchYawRolls[handle] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	scales[handle] = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	rights[handle] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+	ups[handle] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	forwards[handle] = XMFLOAT3(0.0f, 0.0f, 1.0f);
+	XMStoreFloat4x4(&worldMatrices[handle], XMMatrixIdentity());
+	XMStoreFloat4x4(&worldInverseTransposes[handle], XMMatrixIdentity());
+	parents[handle] = InvalidHandle;
+	firstChildren[handle] = InvalidHandle;
+	nextSiblings[handle] = InvalidHandle;
+	live[handle] = true;
+	subtreeSizes[handle] = 1;
+
+	// A new root goes on the end of the order, with nothing to rebuild
+	if (!orderStale)
+	{
+		orderIndices[handle] = (unsigned int)order.size();
+		order.push_back(handle);
+		if (order.size() > dirtyBits.size() * 32)
+			dirtyBits.push_back(0);
+		ClearDirty(handle);
+	}
+
+	return handle;
+}
+
+void TransformSystem::Destroy(unsigned int handle)
+{
+	if (handle >= positions.size() || !live[handle])
+		return;
+
+	// Nothing to rebuild for it anymore
+	if (!orderStale)
+		ClearDirty(handle);
+
+	// Children become roots, which moves them if this had moved them
+	while (firstChildren[handle] != InvalidHandle)
+	{
+		unsigned int child = firstChildren[handle];
+		Unlink(child);
+		MarkDirty(child);
+	}
+
+	Unlink(handle);
+	live[handle] = false;
+	freeHandles.push_back(handle);
+	orderStale = true;
+}
+
+void TransformSystem::SetPosition(unsigned int handle, const XMFLOAT3& position)
+{
+	positions[handle] = position;
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetRotation(unsigned int handle, const XMFLOAT4& rotation)
+{
+	XMStoreFloat4(&rotations[handle], XMQuaternionNormalize(XMLoadFloat4(&rotation)));
+	UpdateAxes(handle);
+
+	// The axes are rows of the rotation matrix, Rz(roll) * Rx(pitch) * Ry(yaw),
+	// which makes forward (sin(yaw)cos(pitch), -sin(pitch), cos(yaw)cos(pitch))
+	const XMFLOAT3& right = rights[handle];
+	const XMFLOAT3& up = ups[handle];
+	const XMFLOAT3& forward = forwards[handle];
+	XMFLOAT3& pitchYawRoll = pitchYawRolls[handle];
+	if (fabsf(forward.y) < 0.99999f)
+	{
+		pitchYawRoll.x = asinf(-forward.y);
+		pitchYawRoll.y = atan2f(forward.x, forward.z);
+		pitchYawRoll.z = atan2f(right.y, up.y);
+	}
+	else
+	{
+		// Looking straight up or down, where yaw and roll turn the same
+		// way, so it's all put in yaw
+		pitchYawRoll.x = forward.y < 0 ? XM_PIDIV2 : -XM_PIDIV2;
+		pitchYawRoll.y = atan2f(-right.z, right.x);
+		pitchYawRoll.z = 0.0f;
+	}
+
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetPitchYawRoll(unsigned int handle, const XMFLOAT3& pitchYawRoll)
+{
+	pitchYawRolls[handle] = pitchYawRoll;
+	XMStoreFloat4(&rotations[handle], XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll)));
+	UpdateAxes(handle);
+	MarkDirty(handle);
+}
+
+void TransformSystem::SetScale(unsigned int handle, const XMFLOAT3& scale)
+{
+	scales[handle] = scale;
+	MarkDirty(handle);
+}
+
+bool TransformSystem::SetParent(unsigned int handle, unsigned int parent)
+{
+	if (parents[handle] == parent)
+		return true;
+
+	// Can't end up as its own ancestor
+	for (unsigned int ancestor = parent; ancestor != InvalidHandle; ancestor = parents[ancestor])
+	{
+		if (ancestor == handle)
+			return false;
+	}
+
+	Unlink(handle);
+	if (parent != InvalidHandle)
+		Link(handle, parent);
+
+	orderStale = true;
+	MarkDirty(handle);
+	return true;
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorldMatrix(unsigned int handle)
+{
+	if (orderStale)
+		UpdateOrder();
+
+	if (IsDirty(handle))
+	{
+		// Dirty parents first, from the top down, which leaves
+		// their other children dirty for the next pass
+		scratch.clear();
+		for (unsigned int h = handle; h != InvalidHandle && IsDirty(h); h = parents[h])
+			scratch.push_back(h);
+
+		for (size_t i = scratch.size(); i > 0; i--)
+		{
+			Rebuild(scratch[i - 1]);
+			ClearDirty(scratch[i - 1]);
+		}
+	}
+
+	return worldMatrices[handle];
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorldInverseTransposeMatrix(unsigned int handle)
+{
+	GetWorldMatrix(handle);
+	return worldInverseTransposes[handle];
+}
+
+unsigned int TransformSystem::UpdateMatrices()
+{
+	if (orderStale)
+		UpdateOrder();
+
+	// Whole words of clean transforms are skipped at once, and each
+	// dirty bit in a word is found without testing the rest.  Going
+	// in order means any dirty parent is already done, and dirty
+	// transforms are rebuilt four at a time, still in order.
+	unsigned int rebuilt = 0;
+	unsigned int batch[4];
+	unsigned int batchCount = 0;
+	for (unsigned int word = 0; word < dirtyBits.size(); word++)
+	{
+		unsigned long bits = dirtyBits[word];
+		dirtyBits[word] = 0;
+
+		unsigned long bit;
+		while (FindLowestBit(bits, bit))
+		{
+			bits &= bits - 1;
+			batch[batchCount++] = order[word * 32 + bit];
+			if (batchCount == 4)
+			{
+				Rebuild4(batch);
+				batchCount = 0;
+			}
+			rebuilt++;
+		}
+	}
+
+	for (unsigned int i = 0; i < batchCount; i++)
+		Rebuild(batch[i]);
+
+	return rebuilt;
+}
+
+void TransformSystem::MarkDirty(unsigned int handle)
+{
+	// Places in the order aren't known until it's rebuilt
+	if (orderStale)
+	{
+		staleDirty.push_back(handle);
+		return;
+	}
+
+	// The subtree is one run of the order, so this is a range fill
+	unsigned int first = orderIndices[handle];
+	unsigned int end = first + subtreeSizes[handle];
+	while (first < end)
+	{
+		unsigned int word = first / 32;
+		unsigned int bit = first % 32;
+		unsigned int count = end - first < 32 - bit ? end - first : 32 - bit;
+		unsigned int mask = count == 32 ? 0xFFFFFFFF : ((1u << count) - 1) << bit;
+		dirtyBits[word] |= mask;
+		first += count;
+	}
+}
+
+void TransformSystem::Rebuild(unsigned int handle)
+{
+	// Scale, then rotate, then translate: the rotated axes, each
+	// scaled by its part of the scale, with the position below
+	const XMFLOAT3& scale = scales[handle];
+	XMMATRIX world;
+	world.r[0] = XMVectorScale(XMLoadFloat3(&rights[handle]), scale.x);
+	world.r[1] = XMVectorScale(XMLoadFloat3(&ups[handle]), scale.y);
+	world.r[2] = XMVectorScale(XMLoadFloat3(&forwards[handle]), scale.z);
+	world.r[3] = XMVectorSetW(XMLoadFloat3(&positions[handle]), 1.0f);
+	StoreMatrices(handle, world, InverseTransposeTRS(world));
+}
+
+// --------------------------------------------------------
+// Rebuild on four transforms at once.  Their local matrices
+// are built as in Rebuild, then turned so each vector holds
+// one component of all four, which lets InverseTransposeTRS's
+// dot products and divides run across the four together.
+// Parents are still applied one at a time, in the order
+// given, so a parent in the same batch is done first.
+// --------------------------------------------------------
+void TransformSystem::Rebuild4(const unsigned int* handles)
+{
+	XMMATRIX worlds[4];
+	for (int i = 0; i < 4; i++)
+	{
+		unsigned int handle = handles[i];
+		const XMFLOAT3& scale = scales[handle];
+		worlds[i].r[0] = XMVectorScale(XMLoadFloat3(&rights[handle]), scale.x);
+		worlds[i].r[1] = XMVectorScale(XMLoadFloat3(&ups[handle]), scale.y);
+		worlds[i].r[2] = XMVectorScale(XMLoadFloat3(&forwards[handle]), scale.z);
+		worlds[i].r[3] = XMVectorSetW(XMLoadFloat3(&positions[handle]), 1.0f);
+	}
+
+	// rows[r].r[c] is component c of row r of all four matrices
+	XMMATRIX rows[4];
+	for (int r = 0; r < 4; r++)
+	{
+		for (int i = 0; i < 4; i++)
+			rows[r].r[i] = worlds[i].r[r];
+		rows[r] = XMMatrixTranspose(rows[r]);
+	}
+
+	// Rows with (close to) no length need the general inverse
+	XMVECTOR lengthsSq[3];
+	for (int r = 0; r < 3; r++)
+	{
+		lengthsSq[r] = XMVectorMultiply(rows[r].r[0], rows[r].r[0]);
+		lengthsSq[r] = XMVectorMultiplyAdd(rows[r].r[1], rows[r].r[1], lengthsSq[r]);
+		lengthsSq[r] = XMVectorMultiplyAdd(rows[r].r[2], rows[r].r[2], lengthsSq[r]);
+	}
+	XMVECTOR shortest = XMVectorMin(lengthsSq[0], XMVectorMin(lengthsSq[1], lengthsSq[2]));
+	if (!XMVector4GreaterOrEqual(shortest, XMVectorReplicate(1e-12f)))
+	{
+		for (int i = 0; i < 4; i++)
+			StoreMatrices(handles[i], worlds[i], InverseTransposeTRS(worlds[i]));
+		return;
+	}
+
+	// Each row divided by its squared length, with the translation
+	// undone in the last column, then turned back to a matrix per vector
+	XMMATRIX inverseRows[3];
+	for (int r = 0; r < 3; r++)
+	{
+		for (int c = 0; c < 3; c++)
+			inverseRows[r].r[c] = XMVectorDivide(rows[r].r[c], lengthsSq[r]);
+
+		XMVECTOR translation = XMVectorMultiply(rows[3].r[0], inverseRows[r].r[0]);
+		translation = XMVectorMultiplyAdd(rows[3].r[1], inverseRows[r].r[1], translation);
+		translation = XMVectorMultiplyAdd(rows[3].r[2], inverseRows[r].r[2], translation);
+		inverseRows[r].r[3] = XMVectorNegate(translation);
+		inverseRows[r] = XMMatrixTranspose(inverseRows[r]);
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		XMMATRIX worldInverseTranspose;
+		worldInverseTranspose.r[0] = inverseRows[0].r[i];
+		worldInverseTranspose.r[1] = inverseRows[1].r[i];
+		worldInverseTranspose.r[2] = inverseRows[2].r[i];
+		worldInverseTranspose.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		StoreMatrices(handles[i], worlds[i], worldInverseTranspose);
+	}
+}
+
+void TransformSystem::StoreMatrices(unsigned int handle, FXMMATRIX localWorld, CXMMATRIX localWorldInverseTranspose)
+{
+	// The inverse transpose of (local * parent) is the product of theirs,
+	// so the parent's never needs inverting again
+	XMMATRIX world = localWorld;
+	XMMATRIX worldInverseTranspose = localWorldInverseTranspose;
+	if (parents[handle] != InvalidHandle)
+	{
+		world = world * XMLoadFloat4x4(&worldMatrices[parents[handle]]);
+		worldInverseTranspose = worldInverseTranspose * XMLoadFloat4x4(&worldInverseTransposes[parents[handle]]);
+	}
+
+	XMStoreFloat4x4(&worldMatrices[handle], world);
+	XMStoreFloat4x4(&worldInverseTransposes[handle], worldInverseTranspose);
+}
+
+// --------------------------------------------------------
+// Inverts and transposes a scale * rotation * translation
+// matrix without a general inverse.  Its first three rows
+// are at right angles, so each row divided by its squared
+// length undoes both the rotation and scale, and the last
+// column just undoes the translation.
+//
+// Falls back to the general inverse when a row has (close
+// to) no length, where there's no proper answer anyway.
+// --------------------------------------------------------
+XMMATRIX TransformSystem::InverseTransposeTRS(FXMMATRIX world)
+{
+	XMVECTOR lengthsSq[3];
+	for (int i = 0; i < 3; i++)
+	{
+		lengthsSq[i] = XMVector3Dot(world.r[i], world.r[i]);
+		if (XMVectorGetX(lengthsSq[i]) < 1e-12f)
+			return XMMatrixInverse(0, XMMatrixTranspose(world));
+	}
+
+	XMMATRIX result;
+	for (int i = 0; i < 3; i++)
+	{
+		XMVECTOR row = XMVectorDivide(world.r[i], lengthsSq[i]);
+		result.r[i] = XMVectorSetW(row, -XMVectorGetX(XMVector3Dot(world.r[3], row)));
+	}
+	result.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	return result;
+}
+
+void TransformSystem::UpdateAxes(unsigned int handle)
+{
+	XMMATRIX rotMat = XMMatrixRotationQuaternion(XMLoadFloat4(&rotations[handle]));
+	XMStoreFloat3(&rights[handle], rotMat.r[0]);
+	XMStoreFloat3(&ups[handle], rotMat.r[1]);
+	XMStoreFloat3(&forwards[handle], rotMat.r[2]);
+}
+
+void TransformSystem::Link(unsigned int handle, unsigned int parent)
+{
+	parents[handle] = parent;
+	nextSiblings[handle] = firstChildren[parent];
+	firstChildren[parent] = handle;
+}
+
+void TransformSystem::Unlink(unsigned int handle)
+{
+	unsigned int parent = parents[handle];
+	if (parent == InvalidHandle)
+		return;
+
+	unsigned int* link = &firstChildren[parent];
+	while (*link != handle)
+		link = &nextSiblings[*link];
+	*link = nextSiblings[handle];
+
+	parents[handle] = InvalidHandle;
+	nextSiblings[handle] = InvalidHandle;
+	orderStale = true;
+}
+
+// --------------------------------------------------------
+// Lays every live transform out depth first again, keeping
+// whatever was dirty dirty (now by its new place)
+// --------------------------------------------------------
+void TransformSystem::UpdateOrder()
+{
+	orderStale = false;
+
+	// What's dirty, by handle, since places are about to change
+	for (unsigned int word = 0; word < dirtyBits.size(); word++)
+	{
+		unsigned long bits = dirtyBits[word];
+		unsigned long bit;
+		while (FindLowestBit(bits, bit))
+		{
+			bits &= bits - 1;
+			unsigned int handle = order[word * 32 + bit];
+			if (live[handle])
+				staleDirty.push_back(handle);
+		}
+	}
+
+	// Roots in handle order, each followed by its subtree
+	order.clear();
+	for (unsigned int root = 0; root < (unsigned int)positions.size(); root++)
+	{
+		if (!live[root] || parents[root] != InvalidHandle)
+			continue;
+
+		scratch.clear();
+		scratch.push_back(root);
+		while (scratch.size() > 0)
+		{
+			unsigned int handle = scratch.back();
+			scratch.pop_back();
+
+			orderIndices[handle] = (unsigned int)order.size();
+			order.push_back(handle);
+			subtreeSizes[handle] = 1;
+
+			for (unsigned int child = firstChildren[handle]; child != InvalidHandle; child = nextSiblings[child])
+				scratch.push_back(child);
+		}
+	}
+
+	// Children come after their parents, so going backwards
+	// totals each subtree before it's added to its parent's
+	for (size_t i = order.size(); i > 0; i--)
+	{
+		unsigned int handle = order[i - 1];
+		if (parents[handle] != InvalidHandle)
+			subtreeSizes[parents[handle]] += subtreeSizes[handle];
+	}
+
+	dirtyBits.assign((order.size() + 31) / 32, 0);
+	for (unsigned int handle : staleDirty)
+	{
+		if (live[handle])
+			MarkDirty(handle);
+	}
+	staleDirty.clear();
+}
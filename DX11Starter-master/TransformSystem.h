@@ -0,0 +1,142 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Holds the data behind every Transform, one array per
+// field rather than one object per transform.  Changing a
+// transform only sets its bit in a dirty bitset, and
+// UpdateMatrices() rebuilds every dirty world and inverse
+// transpose matrix in one pass over the bitset, so drawing
+// just reads them.  Reading a dirty matrix before then
+// still works, rebuilding that one (and any dirty parents)
+// alone.
+//
+// Transforms can have a parent, which their position,
+// rotation and scale are relative to.  The hierarchy is
+// kept in depth-first order, so every subtree is one run
+// of that order with parents before their children.  The
+// dirty bits follow that order: a change marks its whole
+// subtree with a range fill, the pass rebuilds in order
+// (each parent before its children), and untouched runs
+// are skipped a word at a time.
+//
+// Rotations are stored as quaternions, along with the axes
+// they turn into, so neither reading a direction nor building
+// a matrix takes any trig.  Pitch, yaw and roll are kept next
+// to them for code that works in angles.
+//
+// Handles stay valid until destroyed, after which they're
+// handed out again by Create().
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	// Gets the one and only instance of this class
+	static TransformSystem& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new TransformSystem();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	TransformSystem(TransformSystem const&) = delete;
+	void operator=(TransformSystem const&) = delete;
+
+private:
+	static TransformSystem* instance;
+	TransformSystem();
+
+public:
+	~TransformSystem();
+
+	// A new transform at the origin, unrotated, unscaled and with no parent
+	unsigned int Create();
+
+	// Children of a destroyed transform lose their parent, keeping
+	// their own position, rotation and scale
+	void Destroy(unsigned int handle);
+
+	const DirectX::XMFLOAT3& GetPosition(unsigned int handle) { return positions[handle]; }
+	const DirectX::XMFLOAT4& GetRotation(unsigned int handle) { return rotations[handle]; }
+	const DirectX::XMFLOAT3& GetPitchYawRoll(unsigned int handle) { return pitchYawRolls[handle]; }
+	const DirectX::XMFLOAT3& GetScale(unsigned int handle) { return scales[handle]; }
+	void SetPosition(unsigned int handle, const DirectX::XMFLOAT3& position);
+	void SetRotation(unsigned int handle, const DirectX::XMFLOAT4& rotation);
+	void SetPitchYawRoll(unsigned int handle, const DirectX::XMFLOAT3& pitchYawRoll);
+	void SetScale(unsigned int handle, const DirectX::XMFLOAT3& scale);
+
+	// The rotated axes (relative to the parent, if any), kept up to date
+	// whenever the rotation is set
+	const DirectX::XMFLOAT3& GetRight(unsigned int handle) { return rights[handle]; }
+	const DirectX::XMFLOAT3& GetUp(unsigned int handle) { return ups[handle]; }
+	const DirectX::XMFLOAT3& GetForward(unsigned int handle) { return forwards[handle]; }
+
+	// InvalidHandle detaches.  Fails (returning false) if the parent is
+	// the transform itself or one of its descendants.
+	bool SetParent(unsigned int handle, unsigned int parent);
+	unsigned int GetParent(unsigned int handle) { return parents[handle]; }
+
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(unsigned int handle);
+	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix(unsigned int handle);
+
+	// Rebuilds the matrices of everything changed since the last call
+	// (and everything under it) and returns how many there were
+	unsigned int UpdateMatrices();
+
+	unsigned int GetCount() { return (unsigned int)positions.size() - (unsigned int)freeHandles.size(); }
+
+	// The inverse transpose of a scale * rotation * translation matrix, built
+	// straight from its rows rather than with a general inverse
+	static DirectX::XMMATRIX InverseTransposeTRS(DirectX::FXMMATRIX world);
+
+	static const unsigned int InvalidHandle = 0xFFFFFFFF;
+
+private:
+	// Dirty bits are by place in the order, not by handle
+	bool IsDirty(unsigned int handle) { unsigned int i = orderIndices[handle]; return (dirtyBits[i / 32] & (1u << (i % 32))) != 0; }
+	void ClearDirty(unsigned int handle) { unsigned int i = orderIndices[handle]; dirtyBits[i / 32] &= ~(1u << (i % 32)); }
+	void MarkDirty(unsigned int handle); // And everything under it
+
+	void Rebuild(unsigned int handle); // Assumes the parent is up to date, and leaves the dirty bit alone
+	void Rebuild4(const unsigned int* handles); // Rebuild on four at once, in order
+	void StoreMatrices(unsigned int handle, DirectX::FXMMATRIX localWorld, DirectX::CXMMATRIX localWorldInverseTranspose);
+	void UpdateAxes(unsigned int handle);
+	void Link(unsigned int handle, unsigned int parent);
+	void Unlink(unsigned int handle);
+	void UpdateOrder();
+
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT4> rotations;     // Quaternions, which everything else is built from
+	std::vector<DirectX::XMFLOAT3> pitchYawRolls; // The same rotations, as set or worked out from them
+	std::vector<DirectX::XMFLOAT3> scales;
+	std::vector<DirectX::XMFLOAT3> rights;
+	std::vector<DirectX::XMFLOAT3> ups;
+	std::vector<DirectX::XMFLOAT3> forwards;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposes;
+
+	// The hierarchy, by handle (InvalidHandle where there isn't one)
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> firstChildren;
+	std::vector<unsigned int> nextSiblings;
+	std::vector<bool> live;
+	std::vector<unsigned int> freeHandles;
+
+	// Every live handle depth first, each handle's place in that,
+	// and how many places its subtree (itself included) takes up.
+	// Reparenting or destroying only flags the order as stale, and
+	// it's rebuilt the next time it's needed.
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> orderIndices;
+	std::vector<unsigned int> subtreeSizes;
+	bool orderStale;
+	std::vector<unsigned int> staleDirty; // Marked while the order was stale
+
+	std::vector<unsigned int> dirtyBits; // One bit per place in the order, 32 to a word
+	std::vector<unsigned int> scratch;   // Reused by the depth-first walk and dirty parent chains
+};
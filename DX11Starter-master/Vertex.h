@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
 
 struct Vertex
 {
@@ -8,4 +9,16 @@ struct Vertex
 	DirectX::XMFLOAT3 Normal;
 	DirectX::XMFLOAT3 Tangent;
 	DirectX::XMFLOAT2 UV;
-};
\ No newline at end of file
+};
+
+// Compact 20 byte alternative to Vertex (44 bytes)
+// - Position is 16-bit normalized within the mesh's bounds
+// - Normal and tangent are octahedral encoded into 16-bit pairs
+// - UV is half precision
+struct PackedVertex
+{
+	DirectX::PackedVector::XMUSHORTN4 Position;
+	DirectX::PackedVector::XMSHORTN2 Normal;
+	DirectX::PackedVector::XMSHORTN2 Tangent;
+	DirectX::PackedVector::XMHALF2 UV;
+};
@@ -0,0 +1,144 @@
+#include "VertexPacking.h"
+#include <math.h>
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+PackedVertex VertexPacking::Encode(const Vertex& vertex, const BoundingBox& bounds)
+{
+	XMFLOAT3 offset = GetPositionOffset(bounds);
+	XMFLOAT3 scale = GetPositionScale(bounds);
+
+	PackedVertex packed;
+	XMStoreUShortN4(&packed.Position, XMVectorSet(
+		(vertex.Position.x - offset.x) / scale.x,
+		(vertex.Position.y - offset.y) / scale.y,
+		(vertex.Position.z - offset.z) / scale.z,
+		1.0f));
+
+	XMFLOAT2 normal = OctahedralEncode(vertex.Normal);
+	XMFLOAT2 tangent = OctahedralEncode(vertex.Tangent);
+	XMStoreShortN2(&packed.Normal, XMLoadFloat2(&normal));
+	XMStoreShortN2(&packed.Tangent, XMLoadFloat2(&tangent));
+	XMStoreHalf2(&packed.UV, XMLoadFloat2(&vertex.UV));
+	return packed;
+}
+
+Vertex VertexPacking::Decode(const PackedVertex& packed, const BoundingBox& bounds)
+{
+	XMFLOAT3 offset = GetPositionOffset(bounds);
+	XMFLOAT3 scale = GetPositionScale(bounds);
+
+	Vertex vertex;
+	XMStoreFloat3(&vertex.Position, XMVectorMultiplyAdd(XMLoadUShortN4(&packed.Position), XMLoadFloat3(&scale), XMLoadFloat3(&offset)));
+
+	XMFLOAT2 normal, tangent;
+	XMStoreFloat2(&normal, XMLoadShortN2(&packed.Normal));
+	XMStoreFloat2(&tangent, XMLoadShortN2(&packed.Tangent));
+	vertex.Normal = OctahedralDecode(normal);
+	vertex.Tangent = OctahedralDecode(tangent);
+	XMStoreFloat2(&vertex.UV, XMLoadHalf2(&packed.UV));
+	return vertex;
+}
+
+void VertexPacking::EncodeAll(const Vertex* vertices, int numVertices, const BoundingBox& bounds, std::vector<PackedVertex>& packed)
+{
+	packed.resize(numVertices);
+	for(int i = 0; i < numVertices; i++) {
+		packed[i] = Encode(vertices[i], bounds);
+	}
+}
+
+// --------------------------------------------------------
+// Round trips every vertex and records the worst error of
+// each attribute, so a mesh can be checked before it is
+// drawn with packed vertices
+// --------------------------------------------------------
+// Angle between two directions in degrees.  acos of the dot product
+// can't resolve angles under about 0.02 degrees in floats, which is
+// where packing errors are, so this takes atan2 of sine and cosine.
+static float AngleInDegrees(FXMVECTOR a, FXMVECTOR b)
+{
+	float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(a, b)));
+	float cosine = XMVectorGetX(XMVector3Dot(a, b));
+	return XMConvertToDegrees(atan2f(sine, cosine));
+}
+
+VertexPackingError VertexPacking::MeasureError(const Vertex* vertices, int numVertices, const BoundingBox& bounds)
+{
+	VertexPackingError error = {};
+	for(int i = 0; i < numVertices; i++) {
+		const Vertex& original = vertices[i];
+		Vertex decoded = Decode(Encode(original, bounds), bounds);
+
+		float position = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&decoded.Position), XMLoadFloat3(&original.Position))));
+		float uv = XMVectorGetX(XMVector2Length(XMVectorSubtract(XMLoadFloat2(&decoded.UV), XMLoadFloat2(&original.UV))));
+		error.MaxPositionError = fmaxf(error.MaxPositionError, position);
+		error.MaxUVError = fmaxf(error.MaxUVError, uv);
+
+		// Zero length directions (like missing normals) have no angle to lose
+		XMVECTOR normal = XMLoadFloat3(&original.Normal);
+		if(XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f) {
+			error.MaxNormalAngle = fmaxf(error.MaxNormalAngle, AngleInDegrees(normal, XMLoadFloat3(&decoded.Normal)));
+		}
+
+		XMVECTOR tangent = XMLoadFloat3(&original.Tangent);
+		if(XMVectorGetX(XMVector3LengthSq(tangent)) > 0.0f) {
+			error.MaxTangentAngle = fmaxf(error.MaxTangentAngle, AngleInDegrees(tangent, XMLoadFloat3(&decoded.Tangent)));
+		}
+	}
+	return error;
+}
+
+XMFLOAT3 VertexPacking::GetPositionOffset(const BoundingBox& bounds)
+{
+	return XMFLOAT3(
+		bounds.Center.x - bounds.Extents.x,
+		bounds.Center.y - bounds.Extents.y,
+		bounds.Center.z - bounds.Extents.z);
+}
+
+XMFLOAT3 VertexPacking::GetPositionScale(const BoundingBox& bounds)
+{
+	// Flat meshes still need a non-zero scale to divide by
+	const float minScale = 1e-6f;
+	return XMFLOAT3(
+		fmaxf(bounds.Extents.x * 2.0f, minScale),
+		fmaxf(bounds.Extents.y * 2.0f, minScale),
+		fmaxf(bounds.Extents.z * 2.0f, minScale));
+}
+
+// --------------------------------------------------------
+// Projects onto the octahedron |x| + |y| + |z| = 1, then
+// folds the lower half over the diagonals of the upper half
+// --------------------------------------------------------
+XMFLOAT2 VertexPacking::OctahedralEncode(const XMFLOAT3& direction)
+{
+	float sum = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	if(sum <= 0.0f) {
+		return XMFLOAT2(0.0f, 0.0f);
+	}
+
+	float x = direction.x / sum;
+	float y = direction.y / sum;
+	if(direction.z < 0.0f) {
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	return XMFLOAT2(x, y);
+}
+
+XMFLOAT3 VertexPacking::OctahedralDecode(const XMFLOAT2& encoded)
+{
+	XMFLOAT3 direction(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+	float fold = direction.z < 0.0f ? -direction.z : 0.0f;
+	direction.x += direction.x >= 0.0f ? -fold : fold;
+	direction.y += direction.y >= 0.0f ? -fold : fold;
+
+	float length = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+	direction.x /= length;
+	direction.y /= length;
+	direction.z /= length;
+	return direction;
+}
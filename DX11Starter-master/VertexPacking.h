@@ -0,0 +1,39 @@
+#pragma once
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Largest differences seen after packing and unpacking
+// --------------------------------------------------------
+struct VertexPackingError
+{
+	float MaxPositionError; // In model space units
+	float MaxNormalAngle;   // In degrees
+	float MaxTangentAngle;  // In degrees
+	float MaxUVError;
+};
+
+// --------------------------------------------------------
+// Converts between Vertex and PackedVertex.  Positions are
+// stored relative to the mesh bounds, so the shader needs
+// GetPositionOffset/GetPositionScale to rebuild them.
+// --------------------------------------------------------
+class VertexPacking
+{
+public:
+	static PackedVertex Encode(const Vertex& vertex, const DirectX::BoundingBox& bounds);
+	static Vertex Decode(const PackedVertex& packed, const DirectX::BoundingBox& bounds);
+	static void EncodeAll(const Vertex* vertices, int numVertices, const DirectX::BoundingBox& bounds, std::vector<PackedVertex>& packed);
+
+	static VertexPackingError MeasureError(const Vertex* vertices, int numVertices, const DirectX::BoundingBox& bounds);
+
+	// Unpacked position = packed position * scale + offset
+	static DirectX::XMFLOAT3 GetPositionOffset(const DirectX::BoundingBox& bounds);
+	static DirectX::XMFLOAT3 GetPositionScale(const DirectX::BoundingBox& bounds);
+
+	// Maps a unit vector onto an octahedron unfolded into [-1, 1]^2
+	static DirectX::XMFLOAT2 OctahedralEncode(const DirectX::XMFLOAT3& direction);
+	static DirectX::XMFLOAT3 OctahedralDecode(const DirectX::XMFLOAT2& encoded);
+};
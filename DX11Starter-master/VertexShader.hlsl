@@ -1,12 +1,17 @@
 #include "ShaderStructs.hlsli"
 
-cbuffer ExternalData : register(b0) { 
-	matrix world;
-	matrix worldInverseTranspose;
+// Split by how often each changes, so the camera goes up
+// once per frame and only the transforms for every entity
+cbuffer PerFrame : register(b0) {
 	matrix view;
 	matrix projection;
 }
 
+cbuffer PerObject : register(b1) {
+	matrix world;
+	matrix worldInverseTranspose;
+}
+
 struct VertexShaderInput
 { 
 	float3 localPosition: POSITION; // XYZ position